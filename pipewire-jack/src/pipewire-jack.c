@@ -122,8 +122,28 @@ typedef void (*mix_func) (float *dst, float *src[], uint32_t n_src, bool aligned
 
 static mix_func mix_function;
 
+#define KEY_ID		0
+#define KEY_SERIAL	1
+#define KEY_NAME	2
+#define KEY_ALIAS1	3
+#define KEY_ALIAS2	4
+#define KEY_SYSTEM	5
+#define KEY_LINK	6
+#define N_KEYS		7
+
+#define INDEX_SIZE	4096
+#define INDEX_MASK	(INDEX_SIZE-1)
+
+/* an entry in the object index, object is NULL when not indexed */
+struct object_key {
+	struct spa_list link;
+	struct object *object;
+	uint32_t hash;
+};
+
 struct object {
 	struct spa_list link;
+	struct object_key keys[N_KEYS];
 
 	struct client *client;
 
@@ -287,6 +307,9 @@ struct context {
 	pthread_mutex_t lock;		/* protects map and lists below, in addition to thread_lock */
 	struct spa_list objects;
 	uint32_t free_count;
+	struct spa_list *index;		/* INDEX_SIZE buckets of object_key */
+	struct pw_array sorted_ports;	/* visible ports in jack_get_ports() order */
+	bool ports_dirty;
 };
 
 #define GET_DIRECTION(f)	((f) & JackPortIsInput ? SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT)
@@ -485,6 +508,89 @@ int pw_jack_match_rules(const char *rules, size_t size, const struct spa_dict *p
 		int (*matched) (void *data, const char *action, const char *val, int len),
 		void *data);
 
+static inline uint32_t hash_u32(uint32_t hash, uint32_t val)
+{
+	hash ^= val;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	return hash ^ (hash >> 16);
+}
+
+static inline uint32_t hash_str(const char *str)
+{
+	uint32_t hash = 2166136261u;
+	while (*str)
+		hash = (hash ^ (uint8_t)*str++) * 16777619u;
+	return hash;
+}
+
+static inline struct spa_list *index_bucket(struct client *c, uint32_t hash)
+{
+	return &c->context.index[hash & INDEX_MASK];
+}
+
+static void index_key(struct client *c, struct object *o, uint32_t key,
+		bool valid, uint32_t hash)
+{
+	struct object_key *k = &o->keys[key];
+
+	if (k->object != NULL) {
+		if (valid && k->hash == hash)
+			return;
+		spa_list_remove(&k->link);
+		k->object = NULL;
+	}
+	if (valid) {
+		k->object = o;
+		k->hash = hash;
+		spa_list_append(index_bucket(c, hash), &k->link);
+	}
+}
+
+/* (re)index the object after its id, serial, names or link ports changed,
+ * must be called with the context lock */
+static void index_object(struct client *c, struct object *o)
+{
+	bool port = o->type == INTERFACE_Port && !o->removed;
+	bool node = o->type == INTERFACE_Node && !o->removed;
+	bool link = o->type == INTERFACE_Link && !o->removed;
+
+	index_key(c, o, KEY_ID, o->id != SPA_ID_INVALID,
+			hash_u32(KEY_ID, o->id));
+	index_key(c, o, KEY_SERIAL, o->serial != SPA_ID_INVALID,
+			hash_u32(KEY_SERIAL, o->serial));
+	if (node)
+		index_key(c, o, KEY_NAME, o->node.name[0] != '\0',
+				hash_str(o->node.name));
+	else
+		index_key(c, o, KEY_NAME, port && o->port.name[0] != '\0',
+				port ? hash_str(o->port.name) : 0);
+	index_key(c, o, KEY_ALIAS1, port && o->port.alias1[0] != '\0',
+			port ? hash_str(o->port.alias1) : 0);
+	index_key(c, o, KEY_ALIAS2, port && o->port.alias2[0] != '\0',
+			port ? hash_str(o->port.alias2) : 0);
+	index_key(c, o, KEY_SYSTEM, port && o->port.system[0] != '\0',
+			port ? hash_str(o->port.system) : 0);
+	index_key(c, o, KEY_LINK, link,
+			link ? hash_u32(hash_u32(KEY_LINK, o->port_link.src), o->port_link.dst) : 0);
+
+	if (o->type == INTERFACE_Port)
+		c->context.ports_dirty = true;
+}
+
+static void unindex_object(struct object *o)
+{
+	uint32_t i;
+	for (i = 0; i < N_KEYS; i++) {
+		struct object_key *k = &o->keys[i];
+		if (k->object != NULL) {
+			spa_list_remove(&k->link);
+			k->object = NULL;
+		}
+	}
+}
+
 static struct object * alloc_object(struct client *c, int type)
 {
 	struct object *o;
@@ -521,6 +627,7 @@ static void recycle_objects(struct client *c, uint32_t remain)
 			pw_log_debug("%p: recycle object:%p type:%d id:%u/%u",
 					c, o, o->type, o->id, o->serial);
 			spa_list_remove(&o->link);
+			unindex_object(o);
 			memset(o, 0, sizeof(struct object));
 			spa_list_append(&globals.free_objects, &o->link);
 			if (--c->context.free_count == remain)
@@ -540,6 +647,7 @@ static void free_object(struct client *c, struct object *o)
 	spa_list_remove(&o->link);
 	o->removed = true;
 	o->id = SPA_ID_INVALID;
+	index_object(c, o);
 	spa_list_append(&c->context.objects, &o->link);
 	if (++c->context.free_count > RECYCLE_THRESHOLD)
 		recycle_objects(c, RECYCLE_THRESHOLD / 2);
@@ -756,10 +864,13 @@ static void free_port(struct client *c, struct port *p, bool free)
 
 static struct object *find_node(struct client *c, const char *name)
 {
-	struct object *o;
+	uint32_t hash = hash_str(name);
+	struct object_key *k;
 
-	spa_list_for_each(o, &c->context.objects, link) {
-		if (o->removing || o->removed || o->type != INTERFACE_Node)
+	spa_list_for_each(k, index_bucket(c, hash), link) {
+		struct object *o = k->object;
+		if (k->hash != hash || o->removing || o->removed ||
+		    o->type != INTERFACE_Node)
 			continue;
 		if (spa_streq(o->node.name, name))
 			return o;
@@ -791,10 +902,12 @@ static inline bool client_port_visible(struct client *c, struct object *o)
 
 static struct object *find_port_by_name(struct client *c, const char *name)
 {
-	struct object *o;
+	uint32_t hash = hash_str(name);
+	struct object_key *k;
 
-	spa_list_for_each(o, &c->context.objects, link) {
-		if (o->type != INTERFACE_Port || o->removed ||
+	spa_list_for_each(k, index_bucket(c, hash), link) {
+		struct object *o = k->object;
+		if (k->hash != hash || o->type != INTERFACE_Port || o->removed ||
 		    (!client_port_visible(c, o)))
 			continue;
 		if (spa_streq(o->port.name, name) ||
@@ -809,20 +922,22 @@ static struct object *find_port_by_name(struct client *c, const char *name)
 
 static struct object *find_by_id(struct client *c, uint32_t id)
 {
-	struct object *o;
-	spa_list_for_each(o, &c->context.objects, link) {
-		if (o->id == id)
-			return o;
+	uint32_t hash = hash_u32(KEY_ID, id);
+	struct object_key *k;
+	spa_list_for_each(k, index_bucket(c, hash), link) {
+		if (k->hash == hash && k->object->id == id)
+			return k->object;
 	}
 	return NULL;
 }
 
 static struct object *find_by_serial(struct client *c, uint32_t serial)
 {
-	struct object *o;
-	spa_list_for_each(o, &c->context.objects, link) {
-		if (o->serial == serial)
-			return o;
+	uint32_t hash = hash_u32(KEY_SERIAL, serial);
+	struct object_key *k;
+	spa_list_for_each(k, index_bucket(c, hash), link) {
+		if (k->hash == hash && k->object->serial == serial)
+			return k->object;
 	}
 	return NULL;
 }
@@ -845,10 +960,12 @@ static struct object *find_type(struct client *c, uint32_t id, uint32_t type, bo
 
 static struct object *find_link(struct client *c, uint32_t src, uint32_t dst)
 {
-	struct object *l;
+	uint32_t hash = hash_u32(hash_u32(KEY_LINK, src), dst);
+	struct object_key *k;
 
-	spa_list_for_each(l, &c->context.objects, link) {
-		if (l->type != INTERFACE_Link || l->removed)
+	spa_list_for_each(k, index_bucket(c, hash), link) {
+		struct object *l = k->object;
+		if (k->hash != hash || l->type != INTERFACE_Link || l->removed)
 			continue;
 		if (l->port_link.src == src &&
 		    l->port_link.dst == dst) {
@@ -1120,6 +1237,7 @@ static int queue_notify(struct client *c, int type, struct object *o, int arg1,
 	case NOTIFY_TYPE_PORTREGISTRATION:
 		emit = c->portregistration_callback != NULL && o != NULL;
 		o->visible = arg1;
+		c->context.ports_dirty = true;
 		break;
 	case NOTIFY_TYPE_CONNECT:
 		emit = c->connect_callback != NULL && o != NULL;
@@ -3133,6 +3251,8 @@ static int metadata_property(void *data, uint32_t id,
 	pw_log_debug("set id:%u key:'%s' value:'%s' type:'%s'", id, key, value, type);
 
 	if (id == PW_ID_CORE) {
+		/* the default ports are sorted first */
+		c->context.ports_dirty = true;
 		if (key == NULL || spa_streq(key, "default.audio.sink")) {
 			if (value != NULL) {
 				if (json_object_find(value, "name",
@@ -3190,6 +3310,7 @@ static void metadata_proxy_destroy(void *data)
 	spa_hook_remove(&c->metadata->proxy_listener);
 	spa_hook_remove(&c->metadata->listener);
 	c->metadata = NULL;
+	c->context.ports_dirty = true;
 }
 
 static const struct pw_proxy_events metadata_proxy_events = {
@@ -3645,6 +3766,10 @@ static void registry_event_global(void *data, uint32_t id,
 	o->id = id;
 	o->serial = serial;
 
+	pthread_mutex_lock(&c->context.lock);
+	index_object(c, o);
+	pthread_mutex_unlock(&c->context.lock);
+
 	switch (o->type) {
 	case INTERFACE_Node:
 		pw_log_info("%p: client added \"%s\" emit:%d", c, o->node.name, do_emit);
@@ -3701,6 +3826,7 @@ static void registry_event_global_remove(void *data, uint32_t id)
 				c->metadata->default_audio_sink[0] = '\0';
 			if (spa_streq(o->node.node_name, c->metadata->default_audio_source))
 				c->metadata->default_audio_source[0] = '\0';
+			c->context.ports_dirty = true;
 		}
 		if (find_node(c, o->node.name) == NULL) {
 			pw_log_info("%p: client %u removed \"%s\"", c, o->id, o->node.name);
@@ -3777,6 +3903,7 @@ jack_client_t * jack_client_open (const char *client_name,
 	struct spa_cpu *cpu_iface;
 	const struct pw_properties *props;
 	va_list ap;
+	uint32_t i;
 
         if (getenv("PIPEWIRE_NOJACK") != NULL ||
             getenv("PIPEWIRE_INTERNAL") != NULL ||
@@ -3799,6 +3926,7 @@ jack_client_t * jack_client_open (const char *client_name,
 
 	pthread_mutex_init(&client->context.lock, NULL);
 	spa_list_init(&client->context.objects);
+	pw_array_init(&client->context.sorted_ports, sizeof(void*) * 64);
 
 	client->node_id = SPA_ID_INVALID;
 
@@ -3819,6 +3947,12 @@ jack_client_t * jack_client_open (const char *client_name,
 	spa_list_init(&client->rt.target_links);
 	pthread_mutex_init(&client->rt_lock, NULL);
 
+	client->context.index = calloc(INDEX_SIZE, sizeof(struct spa_list));
+	if (client->context.index == NULL)
+		goto no_props;
+	for (i = 0; i < INDEX_SIZE; i++)
+		spa_list_init(&client->context.index[i]);
+
 	if (client->server_name != NULL &&
 	    spa_streq(client->server_name, "default"))
 		client->server_name = NULL;
@@ -4148,6 +4282,9 @@ int jack_client_close (jack_client_t *client)
 		free_object(c, o);
 	recycle_objects(c, 0);
 
+	pw_array_clear(&c->context.sorted_ports);
+	free(c->context.index);
+
 	pw_map_clear(&c->ports[SPA_DIRECTION_INPUT]);
 	pw_map_clear(&c->ports[SPA_DIRECTION_OUTPUT]);
 
@@ -4966,6 +5103,10 @@ jack_port_t * jack_port_register (jack_client_t *client,
 	strcpy(o->port.name, name);
 	o->port.type_id = type_id;
 
+	pthread_mutex_lock(&c->context.lock);
+	index_object(c, o);
+	pthread_mutex_unlock(&c->context.lock);
+
 	init_buffer(p);
 
 	if (direction == SPA_DIRECTION_INPUT) {
@@ -5589,7 +5730,11 @@ int jack_port_rename (jack_client_t* client, jack_port_t *port, const char *port
 	}
 
 	pw_properties_set(p->props, PW_KEY_PORT_NAME, port_name);
+
+	pthread_mutex_lock(&c->context.lock);
 	snprintf(o->port.name, sizeof(o->port.name), "%s:%s", c->name, port_name);
+	index_object(c, o);
+	pthread_mutex_unlock(&c->context.lock);
 
 	p->info.change_mask |= SPA_PORT_CHANGE_MASK_PROPS;
 	p->info.props = &p->props->dict;
@@ -5632,6 +5777,7 @@ int jack_port_set_alias (jack_port_t *port, const char *alias)
 		goto done;
 	}
 
+	pthread_mutex_lock(&c->context.lock);
 	if (o->port.alias1[0] == '\0') {
 		key = PW_KEY_OBJECT_PATH;
 		snprintf(o->port.alias1, sizeof(o->port.alias1), "%s", alias);
@@ -5641,9 +5787,12 @@ int jack_port_set_alias (jack_port_t *port, const char *alias)
 		snprintf(o->port.alias2, sizeof(o->port.alias2), "%s", alias);
 	}
 	else {
+		pthread_mutex_unlock(&c->context.lock);
 		res = -1;
 		goto done;
 	}
+	index_object(c, o);
+	pthread_mutex_unlock(&c->context.lock);
 
 	pw_properties_set(p->props, key, alias);
 
@@ -6243,6 +6392,37 @@ static int port_compare_func(const void *v1, const void *v2)
 	return res;
 }
 
+/* sort the visible ports once, jack_get_ports() only filters them after that,
+ * must be called with the context lock */
+static void update_sorted_ports(struct client *c)
+{
+	struct object *o;
+	uint32_t count;
+
+	if (!c->context.ports_dirty)
+		return;
+	c->context.ports_dirty = false;
+
+	pw_array_reset(&c->context.sorted_ports);
+	spa_list_for_each(o, &c->context.objects, link) {
+		if (o->type != INTERFACE_Port || o->removed || !o->visible)
+			continue;
+		if (o->port.type_id > TYPE_ID_VIDEO)
+			continue;
+		pw_array_add_ptr(&c->context.sorted_ports, o);
+	}
+	count = pw_array_get_len(&c->context.sorted_ports, struct object *);
+	if (count > 1)
+		qsort(c->context.sorted_ports.data, count,
+				sizeof(struct object *), port_compare_func);
+}
+
+/* a pattern without special characters matches like a substring */
+static inline bool is_plain_pattern(const char *pattern)
+{
+	return strpbrk(pattern, "^$.[]|()?*+{}\\") == NULL;
+}
+
 SPA_EXPORT
 const char ** jack_get_ports (jack_client_t *client,
                               const char *port_name_pattern,
@@ -6251,19 +6431,22 @@ const char ** jack_get_ports (jack_client_t *client,
 {
 	struct client *c = (struct client *) client;
 	const char **res;
-	struct object *o;
+	struct object *o, **op;
 	struct pw_array tmp;
 	const char *str;
 	uint32_t i, count;
 	int r;
 	regex_t port_regex, type_regex;
+	bool port_plain = false;
 
 	return_val_if_fail(c != NULL, NULL);
 
 	str = getenv("PIPEWIRE_NODE");
 
 	if (port_name_pattern && port_name_pattern[0]) {
-		if ((r = regcomp(&port_regex, port_name_pattern, REG_EXTENDED | REG_NOSUB)) != 0) {
+		port_plain = is_plain_pattern(port_name_pattern);
+		if (!port_plain &&
+		    (r = regcomp(&port_regex, port_name_pattern, REG_EXTENDED | REG_NOSUB)) != 0) {
 			pw_log_error("cant compile regex %s: %d", port_name_pattern, r);
 			return NULL;
 		}
@@ -6271,6 +6454,8 @@ const char ** jack_get_ports (jack_client_t *client,
 	if (type_name_pattern && type_name_pattern[0]) {
 		if ((r = regcomp(&type_regex, type_name_pattern, REG_EXTENDED | REG_NOSUB)) != 0) {
 			pw_log_error("cant compile regex %s: %d", type_name_pattern, r);
+			if (port_name_pattern && port_name_pattern[0] && !port_plain)
+				regfree(&port_regex);
 			return NULL;
 		}
 	}
@@ -6279,16 +6464,15 @@ const char ** jack_get_ports (jack_client_t *client,
 			port_name_pattern, type_name_pattern, flags);
 
 	pthread_mutex_lock(&c->context.lock);
+	update_sorted_ports(c);
+
 	pw_array_init(&tmp, sizeof(void*) * 32);
 	count = 0;
 
-	spa_list_for_each(o, &c->context.objects, link) {
-		if (o->type != INTERFACE_Port || o->removed || !o->visible)
-			continue;
+	pw_array_for_each(op, &c->context.sorted_ports) {
+		o = *op;
 		pw_log_debug("%p: check port type:%d flags:%08lx name:\"%s\"", c,
 				o->port.type_id, o->port.flags, o->port.name);
-		if (o->port.type_id > TYPE_ID_VIDEO)
-			continue;
 		if (!SPA_FLAG_IS_SET(o->port.flags, flags))
 			continue;
 		if (str != NULL && o->port.node != NULL) {
@@ -6299,9 +6483,15 @@ const char ** jack_get_ports (jack_client_t *client,
 
 		if (port_name_pattern && port_name_pattern[0]) {
 			bool match;
-			match = regexec(&port_regex, o->port.name, 0, NULL, 0) == 0;
-			if (!match && is_port_default(c, o))
-				match = regexec(&port_regex, o->port.system, 0, NULL, 0) == 0;
+			if (port_plain) {
+				match = strstr(o->port.name, port_name_pattern) != NULL;
+				if (!match && is_port_default(c, o))
+					match = strstr(o->port.system, port_name_pattern) != NULL;
+			} else {
+				match = regexec(&port_regex, o->port.name, 0, NULL, 0) == 0;
+				if (!match && is_port_default(c, o))
+					match = regexec(&port_regex, o->port.system, 0, NULL, 0) == 0;
+			}
 			if (!match)
 				continue;
 		}
@@ -6319,7 +6509,6 @@ const char ** jack_get_ports (jack_client_t *client,
 	pthread_mutex_unlock(&c->context.lock);
 
 	if (count > 0) {
-		qsort(tmp.data, count, sizeof(struct object *), port_compare_func);
 		pw_array_add_ptr(&tmp, NULL);
 		res = tmp.data;
 		for (i = 0; i < count; i++)
@@ -6329,7 +6518,7 @@ const char ** jack_get_ports (jack_client_t *client,
 		res = NULL;
 	}
 
-	if (port_name_pattern && port_name_pattern[0])
+	if (port_name_pattern && port_name_pattern[0] && !port_plain)
 		regfree(&port_regex);
 	if (type_name_pattern && type_name_pattern[0])
 		regfree(&type_regex);
@@ -0,0 +1,214 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "pipewire-jack.c"
+
+static struct client *make_client(void)
+{
+	struct client *c;
+	uint32_t i;
+
+	c = calloc(1, sizeof(*c));
+	spa_assert_se(c != NULL);
+	pthread_mutex_init(&c->context.lock, NULL);
+	spa_list_init(&c->context.objects);
+	pw_array_init(&c->context.sorted_ports, sizeof(void*) * 64);
+	c->context.index = calloc(INDEX_SIZE, sizeof(struct spa_list));
+	spa_assert_se(c->context.index != NULL);
+	for (i = 0; i < INDEX_SIZE; i++)
+		spa_list_init(&c->context.index[i]);
+	return c;
+}
+
+static void destroy_client(struct client *c)
+{
+	struct object *o, *t;
+
+	/* free_object() moves the objects to the end of the list, it does
+	 * not recycle while there are few removed objects */
+	recycle_objects(c, 0);
+	spa_list_for_each_safe(o, t, &c->context.objects, link) {
+		if (!o->removed)
+			free_object(c, o);
+	}
+	recycle_objects(c, 0);
+	spa_assert_se(spa_list_is_empty(&c->context.objects));
+	pw_array_clear(&c->context.sorted_ports);
+	free(c->context.index);
+	pthread_mutex_destroy(&c->context.lock);
+	free(c);
+}
+
+/* like registry_event_global(), the objects are indexed once the id and
+ * serial are known */
+static struct object *add_node(struct client *c, uint32_t id, uint32_t serial,
+		const char *name)
+{
+	struct object *o = alloc_object(c, INTERFACE_Node);
+	spa_assert_se(o != NULL);
+	snprintf(o->node.name, sizeof(o->node.name), "%s", name);
+
+	pthread_mutex_lock(&c->context.lock);
+	spa_list_append(&c->context.objects, &o->link);
+	o->id = id;
+	o->serial = serial;
+	index_object(c, o);
+	pthread_mutex_unlock(&c->context.lock);
+	return o;
+}
+
+static struct object *add_port(struct client *c, uint32_t id, uint32_t serial,
+		const char *name, const char *alias)
+{
+	struct object *o = alloc_object(c, INTERFACE_Port);
+	spa_assert_se(o != NULL);
+	snprintf(o->port.name, sizeof(o->port.name), "%s", name);
+	snprintf(o->port.alias1, sizeof(o->port.alias1), "%s", alias);
+	o->visible = true;
+
+	pthread_mutex_lock(&c->context.lock);
+	spa_list_append(&c->context.objects, &o->link);
+	o->id = id;
+	o->serial = serial;
+	index_object(c, o);
+	pthread_mutex_unlock(&c->context.lock);
+	return o;
+}
+
+static struct object *add_link(struct client *c, uint32_t id, uint32_t serial,
+		uint32_t src, uint32_t dst)
+{
+	struct object *o = alloc_object(c, INTERFACE_Link);
+	spa_assert_se(o != NULL);
+	o->port_link.src = src;
+	o->port_link.dst = dst;
+
+	pthread_mutex_lock(&c->context.lock);
+	spa_list_append(&c->context.objects, &o->link);
+	o->id = id;
+	o->serial = serial;
+	index_object(c, o);
+	pthread_mutex_unlock(&c->context.lock);
+	return o;
+}
+
+static void test_lookup(void)
+{
+	struct client *c = make_client();
+	struct object *n, *p1, *p2, *l;
+
+	n = add_node(c, 10, 100, "system");
+	p1 = add_port(c, 11, 101, "system:playback_1", "alsa:out_1");
+	p2 = add_port(c, 12, 102, "system:playback_2", "alsa:out_2");
+	l = add_link(c, 13, 103, 11, 12);
+
+	spa_assert_se(find_by_id(c, 10) == n);
+	spa_assert_se(find_by_id(c, 11) == p1);
+	spa_assert_se(find_by_id(c, 12) == p2);
+	spa_assert_se(find_by_id(c, 13) == l);
+	spa_assert_se(find_by_id(c, 14) == NULL);
+	spa_assert_se(find_by_serial(c, 102) == p2);
+	spa_assert_se(find_by_serial(c, 104) == NULL);
+	spa_assert_se(find_type(c, 11, INTERFACE_Port, true) == p1);
+	spa_assert_se(find_type(c, 11, INTERFACE_Node, true) == NULL);
+
+	spa_assert_se(find_node(c, "system") == n);
+	spa_assert_se(find_node(c, "system:playback_1") == NULL);
+	spa_assert_se(find_port_by_name(c, "system:playback_1") == p1);
+	spa_assert_se(find_port_by_name(c, "alsa:out_2") == p2);
+	spa_assert_se(find_port_by_name(c, "system") == NULL);
+
+	spa_assert_se(find_link(c, 11, 12) == l);
+	spa_assert_se(find_link(c, 12, 11) == NULL);
+
+	/* a renamed port is only found by its new name */
+	pthread_mutex_lock(&c->context.lock);
+	snprintf(p1->port.name, sizeof(p1->port.name), "system:front_left");
+	index_object(c, p1);
+	pthread_mutex_unlock(&c->context.lock);
+	spa_assert_se(find_port_by_name(c, "system:playback_1") == NULL);
+	spa_assert_se(find_port_by_name(c, "system:front_left") == p1);
+	spa_assert_se(find_port_by_name(c, "alsa:out_1") == p1);
+
+	destroy_client(c);
+}
+
+static void test_remove(void)
+{
+	struct client *c = make_client();
+	struct object *p1, *p2, *l1, *l2;
+
+	p1 = add_port(c, 11, 101, "system:playback_1", "");
+	l1 = add_link(c, 12, 102, 11, 20);
+
+	free_object(c, l1);
+	free_object(c, p1);
+
+	/* removed objects are only found by serial until they are recycled */
+	spa_assert_se(find_by_id(c, 11) == NULL);
+	spa_assert_se(find_by_id(c, 12) == NULL);
+	spa_assert_se(find_port_by_name(c, "system:playback_1") == NULL);
+	spa_assert_se(find_link(c, 11, 20) == NULL);
+	spa_assert_se(find_by_serial(c, 101) == p1);
+	spa_assert_se(find_by_serial(c, 102) == l1);
+
+	/* the ids are reused for new objects */
+	p2 = add_port(c, 11, 103, "system:playback_1", "");
+	l2 = add_link(c, 12, 104, 11, 20);
+	spa_assert_se(p2 != p1);
+	spa_assert_se(find_by_id(c, 11) == p2);
+	spa_assert_se(find_by_id(c, 12) == l2);
+	spa_assert_se(find_port_by_name(c, "system:playback_1") == p2);
+	spa_assert_se(find_link(c, 11, 20) == l2);
+	spa_assert_se(find_by_serial(c, 101) == p1);
+	spa_assert_se(find_by_serial(c, 103) == p2);
+
+	destroy_client(c);
+}
+
+static void test_recycle(void)
+{
+	struct client *c = make_client();
+	struct object *o, *objs[8];
+	uint32_t i, j, serial = 1000;
+	char name[64];
+
+	/* add and remove the same ids until the removed objects are recycled
+	 * and their memory is used for the new objects */
+	for (i = 0; i < 4 * RECYCLE_THRESHOLD; i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(objs); j++) {
+			snprintf(name, sizeof(name), "client:port_%u", j);
+			objs[j] = add_port(c, 50 + j, serial++, name, "");
+		}
+		for (j = 0; j < SPA_N_ELEMENTS(objs); j++) {
+			snprintf(name, sizeof(name), "client:port_%u", j);
+			spa_assert_se(find_by_id(c, 50 + j) == objs[j]);
+			spa_assert_se(find_by_serial(c, objs[j]->serial) == objs[j]);
+			spa_assert_se(find_port_by_name(c, name) == objs[j]);
+		}
+		for (j = 0; j < SPA_N_ELEMENTS(objs); j++)
+			free_object(c, objs[j]);
+		for (j = 0; j < SPA_N_ELEMENTS(objs); j++)
+			spa_assert_se(find_by_id(c, 50 + j) == NULL);
+	}
+	spa_assert_se(c->context.free_count <= RECYCLE_THRESHOLD);
+
+	/* the recycled objects are not found anymore */
+	spa_assert_se(find_by_serial(c, 1000) == NULL);
+	spa_assert_se(find_port_by_name(c, "client:port_0") == NULL);
+	spa_list_for_each(o, &c->context.objects, link) {
+		spa_assert_se(o->removed);
+		spa_assert_se(find_by_serial(c, o->serial) == o);
+	}
+	destroy_client(c);
+}
+
+int main(int argc, char *argv[])
+{
+	test_lookup();
+	test_remove();
+	test_recycle();
+
+	return 0;
+}
@@ -49,7 +49,11 @@ enum spa_profiler {
 							  *      Long : driver awake,
 							  *      Long : driver finish,
 							  *      Int : driver status),
-							  *      Fraction : latency))  */
+							  *      Fraction : latency,
+							  *      Int : xrun-count,
+							  *      Long : wakeup p50, p99, p99.9, max,
+							  *      Long : process p50, p99, p99.9, max,
+							  *      Long : cycle p50, p99, p99.9, max))  */
 
 	SPA_PROFILER_START_Follower	= 0x20000,	/**< follower related profiler properties */
 	SPA_PROFILER_followerBlock,			/**< generic follower info block
@@ -61,7 +65,14 @@ enum spa_profiler {
 							  *      Long : awake,
 							  *      Long : finish,
 							  *      Int : status,
-							  *      Fraction : latency))  */
+							  *      Fraction : latency,
+							  *      Int : xrun-count,
+							  *      Long : wakeup p50, p99, p99.9, max,
+							  *      Long : process p50, p99, p99.9, max,
+							  *      Long : cycle p50, p99, p99.9, max))
+							  *  The latencies are in nanoseconds, from the
+							  *  histograms of the node, 0 when the node has
+							  *  none. */
 
 	SPA_PROFILER_START_CUSTOM	= 0x1000000,
 };
@@ -117,6 +117,7 @@ static inline int spa_thread_utils_drop_rt(struct spa_thread_utils *o,
 
 #define SPA_KEY_THREAD_NAME		"thread.name"		/* the thread name */
 #define SPA_KEY_THREAD_STACK_SIZE	"thread.stack-size"	/* the stack size of the thread */
+#define SPA_KEY_THREAD_AFFINITY		"thread.affinity"	/* array of CPUs to run the thread on */
 
 /**
  * \}
@@ -47,6 +47,10 @@ static struct spa_log_topic log_topic = SPA_LOG_TOPIC(0, "spa.audioconvert");
 #define MAX_DATAS	SPA_AUDIO_MAX_CHANNELS
 #define MAX_PORTS	(SPA_AUDIO_MAX_CHANNELS+1)
 
+/* bytes of intermediate float data per block, half of a typical L1 */
+#define DEFAULT_BLOCK_SIZE	16384
+#define MIN_BLOCK_SAMPLES	128
+
 #define DEFAULT_MUTE		false
 #define DEFAULT_VOLUME		VOLUME_NORM
 #define DEFAULT_MIN_VOLUME	0.0
@@ -238,6 +242,9 @@ struct impl {
 	unsigned int rate_adjust:1;
 	unsigned int port_ignore_latency:1;
 
+	uint32_t block_size;		/* bytes of intermediate data per block, 0 disables */
+	uint32_t block_samples;		/* samples per block, 0 when not blocking */
+
 	uint32_t scratch_size;
 	uint32_t scratch_ports;
 	float *empty;
@@ -1653,6 +1660,20 @@ static int setup_resample(struct impl *this)
 	this->resample.quality = this->props.resample_quality;
 	this->resample.cpu_flags = this->cpu_flags;
 
+	/* planar integer input can be converted by the resampler when
+	 * there is nothing to mix */
+	switch (in->format.info.raw.format) {
+	case SPA_AUDIO_FORMAT_S16P:
+	case SPA_AUDIO_FORMAT_S24P:
+	case SPA_AUDIO_FORMAT_S24_32P:
+	case SPA_AUDIO_FORMAT_S32P:
+		this->resample.format = in->format.info.raw.format;
+		break;
+	default:
+		this->resample.format = 0;
+		break;
+	}
+
 	this->rate_adjust = this->props.rate != 1.0;
 
 	if (this->resample_peaks)
@@ -1879,6 +1900,14 @@ static int setup_convert(struct impl *this)
 	if ((res = ensure_tmp(this, maxsize, maxports)) < 0)
 		return res;
 
+	/* size the blocks so that the ping-pong buffers of all channels stay in
+	 * the cache between the stages, keep them aligned for the SIMD kernels */
+	this->block_samples = this->block_size / (maxports * sizeof(float) * 2);
+	this->block_samples = SPA_ROUND_DOWN(this->block_samples, MAX_ALIGN / sizeof(float));
+	if (this->block_samples < MIN_BLOCK_SAMPLES)
+		this->block_samples = this->block_size > 0 ? MIN_BLOCK_SAMPLES : 0;
+	spa_log_debug(this->log, "%p: block samples %d", this, this->block_samples);
+
 	this->setup = true;
 
 	emit_node_info(this, false);
@@ -2787,12 +2816,136 @@ static uint64_t get_time_ns(struct impl *impl)
 	return SPA_TIMESPEC_TO_NSEC(&now);
 }
 
+/* Run all the stages on blocks of the quantum so that the intermediate data
+ * stays in the cache. The input conversion and a channelmix that only scales
+ * the channels are done in one pass when the converter supports it, other
+ * matrices use the channelmix stage. With resample_convert, the input stage
+ * is passthrough and the resampler converts the input. Interleaved formats
+ * have one data for all channels, n_src_datas and n_dst_datas are the real
+ * number of datas. Returns the number of output samples, the consumed input
+ * samples are returned in in_len. */
+static uint32_t process_blocks(struct impl *this,
+		const void *src_datas[], const uint32_t src_strides[], uint32_t n_src_datas,
+		uint32_t n_samples,
+		void *dst_datas[], const uint32_t dst_strides[], uint32_t n_dst_datas,
+		uint32_t n_out,
+		bool in_passthrough, bool mix_passthrough, bool resample_passthrough,
+		bool resample_convert, bool out_passthrough, uint32_t *in_len)
+{
+	struct dir *in = &this->dir[SPA_DIRECTION_INPUT];
+	struct dir *out = &this->dir[SPA_DIRECTION_OUTPUT];
+	const void *block_src[MAX_PORTS], **in_datas;
+	void *block_dst[MAX_PORTS], *remap_datas[MAX_PORTS], *remap_dst[MAX_PORTS];
+	void **out_datas;
+	float volumes[MAX_PORTS];
+	uint32_t i, in_done = 0, out_done = 0, n_in, n_produced, n_dst;
+	bool fused;
+	int tmp;
+
+	fused = !in_passthrough && !mix_passthrough &&
+		in->conv.process_vol != NULL && channelmix_is_copy(&this->mix);
+	if (fused) {
+		for (i = 0; i < in->conv.n_channels; i++) {
+			uint32_t c = in->need_remap ? in->remap[i] : i;
+			volumes[i] = this->mix.matrix[c][c];
+		}
+	}
+	n_dst = out_passthrough ? out->conv.n_channels : 0;
+
+	while (in_done < n_samples && out_done < n_out) {
+		n_in = SPA_MIN(this->block_samples, n_samples - in_done);
+		if (resample_passthrough)
+			n_in = SPA_MIN(n_in, n_out - out_done);
+
+		for (i = 0; i < n_src_datas; i++)
+			block_src[i] = SPA_PTROFF(src_datas[i], in_done * src_strides[i], void);
+		for (i = 0; i < n_dst; i++) {
+			uint32_t c = out->need_remap ? out->remap[i] : i;
+			block_dst[i] = SPA_PTROFF(dst_datas[c], out_done * dst_strides[c], void);
+		}
+		tmp = 0;
+
+		/* the last active stage writes to the output directly when the
+		 * output conversion is passthrough */
+		if (fused) {
+			/* convert and mix in one pass, the mix stage is skipped */
+			if (resample_passthrough && out_passthrough)
+				out_datas = block_dst;
+			else
+				out_datas = (void **)this->tmp_datas[(tmp++) & 1];
+
+			for (i = 0; i < in->conv.n_channels; i++)
+				remap_datas[i] = out_datas[in->need_remap ? in->remap[i] : i];
+			convert_process_vol(&in->conv, remap_datas, block_src, volumes, n_in);
+		} else if (!in_passthrough) {
+			if (mix_passthrough && resample_passthrough && out_passthrough)
+				out_datas = block_dst;
+			else
+				out_datas = (void **)this->tmp_datas[(tmp++) & 1];
+
+			for (i = 0; i < in->conv.n_channels; i++)
+				remap_datas[i] = out_datas[in->need_remap ? in->remap[i] : i];
+			convert_process(&in->conv, remap_datas, block_src, n_in);
+		} else {
+			if (in->need_remap) {
+				for (i = 0; i < in->conv.n_channels; i++)
+					remap_datas[in->remap[i]] = (void *)block_src[i];
+				out_datas = remap_datas;
+			} else {
+				out_datas = (void **)block_src;
+			}
+		}
+		if (!mix_passthrough && !fused) {
+			in_datas = (const void**)out_datas;
+			if (resample_passthrough && out_passthrough)
+				out_datas = block_dst;
+			else
+				out_datas = (void **)this->tmp_datas[(tmp++) & 1];
+			channelmix_process(&this->mix, out_datas, in_datas, n_in);
+		}
+		if (!resample_passthrough) {
+			in_datas = (const void**)out_datas;
+			if (out_passthrough)
+				out_datas = block_dst;
+			else
+				out_datas = (void **)this->tmp_datas[(tmp++) & 1];
+
+			n_produced = n_out - out_done;
+			if (resample_convert)
+				resample_process_convert(&this->resample, in_datas, &n_in,
+						out_datas, &n_produced);
+			else
+				resample_process(&this->resample, in_datas, &n_in,
+						out_datas, &n_produced);
+		} else {
+			n_produced = n_in;
+		}
+		if (!out_passthrough) {
+			for (i = 0; i < out->conv.n_channels; i++) {
+				uint32_t c = out->need_remap ? out->remap[i] : i;
+				remap_dst[c] = out_datas[i];
+			}
+			for (i = 0; i < n_dst_datas; i++)
+				block_dst[i] = SPA_PTROFF(dst_datas[i], out_done * dst_strides[i], void);
+			convert_process(&out->conv, block_dst, (const void**)remap_dst, n_produced);
+		}
+		in_done += n_in;
+		out_done += n_produced;
+
+		if (n_in == 0 && n_produced == 0)
+			break;
+	}
+	*in_len = in_done;
+	return out_done;
+}
+
 static int impl_node_process(void *object)
 {
 	struct impl *this = object;
 	const void *src_datas[MAX_PORTS], **in_datas;
 	void *dst_datas[MAX_PORTS], *remap_src_datas[MAX_PORTS], *remap_dst_datas[MAX_PORTS];
 	void **out_datas, **dst_remap;
+	uint32_t src_strides[MAX_PORTS], dst_strides[MAX_PORTS];
 	uint32_t i, j, n_src_datas = 0, n_dst_datas = 0, n_mon_datas = 0, remap;
 	uint32_t n_samples, max_in, n_out, max_out, quant_samples;
 	struct port *port, *ctrlport = NULL;
@@ -2800,7 +2953,8 @@ static int impl_node_process(void *object)
 	struct spa_data *bd;
 	struct dir *dir;
 	int tmp = 0, res = 0, suppressed;
-	bool in_passthrough, mix_passthrough, resample_passthrough, out_passthrough;
+	bool in_passthrough, mix_passthrough, resample_passthrough, resample_convert;
+	bool out_passthrough;
 	bool in_avail = false, flush_in = false, flush_out = false;
 	bool draining = false, in_empty = this->out_offset == 0;
 	struct spa_io_buffers *io, *ctrlio = NULL;
@@ -2884,6 +3038,7 @@ static int impl_node_process(void *object)
 				} else {
 					remap = n_src_datas++;
 					src_datas[remap] = SPA_PTR_ALIGN(this->empty, MAX_ALIGN, void);
+					src_strides[remap] = port->stride;
 					spa_log_trace_fp(this->log, "%p: empty input %d->%d", this,
 							i * port->blocks + j, remap);
 					max_in = SPA_MIN(max_in, this->scratch_size / port->stride);
@@ -2920,6 +3075,7 @@ static int impl_node_process(void *object)
 					remap = n_src_datas++;
 					offs += this->in_offset * port->stride;
 					src_datas[remap] = SPA_PTROFF(bd->data, offs, void);
+					src_strides[remap] = port->stride;
 
 					spa_log_trace_fp(this->log, "%p: input %d:%d:%d %d %d %d->%d", this,
 							offs, size, port->stride, this->in_offset, max_in,
@@ -2985,6 +3141,7 @@ static int impl_node_process(void *object)
 				} else {
 					remap = n_dst_datas++;
 					dst_datas[remap] = SPA_PTR_ALIGN(this->scratch, MAX_ALIGN, void);
+					dst_strides[remap] = port->stride;
 					spa_log_trace_fp(this->log, "%p: empty output %d->%d", this,
 						i * port->blocks + j, remap);
 					max_out = SPA_MIN(max_out, this->scratch_size / port->stride);
@@ -3028,6 +3185,7 @@ static int impl_node_process(void *object)
 					remap = n_dst_datas++;
 					dst_datas[remap] = SPA_PTROFF(bd->data,
 							this->out_offset * port->stride, void);
+					dst_strides[remap] = port->stride;
 					max_out = SPA_MIN(max_out, bd->maxsize / port->stride);
 
 					spa_log_trace_fp(this->log, "%p: output %d offs:%d %d->%d", this,
@@ -3064,6 +3222,12 @@ static int impl_node_process(void *object)
 	mix_passthrough = SPA_FLAG_IS_SET(this->mix.flags, CHANNELMIX_FLAG_IDENTITY) &&
 		(ctrlport == NULL || ctrlport->ctrl == NULL) && (this->vol_ramp_sequence == NULL);
 
+	/* the resampler converts the input, skip the input conversion */
+	resample_convert = !in_passthrough && mix_passthrough && !resample_passthrough &&
+		this->resample.process_convert != NULL;
+	if (resample_convert)
+		in_passthrough = true;
+
 	out_passthrough = dir->conv.is_passthrough;
 	if (in_passthrough && mix_passthrough && resample_passthrough)
 		out_passthrough = false;
@@ -3081,6 +3245,26 @@ static int impl_node_process(void *object)
 	if (this->direction == SPA_DIRECTION_INPUT)
 		handle_wav(this, src_datas, n_samples);
 
+	/* when more than one stage does work on a large quantum, process in
+	 * blocks so that the intermediate data does not leave the cache */
+	if (this->block_samples > 0 && n_samples > this->block_samples &&
+	    (ctrlport == NULL || ctrlport->ctrl == NULL) &&
+	    this->vol_ramp_sequence == NULL &&
+	    (!in_passthrough + !mix_passthrough + !resample_passthrough + !out_passthrough) >= 2) {
+		uint32_t in_len;
+
+		n_samples = process_blocks(this, src_datas, src_strides, n_src_datas, n_samples,
+				dst_datas, dst_strides, n_dst_datas, n_out,
+				in_passthrough, mix_passthrough,
+				resample_passthrough, resample_convert,
+				out_passthrough, &in_len);
+		spa_log_trace_fp(this->log, "%p: blocks of %d %d -> %d", this,
+				this->block_samples, in_len, n_samples);
+		this->in_offset += in_len;
+		this->out_offset += n_samples;
+		goto done;
+	}
+
 	dir = &this->dir[SPA_DIRECTION_INPUT];
 	if (!in_passthrough) {
 		if (mix_passthrough && resample_passthrough && out_passthrough)
@@ -3150,9 +3334,15 @@ static int impl_node_process(void *object)
 
 		in_len = n_samples;
 		out_len = n_out;
-		resample_process(&this->resample, in_datas, &in_len, out_datas, &out_len);
-		spa_log_trace_fp(this->log, "%p: resample %d/%d -> %d/%d %d", this,
-				n_samples, in_len, n_out, out_len, out_passthrough);
+		if (resample_convert)
+			resample_process_convert(&this->resample, in_datas, &in_len,
+					out_datas, &out_len);
+		else
+			resample_process(&this->resample, in_datas, &in_len,
+					out_datas, &out_len);
+		spa_log_trace_fp(this->log, "%p: resample %d/%d -> %d/%d %d %d", this,
+				n_samples, in_len, n_out, out_len, resample_convert,
+				out_passthrough);
 		this->in_offset += in_len;
 		n_samples = out_len;
 	} else {
@@ -3175,6 +3365,7 @@ static int impl_node_process(void *object)
 		spa_log_trace_fp(this->log, "%p: output convert %d", this, n_samples);
 		convert_process(&dir->conv, dst_datas, in_datas, n_samples);
 	}
+done:
 	if (this->direction == SPA_DIRECTION_OUTPUT)
 		handle_wav(this, (const void**)dst_datas, n_samples);
 
@@ -3382,6 +3573,7 @@ impl_init(const struct spa_handle_factory *factory,
 
 	this->rate_limit.interval = 2 * SPA_NSEC_PER_SEC;
 	this->rate_limit.burst = 1;
+	this->block_size = DEFAULT_BLOCK_SIZE;
 
 	this->mix.options = CHANNELMIX_OPTION_UPMIX | CHANNELMIX_OPTION_MIX_LFE;
 	this->mix.upmix = CHANNELMIX_UPMIX_NONE;
@@ -3401,6 +3593,8 @@ impl_init(const struct spa_handle_factory *factory,
 		else if (spa_streq(k, "resample.prefill"))
 			SPA_FLAG_UPDATE(this->resample.options,
 				RESAMPLE_OPTION_PREFILL, spa_atob(s));
+		else if (spa_streq(k, "convert.block-size"))
+			spa_atou32(s, &this->block_size, 0);
 		else if (spa_streq(k, "factory.mode")) {
 			if (spa_streq(s, "merge"))
 				this->direction = SPA_DIRECTION_OUTPUT;
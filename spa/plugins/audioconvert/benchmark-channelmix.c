@@ -0,0 +1,196 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <spa/support/log-impl.h>
+
+SPA_LOG_IMPL(logger);
+
+#include "test-helper.h"
+#include "channelmix-ops.h"
+
+static uint32_t cpu_flags;
+
+typedef void (*channelmix_func_t) (struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples);
+
+struct stats {
+	uint32_t n_samples;
+	uint32_t src_chan;
+	uint32_t dst_chan;
+	uint32_t density;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_SAMPLES	4096
+#define MAX_CHANNELS	64
+
+#define MAX_COUNT 100
+
+static float samp_in[MAX_CHANNELS][MAX_SAMPLES] SPA_ALIGNED(64);
+static float samp_out[MAX_CHANNELS][MAX_SAMPLES] SPA_ALIGNED(64);
+
+static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
+static const struct {
+	uint32_t src_chan;
+	uint32_t dst_chan;
+	/* fraction of non-zero coefficients in percent */
+	uint32_t density;
+} layouts[] = {
+	{ 8, 2, 100 },
+	{ 16, 16, 100 },
+	{ 16, 16, 25 },
+	{ 32, 8, 100 },
+	{ 64, 64, 100 },
+	{ 64, 64, 10 },
+};
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(layouts) * 10
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+static struct channelmix mix;
+
+static void setup_matrix(uint32_t src_chan, uint32_t dst_chan, uint32_t density)
+{
+	uint32_t i, j;
+
+	spa_zero(mix);
+	mix.src_chan = src_chan;
+	mix.dst_chan = dst_chan;
+	mix.log = &logger.log;
+	mix.cpu_flags = cpu_flags;
+	spa_assert_se(channelmix_init(&mix) == 0);
+
+	srand48(0);
+	for (i = 0; i < dst_chan; i++) {
+		for (j = 0; j < src_chan; j++) {
+			if (i == j || drand48() * 100.0 < density)
+				mix.matrix_orig[i][j] = drand48() - 0.5f;
+			else
+				mix.matrix_orig[i][j] = 0.0f;
+		}
+	}
+	channelmix_set_volume(&mix, 1.0f, false, 0, NULL);
+}
+
+static void run_test1(const char *name, const char *impl, channelmix_func_t func,
+		uint32_t src_chan, uint32_t dst_chan, uint32_t density, int n_samples)
+{
+	int i, j;
+	const void *ip[src_chan];
+	void *op[dst_chan];
+	struct timespec ts;
+	uint64_t count, t1, t2;
+
+	setup_matrix(src_chan, dst_chan, density);
+
+	for (j = 0; j < (int)src_chan; j++)
+		ip[j] = samp_in[j];
+	for (j = 0; j < (int)dst_chan; j++)
+		op[j] = samp_out[j];
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		func(&mix, op, ip, n_samples);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	channelmix_free(&mix);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.src_chan = src_chan,
+		.dst_chan = dst_chan,
+		.density = density,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test(const char *name, const char *impl, channelmix_func_t func)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(sample_sizes, s) {
+		SPA_FOR_EACH_ELEMENT_VAR(layouts, l) {
+			run_test1(name, impl, func, l->src_chan, l->dst_chan,
+					l->density, *s);
+		}
+	}
+}
+
+static void test_n_m(void)
+{
+	run_test("test_f32_n_m", "c", channelmix_f32_n_m_c);
+#if defined (HAVE_SSE)
+	if (cpu_flags & SPA_CPU_FLAG_SSE) {
+		run_test("test_f32_n_m", "sse", channelmix_f32_n_m_sse);
+	}
+#endif
+#if defined (HAVE_AVX) && defined (HAVE_FMA)
+	if (SPA_FLAG_IS_SET(cpu_flags, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3)) {
+		run_test("test_f32_n_m", "avx", channelmix_f32_n_m_avx);
+	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32_n_m", "avx512", channelmix_f32_n_m_avx512);
+	}
+#endif
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
+	if ((diff = a->src_chan - b->src_chan) != 0) return diff;
+	if ((diff = a->dst_chan - b->dst_chan) != 0) return diff;
+	if ((diff = a->density - b->density) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i, j;
+
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
+	for (i = 0; i < MAX_CHANNELS; i++)
+		for (j = 0; j < MAX_SAMPLES; j++)
+			samp_in[i][j] = (drand48() - 0.5f) * 2.0f;
+
+	test_n_m();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t samples %d, src %d, dst %d, density %d%%\n",
+				s->perf, s->name, s->impl, s->n_samples, s->src_chan, s->dst_chan,
+				s->density);
+	}
+	return 0;
+}
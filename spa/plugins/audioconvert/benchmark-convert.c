@@ -0,0 +1,245 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "test-helper.h"
+#include "fmt-ops.h"
+#include "channelmix-ops.h"
+
+static uint32_t cpu_flags;
+
+typedef void (*convert_func_t) (struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples);
+typedef void (*convert_vol_func_t) (struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], const float *volumes, uint32_t n_samples);
+typedef void (*mix_func_t) (struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples);
+
+struct stats {
+	uint32_t n_samples;
+	uint32_t n_channels;
+	uint32_t block;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_SAMPLES	8192
+#define MAX_CHANNELS	8
+#define BLOCK_SAMPLES	256
+
+#define MAX_COUNT 200
+
+static int16_t samp_in[MAX_SAMPLES * MAX_CHANNELS];
+static float samp_tmp[2][MAX_SAMPLES * MAX_CHANNELS];
+static int16_t samp_out[MAX_SAMPLES * MAX_CHANNELS];
+
+static const int sample_sizes[] = { 256, 1024, 4096, 8192 };
+static const int channel_counts[] = { 2, 6, 8 };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 16
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+static struct convert conv_in, conv_out;
+static struct channelmix mix;
+static float volumes[MAX_CHANNELS];
+
+static void add_result(const char *name, const char *impl, uint32_t n_channels,
+		uint32_t n_samples, uint32_t block, uint64_t count, uint64_t t1, uint64_t t2)
+{
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.n_channels = n_channels,
+		.block = block,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void setup(uint32_t n_channels)
+{
+	uint32_t i;
+
+	conv_in.n_channels = n_channels;
+	conv_out.n_channels = n_channels;
+
+	spa_zero(mix);
+	mix.src_chan = mix.dst_chan = n_channels;
+	for (i = 0; i < n_channels; i++)
+		mix.matrix[i][i] = volumes[i] = 0.5f + i * 0.1f;
+}
+
+/* s16 -> f32d -> volume -> s16, one stage at a time over the complete
+ * quantum or over blocks of the quantum */
+static void run_pipeline(const char *name, const char *impl,
+		convert_func_t in_func, mix_func_t mix_func, convert_func_t out_func,
+		uint32_t n_channels, uint32_t n_samples, uint32_t block)
+{
+	uint32_t j, offs, n;
+	const void *ip[1], *tp[n_channels];
+	void *op[1], *t0[n_channels], *t1[n_channels];
+	uint64_t count, start;
+
+	setup(n_channels);
+
+	start = get_time();
+	for (count = 0; count < MAX_COUNT; count++) {
+		for (offs = 0; offs < n_samples; offs += n) {
+			n = SPA_MIN(block, n_samples - offs);
+
+			ip[0] = &samp_in[offs * n_channels];
+			op[0] = &samp_out[offs * n_channels];
+			for (j = 0; j < n_channels; j++) {
+				t0[j] = &samp_tmp[0][j * n_samples + offs];
+				t1[j] = &samp_tmp[1][j * n_samples + offs];
+				tp[j] = t1[j];
+			}
+			in_func(&conv_in, t0, ip, n);
+			mix_func(&mix, t1, (const void **)t0, n);
+			out_func(&conv_out, op, tp, n);
+		}
+	}
+	add_result(name, impl, n_channels, n_samples, block, count, start, get_time());
+}
+
+/* the input conversion and the volume in separate passes or fused */
+static void run_fused(const char *name, const char *impl,
+		convert_vol_func_t func, uint32_t n_channels, uint32_t n_samples)
+{
+	uint32_t j;
+	const void *ip[1];
+	void *op[n_channels];
+	uint64_t count, start;
+
+	setup(n_channels);
+
+	ip[0] = samp_in;
+	for (j = 0; j < n_channels; j++)
+		op[j] = &samp_tmp[0][j * n_samples];
+
+	start = get_time();
+	for (count = 0; count < MAX_COUNT; count++)
+		func(&conv_in, op, ip, volumes, n_samples);
+	add_result(name, impl, n_channels, n_samples, n_samples, count, start, get_time());
+}
+
+static void run_separate(const char *name, const char *impl,
+		convert_func_t in_func, mix_func_t mix_func, uint32_t n_channels, uint32_t n_samples)
+{
+	uint32_t j;
+	const void *ip[1], *tp[n_channels];
+	void *t0[n_channels], *t1[n_channels];
+	uint64_t count, start;
+
+	setup(n_channels);
+
+	ip[0] = samp_in;
+	for (j = 0; j < n_channels; j++) {
+		tp[j] = t0[j] = &samp_tmp[0][j * n_samples];
+		t1[j] = &samp_tmp[1][j * n_samples];
+	}
+
+	start = get_time();
+	for (count = 0; count < MAX_COUNT; count++) {
+		in_func(&conv_in, t0, ip, n_samples);
+		mix_func(&mix, t1, tp, n_samples);
+	}
+	add_result(name, impl, n_channels, n_samples, n_samples, count, start, get_time());
+}
+
+static void test_blocks(void)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(sample_sizes, s) {
+		SPA_FOR_EACH_ELEMENT_VAR(channel_counts, c) {
+			run_pipeline("test_pipeline", "c", conv_s16_to_f32d_c,
+					channelmix_copy_c, conv_f32d_to_s16_c, *c, *s, *s);
+			run_pipeline("test_pipeline", "c", conv_s16_to_f32d_c,
+					channelmix_copy_c, conv_f32d_to_s16_c, *c, *s, BLOCK_SAMPLES);
+#if defined (HAVE_SSE2) && defined (HAVE_SSE)
+			if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+				run_pipeline("test_pipeline", "sse2", conv_s16_to_f32d_sse2,
+						channelmix_copy_sse, conv_f32d_to_s16_sse2, *c, *s, *s);
+				run_pipeline("test_pipeline", "sse2", conv_s16_to_f32d_sse2,
+						channelmix_copy_sse, conv_f32d_to_s16_sse2, *c, *s, BLOCK_SAMPLES);
+			}
+#endif
+		}
+	}
+}
+
+static void test_fused(void)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(sample_sizes, s) {
+		SPA_FOR_EACH_ELEMENT_VAR(channel_counts, c) {
+			run_separate("test_s16_f32d_vol", "c", conv_s16_to_f32d_c,
+					channelmix_copy_c, *c, *s);
+			run_fused("test_s16_f32d_vol", "c-fused", conv_s16_to_f32d_vol_c, *c, *s);
+#if defined (HAVE_SSE2) && defined (HAVE_SSE)
+			if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+				run_separate("test_s16_f32d_vol", "sse2", conv_s16_to_f32d_sse2,
+						channelmix_copy_sse, *c, *s);
+				run_fused("test_s16_f32d_vol", "sse2-fused",
+						conv_s16_to_f32d_vol_sse2, *c, *s);
+				if (*c == 2)
+					run_fused("test_s16_f32d_vol", "sse2-fused-2",
+							conv_s16_to_f32d_vol_2_sse2, *c, *s);
+			}
+#endif
+		}
+	}
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
+	if ((diff = a->n_channels - b->n_channels) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
+	for (i = 0; i < SPA_N_ELEMENTS(samp_in); i++)
+		samp_in[i] = (int16_t)(i * 7919);
+
+	test_fused();
+	test_blocks();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %-12.12s \t samples %d, channels %d, block %d\n",
+				s->perf, s->name, s->impl, s->n_samples, s->n_channels, s->block);
+	}
+	return 0;
+}
@@ -11,8 +11,11 @@
 #include <errno.h>
 #include <time.h>
 
+#include <spa/param/audio/raw.h>
+
 #include "test-helper.h"
 #include "resample.h"
+#include "fmt-ops.h"
 
 #define MAX_SAMPLES	4096
 #define MAX_CHANNELS	11
@@ -33,13 +36,14 @@ struct stats {
 
 static float samp_in[MAX_SAMPLES * MAX_CHANNELS];
 static float samp_out[MAX_SAMPLES * MAX_CHANNELS];
+static int16_t samp_in_s16[MAX_SAMPLES * MAX_CHANNELS];
 
 static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
 static const int in_rates[] = { 44100, 44100, 48000, 96000, 22050, 96000 };
 static const int out_rates[] = { 44100, 48000, 44100, 48000, 48000, 44100 };
 
 
-#define MAX_RESAMPLER	5
+#define MAX_RESAMPLER	8
 #define MAX_SIZES	SPA_N_ELEMENTS(sample_sizes)
 #define MAX_RATES	SPA_N_ELEMENTS(in_rates)
 #define MAX_RESULTS	MAX_RESAMPLER * MAX_SIZES * MAX_RATES
@@ -47,9 +51,12 @@ static const int out_rates[] = { 44100, 48000, 44100, 48000, 48000, 44100 };
 static uint32_t n_results = 0;
 static struct stats results[MAX_RESULTS];
 
-static void run_test1(const char *name, const char *impl, struct resample *r, int n_samples)
+/* with convert set, the input is S16 and converted to float in a separate
+ * pass before resampling, like audioconvert does */
+static void run_test1(const char *name, const char *impl, struct resample *r, int n_samples,
+		bool convert)
 {
-	uint32_t i, j;
+	uint32_t i, j, k;
 	const void *ip[MAX_CHANNELS];
 	void *op[MAX_CHANNELS];
 	struct timespec ts;
@@ -57,7 +64,10 @@ static void run_test1(const char *name, const char *impl, struct resample *r, in
 	uint32_t in_len, out_len;
 
 	for (j = 0; j < r->channels; j++) {
-		ip[j] = &samp_in[j * MAX_SAMPLES];
+		if (r->format == SPA_AUDIO_FORMAT_S16P)
+			ip[j] = &samp_in_s16[j * MAX_SAMPLES];
+		else
+			ip[j] = &samp_in[j * MAX_SAMPLES];
 		op[j] = &samp_out[j * MAX_SAMPLES];
 	}
 
@@ -66,9 +76,20 @@ static void run_test1(const char *name, const char *impl, struct resample *r, in
 
 	count = 0;
 	for (i = 0; i < MAX_COUNT; i++) {
+		if (convert) {
+			for (j = 0; j < r->channels; j++) {
+				const int16_t *s = &samp_in_s16[j * MAX_SAMPLES];
+				float *d = &samp_in[j * MAX_SAMPLES];
+				for (k = 0; k < (uint32_t)n_samples; k++)
+					d[k] = S16_TO_F32(s[k]);
+			}
+		}
 		in_len = n_samples;
 		out_len = MAX_SAMPLES;
-		resample_process(r, ip, &in_len, op, &out_len);
+		if (r->process_convert)
+			resample_process_convert(r, ip, &in_len, op, &out_len);
+		else
+			resample_process(r, ip, &in_len, op, &out_len);
 		count++;
 	}
 	clock_gettime(CLOCK_MONOTONIC, &ts);
@@ -91,7 +112,39 @@ static void run_test(const char *name, const char *impl, struct resample *r)
 {
 	size_t i;
 	for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++)
-		run_test1(name, impl, r, sample_sizes[i]);
+		run_test1(name, impl, r, sample_sizes[i], false);
+}
+
+/* compare converting S16 in a separate pass with converting while resampling */
+static void run_test_s16(uint32_t flags)
+{
+	struct resample r;
+	uint32_t i, j;
+
+	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
+		spa_zero(r);
+		r.channels = 2;
+		r.cpu_flags = flags;
+		r.i_rate = in_rates[i];
+		r.o_rate = out_rates[i];
+		r.quality = RESAMPLE_DEFAULT_QUALITY;
+		resample_native_init(&r);
+		for (j = 0; j < SPA_N_ELEMENTS(sample_sizes); j++)
+			run_test1("native", "s16+convert", &r, sample_sizes[j], true);
+		resample_free(&r);
+
+		spa_zero(r);
+		r.channels = 2;
+		r.cpu_flags = flags;
+		r.i_rate = in_rates[i];
+		r.o_rate = out_rates[i];
+		r.quality = RESAMPLE_DEFAULT_QUALITY;
+		r.format = SPA_AUDIO_FORMAT_S16P;
+		resample_native_init(&r);
+		for (j = 0; j < SPA_N_ELEMENTS(sample_sizes); j++)
+			run_test1("native", "s16-fused", &r, sample_sizes[j], false);
+		resample_free(&r);
+	}
 }
 
 static int compare_func(const void *_a, const void *_b)
@@ -172,6 +225,23 @@ int main(int argc, char *argv[])
 	}
 #endif
 
+#if defined (HAVE_AVX512)
+	if (SPA_FLAG_IS_SET(cpu_flags, SPA_CPU_FLAG_AVX512)) {
+		for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
+			spa_zero(r);
+			r.channels = 2;
+			r.cpu_flags = SPA_CPU_FLAG_AVX512;
+			r.i_rate = in_rates[i];
+			r.o_rate = out_rates[i];
+			r.quality = RESAMPLE_DEFAULT_QUALITY;
+			resample_native_init(&r);
+			run_test("native", "avx512", &r);
+			resample_free(&r);
+		}
+	}
+#endif
+	run_test_s16(cpu_flags);
+
 	qsort(results, n_results, sizeof(struct stats), compare_func);
 
 	for (i = 0; i < n_results; i++) {
@@ -0,0 +1,125 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "channelmix-ops.h"
+
+#include <immintrin.h>
+
+static inline void clear_avx(float *d, uint32_t n_samples)
+{
+	memset(d, 0, n_samples * sizeof(float));
+}
+
+static inline void copy_avx(float *d, const float *s, uint32_t n_samples)
+{
+	spa_memcpy(d, s, n_samples * sizeof(float));
+}
+
+static inline void vol_avx(float *d, const float *s, float vol, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	if (vol == 0.0f) {
+		clear_avx(d, n_samples);
+	} else if (vol == 1.0f) {
+		copy_avx(d, s, n_samples);
+	} else {
+		__m256 t[4];
+		const __m256 v = _mm256_set1_ps(vol);
+
+		if (SPA_IS_ALIGNED(d, 32) &&
+		    SPA_IS_ALIGNED(s, 32))
+			unrolled = n_samples & ~31;
+		else
+			unrolled = 0;
+
+		for(n = 0; n < unrolled; n += 32) {
+			t[0] = _mm256_load_ps(&s[n]);
+			t[1] = _mm256_load_ps(&s[n+8]);
+			t[2] = _mm256_load_ps(&s[n+16]);
+			t[3] = _mm256_load_ps(&s[n+24]);
+			_mm256_store_ps(&d[n], _mm256_mul_ps(t[0], v));
+			_mm256_store_ps(&d[n+8], _mm256_mul_ps(t[1], v));
+			_mm256_store_ps(&d[n+16], _mm256_mul_ps(t[2], v));
+			_mm256_store_ps(&d[n+24], _mm256_mul_ps(t[3], v));
+		}
+		for(; n < n_samples; n++)
+			d[n] = s[n] * vol;
+	}
+}
+
+static inline void conv_avx(float *d, const float **s, float *c, uint32_t n_c, uint32_t n_samples)
+{
+	__m256 mi[n_c], sum[4];
+	uint32_t n, j, unrolled;
+	bool aligned = true;
+
+	for (j = 0; j < n_c; j++) {
+		mi[j] = _mm256_set1_ps(c[j]);
+		aligned &= SPA_IS_ALIGNED(s[j], 32);
+	}
+
+	if (aligned && SPA_IS_ALIGNED(d, 32))
+		unrolled = n_samples & ~31;
+	else
+		unrolled = 0;
+
+	for (n = 0; n < unrolled; n += 32) {
+		sum[0] = _mm256_mul_ps(_mm256_load_ps(&s[0][n + 0]), mi[0]);
+		sum[1] = _mm256_mul_ps(_mm256_load_ps(&s[0][n + 8]), mi[0]);
+		sum[2] = _mm256_mul_ps(_mm256_load_ps(&s[0][n + 16]), mi[0]);
+		sum[3] = _mm256_mul_ps(_mm256_load_ps(&s[0][n + 24]), mi[0]);
+		for (j = 1; j < n_c; j++) {
+			sum[0] = _mm256_fmadd_ps(_mm256_load_ps(&s[j][n + 0]), mi[j], sum[0]);
+			sum[1] = _mm256_fmadd_ps(_mm256_load_ps(&s[j][n + 8]), mi[j], sum[1]);
+			sum[2] = _mm256_fmadd_ps(_mm256_load_ps(&s[j][n + 16]), mi[j], sum[2]);
+			sum[3] = _mm256_fmadd_ps(_mm256_load_ps(&s[j][n + 24]), mi[j], sum[3]);
+		}
+		_mm256_store_ps(&d[n + 0], sum[0]);
+		_mm256_store_ps(&d[n + 8], sum[1]);
+		_mm256_store_ps(&d[n + 16], sum[2]);
+		_mm256_store_ps(&d[n + 24], sum[3]);
+	}
+	for (; n < n_samples; n++) {
+		float t = s[0][n] * c[0];
+		for (j = 1; j < n_c; j++)
+			t += s[j][n] * c[j];
+		d[n] = t;
+	}
+}
+
+void
+channelmix_f32_n_m_avx(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		   const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	uint32_t i, j, n_dst = mix->dst_chan, n_src = mix->src_chan;
+
+	for (i = 0; i < n_dst; i++) {
+		float *di = d[i];
+		float mj[n_src];
+		const float *sj[n_src];
+		uint32_t n_j = 0;
+
+		/* only mix the sources that contribute, large matrices
+		 * are usually sparse */
+		for (j = 0; j < n_src; j++) {
+			if (mix->matrix[i][j] == 0.0f)
+				continue;
+			mj[n_j] = mix->matrix[i][j];
+			sj[n_j++] = s[j];
+		}
+		if (n_j == 0) {
+			clear_avx(di, n_samples);
+		} else if (n_j == 1) {
+			if (mix->lr4[i].active)
+				lr4_process(&mix->lr4[i], di, sj[0], mj[0], n_samples);
+			else
+				vol_avx(di, sj[0], mj[0], n_samples);
+		} else {
+			conv_avx(di, sj, mj, n_j, n_samples);
+			lr4_process(&mix->lr4[i], di, di, 1.0f, n_samples);
+		}
+	}
+}
@@ -0,0 +1,104 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "channelmix-ops.h"
+
+#include <immintrin.h>
+
+/* The buffers are only aligned to 32 bytes, use unaligned loads and stores,
+ * they are as fast as the aligned ones when the data happens to be aligned. */
+static inline void vol_avx512(float *d, const float *s, float vol, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	if (vol == 0.0f) {
+		memset(d, 0, n_samples * sizeof(float));
+	} else if (vol == 1.0f) {
+		spa_memcpy(d, s, n_samples * sizeof(float));
+	} else {
+		const __m512 v = _mm512_set1_ps(vol);
+
+		unrolled = n_samples & ~31;
+
+		for(n = 0; n < unrolled; n += 32) {
+			_mm512_storeu_ps(&d[n], _mm512_mul_ps(_mm512_loadu_ps(&s[n]), v));
+			_mm512_storeu_ps(&d[n+16], _mm512_mul_ps(_mm512_loadu_ps(&s[n+16]), v));
+		}
+		for(; n < n_samples; n++)
+			d[n] = s[n] * vol;
+	}
+}
+
+static inline void conv_avx512(float *d, const float **s, float *c, uint32_t n_c, uint32_t n_samples)
+{
+	__m512 mi[n_c], sum[4];
+	uint32_t n, j, unrolled;
+
+	for (j = 0; j < n_c; j++)
+		mi[j] = _mm512_set1_ps(c[j]);
+
+	unrolled = n_samples & ~63;
+
+	for (n = 0; n < unrolled; n += 64) {
+		sum[0] = _mm512_mul_ps(_mm512_loadu_ps(&s[0][n + 0]), mi[0]);
+		sum[1] = _mm512_mul_ps(_mm512_loadu_ps(&s[0][n + 16]), mi[0]);
+		sum[2] = _mm512_mul_ps(_mm512_loadu_ps(&s[0][n + 32]), mi[0]);
+		sum[3] = _mm512_mul_ps(_mm512_loadu_ps(&s[0][n + 48]), mi[0]);
+		for (j = 1; j < n_c; j++) {
+			sum[0] = _mm512_fmadd_ps(_mm512_loadu_ps(&s[j][n + 0]), mi[j], sum[0]);
+			sum[1] = _mm512_fmadd_ps(_mm512_loadu_ps(&s[j][n + 16]), mi[j], sum[1]);
+			sum[2] = _mm512_fmadd_ps(_mm512_loadu_ps(&s[j][n + 32]), mi[j], sum[2]);
+			sum[3] = _mm512_fmadd_ps(_mm512_loadu_ps(&s[j][n + 48]), mi[j], sum[3]);
+		}
+		_mm512_storeu_ps(&d[n + 0], sum[0]);
+		_mm512_storeu_ps(&d[n + 16], sum[1]);
+		_mm512_storeu_ps(&d[n + 32], sum[2]);
+		_mm512_storeu_ps(&d[n + 48], sum[3]);
+	}
+	for (; n + 16 <= n_samples; n += 16) {
+		sum[0] = _mm512_mul_ps(_mm512_loadu_ps(&s[0][n]), mi[0]);
+		for (j = 1; j < n_c; j++)
+			sum[0] = _mm512_fmadd_ps(_mm512_loadu_ps(&s[j][n]), mi[j], sum[0]);
+		_mm512_storeu_ps(&d[n], sum[0]);
+	}
+	for (; n < n_samples; n++) {
+		float t = s[0][n] * c[0];
+		for (j = 1; j < n_c; j++)
+			t += s[j][n] * c[j];
+		d[n] = t;
+	}
+}
+
+void
+channelmix_f32_n_m_avx512(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		   const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	uint32_t i, j, n_dst = mix->dst_chan, n_src = mix->src_chan;
+
+	for (i = 0; i < n_dst; i++) {
+		float *di = d[i];
+		float mj[n_src];
+		const float *sj[n_src];
+		uint32_t n_j = 0;
+
+		for (j = 0; j < n_src; j++) {
+			if (mix->matrix[i][j] == 0.0f)
+				continue;
+			mj[n_j] = mix->matrix[i][j];
+			sj[n_j++] = s[j];
+		}
+		if (n_j == 0) {
+			memset(di, 0, n_samples * sizeof(float));
+		} else if (n_j == 1) {
+			if (mix->lr4[i].active)
+				lr4_process(&mix->lr4[i], di, sj[0], mj[0], n_samples);
+			else
+				vol_avx512(di, sj[0], mj[0], n_samples);
+		} else {
+			conv_avx512(di, sj, mj, n_j, n_samples);
+			lr4_process(&mix->lr4[i], di, di, 1.0f, n_samples);
+		}
+	}
+}
@@ -80,10 +80,26 @@ static const struct channelmix_info {
 #endif
 	MAKE(6, MASK_5_1, 4, MASK_3_1, channelmix_f32_5p1_3p1_c),
 
+#if defined (HAVE_AVX512)
+	MAKE(8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_n_m_avx512, SPA_CPU_FLAG_AVX512),
+	MAKE(8, MASK_7_1, 4, MASK_QUAD, channelmix_f32_n_m_avx512, SPA_CPU_FLAG_AVX512),
+	MAKE(8, MASK_7_1, 4, MASK_3_1, channelmix_f32_n_m_avx512, SPA_CPU_FLAG_AVX512),
+#endif
+#if defined (HAVE_AVX) && defined (HAVE_FMA)
+	MAKE(8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_n_m_avx, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3),
+	MAKE(8, MASK_7_1, 4, MASK_QUAD, channelmix_f32_n_m_avx, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3),
+	MAKE(8, MASK_7_1, 4, MASK_3_1, channelmix_f32_n_m_avx, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3),
+#endif
 	MAKE(8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_7p1_2_c),
 	MAKE(8, MASK_7_1, 4, MASK_QUAD, channelmix_f32_7p1_4_c),
 	MAKE(8, MASK_7_1, 4, MASK_3_1, channelmix_f32_7p1_3p1_c),
 
+#if defined (HAVE_AVX512)
+	MAKE(ANY, 0, ANY, 0, channelmix_f32_n_m_avx512, SPA_CPU_FLAG_AVX512),
+#endif
+#if defined (HAVE_AVX) && defined (HAVE_FMA)
+	MAKE(ANY, 0, ANY, 0, channelmix_f32_n_m_avx, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3),
+#endif
 #if defined (HAVE_SSE)
 	MAKE(ANY, 0, ANY, 0, channelmix_f32_n_m_sse, SPA_CPU_FLAG_SSE),
 #endif
@@ -137,4 +137,21 @@ DEFINE_FUNCTION(f32_5p1_4, sse);
 DEFINE_FUNCTION(f32_7p1_4, sse);
 #endif
 
+#if defined (HAVE_AVX) && defined (HAVE_FMA)
+DEFINE_FUNCTION(f32_n_m, avx);
+#endif
+#if defined (HAVE_AVX512)
+DEFINE_FUNCTION(f32_n_m, avx512);
+#endif
+
 #undef DEFINE_FUNCTION
+
+/* the mix only scales each channel with the diagonal of the matrix */
+static inline bool channelmix_is_copy(struct channelmix *mix)
+{
+#if defined (HAVE_SSE)
+	if (mix->process == channelmix_copy_sse)
+		return true;
+#endif
+	return mix->process == channelmix_copy_c;
+}
@@ -113,6 +113,25 @@ MAKE_I_TO_D(s16, int16_t, f32, float, S16_TO_F32);
 MAKE_D_TO_I(s16, int16_t, f32, float, S16_TO_F32);
 MAKE_I_TO_D(s16s, uint16_t, f32, float, S16S_TO_F32);
 
+void
+conv_s16_to_f32d_vol_c(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		const float *volumes, uint32_t n_samples)
+{
+	const int16_t *s = src[0];
+	float **d = (float**)dst;
+	uint32_t i, j, n_channels = conv->n_channels;
+
+	for (j = 0; j < n_samples; j++) {
+		for (i = 0; i < n_channels; i++)
+			d[i][j] = S16_TO_F32(*s++) * volumes[i];
+	}
+	/* muted channels are cleared, like channelmix does */
+	for (i = 0; i < n_channels; i++) {
+		if (volumes[i] == 0.0f)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+}
+
 MAKE_I_TO_I(u32, uint32_t, f32, float, U32_TO_F32);
 MAKE_I_TO_D(u32, uint32_t, f32, float, U32_TO_F32);
 
@@ -390,6 +390,46 @@ static const struct noise_info *find_noise_info(uint32_t method,
 	return NULL;
 }
 
+typedef void (*convert_vol_func_t) (struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], const float *volumes, uint32_t n_samples);
+
+struct conv_vol_info {
+	uint32_t src_fmt;
+	uint32_t dst_fmt;
+	uint32_t n_channels;
+
+	convert_vol_func_t process;
+	const char *name;
+
+	uint32_t cpu_flags;
+};
+
+#define MAKE(fmt1,fmt2,chan,func,...) \
+	{  SPA_AUDIO_FORMAT_ ##fmt1, SPA_AUDIO_FORMAT_ ##fmt2, chan, func, #func , __VA_ARGS__ }
+
+static struct conv_vol_info conv_vol_table[] =
+{
+#if defined (HAVE_SSE2)
+	MAKE(S16, F32P, 2, conv_s16_to_f32d_vol_2_sse2, SPA_CPU_FLAG_SSE2),
+	MAKE(S16, F32P, 0, conv_s16_to_f32d_vol_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(S16, F32P, 0, conv_s16_to_f32d_vol_c),
+};
+#undef MAKE
+
+static const struct conv_vol_info *find_conv_vol_info(uint32_t src_fmt, uint32_t dst_fmt,
+		uint32_t n_channels, uint32_t cpu_flags)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(conv_vol_table, c) {
+		if (c->src_fmt == src_fmt &&
+		    c->dst_fmt == dst_fmt &&
+		    MATCH_CHAN(c->n_channels, n_channels) &&
+		    MATCH_CPU_FLAGS(c->cpu_flags, cpu_flags))
+			return c;
+	}
+	return NULL;
+}
+
 static void impl_convert_free(struct convert *conv)
 {
 	conv->process = NULL;
@@ -464,6 +504,7 @@ static const struct dither_info *find_dither_info(uint32_t method, uint32_t rate
 int convert_init(struct convert *conv)
 {
 	const struct conv_info *info;
+	const struct conv_vol_info *vinfo = NULL;
 	const struct dither_info *dinfo;
 	const struct noise_info *ninfo;
 	uint32_t i, conv_flags, data_size[3];
@@ -515,6 +556,10 @@ int convert_init(struct convert *conv)
 	if (ninfo == NULL)
 		return -ENOTSUP;
 
+	if (conv_flags == 0)
+		vinfo = find_conv_vol_info(conv->src_fmt, conv->dst_fmt, conv->n_channels,
+				conv->cpu_flags);
+
 	conv->noise_size = NOISE_SIZE;
 
 	data_size[0] = SPA_ROUND_UP(conv->noise_size * sizeof(float), FMT_OPS_MAX_ALIGN);
@@ -537,6 +582,7 @@ int convert_init(struct convert *conv)
 	conv->cpu_flags = info->cpu_flags;
 	conv->update_noise = ninfo->noise;
 	conv->process = info->process;
+	conv->process_vol = vinfo ? vinfo->process : NULL;
 	conv->free = impl_convert_free;
 	conv->func_name = info->name;
 
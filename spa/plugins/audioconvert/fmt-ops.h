@@ -231,6 +231,9 @@ struct convert {
 	void (*update_noise) (struct convert *conv, float *noise, uint32_t n_samples);
 	void (*process) (struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
 			uint32_t n_samples);
+	/* convert and apply a volume per channel in one pass, NULL when not available */
+	void (*process_vol) (struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+			const float *volumes, uint32_t n_samples);
 	void (*free) (struct convert *conv);
 
 	void *data;
@@ -268,6 +271,7 @@ static inline uint32_t dither_method_from_label(const char *label)
 
 #define convert_update_noise(conv,...)	(conv)->update_noise(conv, __VA_ARGS__)
 #define convert_process(conv,...)	(conv)->process(conv, __VA_ARGS__)
+#define convert_process_vol(conv,...)	(conv)->process_vol(conv, __VA_ARGS__)
 #define convert_free(conv)		(conv)->free(conv)
 
 #define DEFINE_NOISE_FUNCTION(name,arch)				\
@@ -466,3 +470,16 @@ DEFINE_FUNCTION(f32d_to_s16, avx2);
 #endif
 
 #undef DEFINE_FUNCTION
+
+#define DEFINE_VOL_FUNCTION(name,arch)						\
+void conv_##name##_##arch(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], const float *volumes,		\
+		uint32_t n_samples)
+
+DEFINE_VOL_FUNCTION(s16_to_f32d_vol, c);
+#if defined(HAVE_SSE2)
+DEFINE_VOL_FUNCTION(s16_to_f32d_vol_2, sse2);
+DEFINE_VOL_FUNCTION(s16_to_f32d_vol, sse2);
+#endif
+
+#undef DEFINE_VOL_FUNCTION
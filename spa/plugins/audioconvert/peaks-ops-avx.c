@@ -0,0 +1,100 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <math.h>
+
+#include <immintrin.h>
+
+#include "peaks-ops.h"
+
+static inline float hmin_ps(__m256 val)
+{
+	__m128 t = _mm_min_ps(_mm256_castps256_ps128(val), _mm256_extractf128_ps(val, 1));
+	t = _mm_min_ps(t, _mm_movehl_ps(t, t));
+	t = _mm_min_ss(t, _mm_shuffle_ps(t, t, 0x55));
+	return _mm_cvtss_f32(t);
+}
+
+static inline float hmax_ps(__m256 val)
+{
+	__m128 t = _mm_max_ps(_mm256_castps256_ps128(val), _mm256_extractf128_ps(val, 1));
+	t = _mm_max_ps(t, _mm_movehl_ps(t, t));
+	t = _mm_max_ss(t, _mm_shuffle_ps(t, t, 0x55));
+	return _mm_cvtss_f32(t);
+}
+
+void peaks_min_max_avx(struct peaks *peaks, const float * SPA_RESTRICT src,
+		uint32_t n_samples, float *min, float *max)
+{
+	uint32_t n;
+	__m256 in;
+	__m256 mi = _mm256_set1_ps(*min);
+	__m256 ma = _mm256_set1_ps(*max);
+
+	for (n = 0; n < n_samples; n++) {
+		if (SPA_IS_ALIGNED(&src[n], 32))
+			break;
+		in = _mm256_set1_ps(src[n]);
+		mi = _mm256_min_ps(mi, in);
+		ma = _mm256_max_ps(ma, in);
+	}
+	for (; n + 31 < n_samples; n += 32) {
+		in = _mm256_load_ps(&src[n + 0]);
+		mi = _mm256_min_ps(mi, in);
+		ma = _mm256_max_ps(ma, in);
+		in = _mm256_load_ps(&src[n + 8]);
+		mi = _mm256_min_ps(mi, in);
+		ma = _mm256_max_ps(ma, in);
+		in = _mm256_load_ps(&src[n + 16]);
+		mi = _mm256_min_ps(mi, in);
+		ma = _mm256_max_ps(ma, in);
+		in = _mm256_load_ps(&src[n + 24]);
+		mi = _mm256_min_ps(mi, in);
+		ma = _mm256_max_ps(ma, in);
+	}
+	for (; n < n_samples; n++) {
+		in = _mm256_set1_ps(src[n]);
+		mi = _mm256_min_ps(mi, in);
+		ma = _mm256_max_ps(ma, in);
+	}
+	*min = hmin_ps(mi);
+	*max = hmax_ps(ma);
+}
+
+float peaks_abs_max_avx(struct peaks *peaks, const float * SPA_RESTRICT src,
+		uint32_t n_samples, float max)
+{
+	uint32_t n;
+	__m256 in;
+	__m256 ma = _mm256_set1_ps(max);
+	const __m256 mask = _mm256_set1_ps(-0.0f);
+
+	for (n = 0; n < n_samples; n++) {
+		if (SPA_IS_ALIGNED(&src[n], 32))
+			break;
+		in = _mm256_set1_ps(src[n]);
+		in = _mm256_andnot_ps(mask, in);
+		ma = _mm256_max_ps(ma, in);
+	}
+	for (; n + 31 < n_samples; n += 32) {
+		in = _mm256_load_ps(&src[n + 0]);
+		in = _mm256_andnot_ps(mask, in);
+		ma = _mm256_max_ps(ma, in);
+		in = _mm256_load_ps(&src[n + 8]);
+		in = _mm256_andnot_ps(mask, in);
+		ma = _mm256_max_ps(ma, in);
+		in = _mm256_load_ps(&src[n + 16]);
+		in = _mm256_andnot_ps(mask, in);
+		ma = _mm256_max_ps(ma, in);
+		in = _mm256_load_ps(&src[n + 24]);
+		in = _mm256_andnot_ps(mask, in);
+		ma = _mm256_max_ps(ma, in);
+	}
+	for (; n < n_samples; n++) {
+		in = _mm256_set1_ps(src[n]);
+		in = _mm256_andnot_ps(mask, in);
+		ma = _mm256_max_ps(ma, in);
+	}
+	return hmax_ps(ma);
+}
@@ -28,6 +28,9 @@ static const struct peaks_info {
 	uint32_t cpu_flags;
 } peaks_table[] =
 {
+#if defined (HAVE_AVX)
+	MAKE(peaks_min_max_avx, peaks_abs_max_avx, SPA_CPU_FLAG_AVX),
+#endif
 #if defined (HAVE_SSE)
 	MAKE(peaks_min_max_sse, peaks_abs_max_sse, SPA_CPU_FLAG_SSE),
 #endif
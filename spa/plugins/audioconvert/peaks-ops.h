@@ -48,5 +48,9 @@ DEFINE_ABS_MAX_FUNCTION(c);
 DEFINE_MIN_MAX_FUNCTION(sse);
 DEFINE_ABS_MAX_FUNCTION(sse);
 #endif
+#if defined (HAVE_AVX)
+DEFINE_MIN_MAX_FUNCTION(avx);
+DEFINE_ABS_MAX_FUNCTION(avx);
+#endif
 
 #undef DEFINE_FUNCTION
@@ -0,0 +1,81 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "resample-native-impl.h"
+
+#include <assert.h>
+#include <immintrin.h>
+
+/* horizontal sum of the 8 floats, the 512 bit accumulators are folded to 256
+ * bits first so this only needs AVX */
+static inline float hsum_ps_256(__m256 v)
+{
+	__m128 x = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	x = _mm_hadd_ps(x, x);
+	x = _mm_hadd_ps(x, x);
+	return _mm_cvtss_f32(x);
+}
+
+/* n_taps is a multiple of 8 and the taps are 64 byte aligned. We do 32 taps
+ * per iteration in two accumulators and handle the remaining 8, 16 or 24 taps
+ * with 16 and 8 wide operations. */
+static inline void inner_product_avx512(float *d, const float * SPA_RESTRICT s,
+		const float * SPA_RESTRICT taps, uint32_t n_taps)
+{
+	__m512 sz[2] = { _mm512_setzero_ps(), _mm512_setzero_ps() };
+	__m256 sy;
+	uint32_t i = 0;
+	uint32_t n_taps32 = n_taps & ~0x1f;
+
+	for (; i < n_taps32; i += 32) {
+		sz[0] = _mm512_fmadd_ps(_mm512_loadu_ps(s + i + 0),
+				_mm512_load_ps(taps + i + 0), sz[0]);
+		sz[1] = _mm512_fmadd_ps(_mm512_loadu_ps(s + i + 16),
+				_mm512_load_ps(taps + i + 16), sz[1]);
+	}
+	if (n_taps - i >= 16) {
+		sz[0] = _mm512_fmadd_ps(_mm512_loadu_ps(s + i),
+				_mm512_load_ps(taps + i), sz[0]);
+		i += 16;
+	}
+	sz[0] = _mm512_add_ps(sz[0], sz[1]);
+	sy = _mm256_add_ps(_mm512_castps512_ps256(sz[0]),
+			_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(sz[0]), 1)));
+	if (i < n_taps)
+		sy = _mm256_fmadd_ps(_mm256_loadu_ps(s + i),
+				_mm256_load_ps(taps + i), sy);
+
+	*d = hsum_ps_256(sy);
+}
+
+static inline void inner_product_ip_avx512(float *d, const float * SPA_RESTRICT s,
+	const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1, float x,
+	uint32_t n_taps)
+{
+	__m512 sz[2] = { _mm512_setzero_ps(), _mm512_setzero_ps() }, tz;
+	__m256 sy[2], ty;
+	uint32_t i = 0, n_taps16 = n_taps & ~0xf;
+
+	for (; i < n_taps16; i += 16) {
+		tz = _mm512_loadu_ps(s + i);
+		sz[0] = _mm512_fmadd_ps(tz, _mm512_load_ps(t0 + i), sz[0]);
+		sz[1] = _mm512_fmadd_ps(tz, _mm512_load_ps(t1 + i), sz[1]);
+	}
+	sy[0] = _mm256_add_ps(_mm512_castps512_ps256(sz[0]),
+			_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(sz[0]), 1)));
+	sy[1] = _mm256_add_ps(_mm512_castps512_ps256(sz[1]),
+			_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(sz[1]), 1)));
+	if (i < n_taps) {
+		ty = _mm256_loadu_ps(s + i);
+		sy[0] = _mm256_fmadd_ps(ty, _mm256_load_ps(t0 + i), sy[0]);
+		sy[1] = _mm256_fmadd_ps(ty, _mm256_load_ps(t1 + i), sy[1]);
+	}
+	sy[1] = _mm256_mul_ps(_mm256_sub_ps(sy[1], sy[0]), _mm256_set1_ps(x));
+	sy[0] = _mm256_add_ps(sy[0], sy[1]);
+
+	*d = hsum_ps_256(sy[0]);
+}
+
+MAKE_RESAMPLER_FULL(avx512);
+MAKE_RESAMPLER_INTER(avx512);
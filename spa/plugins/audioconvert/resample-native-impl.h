@@ -40,6 +40,10 @@ struct native_data {
 	float *filter;
 	float *hist_mem;
 	const struct resample_info *info;
+	struct resample_filter *shared;
+	void (*conv)(float *d, const void *s, uint32_t offs, uint32_t n_samples);
+	float **conv_src;
+	float **conv_dst;
 };
 
 #define DEFINE_RESAMPLER(type,arch)						\
@@ -169,3 +173,7 @@ DEFINE_RESAMPLER(inter,ssse3);
 DEFINE_RESAMPLER(full,avx);
 DEFINE_RESAMPLER(inter,avx);
 #endif
+#if defined (HAVE_AVX512)
+DEFINE_RESAMPLER(full,avx512);
+DEFINE_RESAMPLER(inter,avx512);
+#endif
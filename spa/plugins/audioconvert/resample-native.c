@@ -3,10 +3,18 @@
 /* SPDX-License-Identifier: MIT */
 
 #include <errno.h>
+#include <pthread.h>
 
 #include <spa/param/audio/format.h>
+#include <spa/utils/list.h>
 
 #include "resample-native-impl.h"
+#include "fmt-ops.h"
+
+/* number of input samples that are converted per channel at a time when the
+ * input is not F32, small enough to stay in the cache between the conversion
+ * and the filter */
+#define CONV_SAMPLES	256u
 
 struct quality {
 	uint32_t n_taps;
@@ -79,6 +87,89 @@ static int build_filter(float *taps, uint32_t stride, uint32_t n_taps, uint32_t
 	return 0;
 }
 
+/* The filter taps only depend on the number of taps and phases and the
+ * cutoff. They are immutable once built and shared between all resamplers
+ * in the process that use the same parameters. */
+struct resample_filter {
+	struct spa_list link;
+	int ref;
+	uint32_t n_taps;
+	uint32_t n_phases;
+	uint32_t stride;
+	double cutoff;
+	float *taps;
+};
+
+static pthread_mutex_t filter_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct spa_list filter_cache = SPA_LIST_INIT(&filter_cache);
+
+static struct resample_filter *find_filter(uint32_t n_taps, uint32_t n_phases,
+		uint32_t stride, double cutoff)
+{
+	struct resample_filter *f;
+	spa_list_for_each(f, &filter_cache, link) {
+		if (f->n_taps == n_taps && f->n_phases == n_phases &&
+		    f->stride == stride && f->cutoff == cutoff)
+			return f;
+	}
+	return NULL;
+}
+
+static struct resample_filter *filter_acquire(uint32_t n_taps, uint32_t n_phases,
+		uint32_t stride, double cutoff)
+{
+	struct resample_filter *f, *found;
+
+	pthread_mutex_lock(&filter_lock);
+	if ((f = find_filter(n_taps, n_phases, stride, cutoff)) != NULL)
+		f->ref++;
+	pthread_mutex_unlock(&filter_lock);
+
+	if (f != NULL)
+		return f;
+
+	/* build the filter without the lock, this can take a while for
+	 * large filters */
+	f = calloc(1, sizeof(struct resample_filter) +
+			(size_t)stride * sizeof(float) * (n_phases + 1) + 64);
+	if (f == NULL)
+		return NULL;
+
+	f->ref = 1;
+	f->n_taps = n_taps;
+	f->n_phases = n_phases;
+	f->stride = stride;
+	f->cutoff = cutoff;
+	f->taps = SPA_PTROFF_ALIGN(f, sizeof(struct resample_filter), 64, float);
+	build_filter(f->taps, stride, n_taps, n_phases, cutoff);
+
+	pthread_mutex_lock(&filter_lock);
+	if ((found = find_filter(n_taps, n_phases, stride, cutoff)) != NULL) {
+		/* someone else was faster */
+		found->ref++;
+	} else {
+		spa_list_append(&filter_cache, &f->link);
+	}
+	pthread_mutex_unlock(&filter_lock);
+
+	if (found != NULL) {
+		free(f);
+		f = found;
+	}
+	return f;
+}
+
+static void filter_release(struct resample_filter *f)
+{
+	pthread_mutex_lock(&filter_lock);
+	if (--f->ref == 0)
+		spa_list_remove(&f->link);
+	else
+		f = NULL;
+	pthread_mutex_unlock(&filter_lock);
+	free(f);
+}
+
 MAKE_RESAMPLER_COPY(c);
 
 #define MAKE(fmt,copy,full,inter,...) \
@@ -90,6 +181,9 @@ static struct resample_info resample_table[] =
 #if defined (HAVE_NEON)
 	MAKE(F32, copy_c, full_neon, inter_neon, SPA_CPU_FLAG_NEON),
 #endif
+#if defined(HAVE_AVX512)
+	MAKE(F32, copy_c, full_avx512, inter_avx512, SPA_CPU_FLAG_AVX512),
+#endif
 #if defined(HAVE_AVX) && defined(HAVE_FMA)
 	MAKE(F32, copy_c, full_avx, inter_avx, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3),
 #endif
@@ -116,8 +210,12 @@ static const struct resample_info *find_resample_info(uint32_t format, uint32_t
 
 static void impl_native_free(struct resample *r)
 {
+	struct native_data *d = r->data;
+
 	spa_log_debug(r->log, "native %p: free", r);
-	free(r->data);
+	if (d != NULL && d->shared != NULL)
+		filter_release(d->shared);
+	free(d);
 	r->data = NULL;
 }
 
@@ -278,6 +376,66 @@ static void impl_native_process(struct resample *r,
 	return;
 }
 
+static void conv_s16_to_f32(float *d, const void *src, uint32_t offs, uint32_t n_samples)
+{
+	const int16_t *s = (const int16_t*)src + offs;
+	uint32_t i;
+	for (i = 0; i < n_samples; i++)
+		d[i] = S16_TO_F32(s[i]);
+}
+
+static void conv_s24_to_f32(float *d, const void *src, uint32_t offs, uint32_t n_samples)
+{
+	const int24_t *s = (const int24_t*)src + offs;
+	uint32_t i;
+	for (i = 0; i < n_samples; i++)
+		d[i] = S24_TO_F32(s[i]);
+}
+
+static void conv_s24_32_to_f32(float *d, const void *src, uint32_t offs, uint32_t n_samples)
+{
+	const int32_t *s = (const int32_t*)src + offs;
+	uint32_t i;
+	for (i = 0; i < n_samples; i++)
+		d[i] = S24_32_TO_F32(s[i]);
+}
+
+static void conv_s32_to_f32(float *d, const void *src, uint32_t offs, uint32_t n_samples)
+{
+	const int32_t *s = (const int32_t*)src + offs;
+	uint32_t i;
+	for (i = 0; i < n_samples; i++)
+		d[i] = S32_TO_F32(s[i]);
+}
+
+/* Convert the integer input in small blocks to float and resample each block
+ * while it is still in the cache. This avoids a separate conversion pass
+ * over the complete input. */
+static void impl_native_process_conv(struct resample *r,
+		const void * SPA_RESTRICT src[], uint32_t *in_len,
+		void * SPA_RESTRICT dst[], uint32_t *out_len)
+{
+	struct native_data *data = r->data;
+	uint32_t c, in, out, chunk, in_done = 0, out_done = 0;
+	uint32_t ilen = *in_len, olen = *out_len;
+
+	do {
+		chunk = in = SPA_MIN(ilen - in_done, CONV_SAMPLES);
+		out = olen - out_done;
+		for (c = 0; c < r->channels; c++) {
+			data->conv(data->conv_src[c], src[c], in_done, in);
+			data->conv_dst[c] = (float*)dst[c] + out_done;
+		}
+		impl_native_process(r, (const void**)data->conv_src, &in,
+				(void**)data->conv_dst, &out);
+		in_done += in;
+		out_done += out;
+	} while (in == chunk && in_done < ilen && out_done < olen);
+
+	*in_len = in_done;
+	*out_len = out_done;
+}
+
 static void impl_native_reset (struct resample *r)
 {
 	struct native_data *d = r->data;
@@ -302,14 +460,37 @@ int resample_native_init(struct resample *r)
 	struct native_data *d;
 	const struct quality *q;
 	double scale;
-	uint32_t c, n_taps, n_phases, filter_size, in_rate, out_rate, gcd, filter_stride;
-	uint32_t history_stride, history_size, oversample;
+	uint32_t c, n_taps, n_phases, in_rate, out_rate, gcd, filter_stride;
+	uint32_t history_stride, history_size, oversample, conv_size = 0;
+	void (*conv)(float *d, const void *s, uint32_t offs, uint32_t n_samples);
+
+	switch (r->format) {
+	case 0:
+	case SPA_AUDIO_FORMAT_F32P:
+		conv = NULL;
+		break;
+	case SPA_AUDIO_FORMAT_S16P:
+		conv = conv_s16_to_f32;
+		break;
+	case SPA_AUDIO_FORMAT_S24P:
+		conv = conv_s24_to_f32;
+		break;
+	case SPA_AUDIO_FORMAT_S24_32P:
+		conv = conv_s24_32_to_f32;
+		break;
+	case SPA_AUDIO_FORMAT_S32P:
+		conv = conv_s32_to_f32;
+		break;
+	default:
+		return -ENOTSUP;
+	}
 
 	r->quality = SPA_CLAMP(r->quality, 0, (int) SPA_N_ELEMENTS(window_qualities) - 1);
 	r->free = impl_native_free;
 	r->update_rate = impl_native_update_rate;
 	r->in_len = impl_native_in_len;
 	r->process = impl_native_process;
+	r->process_convert = conv ? impl_native_process_conv : NULL;
 	r->reset = impl_native_reset;
 	r->delay = impl_native_delay;
 
@@ -333,14 +514,16 @@ int resample_native_init(struct resample *r)
 	n_phases *= oversample;
 
 	filter_stride = SPA_ROUND_UP_N(n_taps * sizeof(float), 64);
-	filter_size = filter_stride * (n_phases + 1);
 	history_stride = SPA_ROUND_UP_N(2 * n_taps * sizeof(float), 64);
 	history_size = r->channels * history_stride;
+	if (conv != NULL)
+		conv_size = r->channels * (CONV_SAMPLES * sizeof(float) +
+				2 * sizeof(float*));
 
 	d = calloc(1, sizeof(struct native_data) +
-			filter_size +
 			history_size +
 			(r->channels * sizeof(float*)) +
+			conv_size +
 			64);
 
 	if (d == NULL)
@@ -351,15 +534,25 @@ int resample_native_init(struct resample *r)
 	d->n_phases = n_phases;
 	d->in_rate = in_rate;
 	d->out_rate = out_rate;
-	d->filter = SPA_PTROFF_ALIGN(d, sizeof(struct native_data), 64, float);
-	d->hist_mem = SPA_PTROFF_ALIGN(d->filter, filter_size, 64, float);
+	d->hist_mem = SPA_PTROFF_ALIGN(d, sizeof(struct native_data), 64, float);
 	d->history = SPA_PTROFF(d->hist_mem, history_size, float*);
 	d->filter_stride = filter_stride / sizeof(float);
 	d->filter_stride_os = d->filter_stride * oversample;
 	for (c = 0; c < r->channels; c++)
 		d->history[c] = SPA_PTROFF(d->hist_mem, c * history_stride, float);
+	if (conv != NULL) {
+		float *conv_mem = SPA_PTROFF(d->history, r->channels * sizeof(float*), float);
+		d->conv = conv;
+		d->conv_src = SPA_PTROFF(conv_mem, r->channels * CONV_SAMPLES * sizeof(float), float*);
+		d->conv_dst = SPA_PTROFF(d->conv_src, r->channels * sizeof(float*), float*);
+		for (c = 0; c < r->channels; c++)
+			d->conv_src[c] = &conv_mem[c * CONV_SAMPLES];
+	}
 
-	build_filter(d->filter, d->filter_stride, n_taps, n_phases, scale);
+	d->shared = filter_acquire(n_taps, n_phases, d->filter_stride, scale);
+	if (d->shared == NULL)
+		return -errno;
+	d->filter = d->shared->taps;
 
 	d->info = find_resample_info(SPA_AUDIO_FORMAT_F32, r->cpu_flags);
 	if (SPA_UNLIKELY(d->info == NULL)) {
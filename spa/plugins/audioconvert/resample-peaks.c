@@ -116,6 +116,7 @@ int resample_peaks_init(struct resample *r)
 
 	r->data = d;
 	r->process = resample_peaks_process;
+	r->process_convert = NULL;
 	r->reset = impl_peaks_reset;
 	r->delay = impl_peaks_delay;
 	r->in_len = impl_peaks_in_len;
@@ -22,6 +22,8 @@ struct resample {
 	uint32_t o_rate;
 	double rate;
 	int quality;
+	uint32_t format;	/**< planar integer input format for process_convert,
+				  *  0 when only F32 input is used */
 
 	void (*free)		(struct resample *r);
 	void (*update_rate)	(struct resample *r, double rate);
@@ -30,6 +32,11 @@ struct resample {
 	void (*process)		(struct resample *r,
 				 const void * SPA_RESTRICT src[], uint32_t *in_len,
 				 void * SPA_RESTRICT dst[], uint32_t *out_len);
+	/* like process but with src in format, converted while resampling.
+	 * NULL when format is not set or not supported */
+	void (*process_convert)	(struct resample *r,
+				 const void * SPA_RESTRICT src[], uint32_t *in_len,
+				 void * SPA_RESTRICT dst[], uint32_t *out_len);
 	void (*reset)		(struct resample *r);
 	uint32_t (*delay)	(struct resample *r);
 	void *data;
@@ -40,6 +47,7 @@ struct resample {
 #define resample_in_len(r,...)		(r)->in_len(r,__VA_ARGS__)
 #define resample_out_len(r,...)		(r)->out_len(r,__VA_ARGS__)
 #define resample_process(r,...)		(r)->process(r,__VA_ARGS__)
+#define resample_process_convert(r,...)	(r)->process_convert(r,__VA_ARGS__)
 #define resample_reset(r)		(r)->reset(r)
 #define resample_delay(r)		(r)->delay(r)
 
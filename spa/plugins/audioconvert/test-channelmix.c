@@ -323,6 +323,18 @@ static void run_n_m_impl(struct channelmix *mix, const void **src, uint32_t n_sa
 		check_samples((float**)dst_c, (float**)dst_x, dst_chan, n_samples);
 	}
 #endif
+#if defined(HAVE_AVX) && defined(HAVE_FMA)
+	if (SPA_FLAG_IS_SET(cpu_flags, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3)) {
+		channelmix_f32_n_m_avx(mix, dst_x, src, n_samples);
+		check_samples((float**)dst_c, (float**)dst_x, dst_chan, n_samples);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		channelmix_f32_n_m_avx512(mix, dst_x, src, n_samples);
+		check_samples((float**)dst_c, (float**)dst_x, dst_chan, n_samples);
+	}
+#endif
 }
 
 static void test_n_m_impl(void)
@@ -51,6 +51,20 @@ static void test_impl(void)
 		spa_assert(absmax[0] == absmax[1]);
 	}
 #endif
+#if defined(HAVE_AVX)
+	if (cpu_flags & SPA_CPU_FLAG_AVX) {
+		min[1] = max[1] = 0.0f;
+		peaks_min_max_avx(&peaks, &vals[1], SPA_N_ELEMENTS(vals) - 1, &min[1], &max[1]);
+		printf("avx peaks min:%f max:%f\n", min[1], max[1]);
+
+		absmax[1] = peaks_abs_max_avx(&peaks, &vals[1], SPA_N_ELEMENTS(vals) - 1, 0.0f);
+		printf("avx peaks abs-max:%f\n", absmax[1]);
+
+		spa_assert(min[0] == min[1]);
+		spa_assert(max[0] == max[1]);
+		spa_assert(absmax[0] == absmax[1]);
+	}
+#endif
 
 }
 
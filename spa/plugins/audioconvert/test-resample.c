@@ -11,10 +11,11 @@
 
 #include <spa/support/log-impl.h>
 #include <spa/debug/mem.h>
+#include <spa/param/audio/raw.h>
 
 SPA_LOG_IMPL(logger);
 
-#include "resample.h"
+#include "resample-native-impl.h"
 
 #define N_SAMPLES	253
 #define N_CHANNELS	11
@@ -146,12 +147,96 @@ static void test_in_len(void)
 	resample_free(&r);
 }
 
+static void init_native(struct resample *r, uint32_t channels,
+		uint32_t i_rate, uint32_t o_rate)
+{
+	spa_zero(*r);
+	r->log = &logger.log;
+	r->channels = channels;
+	r->i_rate = i_rate;
+	r->o_rate = o_rate;
+	r->quality = RESAMPLE_DEFAULT_QUALITY;
+	spa_assert_se(resample_native_init(r) == 0);
+}
+
+static void test_shared_filter(void)
+{
+	struct resample r1, r2, r3;
+	struct native_data *d1, *d2, *d3;
+
+	/* same reduced rates and quality share the filter */
+	init_native(&r1, 2, 44100, 48000);
+	init_native(&r2, 1, 88200, 96000);
+	init_native(&r3, 1, 48000, 44100);
+
+	d1 = r1.data;
+	d2 = r2.data;
+	d3 = r3.data;
+	spa_assert_se(d1->filter == d2->filter);
+	spa_assert_se(d1->filter != d3->filter);
+
+	/* the filter stays valid as long as someone uses it */
+	resample_free(&r1);
+	pull_blocks(&r2, 1024, 1024);
+	resample_free(&r2);
+
+	init_native(&r1, 1, 44100, 48000);
+	pull_blocks(&r1, 1024, 1024);
+	resample_free(&r1);
+	resample_free(&r3);
+}
+
+static void test_s16_input(void)
+{
+	struct resample r1, r2;
+	static int16_t in16[2][4096];
+	static float in[2][4096], out1[2][4096], out2[2][4096];
+	const void *src1[2] = { in[0], in[1] }, *src2[2] = { in16[0], in16[1] };
+	void *dst1[2] = { out1[0], out1[1] }, *dst2[2] = { out2[0], out2[1] };
+	uint32_t i, c, in_len1, in_len2, out_len1, out_len2;
+
+	for (c = 0; c < 2; c++) {
+		for (i = 0; i < 4096; i++) {
+			in16[c][i] = (int16_t)(sinf(i * 0.01f * (c + 1)) * 30000.0f);
+			in[c][i] = in16[c][i] / 32768.0f;
+		}
+	}
+	init_native(&r1, 2, 44100, 48000);
+	spa_zero(r2);
+	r2.log = &logger.log;
+	r2.channels = 2;
+	r2.i_rate = 44100;
+	r2.o_rate = 48000;
+	r2.quality = RESAMPLE_DEFAULT_QUALITY;
+	r2.format = SPA_AUDIO_FORMAT_S16P;
+	spa_assert_se(resample_native_init(&r2) == 0);
+
+	/* converting while resampling must give the same result as
+	 * resampling the converted input */
+	in_len1 = in_len2 = 4096;
+	out_len1 = out_len2 = 4096;
+	resample_process(&r1, src1, &in_len1, dst1, &out_len1);
+	spa_assert_se(r2.process_convert != NULL);
+	resample_process_convert(&r2, src2, &in_len2, dst2, &out_len2);
+
+	spa_assert_se(in_len1 == in_len2);
+	spa_assert_se(out_len1 == out_len2);
+	for (c = 0; c < 2; c++)
+		for (i = 0; i < out_len1; i++)
+			spa_assert_se(fabsf(out1[c][i] - out2[c][i]) < 1e-6f);
+
+	resample_free(&r1);
+	resample_free(&r2);
+}
+
 int main(int argc, char *argv[])
 {
 	logger.log.level = SPA_LOG_LEVEL_TRACE;
 
 	test_native();
 	test_in_len();
+	test_shared_filter();
+	test_s16_input();
 
 	return 0;
 }
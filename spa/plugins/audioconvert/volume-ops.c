@@ -25,6 +25,9 @@ static const struct volume_info {
 	uint32_t cpu_flags;
 } volume_table[] =
 {
+#if defined (HAVE_AVX)
+	MAKE(volume_f32_avx, SPA_CPU_FLAG_AVX),
+#endif
 #if defined (HAVE_SSE)
 	MAKE(volume_f32_sse, SPA_CPU_FLAG_SSE),
 #endif
@@ -22,6 +22,7 @@
 #include <systemd/sd-journal.h>
 
 #include "log-patterns.h"
+#include "log-deferred.h"
 
 #define NAME "journal"
 
@@ -35,33 +36,16 @@ struct impl {
 	struct spa_log *chain_log;
 
 	struct spa_list patterns;
+
+	struct support_log_deferred *deferred;
 };
 
-static SPA_PRINTF_FUNC(7,0) void
-impl_log_logtv(void *object,
-	      enum spa_log_level level,
-	      const struct spa_log_topic *topic,
-	      const char *file,
-	      int line,
-	      const char *func,
-	      const char *fmt,
-	      va_list args)
+static void send_message(enum spa_log_level level, const char *file, int line,
+		const char *func, pid_t tid, const char *message)
 {
-	struct impl *impl = object;
 	char line_buffer[32];
 	char file_buffer[strlen("CODE_FILE=") + strlen(file) + 1];
-	char message_buffer[LINE_MAX];
 	int priority;
-	size_t sz = 0;
-
-	if (impl->chain_log != NULL) {
-		va_list args_copy;
-		va_copy(args_copy, args);
-		spa_log_logtv(impl->chain_log,
-			      level, topic,
-			      file, line, func, fmt, args_copy);
-		va_end(args_copy);
-	}
 
 	/* convert SPA log level to syslog priority */
 	switch (level) {
@@ -81,27 +65,77 @@ impl_log_logtv(void *object,
 		break;
 	}
 
-	if (topic)
-		sz = spa_scnprintf(message_buffer, sizeof(message_buffer),
-				   "%s: ", topic->topic);
-
 	/* we'll be using the low-level journal API, which expects us to provide
 	 * the location explicitly. line and file are to be passed as preformatted
 	 * entries, whereas the function name is passed as-is, and converted into
 	 * a field inside sd_journal_send_with_location(). */
 	snprintf(line_buffer, sizeof(line_buffer), "CODE_LINE=%d", line);
 	snprintf(file_buffer, sizeof(file_buffer), "CODE_FILE=%s", file);
-	vsnprintf(message_buffer + sz, sizeof(message_buffer) - sz, fmt, args);
 
 	sd_journal_send_with_location(file_buffer, line_buffer, func,
-				      "MESSAGE=%s", message_buffer,
+				      "MESSAGE=%s", message,
 				      "PRIORITY=%i", priority,
 #ifdef HAVE_GETTID
-				      "TID=%jd", (intmax_t) gettid(),
+				      "TID=%jd", (intmax_t) tid,
 #endif
 				      NULL);
 }
 
+static void on_deferred_message(void *data, const struct support_log_record *rec)
+{
+	char message_buffer[LINE_MAX];
+
+	if (rec->topic)
+		snprintf(message_buffer, sizeof(message_buffer), "%s: %s",
+				rec->topic, rec->message);
+	else
+		snprintf(message_buffer, sizeof(message_buffer), "%s", rec->message);
+
+	send_message(rec->level, rec->file ? rec->file : "", rec->line,
+			rec->func ? rec->func : "", rec->tid, message_buffer);
+}
+
+static SPA_PRINTF_FUNC(7,0) void
+impl_log_logtv(void *object,
+	      enum spa_log_level level,
+	      const struct spa_log_topic *topic,
+	      const char *file,
+	      int line,
+	      const char *func,
+	      const char *fmt,
+	      va_list args)
+{
+	struct impl *impl = object;
+	char message_buffer[LINE_MAX];
+	pid_t tid = 0;
+	size_t sz = 0;
+
+	if (impl->chain_log != NULL) {
+		va_list args_copy;
+		va_copy(args_copy, args);
+		spa_log_logtv(impl->chain_log,
+			      level, topic,
+			      file, line, func, fmt, args_copy);
+		va_end(args_copy);
+	}
+
+	if (impl->deferred != NULL &&
+	    support_log_deferred_push(impl->deferred, level, topic,
+		    file, line, func, fmt, args) >= 0)
+		return;
+
+	if (topic)
+		sz = spa_scnprintf(message_buffer, sizeof(message_buffer),
+				   "%s: ", topic->topic);
+
+	vsnprintf(message_buffer + sz, sizeof(message_buffer) - sz, fmt, args);
+
+#ifdef HAVE_GETTID
+	tid = gettid();
+#endif
+	send_message(level, file, line, func, tid, message_buffer);
+}
+
 static SPA_PRINTF_FUNC(6,7) void
 impl_log_log(void *object,
 	     enum spa_log_level level,
@@ -185,6 +219,11 @@ static int impl_clear(struct spa_handle *handle)
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
 
 	this = (struct impl *) handle;
+
+	if (this->deferred != NULL) {
+		support_log_deferred_free(this->deferred);
+		this->deferred = NULL;
+	}
 	support_log_free_patterns(&this->patterns);
 
 	return 0;
@@ -258,6 +297,9 @@ impl_init(const struct spa_handle_factory *factory,
 			impl->log.level = atoi(str);
 		if ((str = spa_dict_lookup(info, SPA_KEY_LOG_PATTERNS)) != NULL)
 			support_log_parse_patterns(&impl->patterns, str);
+		if ((str = spa_dict_lookup(info, SPA_KEY_LOG_DEFERRED)) != NULL &&
+		    spa_atob(str))
+			impl->deferred = support_log_deferred_new(on_deferred_message, impl);
 	}
 
 	/* if our stderr goes to the journal, there's no point in logging both
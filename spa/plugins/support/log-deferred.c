@@ -0,0 +1,684 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <spa/utils/atomic.h>
+#include <spa/utils/defs.h>
+#include <spa/utils/ringbuffer.h>
+#include <spa/utils/string.h>
+
+#include "log-deferred.h"
+
+#if defined(__FreeBSD__) || defined(__MidnightBSD__)
+#define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
+#endif
+
+/*
+ * Every thread that logs takes a ring from a fixed pool. A message is
+ * recorded in the ring with its format, the raw arguments and a timestamp
+ * and the formatting thread is woken up when it was idle. The formatting
+ * thread merges the rings in timestamp order and hands the formatted
+ * messages to the logger.
+ *
+ * The strings are copied into the ring, a module can be unloaded before
+ * its messages are formatted. Threads that don't get a ring and formats
+ * with conversions that can't be recorded are formatted by the caller.
+ * When a ring is full, the message is dropped and counted.
+ *
+ * Some rings are kept for realtime threads, they can't afford to format
+ * their messages. When a thread exits, its ring is only handed out again
+ * after the formatting thread emitted the remaining messages of the
+ * ring. Threads that did not get a ring try again after that.
+ *
+ * The logger is made before there is a spa_system, so this uses an
+ * eventfd directly.
+ */
+
+#define MAX_RINGS	16
+#define MAX_RT_RINGS	4	/* only for realtime threads */
+#define RING_SIZE	(32*1024)
+#define RING_MASK	(RING_SIZE-1)
+#define MAX_RECORD	2048
+#define MAX_STRING	512
+#define MAX_MESSAGE	1024
+#define MAX_SPEC	32
+
+enum arg_type {
+	ARG_NONE,
+	ARG_INT,
+	ARG_LONG,
+	ARG_LLONG,
+	ARG_INTMAX,
+	ARG_SIZE,
+	ARG_PTRDIFF,
+	ARG_DOUBLE,
+	ARG_LDOUBLE,
+	ARG_PTR,
+	ARG_STRING,
+};
+
+struct spec {
+	const char *start;
+	const char *end;
+	uint32_t n_star;
+	int precision;		/* -1 when not given, -2 from an argument */
+	enum arg_type type;
+	char conv;
+};
+
+struct arg {
+	uint32_t type;
+	uint32_t size;		/* of the string after the arg */
+	union {
+		int i;
+		long l;
+		long long ll;
+		intmax_t j;
+		size_t z;
+		ptrdiff_t t;
+		double d;
+		long double ld;
+		const void *p;
+	} v;
+};
+
+struct record {
+	uint32_t size;
+	uint32_t level;
+	uint64_t time;
+	int32_t line;
+	int32_t err;
+	uint16_t fmt_len;
+	uint16_t topic_len;
+	uint16_t file_len;
+	uint16_t func_len;
+};
+
+struct builder {
+	uint8_t *data;
+	uint32_t pos;
+	uint32_t size;
+	bool overflow;
+};
+
+enum ring_state {
+	RING_FREE,
+	RING_OWNED,
+	RING_RELEASED,		/* the owner exited, flush before reuse */
+};
+
+struct ring {
+	struct support_log_deferred *d;
+	int state;
+	pid_t tid;
+	uint32_t dropped;
+	struct spa_ringbuffer rb;
+	uint8_t data[RING_SIZE];
+};
+
+struct support_log_deferred {
+	support_log_write_t write;
+	void *data;
+
+	pthread_key_t key;
+	pthread_t thread;
+	int fd;
+	int running;
+	int wakeup;
+	uint32_t generation;	/* incremented when rings become free */
+
+	uint32_t n_rings;
+	struct ring rings[MAX_RINGS];
+};
+
+/* threads that did not get a ring keep the generation of the failed
+ * attempt, tagged with the low bit, and try again when it changes */
+#define NO_RING(gen)		((void *)(((uintptr_t)(gen) << 1) | 1))
+#define IS_NO_RING(p)		(((uintptr_t)(p) & 1) != 0)
+
+static const char *parse_spec(const char *p, struct spec *s)
+{
+	int length = 0;
+
+	s->start = p++;
+	s->n_star = 0;
+	s->precision = -1;
+
+	while (*p != '\0' && strchr("-+ #0'", *p) != NULL)
+		p++;
+	if (*p == '*') {
+		s->n_star++;
+		p++;
+	} else {
+		while (*p >= '0' && *p <= '9')
+			p++;
+	}
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			s->n_star++;
+			s->precision = -2;
+			p++;
+		} else {
+			s->precision = 0;
+			while (*p >= '0' && *p <= '9')
+				s->precision = s->precision * 10 + (*p++ - '0');
+		}
+	}
+	switch (*p) {
+	case 'h':
+		length = *++p == 'h' ? (p++, 'H') : 'h';
+		break;
+	case 'l':
+		length = *++p == 'l' ? (p++, 'q') : 'l';
+		break;
+	case 'q': case 'L': case 'j': case 'z': case 't':
+		length = *p++;
+		break;
+	}
+
+	s->conv = *p;
+	switch (s->conv) {
+	case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+		switch (length) {
+		case 'l': s->type = ARG_LONG; break;
+		case 'q': case 'L': s->type = ARG_LLONG; break;
+		case 'j': s->type = ARG_INTMAX; break;
+		case 'z': s->type = ARG_SIZE; break;
+		case 't': s->type = ARG_PTRDIFF; break;
+		default: s->type = ARG_INT; break;
+		}
+		break;
+	case 'c':
+		if (length != 0)
+			return NULL;
+		s->type = ARG_INT;
+		break;
+	case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+		s->type = length == 'L' ? ARG_LDOUBLE : ARG_DOUBLE;
+		break;
+	case 'p':
+		s->type = ARG_PTR;
+		break;
+	case 's':
+		if (length != 0)
+			return NULL;
+		s->type = ARG_STRING;
+		break;
+	case 'm':
+	case '%':
+		s->type = ARG_NONE;
+		break;
+	default:
+		/* %n, wide chars, positional arguments, ... */
+		return NULL;
+	}
+	s->end = p + 1;
+	if (s->end - s->start >= MAX_SPEC)
+		return NULL;
+	return s->end;
+}
+
+static void builder_add(struct builder *b, const void *data, uint32_t size)
+{
+	if (b->overflow || b->pos + size > b->size) {
+		b->overflow = true;
+		return;
+	}
+	memcpy(b->data + b->pos, data, size);
+	b->pos += size;
+}
+
+static void builder_align(struct builder *b)
+{
+	static const uint8_t zero[8];
+	builder_add(b, zero, SPA_ROUND_UP_N(b->pos, 8) - b->pos);
+}
+
+static uint16_t builder_add_string(struct builder *b, const char *str)
+{
+	size_t len;
+	if (str == NULL)
+		return 0;
+	if ((len = strlen(str) + 1) > UINT16_MAX) {
+		b->overflow = true;
+		return 0;
+	}
+	builder_add(b, str, len);
+	return len;
+}
+
+static void wakeup_thread(struct support_log_deferred *d)
+{
+	int err = errno;
+	if (SPA_ATOMIC_XCHG(d->wakeup, 1) == 0) {
+		uint64_t count = 1;
+		if (write(d->fd, &count, sizeof(count)) != sizeof(count))
+			SPA_ATOMIC_STORE(d->wakeup, 0);
+	}
+	errno = err;
+}
+
+/* called when the owner of the ring exits, the formatting thread frees
+ * the ring after it emitted the messages that are still in it */
+static void release_ring(void *data)
+{
+	struct ring *r = data;
+
+	if (IS_NO_RING(r))
+		return;
+	SPA_ATOMIC_STORE(r->state, RING_RELEASED);
+	wakeup_thread(r->d);
+}
+
+static bool is_rt_thread(void)
+{
+	struct sched_param param;
+	int policy;
+
+	if (pthread_getschedparam(pthread_self(), &policy, &param) != 0)
+		return false;
+	return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+static struct ring *get_ring(struct support_log_deferred *d)
+{
+	struct ring *r;
+	uint32_t i, n, n_max, gen;
+
+	if (SPA_LIKELY((r = pthread_getspecific(d->key)) != NULL)) {
+		if (SPA_LIKELY(!IS_NO_RING(r)))
+			return r;
+		if (r == NO_RING(SPA_ATOMIC_LOAD(d->generation)))
+			return NULL;
+	}
+
+	gen = SPA_ATOMIC_LOAD(d->generation);
+	n_max = is_rt_thread() ? MAX_RINGS : MAX_RINGS - MAX_RT_RINGS;
+
+	for (i = 0; i < n_max; i++) {
+		r = &d->rings[i];
+		if (!SPA_ATOMIC_CAS(r->state, RING_FREE, RING_OWNED))
+			continue;
+#ifdef __linux__
+		r->tid = syscall(SYS_gettid);
+#endif
+		while ((n = SPA_ATOMIC_LOAD(d->n_rings)) <= i &&
+		    !SPA_ATOMIC_CAS(d->n_rings, n, i + 1));
+		pthread_setspecific(d->key, r);
+		return r;
+	}
+	pthread_setspecific(d->key, NO_RING(gen));
+	return NULL;
+}
+
+int support_log_deferred_push(struct support_log_deferred *d,
+		enum spa_log_level level, const struct spa_log_topic *topic,
+		const char *file, int line, const char *func,
+		const char *fmt, va_list args)
+{
+	uint8_t buffer[MAX_RECORD];
+	struct builder b = { buffer, sizeof(struct record), sizeof(buffer), false };
+	struct record rec;
+	struct timespec now;
+	struct ring *r;
+	const char *p;
+	va_list ap;
+	uint32_t index;
+	int32_t filled;
+	int res = 0, err = errno;
+
+	if ((r = get_ring(d)) == NULL)
+		return -ENOSPC;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+
+	spa_zero(rec);
+	rec.level = level;
+	rec.time = SPA_TIMESPEC_TO_NSEC(&now);
+	rec.line = line;
+	rec.err = err;
+	rec.fmt_len = builder_add_string(&b, fmt);
+	rec.topic_len = builder_add_string(&b, topic ? topic->topic : NULL);
+	rec.file_len = builder_add_string(&b, file);
+	rec.func_len = builder_add_string(&b, func);
+	builder_align(&b);
+
+	va_copy(ap, args);
+	for (p = fmt; *p != '\0'; p++) {
+		struct spec s;
+		struct arg a;
+		const char *str = NULL;
+		int star[2] = { 0, 0 };
+		uint32_t i;
+
+		if (*p != '%')
+			continue;
+		if (parse_spec(p, &s) == NULL) {
+			res = -ENOTSUP;
+			break;
+		}
+		p = s.end - 1;
+
+		for (i = 0; i < s.n_star; i++) {
+			spa_zero(a);
+			a.type = ARG_INT;
+			a.v.i = star[i] = va_arg(ap, int);
+			builder_add(&b, &a, sizeof(a));
+		}
+		if (s.type == ARG_NONE)
+			continue;
+
+		spa_zero(a);
+		a.type = s.type;
+		switch (s.type) {
+		case ARG_INT: a.v.i = va_arg(ap, int); break;
+		case ARG_LONG: a.v.l = va_arg(ap, long); break;
+		case ARG_LLONG: a.v.ll = va_arg(ap, long long); break;
+		case ARG_INTMAX: a.v.j = va_arg(ap, intmax_t); break;
+		case ARG_SIZE: a.v.z = va_arg(ap, size_t); break;
+		case ARG_PTRDIFF: a.v.t = va_arg(ap, ptrdiff_t); break;
+		case ARG_DOUBLE: a.v.d = va_arg(ap, double); break;
+		case ARG_LDOUBLE: a.v.ld = va_arg(ap, long double); break;
+		case ARG_PTR: a.v.p = va_arg(ap, void *); break;
+		case ARG_STRING:
+		{
+			size_t max = MAX_STRING - 1;
+			int precision = s.precision == -2 ? star[s.n_star - 1] : s.precision;
+
+			if ((str = va_arg(ap, const char *)) == NULL)
+				str = "(null)";
+			/* strings with a precision don't need to be terminated */
+			if (precision >= 0 && (size_t)precision < max)
+				max = precision;
+			a.size = strnlen(str, max) + 1;
+			break;
+		}
+		default:
+			break;
+		}
+		builder_add(&b, &a, sizeof(a));
+		if (str != NULL) {
+			builder_add(&b, str, a.size - 1);
+			builder_add(&b, "", 1);
+			builder_align(&b);
+		}
+	}
+	va_end(ap);
+	errno = err;
+
+	if (res < 0)
+		return res;
+	if (b.overflow)
+		return -ENOSPC;
+
+	rec.size = b.pos;
+	memcpy(buffer, &rec, sizeof(rec));
+
+	filled = spa_ringbuffer_get_write_index(&r->rb, &index);
+	if (filled < 0 || filled + rec.size > RING_SIZE) {
+		SPA_ATOMIC_INC(r->dropped);
+		return 0;
+	}
+	spa_ringbuffer_write_data(&r->rb, r->data, RING_SIZE,
+			index & RING_MASK, buffer, rec.size);
+	spa_ringbuffer_write_update(&r->rb, index + rec.size);
+
+	wakeup_thread(d);
+
+	return 0;
+}
+
+#define FORMAT(dst,size,spec,s,star,v)							\
+	((s)->n_star == 0 ? spa_scnprintf(dst, size, spec, v) :				\
+	 (s)->n_star == 1 ? spa_scnprintf(dst, size, spec, (star)[0], v) :		\
+	 spa_scnprintf(dst, size, spec, (star)[0], (star)[1], v))
+
+static int format_arg(char *dst, size_t size, const char *spec, const struct spec *s,
+		const int *star, const struct arg *a, const char *str)
+{
+	switch (a->type) {
+	case ARG_INT: return FORMAT(dst, size, spec, s, star, a->v.i);
+	case ARG_LONG: return FORMAT(dst, size, spec, s, star, a->v.l);
+	case ARG_LLONG: return FORMAT(dst, size, spec, s, star, a->v.ll);
+	case ARG_INTMAX: return FORMAT(dst, size, spec, s, star, a->v.j);
+	case ARG_SIZE: return FORMAT(dst, size, spec, s, star, a->v.z);
+	case ARG_PTRDIFF: return FORMAT(dst, size, spec, s, star, a->v.t);
+	case ARG_DOUBLE: return FORMAT(dst, size, spec, s, star, a->v.d);
+	case ARG_LDOUBLE: return FORMAT(dst, size, spec, s, star, a->v.ld);
+	case ARG_PTR: return FORMAT(dst, size, spec, s, star, a->v.p);
+	case ARG_STRING: return FORMAT(dst, size, spec, s, star, str);
+	default:
+		return 0;
+	}
+}
+
+static void emit_record(struct support_log_deferred *d, struct ring *r, const uint8_t *buffer)
+{
+	struct record rec;
+	struct support_log_record lr;
+	const char *fmt, *p;
+	char message[MAX_MESSAGE];
+	uint32_t pos;
+	int len = 0;
+
+	memcpy(&rec, buffer, sizeof(rec));
+
+	pos = sizeof(rec);
+	fmt = (const char *)buffer + pos;
+	pos += rec.fmt_len;
+
+	spa_zero(lr);
+	lr.level = rec.level;
+	lr.topic = rec.topic_len ? (const char *)buffer + pos : NULL;
+	pos += rec.topic_len;
+	lr.file = rec.file_len ? (const char *)buffer + pos : NULL;
+	pos += rec.file_len;
+	lr.func = rec.func_len ? (const char *)buffer + pos : NULL;
+	pos += rec.func_len;
+	pos = SPA_ROUND_UP_N(pos, 8);
+
+	lr.line = rec.line;
+	lr.time = rec.time;
+	lr.tid = r->tid;
+
+	for (p = fmt; *p != '\0' && len < MAX_MESSAGE - 1; ) {
+		struct spec s;
+		struct arg a;
+		char spec[MAX_SPEC];
+		const char *str = NULL;
+		int star[2] = { 0, 0 };
+		uint32_t i;
+
+		if (*p != '%') {
+			message[len++] = *p++;
+			continue;
+		}
+		parse_spec(p, &s);
+		p = s.end;
+
+		for (i = 0; i < s.n_star; i++) {
+			memcpy(&a, buffer + pos, sizeof(a));
+			pos += sizeof(a);
+			star[i] = a.v.i;
+		}
+		if (s.conv == '%') {
+			message[len++] = '%';
+			continue;
+		}
+		if (s.conv == 'm') {
+			len += spa_scnprintf(message + len, sizeof(message) - len,
+					"%s", strerror(rec.err));
+			continue;
+		}
+		memcpy(&a, buffer + pos, sizeof(a));
+		pos += sizeof(a);
+		if (a.type == ARG_STRING) {
+			str = (const char *)buffer + pos;
+			pos = SPA_ROUND_UP_N(pos + a.size, 8);
+		}
+		memcpy(spec, s.start, s.end - s.start);
+		spec[s.end - s.start] = '\0';
+
+		len += format_arg(message + len, sizeof(message) - len, spec, &s, star, &a, str);
+	}
+	message[len] = '\0';
+
+	lr.message = message;
+	lr.len = len;
+	d->write(d->data, &lr);
+}
+
+static void flush_rings(struct support_log_deferred *d)
+{
+	uint8_t buffer[MAX_RECORD];
+	uint32_t i, n_rings = SPA_ATOMIC_LOAD(d->n_rings);
+	bool released[MAX_RINGS];
+
+	/* the owners of these rings exited, everything they logged is in
+	 * the ring and is emitted below */
+	for (i = 0; i < n_rings; i++)
+		released[i] = SPA_ATOMIC_LOAD(d->rings[i].state) == RING_RELEASED;
+
+	while (true) {
+		struct ring *best = NULL;
+		struct record rec, best_rec;
+		uint32_t index, best_index = 0;
+
+		/* the oldest message of all threads */
+		for (i = 0; i < n_rings; i++) {
+			struct ring *r = &d->rings[i];
+
+			if (spa_ringbuffer_get_read_index(&r->rb, &index) < (int32_t)sizeof(rec))
+				continue;
+			spa_ringbuffer_read_data(&r->rb, r->data, RING_SIZE,
+					index & RING_MASK, &rec, sizeof(rec));
+			if (best == NULL || rec.time < best_rec.time) {
+				best = r;
+				best_rec = rec;
+				best_index = index;
+			}
+		}
+		if (best == NULL)
+			break;
+
+		spa_ringbuffer_read_data(&best->rb, best->data, RING_SIZE,
+				best_index & RING_MASK, buffer, best_rec.size);
+		spa_ringbuffer_read_update(&best->rb, best_index + best_rec.size);
+
+		emit_record(d, best, buffer);
+	}
+
+	for (i = 0; i < n_rings; i++) {
+		struct ring *r = &d->rings[i];
+		struct support_log_record lr;
+		struct timespec now;
+		char message[64];
+		uint32_t dropped;
+
+		if ((dropped = SPA_ATOMIC_XCHG(r->dropped, 0)) == 0)
+			continue;
+
+		clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+		spa_zero(lr);
+		lr.level = SPA_LOG_LEVEL_WARN;
+		lr.time = SPA_TIMESPEC_TO_NSEC(&now);
+		lr.tid = r->tid;
+		lr.message = message;
+		lr.len = spa_scnprintf(message, sizeof(message),
+				"%u log messages dropped", dropped);
+		d->write(d->data, &lr);
+	}
+
+	for (i = 0; i < n_rings; i++) {
+		struct ring *r = &d->rings[i];
+
+		if (!released[i])
+			continue;
+		r->tid = 0;
+		SPA_ATOMIC_STORE(r->state, RING_FREE);
+		SPA_ATOMIC_INC(d->generation);
+	}
+}
+
+static void *deferred_thread(void *data)
+{
+	struct support_log_deferred *d = data;
+	uint64_t count;
+
+	while (SPA_ATOMIC_LOAD(d->running)) {
+		if (read(d->fd, &count, sizeof(count)) < 0 && errno != EINTR)
+			break;
+		SPA_ATOMIC_STORE(d->wakeup, 0);
+		flush_rings(d);
+	}
+	return NULL;
+}
+
+struct support_log_deferred *support_log_deferred_new(support_log_write_t write, void *data)
+{
+	struct support_log_deferred *d;
+	uint32_t i;
+	int res;
+
+	if ((d = calloc(1, sizeof(*d))) == NULL)
+		return NULL;
+
+	d->write = write;
+	d->data = data;
+	for (i = 0; i < MAX_RINGS; i++) {
+		d->rings[i].d = d;
+		spa_ringbuffer_init(&d->rings[i].rb);
+	}
+
+	if ((res = pthread_key_create(&d->key, release_ring)) != 0)
+		goto error_free;
+	if ((d->fd = eventfd(0, EFD_CLOEXEC)) < 0) {
+		res = errno;
+		goto error_key;
+	}
+	d->running = 1;
+	if ((res = pthread_create(&d->thread, NULL, deferred_thread, d)) != 0)
+		goto error_close;
+
+	return d;
+
+error_close:
+	close(d->fd);
+error_key:
+	pthread_key_delete(d->key);
+error_free:
+	free(d);
+	errno = res;
+	return NULL;
+}
+
+void support_log_deferred_free(struct support_log_deferred *d)
+{
+	uint64_t count = 1;
+
+	SPA_ATOMIC_STORE(d->running, 0);
+	if (write(d->fd, &count, sizeof(count)) != sizeof(count))
+		fprintf(stderr, "error signaling eventfd: %m\n");
+	pthread_join(d->thread, NULL);
+
+	flush_rings(d);
+
+	close(d->fd);
+	pthread_key_delete(d->key);
+	free(d);
+}
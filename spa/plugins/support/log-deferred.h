@@ -0,0 +1,40 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef LOG_DEFERRED_H
+#define LOG_DEFERRED_H
+
+#include <stdarg.h>
+#include <sys/types.h>
+
+#include <spa/support/log.h>
+
+struct support_log_deferred;
+
+struct support_log_record {
+	enum spa_log_level level;
+	const char *topic;
+	const char *file;
+	int line;
+	const char *func;
+	uint64_t time;		/**< CLOCK_MONOTONIC_RAW when logged */
+	pid_t tid;		/**< the logging thread or 0 */
+	const char *message;
+	int len;
+};
+
+/** called from the formatting thread with the formatted message */
+typedef void (*support_log_write_t) (void *data, const struct support_log_record *rec);
+
+struct support_log_deferred *support_log_deferred_new(support_log_write_t write, void *data);
+void support_log_deferred_free(struct support_log_deferred *d);
+
+/** Record the message and its arguments for the formatting thread. Returns
+ * < 0 when the message needs to be formatted by the caller. */
+SPA_PRINTF_FUNC(7,0) int support_log_deferred_push(struct support_log_deferred *d,
+		enum spa_log_level level, const struct spa_log_topic *topic,
+		const char *file, int line, const char *func,
+		const char *fmt, va_list args);
+
+#endif /* LOG_DEFERRED_H */
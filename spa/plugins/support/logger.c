@@ -21,6 +21,7 @@
 #include <spa/utils/ansi.h>
 
 #include "log-patterns.h"
+#include "log-deferred.h"
 
 #if defined(__FreeBSD__) || defined(__MidnightBSD__)
 #define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
@@ -44,6 +45,8 @@ struct impl {
 	struct spa_ringbuffer trace_rb;
 	uint8_t trace_data[TRACE_BUFFER];
 
+	struct support_log_deferred *deferred;
+
 	unsigned int have_source:1;
 	unsigned int colors:1;
 	unsigned int timestamp:1;
@@ -52,19 +55,19 @@ struct impl {
 	struct spa_list patterns;
 };
 
-static SPA_PRINTF_FUNC(7,0) void
-impl_log_logtv(void *object,
+static SPA_PRINTF_FUNC(8,0) void
+format_message(struct impl *impl,
 	      enum spa_log_level level,
-	      const struct spa_log_topic *topic,
+	      const char *topic,
 	      const char *file,
 	      int line,
 	      const char *func,
+	      uint64_t time,
 	      const char *fmt,
 	      va_list args)
 {
 #define RESERVED_LENGTH 24
 
-	struct impl *impl = object;
 	char timestamp[15] = {0};
 	char topicstr[32] = {0};
 	char filename[64] = {0};
@@ -74,7 +77,8 @@ impl_log_logtv(void *object,
 	int size, len;
 	bool do_trace;
 
-	if ((do_trace = (level == SPA_LOG_LEVEL_TRACE && impl->have_source)))
+	if ((do_trace = (level == SPA_LOG_LEVEL_TRACE && impl->have_source &&
+			impl->deferred == NULL)))
 		level++;
 
 	if (impl->colors) {
@@ -93,16 +97,21 @@ impl_log_logtv(void *object,
 
 	if (impl->timestamp) {
 		struct timespec now;
-		clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+		if (time == 0) {
+			clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+		} else {
+			now.tv_sec = time / SPA_NSEC_PER_SEC;
+			now.tv_nsec = time % SPA_NSEC_PER_SEC;
+		}
 		spa_scnprintf(timestamp, sizeof(timestamp), "[%05lu.%06lu]",
 			(now.tv_sec & 0x1FFFFFFF) % 100000, now.tv_nsec / 1000);
 	}
 
-	if (topic && topic->topic)
-		spa_scnprintf(topicstr, sizeof(topicstr), " %-12s | ", topic->topic);
+	if (topic)
+		spa_scnprintf(topicstr, sizeof(topicstr), " %-12s | ", topic);
 
 
-	if (impl->line && line != 0) {
+	if (impl->line && line != 0 && file != NULL) {
 		s = strrchr(file, '/');
 		spa_scnprintf(filename, sizeof(filename), "[%16.16s:%5i %s()]",
 			s ? s + 1 : file, line, func);
@@ -152,6 +161,51 @@ impl_log_logtv(void *object,
 #undef RESERVED_LENGTH
 }
 
+static SPA_PRINTF_FUNC(8,9) void
+format_message_args(struct impl *impl,
+	      enum spa_log_level level,
+	      const char *topic,
+	      const char *file,
+	      int line,
+	      const char *func,
+	      uint64_t time,
+	      const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	format_message(impl, level, topic, file, line, func, time, fmt, args);
+	va_end(args);
+}
+
+static void on_deferred_message(void *data, const struct support_log_record *rec)
+{
+	struct impl *impl = data;
+	format_message_args(impl, rec->level, rec->topic, rec->file, rec->line,
+			rec->func, rec->time, "%s", rec->message);
+}
+
+static SPA_PRINTF_FUNC(7,0) void
+impl_log_logtv(void *object,
+	      enum spa_log_level level,
+	      const struct spa_log_topic *topic,
+	      const char *file,
+	      int line,
+	      const char *func,
+	      const char *fmt,
+	      va_list args)
+{
+	struct impl *impl = object;
+
+	/* format on the logging thread when the message can't be deferred */
+	if (impl->deferred != NULL &&
+	    support_log_deferred_push(impl->deferred, level, topic,
+		    file, line, func, fmt, args) >= 0)
+		return;
+
+	format_message(impl, level, topic ? topic->topic : NULL,
+			file, line, func, 0, fmt, args);
+}
+
 static SPA_PRINTF_FUNC(6,0) void
 impl_log_logv(void *object,
 	      enum spa_log_level level,
@@ -264,6 +318,12 @@ static int impl_clear(struct spa_handle *handle)
 
 	this = (struct impl *) handle;
 
+	/* flushes the pending messages */
+	if (this->deferred != NULL) {
+		support_log_deferred_free(this->deferred);
+		this->deferred = NULL;
+	}
+
 	support_log_free_patterns(&this->patterns);
 
 	if (this->close_file && this->file != NULL)
@@ -296,6 +356,7 @@ impl_init(const struct spa_handle_factory *factory,
 	const char *str, *dest = "";
 	bool linebuf = false;
 	bool force_colors = false;
+	bool deferred = false;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -360,6 +421,8 @@ impl_init(const struct spa_handle_factory *factory,
 		}
 		if ((str = spa_dict_lookup(info, SPA_KEY_LOG_PATTERNS)) != NULL)
 			support_log_parse_patterns(&this->patterns, str);
+		if ((str = spa_dict_lookup(info, SPA_KEY_LOG_DEFERRED)) != NULL)
+			deferred = spa_atob(str);
 	}
 	if (this->file == NULL) {
 		this->file = stderr;
@@ -376,7 +439,14 @@ impl_init(const struct spa_handle_factory *factory,
 
 	spa_ringbuffer_init(&this->trace_rb);
 
-	spa_log_debug(&this->log, NAME " %p: initialized to %s linebuf:%u", this, dest, linebuf);
+	if (deferred) {
+		this->deferred = support_log_deferred_new(on_deferred_message, this);
+		if (this->deferred == NULL)
+			fprintf(stderr, "Warning: failed to start log thread: %m\n");
+	}
+
+	spa_log_debug(&this->log, NAME " %p: initialized to %s linebuf:%u deferred:%u",
+			this, dest, linebuf, this->deferred != NULL);
 
 	return 0;
 }
@@ -14,6 +14,7 @@
 #include <spa/support/system.h>
 #include <spa/support/log.h>
 #include <spa/support/plugin.h>
+#include <spa/utils/atomic.h>
 #include <spa/utils/list.h>
 #include <spa/utils/names.h>
 #include <spa/utils/ratelimit.h>
@@ -30,18 +31,41 @@ static struct spa_log_topic log_topic = SPA_LOG_TOPIC(0, "spa.loop");
 #define ITEM_ALIGN	8
 #define DATAS_SIZE	(4096*8)
 #define MAX_EP		32
+#define MAX_QUEUES	128
 
 /** \cond */
 
 struct invoke_item {
-	size_t item_size;
+	size_t item_size;		/**< 0 for items on the heap */
 	spa_invoke_func_t func;
 	uint32_t seq;
+	uint32_t count;			/**< order of the invoke */
 	void *data;
 	size_t size;
 	bool block;
 	void *user_data;
 	int res;
+	int ack_fd;
+	struct invoke_item *next;	/**< next item on the heap */
+};
+
+/* Items that did not fit in a queue. */
+struct overflow {
+	struct invoke_item *head;	/**< pushed by the threads, newest first */
+	struct invoke_item *pending;	/**< taken by the loop, oldest first */
+};
+
+/* The invoke queue of one thread. Only the thread that owns the queue
+ * writes into it and only the loop reads from it. */
+struct queue {
+	struct impl *impl;
+	bool owned;
+	int ack_fd;
+	struct overflow overflow;
+
+	struct spa_ringbuffer buffer;
+	uint8_t *buffer_data;
+	uint8_t buffer_mem[DATAS_SIZE + MAX_ALIGN];
 };
 
 static int loop_signal_event(void *object, struct spa_source *source);
@@ -64,12 +88,18 @@ struct impl {
 	int enter_count;
 
 	struct spa_source *wakeup;
-	int ack_fd;
+	int wakeup_pending;
 	struct spa_ratelimit rate_limit;
 
-	struct spa_ringbuffer buffer;
-	uint8_t *buffer_data;
-	uint8_t buffer_mem[DATAS_SIZE + MAX_ALIGN];
+	pthread_key_t queue_key;
+	bool have_key;
+	pthread_mutex_t queue_lock;
+	uint32_t n_queues;
+	struct queue *queues[MAX_QUEUES];
+
+	uint32_t count;
+	/* items of the threads without a queue */
+	struct overflow overflow;
 
 	uint32_t flush_count;
 	unsigned int polling:1;
@@ -153,22 +183,93 @@ static int loop_remove_source(void *object, struct spa_source *source)
 	return res;
 }
 
+static void overflow_push(struct overflow *o, struct invoke_item *item)
+{
+	item->next = __atomic_load_n(&o->head, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&o->head, &item->next, item,
+			true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static struct invoke_item *overflow_peek(struct overflow *o)
+{
+	struct invoke_item *item, *next;
+
+	if (o->pending == NULL) {
+		/* take the pushed items and put them in the order of the pushes */
+		item = __atomic_exchange_n(&o->head, NULL, __ATOMIC_ACQUIRE);
+		for (; item; item = next) {
+			next = item->next;
+			item->next = o->pending;
+			o->pending = item;
+		}
+	}
+	return o->pending;
+}
+
+static inline bool item_older(struct invoke_item *item, struct invoke_item *best)
+{
+	return best == NULL || (int32_t)(item->count - best->count) < 0;
+}
+
+/* find the oldest item in the queues and the overflow lists. Items of one
+ * thread are always returned in the order they were invoked. */
+static struct invoke_item *peek_item(struct impl *impl, struct queue **queue,
+		uint32_t *index, struct overflow **overflow)
+{
+	struct invoke_item *best = NULL, *item;
+	uint32_t i, n_queues, idx;
+
+	n_queues = __atomic_load_n(&impl->n_queues, __ATOMIC_ACQUIRE);
+	for (i = 0; i < n_queues; i++) {
+		struct queue *q = impl->queues[i];
+
+		if (spa_ringbuffer_get_read_index(&q->buffer, &idx) > 0) {
+			item = SPA_PTROFF(q->buffer_data, idx & (DATAS_SIZE - 1), struct invoke_item);
+			if (item_older(item, best)) {
+				best = item;
+				*queue = q;
+				*index = idx;
+				*overflow = NULL;
+			}
+		}
+		/* the thread pushes to the overflow before it writes newer
+		 * items in the queue, so this is read after the queue */
+		if ((item = overflow_peek(&q->overflow)) != NULL &&
+		    item_older(item, best)) {
+			best = item;
+			*queue = NULL;
+			*overflow = &q->overflow;
+		}
+	}
+	if ((item = overflow_peek(&impl->overflow)) != NULL &&
+	    item_older(item, best)) {
+		best = item;
+		*queue = NULL;
+		*overflow = &impl->overflow;
+	}
+	return best;
+}
+
 static void flush_items(struct impl *impl)
 {
-	uint32_t index, flush_count;
-	int32_t avail;
-	int res;
+	uint32_t index = 0, flush_count;
+	struct invoke_item *item;
+	struct queue *queue = NULL;
+	struct overflow *overflow = NULL;
+	int res = 0;
+
+	/* new items after this will signal the wakeup event again */
+	SPA_ATOMIC_STORE(impl->wakeup_pending, 0);
 
 	flush_count = ++impl->flush_count;
-	avail = spa_ringbuffer_get_read_index(&impl->buffer, &index);
-	while (avail > 0) {
-		struct invoke_item *item;
+	while ((item = peek_item(impl, &queue, &index, &overflow)) != NULL) {
 		bool block;
+		int ack_fd;
 		spa_invoke_func_t func;
 
-		item = SPA_PTROFF(impl->buffer_data, index & (DATAS_SIZE - 1), struct invoke_item);
 		block = item->block;
 		func = item->func;
+		ack_fd = item->ack_fd;
 
 		spa_log_trace_fp(impl->log, "%p: flush item %p", impl, item);
 		/* first we remove the function from the item so that recursive
@@ -177,22 +278,29 @@ static void flush_items(struct impl *impl)
 		 * might get overwritten. */
 		item->func = NULL;
 		if (func)
-			item->res = func(&impl->loop, true, item->seq, item->data,
+			res = func(&impl->loop, true, item->seq, item->data,
 				item->size, item->user_data);
 
 		/* if this function did a recursive invoke, it now flushed the
-		 * ringbuffer and we can exit */
+		 * queues and we can exit */
 		if (flush_count != impl->flush_count)
 			break;
 
-		index += item->item_size;
-		avail -= item->item_size;
-		spa_ringbuffer_read_update(&impl->buffer, index);
-
+		if (func)
+			item->res = res;
+
+		if (queue != NULL) {
+			spa_ringbuffer_read_update(&queue->buffer, index + item->item_size);
+		} else {
+			overflow->pending = item->next;
+			/* the caller frees the blocking items */
+			if (!block)
+				free(item);
+		}
 		if (block) {
-			if ((res = spa_system_eventfd_write(impl->system, impl->ack_fd, 1)) < 0)
+			if ((res = spa_system_eventfd_write(impl->system, ack_fd, 1)) < 0)
 				spa_log_warn(impl->log, "%p: failed to write event fd:%d: %s",
-						impl, impl->ack_fd, spa_strerror(res));
+						impl, ack_fd, spa_strerror(res));
 		}
 	}
 }
@@ -213,96 +321,249 @@ loop_invoke_inthread(struct impl *impl,
 	return func ? func(&impl->loop, true, seq, data, size, user_data) : 0;
 }
 
-static int
-loop_invoke(void *object,
-	    spa_invoke_func_t func,
-	    uint32_t seq,
-	    const void *data,
-	    size_t size,
-	    bool block,
-	    void *user_data)
+static void overflow_clear(struct overflow *o)
 {
-	struct impl *impl = object;
 	struct invoke_item *item;
+
+	while ((item = overflow_peek(o)) != NULL) {
+		o->pending = item->next;
+		if (!item->block)
+			free(item);
+	}
+}
+
+static void queue_free(struct queue *queue)
+{
+	struct impl *impl = queue->impl;
+	overflow_clear(&queue->overflow);
+	spa_system_close(impl->system, queue->ack_fd);
+	free(queue);
+}
+
+static struct queue *queue_new(struct impl *impl)
+{
+	struct queue *queue;
 	int res;
+
+	if ((queue = calloc(1, sizeof(*queue))) == NULL)
+		return NULL;
+
+	queue->impl = impl;
+	queue->buffer_data = SPA_PTR_ALIGN(queue->buffer_mem, MAX_ALIGN, uint8_t);
+	spa_ringbuffer_init(&queue->buffer);
+
+	if ((res = spa_system_eventfd_create(impl->system,
+			SPA_FD_EVENT_SEMAPHORE | SPA_FD_CLOEXEC)) < 0) {
+		spa_log_error(impl->log, "%p: can't create ack event: %s",
+				impl, spa_strerror(res));
+		free(queue);
+		errno = -res;
+		return NULL;
+	}
+	queue->ack_fd = res;
+	return queue;
+}
+
+/* called when a thread with a queue exits, the queue is given to the next
+ * thread that needs one */
+static void queue_release(void *data)
+{
+	struct queue *queue = data;
+	struct impl *impl = queue->impl;
+
+	pthread_mutex_lock(&impl->queue_lock);
+	queue->owned = false;
+	pthread_mutex_unlock(&impl->queue_lock);
+}
+
+static struct queue *get_queue(struct impl *impl)
+{
+	struct queue *queue = NULL;
+	uint32_t i, n_queues;
+
+	if (!impl->have_key)
+		return NULL;
+	if ((queue = pthread_getspecific(impl->queue_key)) != NULL)
+		return queue;
+
+	pthread_mutex_lock(&impl->queue_lock);
+	n_queues = impl->n_queues;
+	for (i = 0; i < n_queues; i++) {
+		if (!impl->queues[i]->owned) {
+			queue = impl->queues[i];
+			break;
+		}
+	}
+	if (queue == NULL && n_queues < MAX_QUEUES &&
+	    (queue = queue_new(impl)) != NULL) {
+		impl->queues[n_queues] = queue;
+		__atomic_store_n(&impl->n_queues, n_queues + 1, __ATOMIC_RELEASE);
+	}
+	if (queue != NULL) {
+		queue->owned = true;
+		pthread_setspecific(impl->queue_key, queue);
+	}
+	pthread_mutex_unlock(&impl->queue_lock);
+
+	return queue;
+}
+
+static struct invoke_item *queue_add_item(struct queue *queue, size_t size, uint32_t *index)
+{
+	struct impl *impl = queue->impl;
+	struct invoke_item *item;
 	int32_t filled;
 	uint32_t avail, idx, offset, l0;
+	size_t item_size;
 
-	/* the ringbuffer can only be written to from one thread, if we are
-	 * in the same thread as the loop, don't write into the ringbuffer
-	 * but try to emit the calback right away after flushing what we have */
-	if (impl->thread == 0 || pthread_equal(impl->thread, pthread_self()))
-		return loop_invoke_inthread(impl, func, seq, data, size, block, user_data);
-
-	filled = spa_ringbuffer_get_write_index(&impl->buffer, &idx);
+	filled = spa_ringbuffer_get_write_index(&queue->buffer, &idx);
 	if (filled < 0 || filled > DATAS_SIZE) {
 		spa_log_warn(impl->log, "%p: queue xrun %d", impl, filled);
-		return -EPIPE;
+		return NULL;
 	}
 	avail = DATAS_SIZE - filled;
-	if (avail < sizeof(struct invoke_item)) {
-		spa_log_warn(impl->log, "%p: queue full %d", impl, avail);
-		return -EPIPE;
-	}
+	if (avail < sizeof(struct invoke_item))
+		return NULL;
+
 	offset = idx & (DATAS_SIZE - 1);
 
 	/* l0 is remaining size in ringbuffer, this should always be larger than
 	 * invoke_item, see below */
 	l0 = DATAS_SIZE - offset;
 
-	item = SPA_PTROFF(impl->buffer_data, offset, struct invoke_item);
-	item->func = func;
-	item->seq = seq;
-	item->size = size;
-	item->block = block;
-	item->user_data = user_data;
-	item->res = 0;
-	item->item_size = SPA_ROUND_UP_N(sizeof(struct invoke_item) + size, ITEM_ALIGN);
+	item = SPA_PTROFF(queue->buffer_data, offset, struct invoke_item);
+	item_size = SPA_ROUND_UP_N(sizeof(struct invoke_item) + size, ITEM_ALIGN);
 
-	spa_log_trace_fp(impl->log, "%p: add item %p filled:%d", impl, item, filled);
-
-	if (l0 >= item->item_size) {
+	if (l0 >= item_size) {
 		/* item + size fit in current ringbuffer idx */
 		item->data = SPA_PTROFF(item, sizeof(struct invoke_item), void);
-		if (l0 < sizeof(struct invoke_item) + item->item_size) {
+		if (l0 < sizeof(struct invoke_item) + item_size) {
 			/* not enough space for next invoke_item, fill up till the end
 			 * so that the next item will be at the start */
-			item->item_size = l0;
+			item_size = l0;
 		}
 	} else {
 		/* item does not fit, place the invoke_item at idx and start the
 		 * data at the start of the ringbuffer */
-		item->data = impl->buffer_data;
-		item->item_size = SPA_ROUND_UP_N(l0 + size, ITEM_ALIGN);
+		item->data = queue->buffer_data;
+		item_size = SPA_ROUND_UP_N(l0 + size, ITEM_ALIGN);
 	}
-	if (avail < item->item_size) {
+	if (avail < item_size)
+		return NULL;
+
+	item->item_size = item_size;
+	item->ack_fd = queue->ack_fd;
+	*index = idx;
+	return item;
+}
+
+static struct invoke_item *alloc_item(size_t size)
+{
+	struct invoke_item *item;
+
+	if ((item = calloc(1, sizeof(struct invoke_item) + size)) == NULL)
+		return NULL;
+	item->data = SPA_PTROFF(item, sizeof(struct invoke_item), void);
+	item->ack_fd = -1;
+	return item;
+}
+
+static int
+loop_invoke(void *object,
+	    spa_invoke_func_t func,
+	    uint32_t seq,
+	    const void *data,
+	    size_t size,
+	    bool block,
+	    void *user_data)
+{
+	struct impl *impl = object;
+	struct queue *queue;
+	struct overflow *overflow = NULL;
+	struct invoke_item *item = NULL;
+	uint32_t idx = 0;
+	bool close_ack = false;
+	int res;
+
+	/* the loop reads the queues from its own thread, if we are
+	 * in the same thread as the loop, don't write into a queue
+	 * but try to emit the calback right away after flushing what we have */
+	if (impl->thread == 0 || pthread_equal(impl->thread, pthread_self()))
+		return loop_invoke_inthread(impl, func, seq, data, size, block, user_data);
+
+	if ((queue = get_queue(impl)) != NULL)
+		item = queue_add_item(queue, size, &idx);
+
+	if (item == NULL) {
 		int suppressed;
 		uint64_t nsec = get_time_ns(impl->system);
-		if ((suppressed = spa_ratelimit_test(&impl->rate_limit, nsec)) >= 0) {
-			spa_log_warn(impl->log, "%p: queue full %d, need %zd (%d suppressed)",
-					impl, avail, item->item_size, suppressed);
+
+		/* no queue or the queue is full, place the item on the heap */
+		if ((item = alloc_item(size)) == NULL)
+			return -errno;
+
+		pthread_mutex_lock(&impl->queue_lock);
+		suppressed = spa_ratelimit_test(&impl->rate_limit, nsec);
+		pthread_mutex_unlock(&impl->queue_lock);
+		if (suppressed >= 0) {
+			spa_log_warn(impl->log, "%p: queue full, need %zd (%d suppressed)",
+					impl, size, suppressed);
+		}
+		if (block) {
+			if (queue != NULL) {
+				item->ack_fd = queue->ack_fd;
+			} else if ((res = spa_system_eventfd_create(impl->system,
+					SPA_FD_EVENT_SEMAPHORE | SPA_FD_CLOEXEC)) < 0) {
+				free(item);
+				return res;
+			} else {
+				item->ack_fd = res;
+				close_ack = true;
+			}
 		}
-		return -EPIPE;
+		overflow = queue ? &queue->overflow : &impl->overflow;
+		queue = NULL;
 	}
+	item->func = func;
+	item->seq = seq;
+	item->size = size;
+	item->block = block;
+	item->user_data = user_data;
+	item->res = 0;
+	item->count = SPA_ATOMIC_INC(impl->count);
+
+	spa_log_trace_fp(impl->log, "%p: add item %p queue:%p", impl, item, queue);
+
 	if (data && size > 0)
 		memcpy(item->data, data, size);
 
-	spa_ringbuffer_write_update(&impl->buffer, idx + item->item_size);
+	if (queue != NULL)
+		spa_ringbuffer_write_update(&queue->buffer, idx + item->item_size);
+	else
+		overflow_push(overflow, item);
 
-	loop_signal_event(impl, impl->wakeup);
+	/* only signal when the loop has not been woken up yet */
+	if (SPA_ATOMIC_XCHG(impl->wakeup_pending, 1) == 0)
+		loop_signal_event(impl, impl->wakeup);
 
 	if (block) {
 		uint64_t count = 1;
+		int ack_fd = item->ack_fd;
 
 		spa_loop_control_hook_before(&impl->hooks_list);
 
-		if ((res = spa_system_eventfd_read(impl->system, impl->ack_fd, &count)) < 0)
+		if ((res = spa_system_eventfd_read(impl->system, ack_fd, &count)) < 0)
 			spa_log_warn(impl->log, "%p: failed to read event fd:%d: %s",
-					impl, impl->ack_fd, spa_strerror(res));
+					impl, ack_fd, spa_strerror(res));
 
 		spa_loop_control_hook_after(&impl->hooks_list);
 
 		res = item->res;
+
+		if (close_ack)
+			spa_system_close(impl->system, ack_fd);
+		if (queue == NULL)
+			free(item);
 	}
 	else {
 		if (seq != SPA_ID_INVALID)
@@ -946,6 +1207,7 @@ static int impl_clear(struct spa_handle *handle)
 {
 	struct impl *impl;
 	struct source_impl *source;
+	uint32_t i;
 
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
 
@@ -958,7 +1220,13 @@ static int impl_clear(struct spa_handle *handle)
 	spa_list_consume(source, &impl->source_list, link)
 		loop_destroy_source(impl, &source->source);
 
-	spa_system_close(impl->system, impl->ack_fd);
+	if (impl->have_key)
+		pthread_key_delete(impl->queue_key);
+	overflow_clear(&impl->overflow);
+	for (i = 0; i < impl->n_queues; i++)
+		queue_free(impl->queues[i]);
+	pthread_mutex_destroy(&impl->queue_lock);
+
 	spa_system_close(impl->system, impl->poll_fd);
 
 	return 0;
@@ -1031,30 +1299,29 @@ impl_init(const struct spa_handle_factory *factory,
 	spa_list_init(&impl->destroy_list);
 	spa_hook_list_init(&impl->hooks_list);
 
-	impl->buffer_data = SPA_PTR_ALIGN(impl->buffer_mem, MAX_ALIGN, uint8_t);
-	spa_ringbuffer_init(&impl->buffer);
+	pthread_mutex_init(&impl->queue_lock, NULL);
+	/* without a key, all invokes from other threads go to the heap */
+	if ((res = pthread_key_create(&impl->queue_key, queue_release)) == 0)
+		impl->have_key = true;
+	else
+		spa_log_warn(impl->log, "%p: can't create queue key: %s",
+				impl, strerror(res));
 
 	impl->wakeup = loop_add_event(impl, wakeup_func, impl);
 	if (impl->wakeup == NULL) {
 		res = -errno;
 		spa_log_error(impl->log, "%p: can't create wakeup event: %m", impl);
-		goto error_exit_free_poll;
-	}
-	if ((res = spa_system_eventfd_create(impl->system,
-			SPA_FD_EVENT_SEMAPHORE | SPA_FD_CLOEXEC)) < 0) {
-		spa_log_error(impl->log, "%p: can't create ack event: %s",
-				impl, spa_strerror(res));
-		goto error_exit_free_wakeup;
+		goto error_exit_free_key;
 	}
-	impl->ack_fd = res;
 
 	spa_log_debug(impl->log, "%p: initialized", impl);
 
 	return 0;
 
-error_exit_free_wakeup:
-	loop_destroy_source(impl, impl->wakeup);
-error_exit_free_poll:
+error_exit_free_key:
+	if (impl->have_key)
+		pthread_key_delete(impl->queue_key);
+	pthread_mutex_destroy(&impl->queue_lock);
 	spa_system_close(impl->system, impl->poll_fd);
 error_exit:
 	return res;
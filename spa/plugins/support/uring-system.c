@@ -0,0 +1,965 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+
+#include <liburing.h>
+
+#include <spa/support/log.h>
+#include <spa/support/system.h>
+#include <spa/support/plugin.h>
+#include <spa/utils/atomic.h>
+#include <spa/utils/list.h>
+#include <spa/utils/type.h>
+#include <spa/utils/names.h>
+#include <spa/utils/result.h>
+#include <spa/utils/string.h>
+
+/*
+ * A spa_system that polls with io_uring instead of epoll. All poll
+ * registrations that changed since the last iteration and the rearming
+ * of the oneshot polls are queued as submissions and handed to the
+ * kernel together with the wait, in one io_uring_enter call.
+ *
+ * eventfds and timerfds that are polled for input only are not polled
+ * but read by the ring. The read value is kept and returned by the next
+ * eventfd_read or timerfd_read on the fd without a syscall.
+ *
+ * Select it for the data loops with:
+ *
+ *   context.data-loop.library.name.system = support/libspa-uring
+ *
+ * and add uring.sqpoll = true to a loop in context.data-loops to let a
+ * kernel thread poll the submission queue for that loop.
+ *
+ * Sources must be added, updated and removed from the loop thread or
+ * while the loop is not polling, like with the other loop backends.
+ */
+
+static struct spa_log_topic log_topic = SPA_LOG_TOPIC(0, "spa.uring-system");
+#undef SPA_LOG_TOPIC_DEFAULT
+#define SPA_LOG_TOPIC_DEFAULT &log_topic
+
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#  define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+
+#define MAX_RINGS		8
+#define MAX_COUNTER_FDS		1024
+#define RING_ENTRIES		256
+
+#define DEFAULT_SQPOLL		false
+#define DEFAULT_SQPOLL_IDLE	1000
+
+struct ring;
+
+struct entry {
+	struct spa_list link;
+	struct spa_list pending_link;
+	struct spa_list ready_link;
+	struct ring *ring;
+
+	int fd;
+	uint32_t events;
+	void *data;
+
+	uint32_t revents;
+	uint32_t inflight;
+	uint64_t value;
+
+	unsigned int counter:1;		/* the ring reads the fd instead of polling */
+	unsigned int has_value:1;
+	unsigned int pending:1;
+	unsigned int ready:1;
+	unsigned int update:1;
+	unsigned int removed:1;
+	unsigned int failed:1;
+};
+
+struct ring {
+	struct impl *impl;
+	struct io_uring uring;
+	int fd;
+
+	pthread_mutex_t lock;
+	bool waiting;
+	bool counters;
+
+	int kick_fd;
+	struct entry *kick;
+
+	struct entry **fds;
+	uint32_t n_fds;
+
+	struct spa_list entries;
+	struct spa_list pending;
+	struct spa_list ready;
+};
+
+struct impl {
+	struct spa_handle handle;
+	struct spa_system system;
+	struct spa_log *log;
+
+	bool sqpoll;
+	uint32_t sqpoll_idle;
+
+	struct ring *rings[MAX_RINGS];
+	struct entry *counters[MAX_COUNTER_FDS];
+	uint8_t created[MAX_COUNTER_FDS];
+};
+
+static ssize_t impl_read(void *object, int fd, void *buf, size_t count)
+{
+	ssize_t res = read(fd, buf, count);
+	return res < 0 ? -errno : res;
+}
+
+static ssize_t impl_write(void *object, int fd, const void *buf, size_t count)
+{
+	ssize_t res = write(fd, buf, count);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_ioctl(void *object, int fd, unsigned long request, ...)
+{
+	int res;
+	va_list ap;
+	long arg;
+
+	va_start(ap, request);
+	arg = va_arg(ap, long);
+	res = ioctl(fd, request, arg);
+	va_end(ap);
+
+	return res < 0 ? -errno : res;
+}
+
+/* clock */
+static int impl_clock_gettime(void *object,
+			int clockid, struct timespec *value)
+{
+	int res = clock_gettime(clockid, value);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_clock_getres(void *object,
+			int clockid, struct timespec *res)
+{
+	int r = clock_getres(clockid, res);
+	return r < 0 ? -errno : r;
+}
+
+/* poll */
+static struct ring *find_ring(struct impl *impl, int pfd)
+{
+	uint32_t i;
+	for (i = 0; i < MAX_RINGS; i++) {
+		if (impl->rings[i] != NULL && impl->rings[i]->fd == pfd)
+			return impl->rings[i];
+	}
+	return NULL;
+}
+
+static struct entry *find_entry(struct ring *r, int fd)
+{
+	if (fd < 0 || (uint32_t)fd >= r->n_fds)
+		return NULL;
+	return r->fds[fd];
+}
+
+static struct entry *find_counter(struct impl *impl, int fd)
+{
+	if (fd < 0 || fd >= MAX_COUNTER_FDS)
+		return NULL;
+	return SPA_ATOMIC_LOAD(impl->counters[fd]);
+}
+
+static void set_created(struct impl *impl, int fd, bool created)
+{
+	if (fd >= 0 && fd < MAX_COUNTER_FDS)
+		SPA_ATOMIC_STORE(impl->created[fd], created);
+}
+
+/* only eventfds and timerfds made by us can be read in the ring, they are
+ * read with the eventfd_read and timerfd_read methods that return the
+ * value from the ring */
+static bool is_counter_fd(struct impl *impl, int fd)
+{
+	char path[64], link[64];
+	ssize_t len;
+
+	if (fd < 0 || fd >= MAX_COUNTER_FDS || !SPA_ATOMIC_LOAD(impl->created[fd]))
+		return false;
+
+	snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+	if ((len = readlink(path, link, sizeof(link) - 1)) < 0)
+		return false;
+	link[len] = '\0';
+
+	return spa_streq(link, "anon_inode:[eventfd]") ||
+		spa_streq(link, "anon_inode:[timerfd]");
+}
+
+static void queue_pending(struct ring *r, struct entry *e)
+{
+	if (e->pending)
+		return;
+	e->pending = true;
+	spa_list_append(&r->pending, &e->pending_link);
+
+	/* another thread is blocked in the ring, make it pick up the change */
+	if (r->waiting && r->kick_fd >= 0) {
+		uint64_t count = 1;
+		if (write(r->kick_fd, &count, sizeof(count)) != sizeof(count))
+			spa_log_warn(r->impl->log, "%p: failed to kick ring: %m", r);
+	}
+}
+
+static uint32_t entry_mask(struct entry *e)
+{
+	uint32_t mask = e->revents & (e->events | SPA_IO_ERR | SPA_IO_HUP);
+	if (e->has_value && (e->events & SPA_IO_IN))
+		mask |= SPA_IO_IN;
+	return mask;
+}
+
+static void queue_ready(struct ring *r, struct entry *e)
+{
+	if (e->ready || entry_mask(e) == 0)
+		return;
+	e->ready = true;
+	spa_list_append(&r->ready, &e->ready_link);
+}
+
+static void unqueue_ready(struct entry *e)
+{
+	if (!e->ready)
+		return;
+	e->ready = false;
+	spa_list_remove(&e->ready_link);
+}
+
+static void free_entry(struct entry *e)
+{
+	spa_list_remove(&e->link);
+	if (e->pending)
+		spa_list_remove(&e->pending_link);
+	unqueue_ready(e);
+	free(e);
+}
+
+static struct entry *add_entry(struct ring *r, int fd, uint32_t events, void *data)
+{
+	struct entry *e;
+
+	if ((uint32_t)fd >= r->n_fds) {
+		uint32_t n_fds = SPA_MAX(r->n_fds * 2, 64u);
+		struct entry **fds;
+
+		while ((uint32_t)fd >= n_fds)
+			n_fds *= 2;
+		if ((fds = realloc(r->fds, n_fds * sizeof(struct entry *))) == NULL)
+			return NULL;
+		memset(&fds[r->n_fds], 0, (n_fds - r->n_fds) * sizeof(struct entry *));
+		r->fds = fds;
+		r->n_fds = n_fds;
+	}
+	if ((e = calloc(1, sizeof(*e))) == NULL)
+		return NULL;
+
+	e->ring = r;
+	e->fd = fd;
+	e->events = events;
+	e->data = data;
+	spa_list_append(&r->entries, &e->link);
+	r->fds[fd] = e;
+
+	return e;
+}
+
+static void process_cqe(struct ring *r, struct io_uring_cqe *cqe)
+{
+	struct entry *e = io_uring_cqe_get_data(cqe);
+
+	/* cancellations and poll updates */
+	if (e == NULL)
+		return;
+
+	if (!(cqe->flags & IORING_CQE_F_MORE))
+		e->inflight--;
+
+	if (e->removed) {
+		if (e->inflight == 0)
+			free_entry(e);
+		return;
+	}
+	if (cqe->res == -ECANCELED)
+		return;
+
+	if (e == r->kick) {
+		uint64_t count;
+		if (read(r->kick_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+			spa_log_warn(r->impl->log, "%p: failed to read kick fd: %m", r);
+		queue_pending(r, e);
+		return;
+	}
+
+	if (cqe->res < 0) {
+		spa_log_debug(r->impl->log, "%p: fd:%d error: %s", r, e->fd,
+				spa_strerror(cqe->res));
+		e->revents |= SPA_IO_ERR;
+		e->failed = true;
+	} else if (e->counter) {
+		/* rearmed when the value is consumed */
+		e->has_value = true;
+	} else {
+		e->revents |= cqe->res;
+		if (e->inflight == 0)
+			queue_pending(r, e);
+	}
+	queue_ready(r, e);
+}
+
+static void harvest(struct ring *r)
+{
+	struct io_uring_cqe *cqe;
+	unsigned head, count = 0;
+
+	io_uring_for_each_cqe(&r->uring, head, cqe) {
+		process_cqe(r, cqe);
+		count++;
+	}
+	io_uring_cq_advance(&r->uring, count);
+}
+
+static struct io_uring_sqe *get_sqe(struct ring *r)
+{
+	struct io_uring_sqe *sqe;
+
+	if ((sqe = io_uring_get_sqe(&r->uring)) == NULL) {
+		/* the queue is full, push out what we have and try again */
+		io_uring_submit(&r->uring);
+		sqe = io_uring_get_sqe(&r->uring);
+	}
+	return sqe;
+}
+
+static bool need_sqe(struct entry *e)
+{
+	if (e->removed)
+		return e->inflight > 0;
+	if (e->failed)
+		return false;
+	if (e->counter)
+		return e->inflight == 0 && !e->has_value;
+	return e->inflight == 0 ? e->events != 0 : e->update;
+}
+
+/* turn the changes since the last iteration into submissions */
+static void flush_pending(struct ring *r)
+{
+	struct entry *e;
+	struct io_uring_sqe *sqe = NULL;
+
+	spa_list_consume(e, &r->pending, pending_link) {
+		if (need_sqe(e) && (sqe = get_sqe(r)) == NULL)
+			break;
+
+		spa_list_remove(&e->pending_link);
+		e->pending = false;
+
+		if (!need_sqe(e)) {
+			e->update = false;
+			continue;
+		}
+		if (e->removed) {
+			io_uring_prep_cancel(sqe, e, 0);
+			io_uring_sqe_set_data(sqe, NULL);
+		} else if (e->counter) {
+			io_uring_prep_read(sqe, e->fd, &e->value, sizeof(e->value), 0);
+			io_uring_sqe_set_data(sqe, e);
+			e->inflight++;
+		} else if (e->inflight == 0) {
+			io_uring_prep_poll_add(sqe, e->fd, e->events);
+			io_uring_sqe_set_data(sqe, e);
+			e->inflight++;
+		} else {
+			/* if the poll already completed, the update fails and
+			 * the poll is rearmed with the new events */
+			io_uring_prep_poll_update(sqe, (uintptr_t)e, (uintptr_t)e,
+					e->events, IORING_POLL_UPDATE_EVENTS);
+			io_uring_sqe_set_data(sqe, NULL);
+		}
+		e->update = false;
+	}
+}
+
+static void free_ring(struct ring *r)
+{
+	struct entry *e;
+
+	if (r->fd >= 0)
+		io_uring_queue_exit(&r->uring);
+	spa_list_consume(e, &r->entries, link) {
+		if (e->counter && !e->removed)
+			SPA_ATOMIC_STORE(r->impl->counters[e->fd], NULL);
+		free_entry(e);
+	}
+	if (r->kick_fd >= 0)
+		close(r->kick_fd);
+	pthread_mutex_destroy(&r->lock);
+	free(r->fds);
+	free(r);
+}
+
+static int impl_pollfd_create(void *object, int flags)
+{
+	struct impl *impl = object;
+	struct io_uring_params params;
+	struct ring *r;
+	uint32_t i;
+	int res;
+
+	for (i = 0; i < MAX_RINGS; i++)
+		if (impl->rings[i] == NULL)
+			break;
+	if (i == MAX_RINGS)
+		return -ENOSPC;
+
+	if ((r = calloc(1, sizeof(*r))) == NULL)
+		return -errno;
+
+	r->impl = impl;
+	r->fd = -1;
+	r->kick_fd = -1;
+	pthread_mutex_init(&r->lock, NULL);
+	spa_list_init(&r->entries);
+	spa_list_init(&r->pending);
+	spa_list_init(&r->ready);
+
+	spa_zero(params);
+	if (impl->sqpoll) {
+		params.flags |= IORING_SETUP_SQPOLL;
+		params.sq_thread_idle = impl->sqpoll_idle;
+	} else {
+		params.flags |= IORING_SETUP_COOP_TASKRUN;
+	}
+	if ((res = io_uring_queue_init_params(RING_ENTRIES, &r->uring, &params)) == -EINVAL &&
+	    (params.flags & IORING_SETUP_COOP_TASKRUN)) {
+		spa_zero(params);
+		res = io_uring_queue_init_params(RING_ENTRIES, &r->uring, &params);
+	}
+	if (res < 0)
+		goto error;
+
+	r->fd = r->uring.ring_fd;
+	/* with cooperative task running, the kernel completes the reads
+	 * with task_work that runs when this thread returns from any
+	 * syscall, not only io_uring_enter, instead of interrupting it.
+	 * The kernel hands out the counter value once, so a read of the fd
+	 * from the loop either gets the value or finds it taken by the
+	 * ring, it is then harvested from the completion queue by the
+	 * next read, never both. */
+	r->counters = (params.flags & IORING_SETUP_COOP_TASKRUN) != 0;
+
+	if ((r->kick_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+		res = -errno;
+		goto error;
+	}
+	if ((r->kick = add_entry(r, r->kick_fd, SPA_IO_IN, NULL)) == NULL) {
+		res = -errno;
+		goto error;
+	}
+	queue_pending(r, r->kick);
+
+	impl->rings[i] = r;
+
+	spa_log_debug(impl->log, "%p: new fd:%d sqpoll:%d counters:%d", impl,
+			r->fd, impl->sqpoll, r->counters);
+	return r->fd;
+
+error:
+	spa_log_error(impl->log, "%p: can't create ring: %s", impl, spa_strerror(res));
+	free_ring(r);
+	return res;
+}
+
+static int impl_pollfd_add(void *object, int pfd, int fd, uint32_t events, void *data)
+{
+	struct impl *impl = object;
+	struct ring *r;
+	struct entry *e;
+	int res = 0;
+
+	if ((r = find_ring(impl, pfd)) == NULL)
+		return -EBADF;
+	if (fd < 0)
+		return -EBADF;
+
+	pthread_mutex_lock(&r->lock);
+	if (find_entry(r, fd) != NULL) {
+		res = -EEXIST;
+		goto done;
+	}
+	if ((e = add_entry(r, fd, events, data)) == NULL) {
+		res = -errno;
+		goto done;
+	}
+	if (r->counters && events == SPA_IO_IN && fd < MAX_COUNTER_FDS &&
+	    impl->counters[fd] == NULL && is_counter_fd(impl, fd)) {
+		e->counter = true;
+		SPA_ATOMIC_STORE(impl->counters[fd], e);
+	}
+	queue_pending(r, e);
+done:
+	pthread_mutex_unlock(&r->lock);
+	return res;
+}
+
+static int impl_pollfd_mod(void *object, int pfd, int fd, uint32_t events, void *data)
+{
+	struct impl *impl = object;
+	struct ring *r;
+	struct entry *e;
+	int res = 0;
+
+	if ((r = find_ring(impl, pfd)) == NULL)
+		return -EBADF;
+
+	pthread_mutex_lock(&r->lock);
+	if ((e = find_entry(r, fd)) == NULL) {
+		res = -ENOENT;
+		goto done;
+	}
+	e->data = data;
+	if (e->events != events || e->failed) {
+		e->events = events;
+		e->failed = false;
+		e->revents = 0;
+		unqueue_ready(e);
+		queue_ready(r, e);
+		if (!e->counter)
+			e->update = true;
+		queue_pending(r, e);
+	}
+done:
+	pthread_mutex_unlock(&r->lock);
+	return res;
+}
+
+static int impl_pollfd_del(void *object, int pfd, int fd)
+{
+	struct impl *impl = object;
+	struct ring *r;
+	struct entry *e;
+	int res = 0;
+
+	if ((r = find_ring(impl, pfd)) == NULL)
+		return -EBADF;
+
+	pthread_mutex_lock(&r->lock);
+	if ((e = find_entry(r, fd)) == NULL) {
+		res = -ENOENT;
+		goto done;
+	}
+	r->fds[fd] = NULL;
+	if (e->counter)
+		SPA_ATOMIC_STORE(impl->counters[fd], NULL);
+
+	e->removed = true;
+	unqueue_ready(e);
+	if (e->inflight == 0)
+		free_entry(e);
+	else
+		queue_pending(r, e);
+done:
+	pthread_mutex_unlock(&r->lock);
+	return res;
+}
+
+static int impl_pollfd_wait(void *object, int pfd,
+		struct spa_poll_event *ev, int n_ev, int timeout)
+{
+	struct impl *impl = object;
+	struct ring *r;
+	struct io_uring_cqe *cqe;
+	struct __kernel_timespec ts, *tsp = NULL;
+	struct entry *e, *t;
+	int res, n = 0;
+
+	if (SPA_UNLIKELY((r = find_ring(impl, pfd)) == NULL))
+		return -EBADF;
+
+	pthread_mutex_lock(&r->lock);
+	flush_pending(r);
+	/* entries with a value that was not consumed yet are still ready */
+	spa_list_for_each_safe(e, t, &r->ready, ready_link) {
+		if (entry_mask(e) == 0)
+			unqueue_ready(e);
+	}
+	if (!spa_list_is_empty(&r->ready))
+		timeout = 0;
+	r->waiting = true;
+	pthread_mutex_unlock(&r->lock);
+
+	if (timeout == 0) {
+		res = io_uring_submit_and_get_events(&r->uring);
+	} else {
+		if (timeout > 0) {
+			ts.tv_sec = timeout / 1000;
+			ts.tv_nsec = (timeout % 1000) * SPA_NSEC_PER_MSEC;
+			tsp = &ts;
+		}
+		res = io_uring_submit_and_wait_timeout(&r->uring, &cqe, 1, tsp, NULL);
+	}
+
+	pthread_mutex_lock(&r->lock);
+	r->waiting = false;
+	harvest(r);
+
+	spa_list_for_each_safe(e, t, &r->ready, ready_link) {
+		uint32_t mask;
+
+		if (n == n_ev)
+			break;
+		if ((mask = entry_mask(e)) == 0) {
+			unqueue_ready(e);
+			continue;
+		}
+		ev[n].events = mask;
+		ev[n].data = e->data;
+		n++;
+
+		e->revents = 0;
+		/* counters stay ready until their value is consumed */
+		if (!e->has_value)
+			unqueue_ready(e);
+	}
+	pthread_mutex_unlock(&r->lock);
+
+	if (n == 0 && res < 0 && res != -ETIME)
+		return res;
+
+	return n;
+}
+
+/* take the value the ring read for the fd, if any */
+static bool take_value(struct impl *impl, int fd, uint64_t *value)
+{
+	struct entry *e;
+	struct ring *r;
+	bool res = false;
+
+	if ((e = find_counter(impl, fd)) == NULL)
+		return false;
+
+	r = e->ring;
+	pthread_mutex_lock(&r->lock);
+	harvest(r);
+	if (e->has_value) {
+		*value = e->value;
+		e->has_value = false;
+		res = true;
+	}
+	if (e->inflight == 0 && !e->failed)
+		queue_pending(r, e);
+	pthread_mutex_unlock(&r->lock);
+
+	return res;
+}
+
+static int impl_close(void *object, int fd)
+{
+	struct impl *impl = object;
+	uint32_t i;
+	int res;
+
+	for (i = 0; i < MAX_RINGS; i++) {
+		struct ring *r = impl->rings[i];
+		if (r != NULL && r->fd == fd) {
+			impl->rings[i] = NULL;
+			free_ring(r);
+			spa_log_debug(impl->log, "%p: close ring fd:%d", impl, fd);
+			return 0;
+		}
+	}
+	set_created(impl, fd, false);
+	res = close(fd);
+	spa_log_debug(impl->log, "%p: close fd:%d", impl, fd);
+	return res < 0 ? -errno : res;
+}
+
+/* timers */
+static int impl_timerfd_create(void *object, int clockid, int flags)
+{
+	struct impl *impl = object;
+	int fl = 0, res;
+	if (flags & SPA_FD_CLOEXEC)
+		fl |= TFD_CLOEXEC;
+	if (flags & SPA_FD_NONBLOCK)
+		fl |= TFD_NONBLOCK;
+	res = timerfd_create(clockid, fl);
+	set_created(impl, res, true);
+	spa_log_debug(impl->log, "%p: new fd:%d", impl, res);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_timerfd_settime(void *object,
+			int fd, int flags,
+			const struct itimerspec *new_value,
+			struct itimerspec *old_value)
+{
+	struct impl *impl = object;
+	int fl = 0, res;
+	uint64_t expirations;
+
+	if (flags & SPA_FD_TIMER_ABSTIME)
+		fl |= TFD_TIMER_ABSTIME;
+	if (flags & SPA_FD_TIMER_CANCEL_ON_SET)
+		fl |= TFD_TIMER_CANCEL_ON_SET;
+	res = timerfd_settime(fd, fl, new_value, old_value);
+	if (res < 0)
+		return -errno;
+
+	/* like the kernel, forget the expirations of the old setting */
+	take_value(impl, fd, &expirations);
+
+	return res;
+}
+
+static int impl_timerfd_gettime(void *object,
+			int fd, struct itimerspec *curr_value)
+{
+	int res = timerfd_gettime(fd, curr_value);
+	return res < 0 ? -errno : res;
+
+}
+static int impl_timerfd_read(void *object, int fd, uint64_t *expirations)
+{
+	struct impl *impl = object;
+
+	if (take_value(impl, fd, expirations))
+		return 0;
+	if (read(fd, expirations, sizeof(uint64_t)) != sizeof(uint64_t))
+		return -errno;
+	return 0;
+}
+
+/* events */
+static int impl_eventfd_create(void *object, int flags)
+{
+	struct impl *impl = object;
+	int fl = 0, res;
+	if (flags & SPA_FD_CLOEXEC)
+		fl |= EFD_CLOEXEC;
+	if (flags & SPA_FD_NONBLOCK)
+		fl |= EFD_NONBLOCK;
+	if (flags & SPA_FD_EVENT_SEMAPHORE)
+		fl |= EFD_SEMAPHORE;
+	res = eventfd(0, fl);
+	set_created(impl, res, true);
+	spa_log_debug(impl->log, "%p: new fd:%d", impl, res);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_eventfd_write(void *object, int fd, uint64_t count)
+{
+	if (write(fd, &count, sizeof(uint64_t)) != sizeof(uint64_t))
+		return -errno;
+	return 0;
+}
+
+static int impl_eventfd_read(void *object, int fd, uint64_t *count)
+{
+	struct impl *impl = object;
+
+	if (take_value(impl, fd, count))
+		return 0;
+	if (read(fd, count, sizeof(uint64_t)) != sizeof(uint64_t))
+		return -errno;
+	return 0;
+}
+
+/* signals */
+static int impl_signalfd_create(void *object, int signal, int flags)
+{
+	struct impl *impl = object;
+	sigset_t mask;
+	int res, fl = 0;
+
+	if (flags & SPA_FD_CLOEXEC)
+		fl |= SFD_CLOEXEC;
+	if (flags & SPA_FD_NONBLOCK)
+		fl |= SFD_NONBLOCK;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, signal);
+	res = signalfd(-1, &mask, fl);
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+	spa_log_debug(impl->log, "%p: new fd:%d", impl, res);
+
+	return res < 0 ? -errno : res;
+}
+
+static int impl_signalfd_read(void *object, int fd, int *signal)
+{
+	struct signalfd_siginfo signal_info;
+	int len;
+
+	len = read(fd, &signal_info, sizeof signal_info);
+	if (!(len == -1 && errno == EAGAIN) && len != sizeof signal_info)
+		return -errno;
+
+	*signal = signal_info.ssi_signo;
+
+	return 0;
+}
+
+static const struct spa_system_methods impl_system = {
+	SPA_VERSION_SYSTEM_METHODS,
+	.read = impl_read,
+	.write = impl_write,
+	.ioctl = impl_ioctl,
+	.close = impl_close,
+	.clock_gettime = impl_clock_gettime,
+	.clock_getres = impl_clock_getres,
+	.pollfd_create = impl_pollfd_create,
+	.pollfd_add = impl_pollfd_add,
+	.pollfd_mod = impl_pollfd_mod,
+	.pollfd_del = impl_pollfd_del,
+	.pollfd_wait = impl_pollfd_wait,
+	.timerfd_create = impl_timerfd_create,
+	.timerfd_settime = impl_timerfd_settime,
+	.timerfd_gettime = impl_timerfd_gettime,
+	.timerfd_read = impl_timerfd_read,
+	.eventfd_create = impl_eventfd_create,
+	.eventfd_write = impl_eventfd_write,
+	.eventfd_read = impl_eventfd_read,
+	.signalfd_create = impl_signalfd_create,
+	.signalfd_read = impl_signalfd_read,
+};
+
+static int impl_get_interface(struct spa_handle *handle, const char *type, void **interface)
+{
+	struct impl *impl;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+	spa_return_val_if_fail(interface != NULL, -EINVAL);
+
+	impl = (struct impl *) handle;
+
+	if (spa_streq(type, SPA_TYPE_INTERFACE_System))
+		*interface = &impl->system;
+	else
+		return -ENOENT;
+
+	return 0;
+}
+
+static int impl_clear(struct spa_handle *handle)
+{
+	struct impl *impl;
+	uint32_t i;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	impl = (struct impl *) handle;
+
+	for (i = 0; i < MAX_RINGS; i++) {
+		if (impl->rings[i] != NULL)
+			free_ring(impl->rings[i]);
+		impl->rings[i] = NULL;
+	}
+	return 0;
+}
+
+static size_t
+impl_get_size(const struct spa_handle_factory *factory,
+	      const struct spa_dict *params)
+{
+	return sizeof(struct impl);
+}
+
+static int
+impl_init(const struct spa_handle_factory *factory,
+	  struct spa_handle *handle,
+	  const struct spa_dict *info,
+	  const struct spa_support *support,
+	  uint32_t n_support)
+{
+	struct impl *impl;
+	const char *str;
+
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	handle->get_interface = impl_get_interface;
+	handle->clear = impl_clear;
+
+	impl = (struct impl *) handle;
+	impl->system.iface = SPA_INTERFACE_INIT(
+			SPA_TYPE_INTERFACE_System,
+			SPA_VERSION_SYSTEM,
+			&impl_system, impl);
+
+	impl->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
+	spa_log_topic_init(impl->log, &log_topic);
+
+	impl->sqpoll = DEFAULT_SQPOLL;
+	impl->sqpoll_idle = DEFAULT_SQPOLL_IDLE;
+
+	if (info) {
+		if ((str = spa_dict_lookup(info, "uring.sqpoll")) != NULL)
+			impl->sqpoll = spa_atob(str);
+		if ((str = spa_dict_lookup(info, "uring.sqpoll-idle")) != NULL)
+			spa_atou32(str, &impl->sqpoll_idle, 0);
+	}
+
+	spa_log_debug(impl->log, "%p: initialized sqpoll:%d idle:%u", impl,
+			impl->sqpoll, impl->sqpoll_idle);
+
+	return 0;
+}
+
+static const struct spa_interface_info impl_interfaces[] = {
+	{SPA_TYPE_INTERFACE_System,},
+};
+
+static int
+impl_enum_interface_info(const struct spa_handle_factory *factory,
+			 const struct spa_interface_info **info,
+			 uint32_t *index)
+{
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(info != NULL, -EINVAL);
+	spa_return_val_if_fail(index != NULL, -EINVAL);
+
+	if (*index >= SPA_N_ELEMENTS(impl_interfaces))
+		return 0;
+
+	*info = &impl_interfaces[(*index)++];
+	return 1;
+}
+
+const struct spa_handle_factory spa_support_uring_system_factory = {
+	SPA_VERSION_HANDLE_FACTORY,
+	SPA_NAME_SUPPORT_SYSTEM,
+	NULL,
+	impl_get_size,
+	impl_init,
+	impl_enum_interface_info
+};
@@ -205,6 +205,10 @@ static void *create_object(void *_data,
 		if (factory_name == NULL)
 			goto error_properties;
 
+		/* select the data loop before loading the plugin so that
+		 * the plugin and the node run on the same loop */
+		pw_context_place_data_loop(d->context, properties);
+
 		handle = pw_context_load_spa_handle(d->context,
 				factory_name,
 				&properties->dict);
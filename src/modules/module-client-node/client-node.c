@@ -1252,7 +1252,7 @@ static void node_peer_added(void *data, struct pw_impl_node *peer)
 					  peer->info.id,
 					  peer->source.fd,
 					  m->id,
-					  0,
+					  peer->activation_offset,
 					  sizeof(struct pw_node_activation));
 }
 
@@ -1307,7 +1307,7 @@ void pw_impl_client_node_registered(struct pw_impl_client_node *this, struct pw_
 					  this->node->source.fd,
 					  impl->data_source.fd,
 					  impl->activation->id,
-					  0,
+					  node->activation_offset,
 					  sizeof(struct pw_node_activation));
 
 	node_peer_added(impl, node);
@@ -1381,8 +1381,13 @@ static void node_free(void *data)
 	while ((mm = pw_mempool_find_tag(impl->client_pool, tag, sizeof(uint32_t))) != NULL)
 		pw_memmap_free(mm);
 
-	if (impl->activation)
-		pw_memblock_free(impl->activation);
+	if (impl->activation) {
+		/* a slab block is shared with the other nodes of the client */
+		if (SPA_FLAG_IS_SET(impl->activation->flags, PW_MEMBLOCK_FLAG_SLAB))
+			pw_memblock_unref(impl->activation);
+		else
+			pw_memblock_free(impl->activation);
+	}
 
 	pw_array_for_each(area, &impl->io_areas) {
 		if (*area)
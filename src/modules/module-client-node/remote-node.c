@@ -138,7 +138,8 @@ static void clean_transport(struct node_data *data)
 	}
 
 	pw_memmap_free(data->activation);
-	data->node->rt.target.activation = data->node->activation->map->ptr;
+	data->node->rt.target.activation = SPA_PTROFF(data->node->activation->map->ptr,
+			data->node->activation_offset, struct pw_node_activation);
 
 	spa_system_close(data->data_system, data->rtwritefd);
 	data->have_transport = false;
@@ -841,6 +841,10 @@ static int create_stream(struct stream_info *info)
 		if (pw_properties_get(info->stream_props, PW_KEY_TARGET_OBJECT) == NULL)
 			pw_properties_set(info->stream_props, PW_KEY_TARGET_OBJECT, node_name);
 	}
+	/* the streams are processed from the combine stream, keep them on
+	 * its data loop, the stream properties can't move them */
+	pw_properties_set(info->stream_props, PW_KEY_NODE_LOOP_NAME,
+			pw_properties_get(impl->stream_props, PW_KEY_NODE_LOOP_NAME));
 
 	s->stream = pw_stream_new(impl->core, "Combine stream", info->stream_props);
 	info->stream_props = NULL;
@@ -1448,7 +1452,6 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 
 	pw_log_debug("module %p: new %s", impl, args);
 	impl->main_loop = pw_context_get_main_loop(context);
-	impl->data_loop = pw_context_get_data_loop(context);
 
 	spa_list_init(&impl->streams);
 
@@ -1557,6 +1560,19 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	if (pw_properties_get(impl->stream_props, PW_KEY_NODE_DONT_RECONNECT) == NULL)
 		pw_properties_set(impl->stream_props, PW_KEY_NODE_DONT_RECONNECT, "true");
 
+	/* all streams and the combine stream run on the same data loop so that
+	 * the invokes below are serialized with the process functions */
+	copy_props(props, impl->combine_props, PW_KEY_NODE_LOOP_NAME);
+	impl->data_loop = pw_context_place_data_loop(context, impl->combine_props);
+	if (impl->data_loop == NULL) {
+		res = -ENOENT;
+		pw_log_error("can't find data loop %s",
+				pw_properties_get(impl->combine_props, PW_KEY_NODE_LOOP_NAME));
+		goto error;
+	}
+	pw_properties_set(impl->stream_props, PW_KEY_NODE_LOOP_NAME,
+			pw_properties_get(impl->combine_props, PW_KEY_NODE_LOOP_NAME));
+
 	if (impl->latency_compensate) {
 		impl->update_delay_event = pw_loop_add_event(impl->main_loop,
 				update_delay_event, impl);
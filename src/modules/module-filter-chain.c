@@ -10,6 +10,7 @@
 #include <fcntl.h>
 #include <dlfcn.h>
 #include <unistd.h>
+#include <semaphore.h>
 
 #include "config.h"
 
@@ -19,6 +20,7 @@
 #include <spa/utils/string.h>
 #include <spa/utils/json.h>
 #include <spa/support/cpu.h>
+#include <spa/support/thread.h>
 #include <spa/param/latency-utils.h>
 #include <spa/param/tag-utils.h>
 #include <spa/pod/dynamic.h>
@@ -58,6 +60,12 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  * - `filter.graph = []`: a description of the filter graph to run, see below
  * - `capture.props = {}`: properties to be passed to the input stream
  * - `playback.props = {}`: properties to be passed to the output stream
+ * - `filter.threads = <int>`: the number of extra realtime threads used to run the
+ *    copies of the graph in parallel, default 0. The graph is copied for each
+ *    channel when the stream has more channels than the graph inputs/outputs,
+ *    each copy can then be run on a separate thread. The threads are made with
+ *    the thread utils of the context, the processing thread never waits for
+ *    them to wake up.
  *
  * ## Filter graph description
  *
@@ -237,8 +245,10 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  * for reverbs or virtual surround. The convolver is implemented with a fast FFT
  * implementation.
  *
- * The convolver has an input port "In" and an output port "Out". It requires a config
- * section in the node declaration in this format:
+ * The convolver has an input port "In" and an output port "Out". The convolver_late
+ * label is the same convolver with an extra "Late" control output port, it has the
+ * number of tail blocks that were not ready in time when `tail_thread` is used.
+ * It requires a config section in the node declaration in this format:
  *
  *\code{.unparsed}
  * filter.graph = {
@@ -257,6 +267,7 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  *                 length = ...
  *                 channel = ...
  *                 resample_quality = ...
+ *                 tail_thread = ...
  *             }
  *             ...
  *         }
@@ -286,6 +297,12 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  * - `channel` The channel to use from the file as the IR.
  * - `resample_quality` The resample quality in case the IR does not match the graph
  *                      samplerate.
+ * - `tail_thread` Compute the tail blocks of the IR on a separate, non realtime
+ *                 thread, default false. The tail of a block is only needed one
+ *                 tail block later, so this spreads the cost of long IRs over time
+ *                 and keeps the cycles with small quantums short. When a tail block
+ *                 is not ready in time, the previous tail is played again and the
+ *                 block is left out of the tail.
  *
  * ### Delay
  *
@@ -610,6 +627,8 @@ static const struct spa_dict_item module_props[] = {
 #include <pipewire/pipewire.h>
 
 #define MAX_HNDL 64
+#define MAX_WORKERS 16
+#define MAX_SUPPORT 17
 
 #define DEFAULT_RATE	48000
 
@@ -742,6 +761,11 @@ struct graph {
 
 	uint32_t n_hndl;
 	struct graph_hndl *hndl;
+	uint32_t n_copies;		/* number of independent copies of the graph,
+					 * hndl contains the copies of each node */
+	float *silence_data;		/* silence for unconnected inputs, one block
+					 * per copy because the copies can run in
+					 * parallel */
 
 	uint32_t n_control;
 	struct port **control_port;
@@ -752,6 +776,12 @@ struct graph {
 	unsigned instantiated:1;
 };
 
+struct graph_worker {
+	struct impl *impl;
+	struct spa_thread *thread;
+	sem_t start;
+};
+
 struct impl {
 	struct pw_context *context;
 
@@ -789,8 +819,14 @@ struct impl {
 
 	struct graph graph;
 
-	float *silence_data;
-	float *discard_data;
+	/* workers that run the copies of the graph in parallel */
+	struct spa_thread_utils *thread_utils;
+	uint32_t n_workers;
+	struct graph_worker workers[MAX_WORKERS];
+	uint32_t run_samples;
+	uint32_t copies_next;		/* next copy to claim */
+	uint32_t copies_done;		/* copies that completed */
+	unsigned int workers_quit:1;
 };
 
 static int graph_instantiate(struct graph *graph);
@@ -810,12 +846,123 @@ static void capture_process(void *d)
 	pw_stream_trigger_process(impl->playback);
 }
 
+/* run the copies of the graph that are not claimed yet. The copies don't
+ * share any ports and can run in parallel. */
+static void graph_run_copies(struct impl *impl)
+{
+	struct graph *graph = &impl->graph;
+	uint32_t i, j, n_copies = graph->n_copies;
+
+	while ((i = SPA_ATOMIC_INC(impl->copies_next) - 1) < n_copies) {
+		for (j = i; j < graph->n_hndl; j += n_copies) {
+			struct graph_hndl *hndl = &graph->hndl[j];
+			hndl->desc->run(*hndl->hndl, impl->run_samples);
+		}
+		SPA_ATOMIC_INC(impl->copies_done);
+	}
+}
+
+/* The workers are only woken up, the processing thread never waits for a
+ * worker to start. It runs all the copies that were not claimed by a worker
+ * and then only spins on the copies that a worker is running. */
+static void graph_run(struct impl *impl, uint32_t n_samples)
+{
+	struct graph *graph = &impl->graph;
+	uint32_t i, n_hndl = graph->n_hndl, n_workers = impl->n_workers;
+
+	if (n_workers == 0) {
+		for (i = 0; i < n_hndl; i++) {
+			struct graph_hndl *hndl = &graph->hndl[i];
+			hndl->desc->run(*hndl->hndl, n_samples);
+		}
+		return;
+	}
+	impl->run_samples = n_samples;
+	SPA_ATOMIC_STORE(impl->copies_done, 0);
+	SPA_ATOMIC_STORE(impl->copies_next, 0);
+	for (i = 0; i < n_workers; i++)
+		sem_post(&impl->workers[i].start);
+
+	graph_run_copies(impl);
+
+	while (SPA_ATOMIC_LOAD(impl->copies_done) < graph->n_copies);
+}
+
+static void *graph_worker_thread(void *data)
+{
+	struct graph_worker *w = data;
+	struct impl *impl = w->impl;
+
+	while (true) {
+		while (sem_wait(&w->start) < 0 && errno == EINTR);
+		if (impl->workers_quit)
+			break;
+		graph_run_copies(impl);
+	}
+	return NULL;
+}
+
+static int start_workers(struct impl *impl, uint32_t n_workers)
+{
+	uint32_t i;
+	char name[32];
+
+	n_workers = SPA_MIN(n_workers, impl->graph.n_copies - 1);
+	n_workers = SPA_MIN(n_workers, (uint32_t)MAX_WORKERS);
+	if (n_workers == 0)
+		return 0;
+
+	impl->thread_utils = pw_context_get_object(impl->context,
+			SPA_TYPE_INTERFACE_ThreadUtils);
+	if (impl->thread_utils == NULL)
+		return -ENOTSUP;
+
+	for (i = 0; i < n_workers; i++) {
+		struct graph_worker *w = &impl->workers[i];
+		struct spa_dict_item items[1];
+
+		w->impl = impl;
+		sem_init(&w->start, 0, 0);
+
+		snprintf(name, sizeof(name), "filter-chain-%u", i);
+		items[0] = SPA_DICT_ITEM_INIT(SPA_KEY_THREAD_NAME, name);
+		w->thread = spa_thread_utils_create(impl->thread_utils,
+				&SPA_DICT_INIT_ARRAY(items), graph_worker_thread, w);
+		if (w->thread == NULL) {
+			sem_destroy(&w->start);
+			break;
+		}
+		spa_thread_utils_acquire_rt(impl->thread_utils, w->thread, -1);
+	}
+	impl->n_workers = i;
+	pw_log_info("%p: using %u workers for %u copies", impl, impl->n_workers,
+			impl->graph.n_copies);
+	return i == n_workers ? 0 : -errno;
+}
+
+static void stop_workers(struct impl *impl)
+{
+	uint32_t i;
+
+	if (impl->n_workers == 0)
+		return;
+
+	impl->workers_quit = true;
+	for (i = 0; i < impl->n_workers; i++)
+		sem_post(&impl->workers[i].start);
+	for (i = 0; i < impl->n_workers; i++) {
+		spa_thread_utils_join(impl->thread_utils, impl->workers[i].thread, NULL);
+		sem_destroy(&impl->workers[i].start);
+	}
+	impl->n_workers = 0;
+}
+
 static void playback_process(void *d)
 {
 	struct impl *impl = d;
 	struct pw_buffer *in, *out;
 	struct graph *graph = &impl->graph;
-	uint32_t i, j, insize = 0, outsize = 0, n_hndl = graph->n_hndl;
+	uint32_t i, j, insize = 0, outsize = 0;
 	int32_t stride = 0;
 	struct graph_port *port;
 	struct spa_data *bd;
@@ -880,10 +1027,7 @@ static void playback_process(void *d)
 	pw_log_trace_fp("%p: stride:%d in:%d out:%d requested:%"PRIu64" (%"PRIu64")", impl,
 			stride, insize, outsize, out->requested, out->requested * stride);
 
-	for (i = 0; i < n_hndl; i++) {
-		struct graph_hndl *hndl = &graph->hndl[i];
-		hndl->desc->run(*hndl->hndl, outsize / sizeof(float));
-	}
+	graph_run(impl, outsize / sizeof(float));
 
 done:
 	if (in != NULL)
@@ -1696,8 +1840,10 @@ static struct plugin *plugin_load(struct impl *impl, const char *type, const cha
 {
 	struct fc_plugin *pl = NULL;
 	struct plugin *hndl;
-	const struct spa_support *support;
+	const struct spa_support *context_support;
+	struct spa_support support[MAX_SUPPORT];
 	uint32_t n_support;
+	void *thread_utils;
 	fc_plugin_load_func *plugin_func;
 
 	spa_list_for_each(hndl, &impl->plugin_list, link) {
@@ -1707,7 +1853,13 @@ static struct plugin *plugin_load(struct impl *impl, const char *type, const cha
 			return hndl;
 		}
 	}
-	support = pw_context_get_support(impl->context, &n_support);
+	/* the plugins make their threads with the thread utils of the context */
+	context_support = pw_context_get_support(impl->context, &n_support);
+	n_support = SPA_MIN(n_support, MAX_SUPPORT - 1);
+	memcpy(support, context_support, n_support * sizeof(struct spa_support));
+	thread_utils = pw_context_get_object(impl->context, SPA_TYPE_INTERFACE_ThreadUtils);
+	if (thread_utils != NULL)
+		support[n_support++] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_ThreadUtils, thread_utils);
 
 	plugin_func = find_plugin_func(impl, type);
 	if (plugin_func == NULL) {
@@ -2310,11 +2462,17 @@ static int graph_instantiate(struct graph *graph)
 	const struct fc_descriptor *d;
 	uint32_t i, j, max_samples = impl->quantum_limit;
 	int res;
-	float *sd = impl->silence_data, *dd = impl->discard_data;
+	float *sd;
 
 	if (graph->instantiated)
 		return 0;
 
+	if (graph->silence_data == NULL) {
+		graph->silence_data = calloc(SPA_MAX(graph->n_copies, 1u) * max_samples,
+				sizeof(float));
+		if (graph->silence_data == NULL)
+			return -errno;
+	}
 	graph->instantiated = true;
 
 	spa_list_for_each(node, &graph->node_list, link) {
@@ -2323,10 +2481,13 @@ static int graph_instantiate(struct graph *graph)
 
 		desc = node->desc;
 		d = desc->desc;
-		if (d->flags & FC_DESCRIPTOR_SUPPORTS_NULL_DATA)
-			sd = dd = NULL;
 
 		for (i = 0; i < node->n_hndl; i++) {
+			if (d->flags & FC_DESCRIPTOR_SUPPORTS_NULL_DATA)
+				sd = NULL;
+			else
+				sd = graph->silence_data + i * max_samples;
+
 			pw_log_info("instantiate %s %d rate:%lu", d->name, i, impl->rate);
 			errno = EINVAL;
 			if ((node->hndl[i] = d->instantiate(d, impl->rate, i, node->config)) == NULL) {
@@ -2640,6 +2801,7 @@ static int setup_graph(struct graph *graph, struct spa_json *inputs, struct spa_
 	}
 
 	/* order all nodes based on dependencies */
+	graph->n_copies = n_hndl;
 	graph->n_hndl = 0;
 	graph->hndl = calloc(n_nodes * n_hndl, sizeof(struct graph_hndl));
 	graph->n_control = 0;
@@ -2800,6 +2962,7 @@ static void graph_free(struct graph *graph)
 	free(graph->output);
 	free(graph->hndl);
 	free(graph->control_port);
+	free(graph->silence_data);
 }
 
 static void core_error(void *data, uint32_t id, int seq, int res, const char *message)
@@ -2853,14 +3016,14 @@ static void impl_destroy(struct impl *impl)
 	if (impl->core && impl->do_disconnect)
 		pw_core_disconnect(impl->core);
 
+	stop_workers(impl);
+
 	pw_properties_free(impl->capture_props);
 	pw_properties_free(impl->playback_props);
 	graph_free(&impl->graph);
 	spa_list_consume(pl, &impl->plugin_func_list, link)
 		free_plugin_func(pl);
 
-	free(impl->silence_data);
-	free(impl->discard_data);
 	free(impl);
 }
 
@@ -2982,18 +3145,6 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 			pw_context_get_properties(impl->context),
 			"default.clock.quantum-limit", 8192u);
 
-	impl->silence_data = calloc(impl->quantum_limit, sizeof(float));
-	if (impl->silence_data == NULL) {
-		res = -errno;
-		goto error;
-	}
-
-	impl->discard_data = calloc(impl->quantum_limit, sizeof(float));
-	if (impl->discard_data == NULL) {
-		res = -errno;
-		goto error;
-	}
-
 	cpu_iface = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
 	impl->dsp.cpu_flags = cpu_iface ? spa_cpu_get_flags(cpu_iface) : 0;
 	dsp_ops_init(&impl->dsp);
@@ -3069,6 +3220,9 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		goto error;
 	}
 
+	if ((res = start_workers(impl, pw_properties_get_uint32(props, "filter.threads", 0))) < 0)
+		pw_log_warn("can't start all worker threads: %s", spa_strerror(res));
+
 	impl->core = pw_context_get_object(impl->context, PW_TYPE_INTERFACE_Core);
 	if (impl->core == NULL) {
 		str = pw_properties_get(props, PW_KEY_REMOTE_NAME);
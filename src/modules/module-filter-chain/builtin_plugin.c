@@ -15,6 +15,7 @@
 #include <spa/utils/json.h>
 #include <spa/utils/result.h>
 #include <spa/support/cpu.h>
+#include <spa/support/thread.h>
 #include <spa/plugins/audioconvert/resample.h>
 
 #include <pipewire/log.h>
@@ -29,6 +30,7 @@
 #define MAX_RATES	32u
 
 static struct dsp_ops *dsp_ops;
+static struct spa_thread_utils *thread_utils;
 
 struct builtin {
 	unsigned long rate;
@@ -867,6 +869,8 @@ static void * convolver_instantiate(const struct fc_descriptor * Descriptor,
 	int resample_quality = RESAMPLE_DEFAULT_QUALITY;
 	float gain = 1.0f;
 	unsigned long rate;
+	bool tail_thread = false;
+	int res;
 
 	errno = EINVAL;
 	if (config == NULL) {
@@ -949,6 +953,12 @@ static void * convolver_instantiate(const struct fc_descriptor * Descriptor,
 				return NULL;
 			}
 		}
+		else if (spa_streq(key, "tail_thread")) {
+			if (spa_json_get_bool(&it[1], &tail_thread) <= 0) {
+				pw_log_error("convolver:tail_thread requires a boolean");
+				return NULL;
+			}
+		}
 		else {
 			pw_log_warn("convolver: ignoring config key: '%s'", key);
 			if (spa_json_next(&it[1], &val) < 0)
@@ -1006,6 +1016,12 @@ static void * convolver_instantiate(const struct fc_descriptor * Descriptor,
 	if (impl->conv == NULL)
 		goto error;
 
+	if (tail_thread && thread_utils == NULL)
+		pw_log_warn("convolver: no thread utils, computing the tail in process");
+	else if (tail_thread &&
+	    (res = convolver_start_tail_thread(impl->conv, thread_utils)) < 0)
+		pw_log_warn("convolver: can't start tail thread: %s", spa_strerror(res));
+
 	free(samples);
 
 	return impl;
@@ -1039,6 +1055,11 @@ static struct fc_port convolve_ports[] = {
 	  .name = "In",
 	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
 	},
+	/* only in convolver_late */
+	{ .index = 2,
+	  .name = "Late",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_CONTROL,
+	},
 };
 
 static void convolver_deactivate(void * Instance)
@@ -1051,6 +1072,8 @@ static void convolve_run(void * Instance, unsigned long SampleCount)
 {
 	struct convolver_impl *impl = Instance;
 	convolver_run(impl->conv, impl->port[1], impl->port[0], SampleCount);
+	if (impl->port[2] != NULL)
+		impl->port[2][0] = convolver_get_late_count(impl->conv);
 }
 
 static const struct fc_descriptor convolve_desc = {
@@ -1066,6 +1089,19 @@ static const struct fc_descriptor convolve_desc = {
 	.cleanup = convolver_cleanup,
 };
 
+static const struct fc_descriptor convolve_late_desc = {
+	.name = "convolver_late",
+
+	.n_ports = SPA_N_ELEMENTS(convolve_ports),
+	.ports = convolve_ports,
+
+	.instantiate = convolver_instantiate,
+	.connect_port = convolver_connect_port,
+	.deactivate = convolver_deactivate,
+	.run = convolve_run,
+	.cleanup = convolver_cleanup,
+};
+
 /** delay */
 struct delay_impl {
 	unsigned long rate;
@@ -1717,6 +1753,8 @@ static const struct fc_descriptor * builtin_descriptor(unsigned long Index)
 		return &mult_desc;
 	case 20:
 		return &sine_desc;
+	case 21:
+		return &convolve_late_desc;
 	}
 	return NULL;
 }
@@ -1742,6 +1780,7 @@ struct fc_plugin *load_builtin_plugin(const struct spa_support *support, uint32_
 		struct dsp_ops *dsp, const char *plugin, const char *config)
 {
 	dsp_ops = dsp;
+	thread_utils = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_ThreadUtils);
 	pffft_select_cpu(dsp->cpu_flags);
 	return &builtin_plugin;
 }
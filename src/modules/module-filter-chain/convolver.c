@@ -7,8 +7,12 @@
 #include "convolver.h"
 
 #include <spa/utils/defs.h>
+#include <spa/utils/dict.h>
+#include <spa/support/thread.h>
 
+#include <errno.h>
 #include <math.h>
+#include <semaphore.h>
 
 static struct dsp_ops *dsp;
 
@@ -266,10 +270,111 @@ struct convolver
 	float *tailInput;
 	int tailInputFill;
 	int precalculatedPos;
+
+	/* the tail can be computed on a separate thread. The result is only
+	 * needed one tail block later, the worker has that much time to
+	 * compute it. */
+	struct spa_thread_utils *utils;
+	struct spa_thread *thread;
+	sem_t tailStart;
+	sem_t tailDone;
+	float *tailWork;
+	uint32_t lateCount;
+	unsigned int threaded:1;
+	unsigned int tailBusy:1;
+	unsigned int quit:1;
 };
 
+/* wait for the worker to complete the tail block it is working on, only
+ * used outside of the processing thread */
+static void tail_wait(struct convolver *conv)
+{
+	if (!conv->tailBusy)
+		return;
+	while (sem_wait(&conv->tailDone) < 0 && errno == EINTR);
+	conv->tailBusy = false;
+}
+
+/* check if the worker completed the tail block it was working on */
+static bool tail_ready(struct convolver *conv)
+{
+	if (conv->tailBusy) {
+		if (sem_trywait(&conv->tailDone) < 0)
+			return false;
+		conv->tailBusy = false;
+	}
+	return true;
+}
+
+static void *tail_thread(void *data)
+{
+	struct convolver *conv = data;
+
+	while (true) {
+		while (sem_wait(&conv->tailStart) < 0 && errno == EINTR);
+		if (conv->quit)
+			break;
+		convolver1_run(conv->tailConvolver, conv->tailWork,
+				conv->tailOutput, conv->tailBlockSize);
+		sem_post(&conv->tailDone);
+	}
+	return NULL;
+}
+
+int convolver_start_tail_thread(struct convolver *conv, struct spa_thread_utils *utils)
+{
+	struct spa_dict_item items[1];
+
+	if (conv->tailConvolver == NULL || conv->threaded)
+		return 0;
+
+	conv->tailWork = fft_alloc(conv->tailBlockSize);
+	if (conv->tailWork == NULL)
+		return -errno;
+
+	sem_init(&conv->tailStart, 0, 0);
+	sem_init(&conv->tailDone, 0, 0);
+	conv->quit = false;
+
+	items[0] = SPA_DICT_ITEM_INIT(SPA_KEY_THREAD_NAME, "convolver-tail");
+	conv->thread = spa_thread_utils_create(utils, &SPA_DICT_INIT_ARRAY(items),
+			tail_thread, conv);
+	if (conv->thread == NULL) {
+		int res = -errno;
+		sem_destroy(&conv->tailStart);
+		sem_destroy(&conv->tailDone);
+		fft_free(conv->tailWork);
+		conv->tailWork = NULL;
+		return res;
+	}
+	conv->utils = utils;
+	conv->threaded = true;
+	return 1;
+}
+
+static void stop_tail_thread(struct convolver *conv)
+{
+	if (!conv->threaded)
+		return;
+	tail_wait(conv);
+	conv->quit = true;
+	sem_post(&conv->tailStart);
+	spa_thread_utils_join(conv->utils, conv->thread, NULL);
+	sem_destroy(&conv->tailStart);
+	sem_destroy(&conv->tailDone);
+	fft_free(conv->tailWork);
+	conv->tailWork = NULL;
+	conv->threaded = false;
+}
+
+uint32_t convolver_get_late_count(struct convolver *conv)
+{
+	return conv->lateCount;
+}
+
 void convolver_reset(struct convolver *conv)
 {
+	tail_wait(conv);
 	if (conv->headConvolver)
 		convolver1_reset(conv->headConvolver);
 	if (conv->tailConvolver0) {
@@ -340,6 +445,7 @@ struct convolver *convolver_new(struct dsp_ops *dsp_ops, int head_block, int tai
 
 void convolver_free(struct convolver *conv)
 {
+	stop_tail_thread(conv);
 	if (conv->headConvolver)
 		convolver1_free(conv->headConvolver);
 	if (conv->tailConvolver0)
@@ -390,9 +496,24 @@ int convolver_run(struct convolver *conv, const float *input, float *output, int
 
 			if (conv->tailPrecalculated &&
 			    conv->tailInputFill == conv->tailBlockSize) {
-				SPA_SWAP(conv->tailPrecalculated, conv->tailOutput);
-				convolver1_run(conv->tailConvolver, conv->tailInput,
-						conv->tailOutput, conv->tailBlockSize);
+				if (!conv->threaded) {
+					SPA_SWAP(conv->tailPrecalculated, conv->tailOutput);
+					convolver1_run(conv->tailConvolver, conv->tailInput,
+							conv->tailOutput, conv->tailBlockSize);
+				} else if (tail_ready(conv)) {
+					/* collect the previous block and start the
+					 * worker on this one */
+					SPA_SWAP(conv->tailPrecalculated, conv->tailOutput);
+					dsp_ops_copy(dsp, conv->tailWork, conv->tailInput,
+							conv->tailBlockSize);
+					conv->tailBusy = true;
+					sem_post(&conv->tailStart);
+				} else {
+					/* the worker missed the deadline, we never wait
+					 * for it. Play the last completed tail again and
+					 * leave this block out of the tail. */
+					conv->lateCount++;
+				}
 			}
 			if (conv->tailInputFill == conv->tailBlockSize) {
 				conv->tailInputFill = 0;
@@ -7,8 +7,14 @@
 
 #include "dsp-ops.h"
 
+struct spa_thread_utils;
+
 struct convolver *convolver_new(struct dsp_ops *dsp, int block, int tail, const float *ir, int irlen);
 void convolver_free(struct convolver *conv);
 
 void convolver_reset(struct convolver *conv);
 int convolver_run(struct convolver *conv, const float *input, float *output, int length);
+
+/* compute the tail blocks on a separate thread */
+int convolver_start_tail_thread(struct convolver *conv, struct spa_thread_utils *utils);
+uint32_t convolver_get_late_count(struct convolver *conv);
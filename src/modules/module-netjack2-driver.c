@@ -1218,7 +1218,7 @@ SPA_EXPORT
 int pipewire__module_init(struct pw_impl_module *module, const char *args)
 {
 	struct pw_context *context = pw_impl_module_get_context(module);
-	struct pw_properties *props = NULL;
+	struct pw_properties *props = NULL, *driver_props;
 	struct pw_data_loop *data_loop;
 	struct impl *impl;
 	const char *str;
@@ -1242,8 +1242,6 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		goto error;
 	}
 	impl->props = props;
-	data_loop = pw_context_get_data_loop(context);
-	impl->data_loop = pw_data_loop_get_loop(data_loop);
 	impl->quantum_limit = pw_properties_get_uint32(
 			pw_context_get_properties(context),
 			"default.clock.quantum-limit", 8192u);
@@ -1308,6 +1306,20 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	copy_props(impl, props, PW_KEY_NODE_ALWAYS_PROCESS);
 	copy_props(impl, props, PW_KEY_NODE_GROUP);
 	copy_props(impl, props, PW_KEY_NODE_VIRTUAL);
+	copy_props(impl, props, PW_KEY_NODE_LOOP_NAME);
+
+	/* the source has the highest priority and drives the group, the socket
+	 * is on its data loop and the sink follows it on the same loop */
+	driver_props = impl->mode & MODE_SOURCE ? impl->source.props : impl->sink.props;
+	if ((data_loop = pw_context_place_data_loop(context, driver_props)) == NULL) {
+		res = -ENOENT;
+		pw_log_error("can't find data loop %s",
+				pw_properties_get(driver_props, PW_KEY_NODE_LOOP_NAME));
+		goto error;
+	}
+	impl->data_loop = pw_data_loop_get_loop(data_loop);
+	pw_properties_set(impl->sink.props, PW_KEY_NODE_LOOP_NAME,
+			pw_properties_get(driver_props, PW_KEY_NODE_LOOP_NAME));
 
 	parse_audio_info(impl->source.props, &impl->source.info);
 	parse_audio_info(impl->sink.props, &impl->sink.info);
@@ -214,6 +214,7 @@ struct follower {
 	uint32_t pw_xrun;
 	uint32_t nj2_xrun;
 
+	struct pw_loop *data_loop;
 	struct spa_source *setup_socket;
 	struct spa_source *socket;
 
@@ -227,7 +228,6 @@ struct follower {
 struct impl {
 	struct pw_context *context;
 	struct pw_loop *main_loop;
-	struct pw_loop *data_loop;
 	struct spa_system *system;
 
 #define MODE_SINK	(1<<0)
@@ -344,7 +344,7 @@ static void sink_process(void *d, struct spa_io_position *position)
 	netjack2_send_data(&follower->peer, nframes, midi, n_midi, audio, n_audio);
 
 	if (follower->socket)
-		pw_loop_update_io(s->impl->data_loop, follower->socket, SPA_IO_IN);
+		pw_loop_update_io(follower->data_loop, follower->socket, SPA_IO_IN);
 }
 
 static void source_process(void *d, struct spa_io_position *position)
@@ -377,7 +377,7 @@ static void follower_free(struct follower *follower)
 	pw_properties_free(follower->sink.props);
 
 	if (follower->socket)
-		pw_loop_destroy_source(impl->data_loop, follower->socket);
+		pw_loop_destroy_source(follower->data_loop, follower->socket);
 	if (follower->setup_socket)
 		pw_loop_destroy_source(impl->main_loop, follower->setup_socket);
 
@@ -464,13 +464,13 @@ on_data_io(void *data, int fd, uint32_t mask)
 
 	if (mask & (SPA_IO_ERR | SPA_IO_HUP)) {
 		pw_log_warn("error:%08x", mask);
-		pw_loop_destroy_source(impl->data_loop, follower->socket);
+		pw_loop_destroy_source(follower->data_loop, follower->socket);
 		follower->socket = NULL;
 		pw_loop_invoke(impl->main_loop, do_stop_follower, 1, NULL, 0, false, follower);
 		return;
 	}
 	if (mask & SPA_IO_IN) {
-		pw_loop_update_io(impl->data_loop, follower->socket, 0);
+		pw_loop_update_io(follower->data_loop, follower->socket, 0);
 
 		pw_filter_trigger_process(follower->source.filter);
 	}
@@ -897,6 +897,7 @@ static int handle_follower_available(struct impl *impl, struct nj2_session_param
 {
 	int res, fd;
 	struct follower *follower;
+	struct pw_data_loop *data_loop;
 	char buffer[256];
 	struct netjack2_peer *peer;
 
@@ -988,6 +989,19 @@ static int handle_follower_available(struct impl *impl, struct nj2_session_param
 		goto cleanup;
 	}
 
+	/* the source is triggered from the socket, the socket is on its data
+	 * loop and the sink of the follower is placed on the same loop */
+	if ((data_loop = pw_context_place_data_loop(impl->context,
+					follower->source.props)) == NULL) {
+		res = -ENOENT;
+		pw_log_error("can't find data loop %s",
+				pw_properties_get(follower->source.props, PW_KEY_NODE_LOOP_NAME));
+		goto cleanup;
+	}
+	follower->data_loop = pw_data_loop_get_loop(data_loop);
+	pw_properties_set(follower->sink.props, PW_KEY_NODE_LOOP_NAME,
+			pw_properties_get(follower->source.props, PW_KEY_NODE_LOOP_NAME));
+
 	if ((res = create_filters(follower)) < 0)
 		goto create_failed;
 
@@ -1004,7 +1018,7 @@ static int handle_follower_available(struct impl *impl, struct nj2_session_param
 		goto socket_failed;
 	}
 
-	follower->socket = pw_loop_add_io(impl->data_loop, fd,
+	follower->socket = pw_loop_add_io(follower->data_loop, fd,
 			0, false, on_data_io, follower);
 	if (follower->socket == NULL) {
 		res = -errno;
@@ -1259,7 +1273,6 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 {
 	struct pw_context *context = pw_impl_module_get_context(module);
 	struct pw_properties *props = NULL;
-	struct pw_data_loop *data_loop;
 	struct impl *impl;
 	const char *str;
 	int res;
@@ -1283,8 +1296,6 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		goto error;
 	}
 	impl->props = props;
-	data_loop = pw_context_get_data_loop(context);
-	impl->data_loop = pw_data_loop_get_loop(data_loop);
 	impl->quantum_limit = pw_properties_get_uint32(
 			pw_context_get_properties(context),
 			"default.clock.quantum-limit", 8192u);
@@ -1372,6 +1383,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	copy_props(impl, props, PW_KEY_NODE_ALWAYS_PROCESS);
 	copy_props(impl, props, PW_KEY_NODE_LOCK_QUANTUM);
 	copy_props(impl, props, PW_KEY_NODE_LOCK_RATE);
+	copy_props(impl, props, PW_KEY_NODE_LOOP_NAME);
 	copy_props(impl, props, PW_KEY_AUDIO_CHANNELS);
 	copy_props(impl, props, SPA_KEY_AUDIO_POSITION);
 
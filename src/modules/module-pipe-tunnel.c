@@ -882,8 +882,6 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	impl->module = module;
 	impl->context = context;
 	impl->main_loop = pw_context_get_main_loop(context);
-	data_loop = pw_context_get_data_loop(context);
-	impl->data_loop = pw_data_loop_get_loop(data_loop);
 
 	if ((str = pw_properties_get(props, "tunnel.mode")) == NULL)
 		str = "playback";
@@ -950,6 +948,17 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 				"1/%u", impl->info.rate),
 
 	copy_props(impl, props, PW_KEY_NODE_RATE);
+	copy_props(impl, props, PW_KEY_NODE_LOOP_NAME);
+
+	/* the pipe and the timer are on the data loop of the stream, the loop
+	 * name is placed in the stream properties */
+	if ((data_loop = pw_context_place_data_loop(context, impl->stream_props)) == NULL) {
+		res = -ENOENT;
+		pw_log_error("can't find data loop %s",
+				pw_properties_get(impl->stream_props, PW_KEY_NODE_LOOP_NAME));
+		goto error;
+	}
+	impl->data_loop = pw_data_loop_get_loop(data_loop);
 
 	impl->buffer = calloc(1, RINGBUFFER_SIZE);
 	if (impl->buffer == NULL) {
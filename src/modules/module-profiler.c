@@ -22,6 +22,10 @@
 #include <pipewire/impl.h>
 #include <pipewire/extensions/profiler.h>
 
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE	0x0010	/* prevent future writes while mapped */
+#endif
+
 /** \page page_module_profiler Profiler
  *
  * The profiler module provides a Profiler interface for applications that
@@ -34,10 +38,19 @@
  *
  * `libpipewire-module-profiler`
  *
+ * ## Module Options
+ *
+ * - `profiler.ring-records`: the number of records in the shared memory ring,
+ *   rounded up to a power of 2, default 65536.
+ *
+ * Clients that bind version 4 of the interface receive the profiling data in
+ * a shared memory ring of fixed size records, see \ref pw_profiler_ring, and
+ * the node names with the node event. Older clients receive a POD with the
+ * data of every cycle.
+ *
  * ## Example configuration
  *
- * The module has no arguments and is usually added to the config file of
- * the main pipewire daemon.
+ * The module is usually added to the config file of the main pipewire daemon.
  *
  *\code{.unparsed}
  * context.modules = [
@@ -56,10 +69,15 @@
 PW_LOG_TOPIC(mod_topic, "mod." NAME);
 #define PW_LOG_TOPIC_DEFAULT mod_topic
 
-#define TMP_BUFFER		(16 * 1024)
-#define DATA_BUFFER		(32 * 1024)
+#define TMP_BUFFER		(32 * 1024)
+#define DATA_BUFFER		(64 * 1024)
 #define FLUSH_BUFFER		(8 * 1024 * 1024)
 
+#define DEFAULT_RING_RECORDS	65536
+
+/* the first version that receives the ring */
+#define VERSION_RING		4
+
 int pw_protocol_native_ext_profiler_init(struct pw_context *context);
 
 #define pw_profiler_resource(r,m,v,...)      \
@@ -67,6 +85,10 @@ int pw_protocol_native_ext_profiler_init(struct pw_context *context);
 
 #define pw_profiler_resource_profile(r,...)        \
         pw_profiler_resource(r,profile,0,__VA_ARGS__)
+#define pw_profiler_resource_ring(r,...)        \
+        pw_profiler_resource(r,ring,1,__VA_ARGS__)
+#define pw_profiler_resource_node(r,...)        \
+        pw_profiler_resource(r,node,1,__VA_ARGS__)
 
 static const struct spa_dict_item module_props[] = {
 	{ PW_KEY_MODULE_AUTHOR, "Wim Taymans <wim.taymans@gmail.com>" },
@@ -74,6 +96,9 @@ static const struct spa_dict_item module_props[] = {
 	{ PW_KEY_MODULE_VERSION, PACKAGE_VERSION },
 };
 
+/* The drivers can run on different data loops. The buffer of a node is only
+ * written from the rt hooks of the driver, on its own data loop, and read
+ * from the main loop. */
 struct node {
 	struct spa_list link;
 	struct impl *impl;
@@ -94,7 +119,6 @@ struct impl {
 	struct pw_properties *properties;
 
 	struct pw_loop *main_loop;
-	struct pw_loop *data_loop;
 
 	struct spa_hook context_listener;
 	struct spa_hook module_listener;
@@ -105,9 +129,19 @@ struct impl {
 	struct spa_list node_list;
 
 	uint32_t busy;
+	uint32_t pod_clients;
+	uint32_t ring_clients;
 	struct spa_source *flush_event;
 	unsigned int listening:1;
 
+	uint32_t n_records;
+	struct pw_memblock *ring_mem;
+	struct pw_profiler_ring *ring;
+	/* the layout of the ring, the header is in shared memory and is
+	 * never used to find the records */
+	uint32_t ring_mask;
+	uint32_t record_size;
+
 #ifdef max_align_t
 	alignas(max_align_t)
 #else
@@ -121,6 +155,8 @@ struct resource_data {
 
 	struct pw_resource *resource;
 	struct spa_hook resource_listener;
+
+	struct pw_memblock *mem;
 };
 
 static void do_flush_event(void *data, uint64_t count)
@@ -155,13 +191,172 @@ static void do_flush_event(void *data, uint64_t count)
 
 	*p = SPA_POD_INIT_Struct(total);
 
-	spa_list_for_each(resource, &impl->global->resource_list, link)
-		pw_profiler_resource_profile(resource, &p->pod);
+	spa_list_for_each(resource, &impl->global->resource_list, link) {
+		struct resource_data *d = pw_resource_get_user_data(resource);
+		if (d->mem == NULL)
+			pw_profiler_resource_profile(resource, &p->pod);
+	}
 }
 
-static void context_do_profile(void *data)
+static void target_latency(struct pw_node_target *t, struct spa_fraction *latency)
+{
+	struct pw_impl_node *n = t->node;
+
+	if (n != NULL) {
+		*latency = n->latency;
+		if (n->force_quantum != 0)
+			latency->num = n->force_quantum;
+		if (n->force_rate != 0)
+			latency->denom = n->force_rate;
+		else if (n->rate.denom != 0)
+			latency->denom = n->rate.denom;
+	} else {
+		spa_zero(*latency);
+	}
+}
+
+/* p50, p99, p99.9 and max of the latency histograms of a node, in the order
+ * wakeup, process and cycle. Nodes of other processes have no histograms. */
+static void get_hists(struct pw_impl_node *node, uint64_t values[3][4])
+{
+	static const struct pw_node_hist empty;
+	const struct pw_node_hist *h;
+	uint32_t i;
+
+	for (i = 0; i < 3; i++) {
+		if (node == NULL)
+			h = &empty;
+		else
+			h = i == 0 ? &node->rt.wakeup_hist :
+			    i == 1 ? &node->rt.process_hist : &node->rt.cycle_hist;
+
+		values[i][0] = pw_node_hist_percentile(h, 0.5);
+		values[i][1] = pw_node_hist_percentile(h, 0.99);
+		values[i][2] = pw_node_hist_percentile(h, 0.999);
+		values[i][3] = h->max;
+	}
+}
+
+static inline void record_hists(struct pw_profiler_record *r, struct pw_impl_node *node)
+{
+	uint64_t values[3][4];
+
+	get_hists(node, values);
+	memcpy(r->wakeup_hist, values[0], sizeof(r->wakeup_hist));
+	memcpy(r->process_hist, values[1], sizeof(r->process_hist));
+	memcpy(r->cycle_hist, values[2], sizeof(r->cycle_hist));
+}
+
+static void add_hists(struct spa_pod_builder *b, struct pw_impl_node *node)
+{
+	uint64_t values[3][4];
+	uint32_t i;
+
+	get_hists(node, values);
+	for (i = 0; i < 3; i++)
+		spa_pod_builder_add(b,
+				SPA_POD_Long(values[i][0]),
+				SPA_POD_Long(values[i][1]),
+				SPA_POD_Long(values[i][2]),
+				SPA_POD_Long(values[i][3]),
+				NULL);
+}
+
+static inline struct pw_profiler_record *ring_record(struct impl *impl, uint32_t index)
+{
+	return PW_PROFILER_RING_RECORD(impl->ring, impl->ring_mask,
+			impl->record_size, index);
+}
+
+static inline struct pw_profiler_record *record_begin(struct impl *impl, uint32_t index)
+{
+	struct pw_profiler_record *r = ring_record(impl, index);
+	SPA_SEQ_WRITE(r->seq);
+	r->index = index;
+	return r;
+}
+
+static inline void record_end(struct pw_profiler_record *r)
+{
+	SPA_SEQ_WRITE(r->seq);
+}
+
+static void write_records(struct node *n)
+{
+	struct impl *impl = n->impl;
+	struct pw_profiler_ring *ring = impl->ring;
+	struct pw_impl_node *node = n->node;
+	uint32_t id = node->info.id;
+	struct pw_node_activation *a = node->rt.target.activation;
+	struct spa_io_position *pos = &a->position;
+	struct pw_profiler_record *r;
+	struct pw_node_target *t;
+	uint32_t index, n_followers = 0;
+
+	spa_list_for_each(t, &node->rt.target_list, link) {
+		if (t->id == id || t->flags & PW_NODE_TARGET_PEER)
+			continue;
+		n_followers++;
+	}
+	if (n_followers > impl->ring_mask)
+		return;
+
+	/* claim the records of the cycle, other drivers can write at the same time */
+	index = __atomic_fetch_add(&ring->write_index, n_followers + 1, __ATOMIC_SEQ_CST);
+
+	r = record_begin(impl, index++);
+	r->type = PW_PROFILER_RECORD_DRIVER;
+	r->id = id;
+	r->driver_id = id;
+	r->status = a->status;
+	r->count = n->count;
+	r->prev_signal = a->prev_signal_time;
+	r->signal = a->signal_time;
+	r->awake = a->awake_time;
+	r->finish = a->finish_time;
+	r->latency = node->latency;
+	r->xrun_count = a->xrun_count;
+	r->n_followers = n_followers;
+	r->cpu_load[0] = a->cpu_load[0];
+	r->cpu_load[1] = a->cpu_load[1];
+	r->cpu_load[2] = a->cpu_load[2];
+	r->clock_flags = pos->clock.flags;
+	r->clock_nsec = pos->clock.nsec;
+	r->clock_rate = pos->clock.rate;
+	r->clock_position = pos->clock.position;
+	r->clock_duration = pos->clock.duration;
+	r->clock_delay = pos->clock.delay;
+	r->clock_rate_diff = pos->clock.rate_diff;
+	r->clock_next_nsec = pos->clock.next_nsec;
+	record_hists(r, node);
+	record_end(r);
+
+	spa_list_for_each(t, &node->rt.target_list, link) {
+		struct pw_node_activation *na = t->activation;
+
+		if (t->id == id || t->flags & PW_NODE_TARGET_PEER)
+			continue;
+
+		r = record_begin(impl, index++);
+		r->type = PW_PROFILER_RECORD_FOLLOWER;
+		r->id = t->id;
+		r->driver_id = id;
+		r->status = na->status;
+		r->count = n->count;
+		r->prev_signal = a->signal_time;
+		r->signal = na->signal_time;
+		r->awake = na->awake_time;
+		r->finish = na->finish_time;
+		target_latency(t, &r->latency);
+		r->xrun_count = na->xrun_count;
+		r->n_followers = 0;
+		record_hists(r, t->node);
+		record_end(r);
+	}
+}
+
+static void write_pod(struct node *n)
 {
-	struct node *n = data;
 	struct pw_impl_node *node = n->node;
 	struct impl *impl = n->impl;
 	struct spa_pod_builder b;
@@ -173,9 +368,6 @@ static void context_do_profile(void *data)
 	int32_t filled;
 	uint32_t idx, avail;
 
-	if (SPA_FLAG_IS_SET(pos->clock.flags, SPA_IO_CLOCK_FLAG_FREEWHEEL))
-		return;
-
 	spa_pod_builder_init(&b, n->tmp, sizeof(n->tmp));
 	spa_pod_builder_push_object(&b, &f[0],
 			SPA_TYPE_OBJECT_Profiler, 0);
@@ -203,7 +395,8 @@ static void context_do_profile(void *data)
 
 
 	spa_pod_builder_prop(&b, SPA_PROFILER_driverBlock, 0);
-	spa_pod_builder_add_struct(&b,
+	spa_pod_builder_push_struct(&b, &f[1]);
+	spa_pod_builder_add(&b,
 			SPA_POD_Int(id),
 			SPA_POD_String(node->name),
 			SPA_POD_Long(a->prev_signal_time),
@@ -212,31 +405,24 @@ static void context_do_profile(void *data)
 			SPA_POD_Long(a->finish_time),
 			SPA_POD_Int(a->status),
 			SPA_POD_Fraction(&node->latency),
-			SPA_POD_Int(a->xrun_count));
+			SPA_POD_Int(a->xrun_count),
+			NULL);
+	add_hists(&b, node);
+	spa_pod_builder_pop(&b, &f[1]);
 
 	spa_list_for_each(t, &node->rt.target_list, link) {
-		struct pw_impl_node *n = t->node;
 		struct pw_node_activation *na;
 		struct spa_fraction latency;
 
 		if (t->id == id || t->flags & PW_NODE_TARGET_PEER)
 			continue;
 
-		if (n != NULL) {
-			latency = n->latency;
-			if (n->force_quantum != 0)
-				latency.num = n->force_quantum;
-			if (n->force_rate != 0)
-				latency.denom = n->force_rate;
-			else if (n->rate.denom != 0)
-				latency.denom = n->rate.denom;
-		} else {
-			spa_zero(latency);
-		}
+		target_latency(t, &latency);
 
 		na = t->activation;
 		spa_pod_builder_prop(&b, SPA_PROFILER_followerBlock, 0);
-		spa_pod_builder_add_struct(&b,
+		spa_pod_builder_push_struct(&b, &f[1]);
+		spa_pod_builder_add(&b,
 			SPA_POD_Int(t->id),
 			SPA_POD_String(t->name),
 			SPA_POD_Long(a->signal_time),
@@ -245,22 +431,25 @@ static void context_do_profile(void *data)
 			SPA_POD_Long(na->finish_time),
 			SPA_POD_Int(na->status),
 			SPA_POD_Fraction(&latency),
-			SPA_POD_Int(na->xrun_count));
+			SPA_POD_Int(na->xrun_count),
+			NULL);
+		add_hists(&b, t->node);
+		spa_pod_builder_pop(&b, &f[1]);
 	}
 	spa_pod_builder_pop(&b, &f[0]);
 
 	if (b.state.offset > sizeof(n->tmp))
-		goto done;
+		return;
 
 	filled = spa_ringbuffer_get_write_index(&n->buffer, &idx);
 	if (filled < 0 || filled > DATA_BUFFER) {
 		pw_log_warn("%p: queue xrun %d", impl, filled);
-		goto done;
+		return;
 	}
 	avail = DATA_BUFFER - filled;
 	if (avail < b.state.offset) {
 		pw_log_warn("%p: queue full %d < %d", impl, avail, b.state.offset);
-		goto done;
+		return;
 	}
 	spa_ringbuffer_write_data(&n->buffer,
 			n->data, DATA_BUFFER,
@@ -269,7 +458,22 @@ static void context_do_profile(void *data)
 	spa_ringbuffer_write_update(&n->buffer, idx + b.state.offset);
 
 	pw_loop_signal_event(impl->main_loop, impl->flush_event);
-done:
+}
+
+static void context_do_profile(void *data)
+{
+	struct node *n = data;
+	struct impl *impl = n->impl;
+	struct spa_io_position *pos = &n->node->rt.target.activation->position;
+
+	if (SPA_FLAG_IS_SET(pos->clock.flags, SPA_IO_CLOCK_FLAG_FREEWHEEL))
+		return;
+
+	if (impl->ring != NULL && impl->ring_clients > 0)
+		write_records(n);
+	if (impl->pod_clients > 0)
+		write_pod(n);
+
 	n->count++;
 }
 
@@ -340,8 +544,39 @@ static void context_driver_removed(void *data, struct pw_impl_node *node)
 	free(n);
 }
 
+static int send_node(void *data, struct pw_global *global)
+{
+	struct resource_data *d = data;
+	struct pw_resource *resource = d->resource;
+	struct pw_impl_node *node;
+
+	if (!pw_global_is_type(global, PW_TYPE_INTERFACE_Node) ||
+	    !PW_PERM_IS_R(pw_global_get_permissions(global, pw_resource_get_client(resource))))
+		return 0;
+
+	node = pw_global_get_object(global);
+	pw_profiler_resource_node(resource, pw_global_get_id(global), node->name);
+	return 0;
+}
+
+static void context_global_added(void *data, struct pw_global *global)
+{
+	struct impl *impl = data;
+	struct pw_resource *resource;
+
+	if (impl->global == NULL || impl->ring_clients == 0)
+		return;
+
+	spa_list_for_each(resource, &impl->global->resource_list, link) {
+		struct resource_data *d = pw_resource_get_user_data(resource);
+		if (d->mem != NULL)
+			send_node(d, global);
+	}
+}
+
 static const struct pw_context_events context_events = {
 	PW_VERSION_CONTEXT_EVENTS,
+	.global_added = context_global_added,
 	.driver_added = context_driver_added,
 	.driver_removed = context_driver_removed,
 };
@@ -356,7 +591,16 @@ static void stop_listener(struct impl *impl)
 
 static void resource_destroy(void *data)
 {
-	struct impl *impl = data;
+	struct resource_data *d = data;
+	struct impl *impl = d->impl;
+
+	if (d->mem != NULL) {
+		impl->ring_clients--;
+		pw_memblock_unref(d->mem);
+		d->mem = NULL;
+	} else {
+		impl->pod_clients--;
+	}
 	if (--impl->busy == 0) {
 		pw_log_info("%p: stopping profiler", impl);
 		stop_listener(impl);
@@ -368,6 +612,53 @@ static const struct pw_resource_events resource_events = {
 	.destroy = resource_destroy,
 };
 
+static int alloc_ring(struct impl *impl)
+{
+	struct pw_profiler_ring *ring;
+	uint32_t i;
+
+	if (impl->ring_mem != NULL)
+		return 0;
+
+	/* sealed below, after the ring is mapped */
+	impl->ring_mem = pw_mempool_alloc(pw_context_get_mempool(impl->context),
+			PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd,
+			sizeof(struct pw_profiler_ring) +
+			impl->n_records * sizeof(struct pw_profiler_record));
+	if (impl->ring_mem == NULL)
+		return -errno;
+
+	impl->ring = ring = impl->ring_mem->map->ptr;
+	impl->ring_mask = impl->n_records - 1;
+	impl->record_size = sizeof(struct pw_profiler_record);
+
+	ring->version = PW_PROFILER_RING_VERSION;
+	ring->n_records = impl->n_records;
+	ring->record_size = impl->record_size;
+	ring->write_index = 0;
+	/* make the slots look like they were written in the previous round */
+	for (i = 0; i < impl->n_records; i++)
+		ring_record(impl, i)->index = i - impl->n_records;
+
+#ifdef F_ADD_SEALS
+	/* only our mapping can write, clients get a read-only view. Older
+	 * kernels don't have F_SEAL_FUTURE_WRITE, we never trust the header
+	 * anyway. */
+	if (fcntl(impl->ring_mem->fd, F_ADD_SEALS, F_SEAL_GROW | F_SEAL_SHRINK |
+				F_SEAL_FUTURE_WRITE | F_SEAL_SEAL) < 0 &&
+	    fcntl(impl->ring_mem->fd, F_ADD_SEALS, F_SEAL_GROW | F_SEAL_SHRINK |
+				F_SEAL_SEAL) < 0)
+		pw_log_warn("%p: can't seal ring: %m", impl);
+#endif
+
+	pw_log_info("%p: ring of %u records, %u bytes", impl,
+			impl->n_records, impl->ring_mem->size);
+
+	return 0;
+}
+
 static int
 global_bind(void *object, struct pw_impl_client *client, uint32_t permissions,
             uint32_t version, uint32_t id)
@@ -376,6 +667,10 @@ global_bind(void *object, struct pw_impl_client *client, uint32_t permissions,
 	struct pw_global *global = impl->global;
 	struct pw_resource *resource;
 	struct resource_data *data;
+	int res;
+
+	if (version >= VERSION_RING && (res = alloc_ring(impl)) < 0)
+		return res;
 
 	resource = pw_resource_new(client, id, permissions,
 			PW_TYPE_INTERFACE_Profiler, version, sizeof(*data));
@@ -385,10 +680,30 @@ global_bind(void *object, struct pw_impl_client *client, uint32_t permissions,
         data = pw_resource_get_user_data(resource);
         data->impl = impl;
         data->resource = resource;
+
+	if (version >= VERSION_RING) {
+		/* clients only read from the ring */
+		data->mem = pw_mempool_import(pw_impl_client_get_mempool(client),
+				PW_MEMBLOCK_FLAG_READABLE | PW_MEMBLOCK_FLAG_DONT_CLOSE,
+				impl->ring_mem->type, impl->ring_mem->fd);
+		if (data->mem == NULL) {
+			res = -errno;
+			pw_resource_destroy(resource);
+			return res;
+		}
+	}
 	pw_global_add_resource(global, resource);
 
 	pw_resource_add_listener(resource, &data->resource_listener,
-			&resource_events, impl);
+			&resource_events, data);
+
+	if (data->mem != NULL) {
+		impl->ring_clients++;
+		pw_context_for_each_global(impl->context, send_node, data);
+		pw_profiler_resource_ring(resource, data->mem->id, 0, data->mem->size);
+	} else {
+		impl->pod_clients++;
+	}
 
 	if (++impl->busy == 1) {
 		pw_log_info("%p: starting profiler", impl);
@@ -412,6 +727,9 @@ static void module_destroy(void *data)
 
 	pw_loop_destroy_source(impl->main_loop, impl->flush_event);
 
+	if (impl->ring_mem != NULL)
+		pw_memblock_unref(impl->ring_mem);
+
 	free(impl);
 }
 
@@ -465,7 +783,13 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	impl->context = context;
 	impl->properties = props;
 	impl->main_loop = pw_context_get_main_loop(impl->context);
-	impl->data_loop = pw_data_loop_get_loop(pw_context_get_data_loop(impl->context));
+
+	impl->n_records = pw_properties_get_uint32(props, "profiler.ring-records",
+			DEFAULT_RING_RECORDS);
+	impl->n_records = SPA_CLAMP(impl->n_records, 1024u, 1u << 20);
+	/* round up to a power of 2 */
+	while (impl->n_records & (impl->n_records - 1))
+		impl->n_records += impl->n_records & -impl->n_records;
 
 	impl->global = pw_global_new(context,
 			PW_TYPE_INTERFACE_Profiler,
@@ -185,6 +185,28 @@
  * This is equivalent to the PulseAudio `default-sample-channels` and
  * `default-channel-map` options in `/etc/pulse/daemon.conf`.
  *
+ * ### Shared memory options
+ *
+ *\code{.unparsed}
+ *     pulse.shm = true
+ *\endcode
+ *
+ * Local, unrestricted clients of the same user can send the audio of
+ * playback streams in a sealed memfd pool instead of copying it through
+ * the socket. POSIX shm pools are not accepted. Disable this to always
+ * receive the audio through the socket.
+ *
+ * ### Registry options
+ *
+ *\code{.unparsed}
+ *     pulse.registry.shared = true
+ *\endcode
+ *
+ * Clients with unrestricted access share one copy of the PipeWire registry,
+ * with all objects, their properties and params. When disabled, each client
+ * keeps its own copy. Clients with restricted access always use their own
+ * copy because they see a different set of objects.
+ *
  * ### VM options
  *
  *\code{.unparsed}
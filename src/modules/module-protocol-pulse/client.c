@@ -2,9 +2,12 @@
 /* SPDX-FileCopyrightText: Copyright © 2020 Wim Taymans */
 /* SPDX-License-Identifier: MIT */
 
+#include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 
@@ -27,8 +30,11 @@
 #include "operation.h"
 #include "pending-sample.h"
 #include "server.h"
+#include "shm.h"
 #include "stream.h"
 
+#define MAX_RELEASES	64
+
 #define client_emit_disconnect(c) spa_hook_list_call(&(c)->listener_list, struct client_events, disconnect, 0)
 
 struct client *client_new(struct server *server)
@@ -41,11 +47,14 @@ struct client *client_new(struct server *server)
 	client->server = server;
 	client->impl = server->impl;
 	client->connect_tag = SPA_ID_INVALID;
+	client->recv_fd = -1;
 
 	pw_map_init(&client->streams, 16, 16);
+	pw_array_init(&client->shm_pools, 256);
 	spa_list_init(&client->out_messages);
 	spa_list_init(&client->operations);
 	spa_list_init(&client->pending_samples);
+	spa_list_init(&client->temporary_moves);
 	spa_hook_list_init(&client->listener_list);
 
 	spa_list_append(&server->clients, &client->link);
@@ -114,7 +123,12 @@ void client_disconnect(struct client *client)
 	}
 
 	if (client->manager) {
-		pw_manager_destroy(client->manager);
+		if (client->shared_manager) {
+			spa_hook_remove(&client->manager_listener);
+			impl_release_manager(impl);
+		} else {
+			pw_manager_destroy(client->manager);
+		}
 		client->manager = NULL;
 	}
 }
@@ -142,12 +156,19 @@ void client_free(struct client *client)
 
 	spa_list_consume(msg, &client->out_messages, link)
 		message_free(msg, true, false);
+	client->release_msg = NULL;
+
+	shm_clear(client);
+	if (client->recv_fd >= 0)
+		close(client->recv_fd);
 
 	spa_list_consume(o, &client->operations, link)
 		operation_free(o);
 
-	if (client->core)
+	if (client->core) {
+		spa_hook_remove(&client->core_listener);
 		pw_core_disconnect(client->core);
+	}
 
 	pw_map_clear(&client->streams);
 
@@ -206,6 +227,78 @@ error:
 	return res;
 }
 
+/* Tell the client that we are done with a shared memory block. The
+ * release frames are collected in one message so that they are sent
+ * together. */
+int client_queue_release(struct client *client, uint32_t block_id)
+{
+	struct message *m = client->release_msg;
+	struct descriptor *desc;
+	int res;
+
+	if (client->disconnect)
+		return -ENOTCONN;
+
+	if (m != NULL && m->length + sizeof(*desc) <= m->allocated &&
+	    (client->out_index == 0 ||
+	     m != spa_list_first(&client->out_messages, struct message, link))) {
+		desc = SPA_PTROFF(m->data, m->length, struct descriptor);
+		m->length += sizeof(*desc);
+	} else {
+		m = message_alloc(client->impl, SPA_ID_INVALID, MAX_RELEASES * sizeof(*desc));
+		if (m == NULL)
+			return -errno;
+		m->raw = true;
+		m->length = sizeof(*desc);
+		desc = (struct descriptor *) m->data;
+	}
+
+	desc->length = 0;
+	desc->channel = htonl((uint32_t) -1);
+	desc->offset_hi = htonl(block_id);
+	desc->offset_lo = 0;
+	desc->flags = htonl(FLAG_SHMRELEASE);
+
+	if (m == client->release_msg)
+		return 0;
+
+	if ((res = client_queue_message(client, m)) < 0)
+		return res;
+
+	client->release_msg = m;
+	return 0;
+}
+
+static ssize_t client_send(struct client *client, const void *data, size_t size, bool creds)
+{
+#ifdef SCM_CREDENTIALS
+	if (creds) {
+		struct iovec iov = { (void *) data, size };
+		char buf[CMSG_SPACE(sizeof(struct ucred))];
+		struct msghdr msg = {
+			.msg_iov = &iov,
+			.msg_iovlen = 1,
+			.msg_control = buf,
+			.msg_controllen = sizeof(buf),
+		};
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		struct ucred ucred = {
+			.pid = getpid(),
+			.uid = getuid(),
+			.gid = getgid(),
+		};
+
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_CREDENTIALS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(ucred));
+		memcpy(CMSG_DATA(cmsg), &ucred, sizeof(ucred));
+
+		return sendmsg(client->source->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+	}
+#endif
+	return send(client->source->fd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
 static int client_try_flush_messages(struct client *client)
 {
 	pw_log_trace("client %p: flushing", client);
@@ -216,9 +309,9 @@ static int client_try_flush_messages(struct client *client)
 		struct message *m = spa_list_first(&client->out_messages, struct message, link);
 		struct descriptor desc;
 		const void *data;
-		size_t size;
+		size_t size, header = m->raw ? 0 : sizeof(desc);
 
-		if (client->out_index < sizeof(desc)) {
+		if (client->out_index < header) {
 			desc.length = htonl(m->length);
 			desc.channel = htonl(m->channel);
 			desc.offset_hi = 0;
@@ -227,20 +320,23 @@ static int client_try_flush_messages(struct client *client)
 
 			data = SPA_PTROFF(&desc, client->out_index, void);
 			size = sizeof(desc) - client->out_index;
-		} else if (client->out_index < m->length + sizeof(desc)) {
-			uint32_t idx = client->out_index - sizeof(desc);
+		} else if (client->out_index < m->length + header) {
+			uint32_t idx = client->out_index - header;
 			data = m->data + idx;
 			size = m->length - idx;
 		} else {
-			if (debug_messages && m->channel == SPA_ID_INVALID)
+			if (debug_messages && m->channel == SPA_ID_INVALID && !m->raw)
 				message_dump(SPA_LOG_LEVEL_INFO, m);
+			if (m == client->release_msg)
+				client->release_msg = NULL;
 			message_free(m, true, false);
 			client->out_index = 0;
 			continue;
 		}
 
 		while (true) {
-			ssize_t sent = send(client->source->fd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+			ssize_t sent = client_send(client, data, size,
+					m->creds && client->out_index == 0);
 			if (sent < 0) {
 				int res = -errno;
 				if (res == -EINTR)
@@ -367,3 +463,19 @@ int client_queue_subscribe_event(struct client *client, uint32_t mask, uint32_t
 
 	return client_queue_message(client, reply);
 }
+
+/*
+ * completes the operations of the client after all its previous requests
+ * are processed and the manager has seen the result. When the manager is
+ * shared, the requests on the client core are synced first.
+ */
+int client_sync(struct client *client)
+{
+	if (!client->shared_manager) {
+		client->sync_pending = true;
+		return pw_manager_sync(client->manager);
+	}
+	client->sync_pending = false;
+	client->core_seq = pw_core_sync(client->core, PW_ID_CORE, client->core_seq);
+	return client->core_seq;
+}
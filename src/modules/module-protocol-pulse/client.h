@@ -10,6 +10,7 @@
 
 #include <spa/utils/list.h>
 #include <spa/utils/hook.h>
+#include <pipewire/array.h>
 #include <pipewire/map.h>
 
 struct impl;
@@ -47,6 +48,8 @@ struct client {
 	uint64_t quirks;
 
 	struct pw_core *core;
+	struct spa_hook core_listener;
+	int core_seq;
 	struct pw_manager *manager;
 	struct spa_hook manager_listener;
 
@@ -57,6 +60,7 @@ struct client {
 	char *default_source;
 	char *temporary_default_sink;		/**< pending value, for MOVE_* commands */
 	char *temporary_default_source;		/**< pending value, for MOVE_* commands */
+	struct spa_list temporary_moves;	/**< pending stream targets, for MOVE_* commands */
 	struct pw_manager_object *metadata_routes;
 	struct pw_properties *routes;
 
@@ -66,6 +70,10 @@ struct client {
 	uint32_t out_index;
 	struct descriptor desc;
 	struct message *message;
+	int recv_fd;				/**< fd received with the current frame */
+
+	struct pw_array shm_pools;		/**< shared memory imported from the client */
+	struct message *release_msg;		/**< pending SHMRELEASE frames */
 
 	struct pw_map streams;
 	struct spa_list out_messages;
@@ -77,6 +85,10 @@ struct client {
 	unsigned int disconnect:1;
 	unsigned int new_msg_since_last_flush:1;
 	unsigned int authenticated:1;
+	unsigned int shared_manager:1;		/**< manager is shared with other clients */
+	unsigned int sync_pending:1;		/**< waiting for a manager sync */
+	unsigned int use_shm:1;			/**< client sends memblocks in shared memory */
+	unsigned int use_memfd:1;		/**< client can register memfd pools */
 
 	struct pw_manager_object *prev_default_sink;
 	struct pw_manager_object *prev_default_source;
@@ -96,8 +108,10 @@ bool client_detach(struct client *client);
 void client_disconnect(struct client *client);
 void client_free(struct client *client);
 int client_queue_message(struct client *client, struct message *msg);
+int client_queue_release(struct client *client, uint32_t block_id);
 int client_flush_messages(struct client *client);
 int client_queue_subscribe_event(struct client *client, uint32_t mask, uint32_t event, uint32_t id);
+int client_sync(struct client *client);
 
 static inline void client_unref(struct client *client)
 {
@@ -23,6 +23,8 @@
 #define FRAME_SIZE_MAX_ALLOW (1024*1024*16)
 
 #define PROTOCOL_FLAG_MASK	0xffff0000u
+#define PROTOCOL_FLAG_SHM	0x80000000u
+#define PROTOCOL_FLAG_MEMFD	0x40000000u
 #define PROTOCOL_VERSION_MASK	0x0000ffffu
 #define PROTOCOL_VERSION	35
 
@@ -33,6 +35,7 @@
 #define MAX_BUFFERS     4u
 
 #define MAXLENGTH		(4u*1024*1024) /* 4MB */
+#define MIN_BUFFER_SIZE		(16u*1024) /* 16KB */
 
 #define SCACHE_ENTRY_SIZE_MAX	(1024*1024*16)
 
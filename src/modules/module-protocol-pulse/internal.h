@@ -67,6 +67,15 @@ struct impl {
 	struct spa_list free_messages;
 	struct defs defs;
 	struct stats stat;
+
+	/* allow local clients to send memblocks in shared memory */
+	bool enable_shm;
+
+	/* registry mirror shared by the clients with unrestricted access */
+	bool share_manager;
+	struct pw_core *manager_core;
+	struct pw_manager *manager;
+	uint32_t manager_users;
 };
 
 struct impl_events {
@@ -86,4 +95,7 @@ extern bool debug_messages;
 
 void broadcast_subscribe_event(struct impl *impl, uint32_t mask, uint32_t event, uint32_t id);
 
+struct pw_manager *impl_acquire_manager(struct impl *impl);
+void impl_release_manager(struct impl *impl);
+
 #endif
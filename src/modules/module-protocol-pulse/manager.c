@@ -43,6 +43,14 @@ struct object_info {
 	void (*destroy) (struct object *object);
 };
 
+struct metadata_entry {
+	struct spa_list link;
+	uint32_t subject;
+	char *key;
+	char *type;
+	char *value;
+};
+
 struct object_data {
 	struct spa_list link;
 	struct object *object;
@@ -65,6 +73,8 @@ struct object {
 	struct spa_hook object_listener;
 
 	struct spa_list data_list;
+
+	struct spa_list metadata_list;	/* cached metadata properties */
 };
 
 static int core_sync(struct manager *m)
@@ -179,10 +189,20 @@ static void object_data_free(struct object_data *d)
 	free(d);
 }
 
+static void metadata_entry_free(struct metadata_entry *e)
+{
+	spa_list_remove(&e->link);
+	free(e->key);
+	free(e->type);
+	free(e->value);
+	free(e);
+}
+
 static void object_destroy(struct object *o)
 {
 	struct manager *m = o->manager;
 	struct object_data *d;
+	struct metadata_entry *e;
 	spa_list_remove(&o->this.link);
 	m->this.n_objects--;
 	if (o->this.proxy)
@@ -194,6 +214,8 @@ static void object_destroy(struct object *o)
 	clear_params(&o->pending_list, SPA_ID_INVALID);
 	spa_list_consume(d, &o->data_list, link)
 		object_data_free(d);
+	spa_list_consume(e, &o->metadata_list, link)
+		metadata_entry_free(e);
 	free(o);
 }
 
@@ -501,6 +523,37 @@ static const struct object_info link_info = {
 };
 
 /* metadata */
+static void metadata_cache_update(struct object *o, uint32_t subject,
+		const char *key, const char *type, const char *value)
+{
+	struct metadata_entry *e, *t;
+
+	spa_list_for_each_safe(e, t, &o->metadata_list, link) {
+		if (e->subject != subject)
+			continue;
+		if (key == NULL || spa_streq(e->key, key))
+			metadata_entry_free(e);
+	}
+	if (key == NULL || value == NULL)
+		return;
+
+	e = calloc(1, sizeof(*e));
+	if (e == NULL)
+		return;
+	e->subject = subject;
+	e->key = strdup(key);
+	e->type = type ? strdup(type) : NULL;
+	e->value = strdup(value);
+	if (e->key == NULL || e->value == NULL || (type != NULL && e->type == NULL)) {
+		free(e->key);
+		free(e->type);
+		free(e->value);
+		free(e);
+		return;
+	}
+	spa_list_append(&o->metadata_list, &e->link);
+}
+
 static int metadata_property(void *data,
 			uint32_t subject,
 			const char *key,
@@ -509,6 +562,7 @@ static int metadata_property(void *data,
 {
 	struct object *o = data;
 	struct manager *m = o->manager;
+	metadata_cache_update(o, subject, key, type, value);
 	manager_emit_metadata(m, &o->this, subject, key, type, value);
 	return 0;
 }
@@ -523,7 +577,9 @@ static void metadata_init(struct object *object)
 	struct object *o = object;
 	struct manager *m = o->manager;
 	o->this.creating = false;
+	o->this.generation++;
 	manager_emit_added(m, &o->this);
+	o->this.change_mask = 0;
 }
 
 static const struct object_info metadata_info = {
@@ -624,6 +680,7 @@ static void registry_event_global(void *data, uint32_t id,
 	spa_list_init(&o->this.param_list);
 	spa_list_init(&o->pending_list);
 	spa_list_init(&o->data_list);
+	spa_list_init(&o->metadata_list);
 
 	o->manager = m;
 	o->info = info;
@@ -692,10 +749,14 @@ static void on_core_done(void *data, uint32_t id, int seq)
 		spa_list_for_each(o, &m->this.object_list, this.link) {
 			if (o->this.creating) {
 				o->this.creating = false;
+				o->this.generation++;
 				manager_emit_added(m, &o->this);
+				o->this.change_mask = 0;
 				o->changed = 0;
 			} else if (o->changed > 0) {
+				o->this.generation++;
 				manager_emit_updated(m, &o->this);
+				o->this.change_mask = 0;
 				o->changed = 0;
 			}
 		}
@@ -758,7 +819,23 @@ void pw_manager_add_listener(struct pw_manager *manager,
 		const struct pw_manager_events *events, void *data)
 {
 	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	struct object *o;
+	struct metadata_entry *e;
+
 	spa_hook_list_append(&m->hooks, listener, events, data);
+
+	/* when the manager is shared, replay the objects and metadata we
+	 * already know about to the new listener only */
+	spa_list_for_each(o, &m->this.object_list, this.link) {
+		if (o->this.creating || o->this.removing)
+			continue;
+		spa_callbacks_call(&listener->cb, struct pw_manager_events,
+				added, 0, &o->this);
+		spa_list_for_each(e, &o->metadata_list, link)
+			spa_callbacks_call(&listener->cb, struct pw_manager_events,
+					metadata, 0, &o->this, e->subject, e->key,
+					e->type, e->value);
+	}
 	core_sync(m);
 }
 
@@ -889,6 +966,9 @@ static void object_data_timeout(void *data, uint64_t count)
 	}
 
 	manager_emit_object_data_timeout(m, &o->this, d->key);
+
+	/* all listeners have seen the end of the lifetime */
+	object_data_free(d);
 }
 
 void *pw_manager_object_add_temporary_data(struct pw_manager_object *obj, const char *key,
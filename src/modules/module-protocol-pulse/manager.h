@@ -81,6 +81,8 @@ struct pw_manager_object {
 #define PW_MANAGER_OBJECT_FLAG_SOURCE	(1<<0)
 #define PW_MANAGER_OBJECT_FLAG_SINK	(1<<1)
 	uint64_t change_mask;	/* object specific params change mask */
+	uint32_t generation;	/* incremented before each added/updated event */
+	uint32_t info_generation; /* generation the derived info was collected for */
 	struct spa_list param_list;
 	unsigned int creating:1;
 	unsigned int removing:1;
@@ -830,6 +830,8 @@ struct message *message_alloc(struct impl *impl, uint32_t channel, uint32_t size
 	}
 
 	spa_zero(msg->extra);
+	msg->raw = false;
+	msg->creds = false;
 	msg->channel = channel;
 	msg->offset = 0;
 	msg->length = size;
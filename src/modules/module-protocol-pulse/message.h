@@ -22,6 +22,8 @@ struct message {
 	uint32_t length;
 	uint32_t offset;
 	uint8_t *data;
+	unsigned int raw:1;		/**< data contains complete frames */
+	unsigned int creds:1;		/**< send our credentials with the message */
 };
 
 enum {
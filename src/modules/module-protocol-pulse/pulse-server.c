@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include <sys/time.h>
 
 #include <pipewire/log.h>
@@ -52,6 +53,7 @@
 #include "reply.h"
 #include "sample.h"
 #include "server.h"
+#include "shm.h"
 #include "stream.h"
 #include "utils.h"
 #include "volume.h"
@@ -79,10 +81,17 @@ bool debug_messages = false;
 
 struct latency_offset_data {
 	int64_t prev_latency_offset;
+	uint32_t generation;
 	uint8_t initialized:1;
+	uint8_t changed:1;
 };
 
-struct temporary_move_data {
+struct temporary_move {
+	struct spa_list link;
+	struct client *client;
+	struct spa_hook client_listener;
+	struct spa_source *timer;
+	uint32_t id;
 	uint32_t peer_index;
 	uint8_t used:1;
 };
@@ -113,12 +122,35 @@ void broadcast_subscribe_event(struct impl *impl, uint32_t mask, uint32_t event,
 	}
 }
 
+/* clients that are not sandboxed or otherwise restricted */
+static bool client_is_unrestricted(struct client *client)
+{
+	const char *str = pw_properties_get(client->props, PW_KEY_CLIENT_ACCESS);
+	return str == NULL || spa_streq(str, "unrestricted");
+}
+
+/* shared memory is only used with unrestricted clients of the same user
+ * on the local socket, other users could see the data of the client */
+static bool client_can_use_shm(struct client *client)
+{
+	uid_t uid;
+
+	if (!client->impl->enable_shm ||
+	    client->server->addr.ss_family != AF_UNIX ||
+	    !client_is_unrestricted(client))
+		return false;
+	if (get_client_uid(client, client->source->fd, &uid) < 0)
+		return false;
+	return uid == getuid();
+}
+
 static int do_command_auth(struct client *client, uint32_t command, uint32_t tag, struct message *m)
 {
 	struct message *reply;
 	uint32_t version;
 	const void *cookie;
 	size_t len;
+	bool shm = false, memfd = false;
 
 	if (message_get(m,
 			TAG_U32, &version,
@@ -131,19 +163,32 @@ static int do_command_auth(struct client *client, uint32_t command, uint32_t tag
 	if (len != NATIVE_COOKIE_LENGTH)
 		return -EINVAL;
 
-	if ((version & PROTOCOL_VERSION_MASK) >= 13)
+	if ((version & PROTOCOL_VERSION_MASK) >= 13) {
+		shm = SPA_FLAG_IS_SET(version, PROTOCOL_FLAG_SHM);
+		if ((version & PROTOCOL_VERSION_MASK) >= 31)
+			memfd = SPA_FLAG_IS_SET(version, PROTOCOL_FLAG_MEMFD);
 		version &= PROTOCOL_VERSION_MASK;
+	}
 
 	client->version = version;
 	client->authenticated = true;
+	/* we only accept memfd pools, shm without memfd is refused */
+	client->use_memfd = shm && memfd && client_can_use_shm(client);
+	client->use_shm = client->use_memfd;
 
-	pw_log_info("client:%p AUTH tag:%u version:%d", client, tag, version);
+	pw_log_info("client:%p AUTH tag:%u version:%d shm:%d memfd:%d", client, tag,
+			version, client->use_shm, client->use_memfd);
 
 	reply = reply_new(client, tag);
 	message_put(reply,
-			TAG_U32, PROTOCOL_VERSION,
+			TAG_U32, PROTOCOL_VERSION |
+				(client->use_shm ? PROTOCOL_FLAG_SHM : 0) |
+				(client->use_memfd ? PROTOCOL_FLAG_MEMFD : 0),
 			TAG_INVALID);
 
+	/* the client only enables shm when it sees our credentials */
+	reply->creds = client->use_shm;
+
 	return client_queue_message(client, reply);
 }
 
@@ -178,6 +223,11 @@ static void manager_sync(void *data)
 	struct client *client = data;
 	struct operation *o;
 
+	/* the manager can be shared, ignore the syncs of other clients */
+	if (!client->sync_pending)
+		return;
+	client->sync_pending = false;
+
 	pw_log_debug("%p: manager sync", client);
 
 	if (client->connect_tag != SPA_ID_INVALID) {
@@ -250,73 +300,116 @@ static int send_object_event(struct client *client, struct pw_manager_object *o,
 	return 0;
 }
 
+static struct temporary_move *find_temporary_move(struct client *client, uint32_t id)
+{
+	struct temporary_move *m;
+
+	spa_list_for_each(m, &client->temporary_moves, link) {
+		if (m->id == id)
+			return m;
+	}
+	return NULL;
+}
+
+static void temporary_move_free(struct temporary_move *m)
+{
+	spa_list_remove(&m->link);
+	spa_hook_remove(&m->client_listener);
+	if (m->timer)
+		pw_loop_destroy_source(m->client->impl->loop, m->timer);
+	free(m);
+}
+
+static void temporary_move_timeout(void *data, uint64_t expirations)
+{
+	struct temporary_move *m = data;
+	struct client *client = m->client;
+	struct selector sel = { .id = m->id, .index = SPA_ID_INVALID, };
+	struct pw_manager_object *o, *peer;
+
+	/*
+	 * Send change event if the temporary target was used, and the peer
+	 * is not what we claimed.
+	 */
+	if (m->used && (o = select_object(client->manager, &sel)) != NULL) {
+		peer = find_linked(client->manager, o->id, pw_manager_object_is_sink_input(o) ?
+				PW_DIRECTION_OUTPUT : PW_DIRECTION_INPUT);
+		if (peer == NULL || peer->index != m->peer_index) {
+			pw_log_debug("[%s] temporary move timeout for index:%d, send change event",
+					client->name, o->index);
+			send_object_event(client, o, SUBSCRIPTION_EVENT_CHANGE);
+		}
+	}
+	temporary_move_free(m);
+}
+
+static void temporary_move_client_disconnect(void *data)
+{
+	temporary_move_free(data);
+}
+
+static const struct client_events temporary_move_client_events = {
+	VERSION_CLIENT_EVENTS,
+	.disconnect = temporary_move_client_disconnect,
+};
+
 static uint32_t get_temporary_move_target(struct client *client, struct pw_manager_object *o)
 {
-	struct temporary_move_data *d;
+	struct temporary_move *m;
 
-	d = pw_manager_object_get_data(o, "temporary_move_data");
-	if (d == NULL || d->peer_index == SPA_ID_INVALID)
+	if ((m = find_temporary_move(client, o->id)) == NULL)
 		return SPA_ID_INVALID;
 
 	pw_log_debug("[%s] using temporary move target for index:%d -> index:%d",
-			client->name, o->index, d->peer_index);
-	d->used = true;
-	return d->peer_index;
+			client->name, o->index, m->peer_index);
+	m->used = true;
+	return m->peer_index;
 }
 
+/* The move targets are kept per client, the manager and its objects can
+ * be shared with other clients that did not ask for the move. */
 static void set_temporary_move_target(struct client *client, struct pw_manager_object *o, uint32_t index)
 {
-	struct temporary_move_data *d;
+	struct impl *impl = client->impl;
+	struct temporary_move *m;
+	struct timespec timeout = { 0, }, interval = { 0, };
 
 	if (!pw_manager_object_is_sink_input(o) && !pw_manager_object_is_source_output(o))
 		return;
 
+	m = find_temporary_move(client, o->id);
+
 	if (index == SPA_ID_INVALID) {
-		d = pw_manager_object_get_data(o, "temporary_move_data");
-		if (d == NULL)
+		if (m == NULL)
 			return;
-		if (d->peer_index != SPA_ID_INVALID)
-			pw_log_debug("cleared temporary move target for index:%d", o->index);
-		d->peer_index = SPA_ID_INVALID;
-		d->used = false;
+		pw_log_debug("cleared temporary move target for index:%d", o->index);
+		temporary_move_free(m);
 		return;
 	}
 
-	d = pw_manager_object_add_temporary_data(o, "temporary_move_data",
-			sizeof(struct temporary_move_data),
-			TEMPORARY_MOVE_TIMEOUT);
-	if (d == NULL)
-		return;
+	if (m == NULL) {
+		if ((m = calloc(1, sizeof(*m))) == NULL)
+			return;
+		m->client = client;
+		m->id = o->id;
+		m->timer = pw_loop_add_timer(impl->loop, temporary_move_timeout, m);
+		if (m->timer == NULL) {
+			free(m);
+			return;
+		}
+		spa_list_append(&client->temporary_moves, &m->link);
+		client_add_listener(client, &m->client_listener,
+				&temporary_move_client_events, m);
+	}
 
 	pw_log_debug("[%s] set temporary move target for index:%d to index:%d",
 			client->name, o->index, index);
-	d->peer_index = index;
-	d->used = false;
-}
-
-static void temporary_move_target_timeout(struct client *client, struct pw_manager_object *o)
-{
-	struct temporary_move_data *d = pw_manager_object_get_data(o, "temporary_move_data");
-	struct pw_manager_object *peer;
-
-	/*
-	 * Send change event if the temporary data was used, and the peer
-	 * is not what we claimed.
-	 */
-
-	if (d == NULL || d->peer_index == SPA_ID_INVALID || !d->used)
-		goto done;
+	m->peer_index = index;
+	m->used = false;
 
-	peer = find_linked(client->manager, o->id, pw_manager_object_is_sink_input(o) ?
-			PW_DIRECTION_OUTPUT : PW_DIRECTION_INPUT);
-	if (peer == NULL || peer->index != d->peer_index) {
-		pw_log_debug("[%s] temporary move timeout for index:%d, send change event",
-				client->name, o->index);
-		send_object_event(client, o, SUBSCRIPTION_EVENT_CHANGE);
-	}
-
-done:
-	set_temporary_move_target(client, o, SPA_ID_INVALID);
+	timeout.tv_sec = TEMPORARY_MOVE_TIMEOUT / SPA_NSEC_PER_SEC;
+	timeout.tv_nsec = TEMPORARY_MOVE_TIMEOUT % SPA_NSEC_PER_SEC;
+	pw_loop_update_timer(impl->loop, m->timer, &timeout, &interval, false);
 }
 
 static struct pw_manager_object *find_device(struct client *client,
@@ -346,7 +439,6 @@ static void send_latency_offset_subscribe_event(struct client *client, struct pw
 	const char *str;
 	uint32_t card_id = SPA_ID_INVALID;
 	int64_t latency_offset = 0LL;
-	bool changed = false;
 
 	if (!pw_manager_object_is_sink(o) && !pw_manager_object_is_source_or_monitor(o))
 		return;
@@ -365,13 +457,16 @@ static void send_latency_offset_subscribe_event(struct client *client, struct pw
 	if (d == NULL)
 		return;
 
-	latency_offset = get_node_latency_offset(o);
-	changed = (!d->initialized || latency_offset != d->prev_latency_offset);
-
-	d->prev_latency_offset = latency_offset;
-	d->initialized = true;
+	/* only compare once for each update, the manager can be shared */
+	if (!d->initialized || d->generation != o->generation) {
+		latency_offset = get_node_latency_offset(o);
+		d->changed = (!d->initialized || latency_offset != d->prev_latency_offset);
+		d->prev_latency_offset = latency_offset;
+		d->generation = o->generation;
+		d->initialized = true;
+	}
 
-	if (changed)
+	if (d->changed)
 		client_queue_subscribe_event(client,
 				SUBSCRIPTION_MASK_CARD,
 				SUBSCRIPTION_EVENT_CARD | SUBSCRIPTION_EVENT_CHANGE,
@@ -573,13 +668,13 @@ static int reply_create_playback_stream(struct stream *stream, struct pw_manager
 	uint32_t missing, peer_index;
 	const char *peer_name;
 	uint64_t lat_usec;
-
-	stream->buffer = calloc(1, MAXLENGTH);
-	if (stream->buffer == NULL)
-		return -errno;
+	int res;
 
 	lat_usec = set_playback_buffer_attr(stream, &stream->attr);
 
+	if ((res = stream_update_buffer_size(stream)) < 0)
+		return res;
+
 	missing = stream_pop_missing(stream);
 	stream->index = id_to_index(manager, stream->id);
 	stream->lat_usec = lat_usec;
@@ -728,13 +823,13 @@ static int reply_create_record_stream(struct stream *stream, struct pw_manager_o
 	const char *peer_name, *name;
 	uint32_t peer_index;
 	uint64_t lat_usec;
-
-	stream->buffer = calloc(1, MAXLENGTH);
-	if (stream->buffer == NULL)
-		return -errno;
+	int res;
 
 	lat_usec = set_record_buffer_attr(stream, &stream->attr);
 
+	if ((res = stream_update_buffer_size(stream)) < 0)
+		return res;
+
 	stream->index = id_to_index(manager, stream->id);
 	stream->lat_usec = lat_usec;
 
@@ -813,16 +908,22 @@ static void manager_added(void *data, struct pw_manager_object *o)
 	struct impl *impl = client->impl;
 	const char *str;
 
-	register_object_message_handlers(o);
+	/* when the manager is shared, the first client collects the info */
+	if (o->info_generation != o->generation) {
+		o->info_generation = o->generation;
+
+		register_object_message_handlers(o);
 
-	if (strcmp(o->type, PW_TYPE_INTERFACE_Core) == 0 && manager->info != NULL) {
-		struct pw_core_info *info = manager->info;
-		if (info->props) {
-			if ((str = spa_dict_lookup(info->props, "default.clock.rate")) != NULL)
-				client->impl->defs.sample_spec.rate = atoi(str);
-			if ((str = spa_dict_lookup(info->props, "default.clock.quantum-limit")) != NULL)
-				client->impl->defs.quantum_limit = atoi(str);
+		if (strcmp(o->type, PW_TYPE_INTERFACE_Core) == 0 && manager->info != NULL) {
+			struct pw_core_info *info = manager->info;
+			if (info->props) {
+				if ((str = spa_dict_lookup(info->props, "default.clock.rate")) != NULL)
+					impl->defs.sample_spec.rate = atoi(str);
+				if ((str = spa_dict_lookup(info->props, "default.clock.quantum-limit")) != NULL)
+					impl->defs.quantum_limit = atoi(str);
+			}
 		}
+		update_object_info(manager, o, &impl->defs);
 	}
 
 	if (spa_streq(o->type, PW_TYPE_INTERFACE_Metadata)) {
@@ -873,12 +974,8 @@ static void manager_added(void *data, struct pw_manager_object *o)
 		}
 	}
 
-	update_object_info(manager, o, &impl->defs);
-
 	send_object_event(client, o, SUBSCRIPTION_EVENT_NEW);
 
-	o->change_mask = 0;
-
 	/* Adding sinks etc. may also change defaults */
 	send_default_change_subscribe_event(client, pw_manager_object_is_sink(o), pw_manager_object_is_source_or_monitor(o));
 }
@@ -889,12 +986,13 @@ static void manager_updated(void *data, struct pw_manager_object *o)
 	struct pw_manager *manager = client->manager;
 	struct impl *impl = client->impl;
 
-	update_object_info(manager, o, &impl->defs);
+	if (o->info_generation != o->generation) {
+		o->info_generation = o->generation;
+		update_object_info(manager, o, &impl->defs);
+	}
 
 	send_object_event(client, o, SUBSCRIPTION_EVENT_CHANGE);
 
-	o->change_mask = 0;
-
 	set_temporary_move_target(client, o, SPA_ID_INVALID);
 
 	send_latency_offset_subscribe_event(client, o);
@@ -904,8 +1002,12 @@ static void manager_updated(void *data, struct pw_manager_object *o)
 static void manager_removed(void *data, struct pw_manager_object *o)
 {
 	struct client *client = data;
+	struct temporary_move *m;
 	const char *str;
 
+	if ((m = find_temporary_move(client, o->id)) != NULL)
+		temporary_move_free(m);
+
 	send_object_event(client, o, SUBSCRIPTION_EVENT_REMOVE);
 
 	send_default_change_subscribe_event(client, pw_manager_object_is_sink(o), pw_manager_object_is_source_or_monitor(o));
@@ -917,14 +1019,6 @@ static void manager_removed(void *data, struct pw_manager_object *o)
 	}
 }
 
-static void manager_object_data_timeout(void *data, struct pw_manager_object *o, const char *key)
-{
-	struct client *client = data;
-
-	if (spa_streq(key, "temporary_move_data"))
-		temporary_move_target_timeout(client, o);
-}
-
 static int json_object_find(const char *obj, const char *key, char *value, size_t len)
 {
 	struct spa_json it[2];
@@ -1012,6 +1106,8 @@ static void manager_disconnect(void *data)
 {
 	struct client *client = data;
 	pw_log_debug("manager_disconnect()");
+	/* both the client core and the shared manager can report this */
+	pw_work_queue_cancel(client->impl->work_queue, client, SPA_ID_INVALID);
 	pw_work_queue_add(client->impl->work_queue, client, 0,
 				do_free_client, NULL);
 }
@@ -1024,9 +1120,87 @@ static const struct pw_manager_events manager_events = {
 	.removed = manager_removed,
 	.metadata = manager_metadata,
 	.disconnect = manager_disconnect,
-	.object_data_timeout = manager_object_data_timeout,
 };
 
+static void client_core_done(void *data, uint32_t id, int seq)
+{
+	struct client *client = data;
+
+	if (id != PW_ID_CORE || seq != client->core_seq || !client->shared_manager)
+		return;
+
+	/* the requests on the client core are processed, now wait until the
+	 * shared manager has seen the result */
+	client->sync_pending = true;
+	pw_manager_sync(client->manager);
+}
+
+static void client_core_error(void *data, uint32_t id, int seq, int res, const char *message)
+{
+	struct client *client = data;
+
+	/* a private manager listens on the client core and reports this itself */
+	if (id == PW_ID_CORE && res == -EPIPE && client->shared_manager)
+		manager_disconnect(client);
+}
+
+static const struct pw_core_events client_core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.done = client_core_done,
+	.error = client_core_error,
+};
+
+struct pw_manager *impl_acquire_manager(struct impl *impl)
+{
+	int res;
+
+	if (impl->manager == NULL) {
+		impl->manager_core = pw_context_connect(impl->context, NULL, 0);
+		if (impl->manager_core == NULL)
+			return NULL;
+
+		impl->manager = pw_manager_new(impl->manager_core);
+		if (impl->manager == NULL) {
+			res = -errno;
+			pw_core_disconnect(impl->manager_core);
+			impl->manager_core = NULL;
+			errno = -res;
+			return NULL;
+		}
+	}
+	impl->manager_users++;
+	pw_log_debug("%p: shared manager %p users:%u", impl, impl->manager,
+			impl->manager_users);
+	return impl->manager;
+}
+
+void impl_release_manager(struct impl *impl)
+{
+	spa_assert(impl->manager_users > 0);
+
+	if (--impl->manager_users > 0)
+		return;
+
+	pw_log_debug("%p: destroy shared manager %p", impl, impl->manager);
+	pw_manager_destroy(impl->manager);
+	impl->manager = NULL;
+	pw_core_disconnect(impl->manager_core);
+	impl->manager_core = NULL;
+}
+
+static bool client_use_shared_manager(struct client *client)
+{
+	const char *str;
+
+	if (!client->impl->share_manager)
+		return false;
+
+	/* the shared manager sees everything, only use it for the clients that
+	 * would get the same unrestricted view */
+	str = pw_properties_get(client->props, PW_KEY_CLIENT_ACCESS);
+	return str == NULL || spa_streq(str, "unrestricted");
+}
+
 static int do_set_client_name(struct client *client, uint32_t command, uint32_t tag, struct message *m)
 {
 	struct impl *impl = client->impl;
@@ -1062,7 +1236,15 @@ static int do_set_client_name(struct client *client, uint32_t command, uint32_t
 			res = -errno;
 			goto error;
 		}
-		client->manager = pw_manager_new(client->core);
+		pw_core_add_listener(client->core, &client->core_listener,
+				&client_core_events, client);
+
+		if (client_use_shared_manager(client)) {
+			client->manager = impl_acquire_manager(impl);
+			client->shared_manager = client->manager != NULL;
+		} else {
+			client->manager = pw_manager_new(client->core);
+		}
 		if (client->manager == NULL) {
 			res = -errno;
 			goto error;
@@ -1070,6 +1252,7 @@ static int do_set_client_name(struct client *client, uint32_t command, uint32_t
 		client->connect_tag = tag;
 		pw_manager_add_listener(client->manager, &client->manager_listener,
 				&manager_events, client);
+		client_sync(client);
 	} else {
 		if (changed)
 			pw_core_update_properties(client->core, &client->props->dict);
@@ -1334,6 +1517,15 @@ do_process_done(struct spa_loop *loop,
 
 		avail = spa_ringbuffer_get_read_index(&stream->ring, &index);
 
+		if (avail > 0 && (uint32_t)avail > stream->buffer_size / 2 &&
+		    (uint32_t)avail <= stream->buffer_size &&
+		    stream->buffer_size < stream->attr.maxlength) {
+			/* the client is not reading fast enough, make room
+			 * before the ring overruns */
+			stream_ensure_buffer_size(stream,
+					SPA_MIN((uint32_t)avail * 2, stream->attr.maxlength));
+		}
+
 		if (!spa_list_is_empty(&client->out_messages)) {
 			pw_log_debug("%p: [%s] pending read:%u avail:%d",
 					stream, client->name, index, avail);
@@ -1346,7 +1538,7 @@ do_process_done(struct spa_loop *loop,
 			pw_log_warn("%p: [%s] underrun read:%u avail:%d",
 					stream, client->name, index, avail);
 		} else {
-			if ((uint32_t)avail > stream->attr.maxlength) {
+			if ((uint32_t)avail > SPA_MIN(stream->attr.maxlength, stream->buffer_size)) {
 				uint32_t skip = avail - stream->attr.fragsize;
 				/* overrun, catch up to latest fragment and send it */
 				pw_log_warn("%p: [%s] overrun recover read:%u avail:%d max:%u skip:%u",
@@ -1367,8 +1559,8 @@ do_process_done(struct spa_loop *loop,
 					return -errno;
 
 				spa_ringbuffer_read_data(&stream->ring,
-						stream->buffer, MAXLENGTH,
-						index % MAXLENGTH,
+						stream->buffer, stream->buffer_size,
+						index % stream->buffer_size,
 						msg->data, towrite);
 
 				client_queue_message(client, msg);
@@ -1451,8 +1643,8 @@ static void stream_process(void *data)
 				if (avail > 0) {
 					avail = SPA_MIN((uint32_t)avail, size);
 					spa_ringbuffer_read_data(&stream->ring,
-						stream->buffer, MAXLENGTH,
-						index % MAXLENGTH,
+						stream->buffer, stream->buffer_size,
+						index % stream->buffer_size,
 						p, avail);
 				}
 				index += size;
@@ -1480,8 +1672,8 @@ static void stream_process(void *data)
 			size = SPA_MIN(size, minreq);
 
 			spa_ringbuffer_read_data(&stream->ring,
-					stream->buffer, MAXLENGTH,
-					index % MAXLENGTH,
+					stream->buffer, stream->buffer_size,
+					index % stream->buffer_size,
 					p, size);
 
 			index += size;
@@ -1516,10 +1708,10 @@ static void stream_process(void *data)
 		}
 
 		spa_ringbuffer_write_data(&stream->ring,
-				stream->buffer, MAXLENGTH,
-				index % MAXLENGTH,
+				stream->buffer, stream->buffer_size,
+				index % stream->buffer_size,
 				SPA_PTROFF(p, offs, void),
-				SPA_MIN(size, MAXLENGTH));
+				SPA_MIN(size, stream->buffer_size));
 
 		index += size;
 		pd.write_inc = size;
@@ -2301,8 +2493,7 @@ static int do_create_upload_stream(struct client *client, uint32_t command, uint
 
 	stream->props = props;
 
-	stream->buffer = calloc(1, MAXLENGTH);
-	if (stream->buffer == NULL)
+	if (stream_update_buffer_size(stream) < 0)
 		goto error_errno;
 
 	reply = reply_new(client, tag);
@@ -4536,6 +4727,9 @@ static int do_set_stream_buffer_attr(struct client *client, uint32_t command, ui
 				TAG_INVALID);
 		}
 	}
+	/* on failure we keep the old buffer */
+	stream_update_buffer_size(stream);
+
 	return client_queue_message(client, reply);
 }
 
@@ -5150,6 +5344,35 @@ static int do_error_access(struct client *client, uint32_t command, uint32_t tag
 	return -EACCES;
 }
 
+static int do_register_memfd_shmid(struct client *client, uint32_t command, uint32_t tag, struct message *m)
+{
+	uint32_t shm_id;
+	int fd, res;
+
+	if (message_get(m,
+			TAG_U32, &shm_id,
+			TAG_INVALID) < 0)
+		return -EPROTO;
+
+	if (!client->use_memfd)
+		return -EPROTO;
+
+	/* the memfd of the pool is sent along with the packet */
+	if ((fd = client->recv_fd) < 0)
+		return -EPROTO;
+	client->recv_fd = -1;
+
+	pw_log_info("[%s] REGISTER_MEMFD_SHMID tag:%u shm_id:%u fd:%d",
+			client->name, tag, shm_id, fd);
+
+	if ((res = shm_attach_memfd(client, shm_id, fd)) < 0) {
+		pw_log_warn("[%s] can't attach memfd pool %u: %s",
+				client->name, shm_id, spa_strerror(res));
+		return res;
+	}
+	return 0;
+}
+
 static SPA_UNUSED int do_error_not_implemented(struct client *client, uint32_t command, uint32_t tag, struct message *m)
 {
 	return -ENOSYS;
@@ -5313,7 +5536,7 @@ const struct command commands[COMMAND_MAX] =
 
 	/* Supported since protocol v31 (9.0)
 	 * BOTH DIRECTIONS */
-	COMMAND(REGISTER_MEMFD_SHMID, do_error_access),
+	COMMAND(REGISTER_MEMFD_SHMID, do_register_memfd_shmid, COMMAND_ACCESS_WITHOUT_MANAGER),
 
 	/* Supported since protocol v35 (15.0) */
 	COMMAND(SEND_OBJECT_MESSAGE, do_send_object_message),
@@ -5542,6 +5765,8 @@ struct pw_protocol_pulse *pw_protocol_pulse_new(struct pw_context *context,
 #endif
 
 	load_defaults(&impl->defs, props);
+	impl->enable_shm = pw_properties_get_bool(props, "pulse.shm", true);
+	impl->share_manager = pw_properties_get_bool(props, "pulse.registry.shared", true);
 	impl->props = spa_steal_ptr(props);
 
 	pw_context_add_listener(context, &impl->context_listener,
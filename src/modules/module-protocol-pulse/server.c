@@ -39,6 +39,7 @@
 #include "message.h"
 #include "reply.h"
 #include "server.h"
+#include "shm.h"
 #include "stream.h"
 #include "utils.h"
 #include "flatpak-utils.h"
@@ -91,6 +92,11 @@ static int handle_packet(struct client *client, struct message *msg)
 	res = cmd->run(client, command, tag, msg);
 
 finish:
+	/* close the fd when the command did not take it */
+	if (client->recv_fd >= 0) {
+		close(client->recv_fd);
+		client->recv_fd = -1;
+	}
 	message_free(msg, false, false);
 	if (res < 0)
 		reply_error(client, command, tag, res);
@@ -101,9 +107,10 @@ finish:
 static int handle_memblock(struct client *client, struct message *msg)
 {
 	struct stream *stream;
-	uint32_t channel, flags, index;
+	uint32_t channel, flags, index, length, block_id = SPA_ID_INVALID;
 	int64_t offset, diff;
 	int32_t filled;
+	const void *data;
 	int res = 0;
 
 	channel = ntohl(client->desc.channel);
@@ -112,8 +119,28 @@ static int handle_memblock(struct client *client, struct message *msg)
 		(((uint64_t) ntohl(client->desc.offset_lo))));
 	flags = ntohl(client->desc.flags);
 
+	if (flags & FLAG_SHMDATA) {
+		uint32_t info[4];
+
+		memcpy(info, msg->data, sizeof(info));
+		block_id = ntohl(info[0]);
+		length = ntohl(info[3]);
+
+		res = shm_get_data(client, ntohl(info[1]), ntohl(info[2]), length, &data);
+		if (res < 0) {
+			pw_log_warn("client %p [%s]: can't import block %u from pool %u: %s",
+				    client, client->name, block_id, ntohl(info[1]),
+				    spa_strerror(res));
+			res = -EPROTO;
+			goto finish;
+		}
+	} else {
+		data = msg->data;
+		length = msg->length;
+	}
+
 	pw_log_debug("client %p: received memblock channel:%d offset:%" PRIi64 " flags:%08x size:%u",
-		     client, channel, offset, flags, msg->length);
+		     client, channel, offset, flags, length);
 
 	stream = pw_map_lookup(&client->streams, channel);
 	if (stream == NULL || stream->type == STREAM_TYPE_RECORD) {
@@ -124,7 +151,7 @@ static int handle_memblock(struct client *client, struct message *msg)
 
 	filled = spa_ringbuffer_get_write_index(&stream->ring, &index);
 	pw_log_debug("new block %p %p/%u filled:%d index:%d flags:%02x offset:%" PRIu64,
-		     msg, msg->data, msg->length, filled, index, flags, offset);
+		     msg, data, length, filled, index, flags, offset);
 
 	switch (flags & FLAG_SEEKMASK) {
 	case SEEK_RELATIVE:
@@ -152,23 +179,26 @@ static int handle_memblock(struct client *client, struct message *msg)
 
 	if (filled < 0) {
 		/* underrun, reported on reader side */
-	} else if (filled + msg->length > stream->attr.maxlength) {
+	} else if (filled + length > stream->attr.maxlength) {
 		/* overrun */
 		stream_send_overflow(stream);
 	}
 
+	if (filled >= 0)
+		stream_ensure_buffer_size(stream, filled + length);
+
 	/* always write data to ringbuffer, we expect the other side
 	 * to recover */
 	spa_ringbuffer_write_data(&stream->ring,
-			stream->buffer, MAXLENGTH,
-			index % MAXLENGTH,
-			msg->data,
-			SPA_MIN(msg->length, MAXLENGTH));
-	index += msg->length;
+			stream->buffer, stream->buffer_size,
+			index % stream->buffer_size,
+			data,
+			SPA_MIN(length, stream->buffer_size));
+	index += length;
 	spa_ringbuffer_write_update(&stream->ring, index);
 
-	stream->write_index += msg->length;
-	stream->requested -= msg->length;
+	stream->write_index += length;
+	stream->requested -= length;
 
 	stream_send_request(stream);
 
@@ -176,10 +206,49 @@ static int handle_memblock(struct client *client, struct message *msg)
 		stream_set_paused(stream, false, "new data");
 
 finish:
+	/* the data was copied, the client can reuse the block */
+	if (block_id != SPA_ID_INVALID)
+		client_queue_release(client, block_id);
 	message_free(msg, false, false);
 	return res;
 }
 
+static ssize_t client_recv(struct client *client, void *data, size_t size)
+{
+	struct iovec iov = { data, size };
+	char buf[CMSG_SPACE(sizeof(int) * 4)];
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = buf,
+		.msg_controllen = sizeof(buf),
+	};
+	struct cmsghdr *cmsg;
+	ssize_t r;
+
+	r = recvmsg(client->source->fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+	if (r < 0)
+		return r;
+
+	/* fds are sent along with the REGISTER_MEMFD_SHMID packet */
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		int *fds, i, n_fds;
+
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+
+		fds = (int *) CMSG_DATA(cmsg);
+		n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (i = 0; i < n_fds; i++) {
+			if (client->recv_fd < 0)
+				client->recv_fd = fds[i];
+			else
+				close(fds[i]);
+		}
+	}
+	return r;
+}
+
 static int do_read(struct client *client)
 {
 	struct impl * const impl = client->impl;
@@ -203,7 +272,7 @@ static int do_read(struct client *client)
 	}
 
 	while (true) {
-		ssize_t r = recv(client->source->fd, data, size, MSG_DONTWAIT);
+		ssize_t r = client_recv(client, data, size);
 
 		if (r == 0 && size != 0) {
 			res = -EPIPE;
@@ -226,20 +295,42 @@ static int do_read(struct client *client)
 		uint32_t flags, length, channel;
 
 		flags = ntohl(client->desc.flags);
-		if ((flags & FLAG_SHMMASK) != 0) {
+		length = ntohl(client->desc.length);
+		channel = ntohl(client->desc.channel);
+
+		switch (flags & FLAG_SHMMASK) {
+		case 0:
+			break;
+		case FLAG_SHMRELEASE:
+		case FLAG_SHMREVOKE:
+			/* we don't export memory to clients, nothing to do */
+			if (length != 0) {
+				res = -EPROTO;
+				goto exit;
+			}
+			client->in_index = 0;
+			goto exit;
+		case FLAG_SHMDATA | FLAG_SHMDATA_MEMFD_BLOCK:
+			/* only blocks in a registered memfd pool are accepted */
+			if (!client->use_memfd || channel == (uint32_t) -1 ||
+			    length != SHM_INFO_SIZE) {
+				pw_log_warn("client %p: received invalid shm frame",
+					    client);
+				res = -EPROTO;
+				goto exit;
+			}
+			break;
+		default:
 			res = -EPROTO;
 			goto exit;
 		}
 
-		length = ntohl(client->desc.length);
 		if (length > FRAME_SIZE_MAX_ALLOW || length <= 0) {
 			pw_log_warn("client %p: received invalid frame size: %u",
 				    client, length);
 			res = -EPROTO;
 			goto exit;
 		}
-
-		channel = ntohl(client->desc.channel);
 		if (channel == (uint32_t) -1) {
 			if (flags != 0) {
 				pw_log_warn("client %p: received packet frame with invalid flags",
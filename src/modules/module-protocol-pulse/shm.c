@@ -0,0 +1,122 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <spa/utils/defs.h>
+#include <pipewire/array.h>
+#include <pipewire/log.h>
+
+#include "client.h"
+#include "log.h"
+#include "shm.h"
+
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS (F_LINUX_SPECIFIC_BASE + 9)
+#define F_GET_SEALS (F_LINUX_SPECIFIC_BASE + 10)
+#define F_SEAL_SHRINK   0x0002	/* prevent file from shrinking */
+#endif
+
+/* Memory pools of a client. The client sends the memblocks of
+ * playback streams as a reference into one of these pools when
+ * shared memory was negotiated. Only memfd pools registered with
+ * REGISTER_MEMFD_SHMID are used, POSIX shm segments can be created
+ * and truncated by anyone. */
+struct shm_pool {
+	uint32_t id;
+	void *data;
+	size_t size;
+};
+
+static struct shm_pool *find_pool(struct client *client, uint32_t id)
+{
+	struct shm_pool *p;
+
+	pw_array_for_each(p, &client->shm_pools) {
+		if (p->id == id)
+			return p;
+	}
+	return NULL;
+}
+
+static int add_pool(struct client *client, uint32_t id, int fd)
+{
+	struct shm_pool *p;
+	struct stat st;
+	void *data;
+	int seals;
+
+	if (pw_array_get_len(&client->shm_pools, struct shm_pool) >= MAX_SHM_POOLS)
+		return -ENOSPC;
+
+	/* the client must not be able to shrink the pool while we read
+	 * from the mapping, we would get a SIGBUS. libpulse creates its
+	 * pools with MFD_ALLOW_SEALING but does not seal them, do it here. */
+	if ((seals = fcntl(fd, F_GET_SEALS)) < 0)
+		return -errno;
+	if (!SPA_FLAG_IS_SET(seals, F_SEAL_SHRINK) &&
+	    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK) < 0)
+		return -errno;
+
+	if (fstat(fd, &st) < 0)
+		return -errno;
+	if (st.st_size <= 0)
+		return -EINVAL;
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+		return -errno;
+
+	p = pw_array_add(&client->shm_pools, sizeof(*p));
+	if (p == NULL) {
+		munmap(data, st.st_size);
+		return -errno;
+	}
+	p->id = id;
+	p->data = data;
+	p->size = st.st_size;
+
+	pw_log_info("client %p [%s]: attached memfd pool %u size:%zu", client,
+			client->name, id, p->size);
+	return 0;
+}
+
+int shm_attach_memfd(struct client *client, uint32_t shm_id, int fd)
+{
+	int res;
+
+	if (find_pool(client, shm_id) != NULL)
+		res = -EEXIST;
+	else
+		res = add_pool(client, shm_id, fd);
+	close(fd);
+	return res;
+}
+
+int shm_get_data(struct client *client, uint32_t shm_id,
+		uint32_t offset, uint32_t length, const void **data)
+{
+	struct shm_pool *p;
+
+	if ((p = find_pool(client, shm_id)) == NULL)
+		return -ENOENT;
+	if (offset > p->size || length > p->size - offset)
+		return -EINVAL;
+
+	*data = SPA_PTROFF(p->data, offset, void);
+	return 0;
+}
+
+void shm_clear(struct client *client)
+{
+	struct shm_pool *p;
+
+	pw_array_for_each(p, &client->shm_pools)
+		munmap(p->data, p->size);
+	pw_array_clear(&client->shm_pools);
+}
@@ -0,0 +1,23 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef PULSE_SERVER_SHM_H
+#define PULSE_SERVER_SHM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct client;
+
+/* block_id, shm_id, offset, length */
+#define SHM_INFO_SIZE	(4 * sizeof(uint32_t))
+/* like PA_MEMIMPORT_SEGMENTS_MAX */
+#define MAX_SHM_POOLS	16
+
+int shm_attach_memfd(struct client *client, uint32_t shm_id, int fd);
+int shm_get_data(struct client *client, uint32_t shm_id,
+		uint32_t offset, uint32_t length, const void **data);
+void shm_clear(struct client *client);
+
+#endif /* PULSE_SERVER_SHM_H */
@@ -2,6 +2,7 @@
 /* SPDX-FileCopyrightText: Copyright © 2020 Wim Taymans */
 /* SPDX-License-Identifier: MIT */
 
+#include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -347,6 +348,8 @@ int stream_update_minreq(struct stream *stream, uint32_t minreq)
 	if (stream->attr.tlength > stream->attr.maxlength)
 		stream->attr.maxlength = stream->attr.tlength;
 
+	stream_update_buffer_size(stream);
+
 	if (client->version >= 15) {
 		struct message *msg;
 
@@ -368,6 +371,125 @@ int stream_update_minreq(struct stream *stream, uint32_t minreq)
 	return 0;
 }
 
+struct buffer_swap {
+	struct stream *stream;
+	void *buffer;
+	uint32_t size;
+};
+
+static int do_swap_buffer(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct buffer_swap *d = user_data;
+	struct stream *stream = d->stream;
+	uint32_t index, len, offs, l0;
+	int32_t avail;
+
+	avail = spa_ringbuffer_get_read_index(&stream->ring, &index);
+	if (stream->buffer != NULL && avail > 0) {
+		/* copy the most recent data to the same indexes in the new
+		 * buffer, the ring indexes don't change */
+		len = SPA_MIN((uint32_t)avail, SPA_MIN(stream->buffer_size, d->size));
+		index += avail - len;
+		offs = index % stream->buffer_size;
+		l0 = SPA_MIN(len, stream->buffer_size - offs);
+
+		spa_ringbuffer_write_data(&stream->ring, d->buffer, d->size,
+				index % d->size,
+				SPA_PTROFF(stream->buffer, offs, void), l0);
+		spa_ringbuffer_write_data(&stream->ring, d->buffer, d->size,
+				(index + l0) % d->size,
+				stream->buffer, len - l0);
+	}
+	SPA_SWAP(stream->buffer, d->buffer);
+	SPA_SWAP(stream->buffer_size, d->size);
+	return 0;
+}
+
+static int resize_buffer(struct stream *stream, uint32_t size)
+{
+	struct buffer_swap d;
+	struct pw_loop *loop;
+
+	if (size == stream->buffer_size)
+		return 0;
+
+	d.stream = stream;
+	d.size = size;
+	d.buffer = calloc(1, size);
+	if (d.buffer == NULL)
+		return -errno;
+
+	pw_log_debug("stream %p: [%s] buffer size %u -> %u", stream,
+			stream->client->name, stream->buffer_size, size);
+
+	/* the process function uses the buffer from the data loop */
+	if (stream->stream != NULL &&
+	    (loop = pw_stream_get_data_loop(stream->stream)) != NULL)
+		pw_loop_invoke(loop, do_swap_buffer, 1, NULL, 0, true, &d);
+	else
+		do_swap_buffer(NULL, false, 1, NULL, 0, &d);
+
+	free(d.buffer);
+	return 0;
+}
+
+/* the ring indexes wrap around at 2^32 so the size must be a power of 2 */
+static uint32_t buffer_size_for(uint32_t size)
+{
+	uint32_t res = MIN_BUFFER_SIZE;
+	while (res < size && res < MAXLENGTH)
+		res <<= 1;
+	return res;
+}
+
+int stream_update_buffer_size(struct stream *stream)
+{
+	struct impl *impl = stream->impl;
+	uint32_t index, size;
+	int32_t avail;
+
+	switch (stream->type) {
+	case STREAM_TYPE_PLAYBACK:
+		/* room for the target length and the data in flight, more
+		 * is allocated when the client writes ahead */
+		size = stream->attr.tlength * 2;
+		break;
+	case STREAM_TYPE_RECORD:
+		/* room for a few fragments and the largest quantum, more is
+		 * allocated when the client does not keep up */
+		size = SPA_MAX(stream->attr.fragsize * 4,
+				impl->defs.quantum_limit * sample_spec_frame_size(&stream->ss) * 2);
+		break;
+	case STREAM_TYPE_UPLOAD:
+		/* not a ring, the complete sample is kept */
+		if (stream->buffer != NULL)
+			return 0;
+		if ((stream->buffer = calloc(1, stream->attr.maxlength)) == NULL)
+			return -errno;
+		stream->buffer_size = stream->attr.maxlength;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+
+	avail = spa_ringbuffer_get_read_index(&stream->ring, &index);
+	if (avail > 0)
+		size = SPA_MAX(size, (uint32_t)avail);
+
+	return resize_buffer(stream, buffer_size_for(size));
+}
+
+int stream_ensure_buffer_size(struct stream *stream, uint32_t size)
+{
+	if (stream->type == STREAM_TYPE_UPLOAD ||
+	    size <= stream->buffer_size)
+		return 0;
+
+	return resize_buffer(stream,
+			buffer_size_for(SPA_MAX(size, stream->buffer_size * 2)));
+}
+
 int stream_send_moved(struct stream *stream, uint32_t peer_index, const char *peer_name)
 {
 	struct client *client = stream->client;
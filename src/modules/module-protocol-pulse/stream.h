@@ -54,6 +54,7 @@ struct stream {
 	struct spa_io_position *position;
 	struct spa_ringbuffer ring;
 	void *buffer;
+	uint32_t buffer_size;	/* power of 2, except for uploads */
 
 	int64_t read_index;
 	int64_t write_index;
@@ -115,6 +116,8 @@ int stream_send_killed(struct stream *stream);
 int stream_send_started(struct stream *stream);
 int stream_send_request(struct stream *stream);
 int stream_update_minreq(struct stream *stream, uint32_t minreq);
+int stream_update_buffer_size(struct stream *stream);
+int stream_ensure_buffer_size(struct stream *stream, uint32_t size);
 int stream_send_moved(struct stream *stream, uint32_t peer_index, const char *peer_name);
 int stream_update_tag_param(struct stream *stream);
 
@@ -0,0 +1,114 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+
+#include <spa/utils/defs.h>
+
+#include <pipewire/pipewire.h>
+
+#include "client.h"
+#include "shm.h"
+
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS (F_LINUX_SPECIFIC_BASE + 9)
+#define F_GET_SEALS (F_LINUX_SPECIFIC_BASE + 10)
+#define F_SEAL_SHRINK   0x0002	/* prevent file from shrinking */
+#endif
+
+#define NAME "protocol-pulse"
+PW_LOG_TOPIC(mod_topic, "mod." NAME);
+
+#define POOL_SIZE	4096
+
+/* a pool like libpulse makes it: sealable but not sealed */
+static int make_pool(unsigned int flags)
+{
+	uint8_t data[POOL_SIZE];
+	uint32_t i;
+	int fd;
+
+	fd = memfd_create("pulseaudio", MFD_CLOEXEC | flags);
+	spa_assert_se(fd >= 0);
+	for (i = 0; i < POOL_SIZE; i++)
+		data[i] = i & 0xff;
+	spa_assert_se(write(fd, data, sizeof(data)) == sizeof(data));
+	return fd;
+}
+
+static void test_unsealed_pool(struct client *client)
+{
+	const uint8_t *data;
+	uint32_t info[4], i;
+	int fd, res;
+
+	fd = make_pool(MFD_ALLOW_SEALING);
+	spa_assert_se(fcntl(fd, F_GET_SEALS) == 0);
+
+	/* shm_attach_memfd() takes the fd, keep our own to check the seals */
+	res = shm_attach_memfd(client, 1, dup(fd));
+	spa_assert_se(res == 0);
+	spa_assert_se(fcntl(fd, F_GET_SEALS) & F_SEAL_SHRINK);
+	spa_assert_se(ftruncate(fd, POOL_SIZE / 2) < 0);
+
+	/* read a memblock frame: block_id, shm_id, offset, length */
+	info[0] = htonl(7);
+	info[1] = htonl(1);
+	info[2] = htonl(1024);
+	info[3] = htonl(256);
+	res = shm_get_data(client, ntohl(info[1]), ntohl(info[2]),
+			ntohl(info[3]), (const void **) &data);
+	spa_assert_se(res == 0);
+	for (i = 0; i < 256; i++)
+		spa_assert_se(data[i] == ((1024 + i) & 0xff));
+
+	/* outside of the pool or an unknown pool */
+	res = shm_get_data(client, 1, POOL_SIZE - 16, 32, (const void **) &data);
+	spa_assert_se(res == -EINVAL);
+	res = shm_get_data(client, 2, 0, 16, (const void **) &data);
+	spa_assert_se(res == -ENOENT);
+
+	/* the id can only be registered once */
+	res = shm_attach_memfd(client, 1, dup(fd));
+	spa_assert_se(res == -EEXIST);
+
+	close(fd);
+}
+
+static void test_unsealable_pool(struct client *client)
+{
+	const void *data;
+	int fd, res;
+
+	/* without MFD_ALLOW_SEALING we can't protect the mapping */
+	fd = make_pool(0);
+	res = shm_attach_memfd(client, 3, fd);
+	spa_assert_se(res == -EPERM);
+	res = shm_get_data(client, 3, 0, 16, &data);
+	spa_assert_se(res == -ENOENT);
+}
+
+int main(int argc, char *argv[])
+{
+	struct client client;
+
+	pw_init(&argc, &argv);
+
+	spa_zero(client);
+	client.name = "test";
+	pw_array_init(&client.shm_pools, 256);
+
+	test_unsealed_pool(&client);
+	test_unsealable_pool(&client);
+
+	shm_clear(&client);
+	pw_deinit();
+
+	return 0;
+}
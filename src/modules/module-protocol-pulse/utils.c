@@ -146,6 +146,28 @@ pid_t get_client_pid(struct client *client, int client_fd)
 	return 0;
 }
 
+int get_client_uid(struct client *client, int client_fd, uid_t *uid)
+{
+	socklen_t len;
+#if defined(__linux__)
+	struct ucred ucred;
+	len = sizeof(ucred);
+	if (getsockopt(client_fd, SOL_SOCKET, SO_PEERCRED, &ucred, &len) < 0)
+		return -errno;
+	*uid = ucred.uid;
+	return 0;
+#elif defined(__FreeBSD__) || defined(__MidnightBSD__)
+	struct xucred xucred;
+	len = sizeof(xucred);
+	if (getsockopt(client_fd, 0, LOCAL_PEERCRED, &xucred, &len) < 0)
+		return -errno;
+	*uid = xucred.cr_uid;
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
 const char *get_server_name(struct pw_context *context)
 {
 	const char *name = NULL;
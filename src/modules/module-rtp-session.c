@@ -1689,6 +1689,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	struct pw_context *context = pw_impl_module_get_context(module);
 	struct impl *impl;
 	struct pw_properties *props = NULL, *stream_props = NULL;
+	struct pw_data_loop *data_loop;
 	uint16_t port;
 	const char *str;
 	struct timespec value, interval;
@@ -1725,7 +1726,6 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	impl->module = module;
 	impl->context = context;
 	impl->loop = pw_context_get_main_loop(context);
-	impl->data_loop = pw_data_loop_get_loop(pw_context_get_data_loop(context));
 
 	if (pw_properties_get(props, "sess.media") == NULL)
 		pw_properties_set(props, "sess.media", "midi");
@@ -1751,6 +1751,17 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	copy_props(impl, props, "sess.max-ptime");
 	copy_props(impl, props, "sess.latency.msec");
 	copy_props(impl, props, "sess.ts-refclk");
+	copy_props(impl, props, PW_KEY_NODE_LOOP_NAME);
+
+	/* the data socket is shared by the streams of all sessions, they are
+	 * all placed on its data loop with the loop name in the stream properties */
+	if ((data_loop = pw_context_place_data_loop(context, stream_props)) == NULL) {
+		res = -ENOENT;
+		pw_log_error("can't find data loop %s",
+				pw_properties_get(stream_props, PW_KEY_NODE_LOOP_NAME));
+		goto out;
+	}
+	impl->data_loop = pw_data_loop_get_loop(data_loop);
 
 	impl->ttl = pw_properties_get_uint32(props, "net.ttl", DEFAULT_TTL);
 	impl->mcast_loop = pw_properties_get_bool(props, "net.loop", DEFAULT_LOOP);
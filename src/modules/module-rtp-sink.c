@@ -12,6 +12,7 @@
 #include <arpa/inet.h>
 #include <netinet/ip.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <net/if.h>
 #include <ctype.h>
 
@@ -52,6 +53,8 @@
  * - `net.mtu = <int>`: MTU to use, default 1280
  * - `net.ttl = <int>`: TTL to use, default 1
  * - `net.loop = <bool>`: loopback multicast, default false
+ * - `net.gso = <bool>`: send the packets of a cycle with UDP segmentation offload,
+ *                       default false
  * - `sess.min-ptime = <int>`: minimum packet time in milliseconds, default 2
  * - `sess.max-ptime = <int>`: maximum packet time in milliseconds, default 20
  * - `sess.name = <str>`: a session name
@@ -89,6 +92,7 @@
  *         #net.mtu = 1280
  *         #net.ttl = 1
  *         #net.loop = false
+ *         #net.gso = false
  *         #sess.min-ptime = 2
  *         #sess.max-ptime = 20
  *         #sess.name = "PipeWire RTP stream"
@@ -119,6 +123,11 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
 #define DEFAULT_TTL		1
 #define DEFAULT_LOOP		false
 #define DEFAULT_DSCP		34 /* Default to AES-67 AF41 (34) */
+#define DEFAULT_GSO		false
+
+#define MAX_MMSG		64u
+#define MAX_GSO_SEGMENTS	64u
+#define MAX_GSO_SIZE		65000
 
 #define DEFAULT_TS_OFFSET	-1
 
@@ -130,6 +139,7 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
 		"( net.ttl=<desired TTL, default:"SPA_STRINGIFY(DEFAULT_TTL)"> ) "			\
 		"( net.loop=<desired loopback, default:"SPA_STRINGIFY(DEFAULT_LOOP)"> ) "		\
 		"( net.dscp=<desired DSCP, default:"SPA_STRINGIFY(DEFAULT_DSCP)"> ) "			\
+		"( net.gso=<use UDP segmentation offload, default:"SPA_STRINGIFY(DEFAULT_GSO)"> ) "	\
 		"( sess.name=<a name for the session> ) "						\
 		"( sess.min-ptime=<minimum packet time in milliseconds, default:2> ) "			\
 		"( sess.max-ptime=<maximum packet time in milliseconds, default:20> ) "			\
@@ -170,6 +180,7 @@ struct impl {
 	uint32_t ttl;
 	bool mcast_loop;
 	uint32_t dscp;
+	bool gso;
 
 	struct sockaddr_storage src_addr;
 	socklen_t src_len;
@@ -205,6 +216,91 @@ static void stream_send_packet(void *data, struct iovec *iov, size_t iovlen)
 		pw_log_debug("sendmsg() failed: %m");
 }
 
+#ifdef UDP_SEGMENT
+/* send equally sized packets as one large datagram that the kernel or
+ * the network card splits up */
+static int send_packets_gso(struct impl *impl, struct iovec *iov, size_t iovlen,
+		uint32_t n_packets)
+{
+	struct msghdr msg;
+	union {
+		char buf[CMSG_SPACE(sizeof(uint16_t))];
+		struct cmsghdr align;
+	} ctrl;
+	struct cmsghdr *cmsg;
+	size_t i, j, size, seg_size = 0, total = 0;
+
+	if (n_packets < 2 || n_packets > MAX_GSO_SEGMENTS)
+		return -EAGAIN;
+
+	/* only the last packet can be smaller */
+	for (i = 0; i < n_packets; i++) {
+		for (j = 0, size = 0; j < iovlen; j++)
+			size += iov[i * iovlen + j].iov_len;
+		if (i == 0)
+			seg_size = size;
+		else if (size > seg_size || (size < seg_size && i < n_packets - 1))
+			return -EAGAIN;
+		total += size;
+	}
+	if (total > MAX_GSO_SIZE)
+		return -EAGAIN;
+
+	spa_zero(msg);
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iovlen * n_packets;
+	msg.msg_control = ctrl.buf;
+	msg.msg_controllen = sizeof(ctrl.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = IPPROTO_UDP;
+	cmsg->cmsg_type = UDP_SEGMENT;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+	*((uint16_t*)CMSG_DATA(cmsg)) = seg_size;
+
+	if (sendmsg(impl->rtp_fd, &msg, MSG_NOSIGNAL) < 0)
+		return -errno;
+	return 0;
+}
+#endif
+
+static void stream_send_packets(void *data, struct iovec *iov, size_t iovlen,
+		uint32_t n_packets)
+{
+	struct impl *impl = data;
+	struct mmsghdr msg[MAX_MMSG];
+	uint32_t i, n;
+	int res;
+
+#ifdef UDP_SEGMENT
+	if (impl->gso) {
+		res = send_packets_gso(impl, iov, iovlen, n_packets);
+		if (res == 0)
+			return;
+		if (res != -EAGAIN) {
+			pw_log_warn("UDP segmentation offload failed, disabling: %s",
+					spa_strerror(res));
+			impl->gso = false;
+		}
+	}
+#endif
+	while (n_packets > 0) {
+		n = SPA_MIN(n_packets, MAX_MMSG);
+		for (i = 0; i < n; i++) {
+			spa_zero(msg[i]);
+			msg[i].msg_hdr.msg_iov = &iov[i * iovlen];
+			msg[i].msg_hdr.msg_iovlen = iovlen;
+		}
+		res = sendmmsg(impl->rtp_fd, msg, n, MSG_NOSIGNAL);
+		if (res <= 0) {
+			pw_log_debug("sendmmsg() failed: %m");
+			break;
+		}
+		iov += res * iovlen;
+		n_packets -= res;
+	}
+}
+
 static void stream_state_changed(void *data, bool started, const char *error)
 {
 	struct impl *impl = data;
@@ -220,6 +316,7 @@ static const struct rtp_stream_events stream_events = {
 	.destroy = stream_destroy,
 	.state_changed = stream_state_changed,
 	.send_packet = stream_send_packet,
+	.send_packets = stream_send_packets,
 };
 
 static int parse_address(const char *address, uint16_t port,
@@ -489,6 +586,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	impl->ttl = pw_properties_get_uint32(props, "net.ttl", DEFAULT_TTL);
 	impl->mcast_loop = pw_properties_get_bool(props, "net.loop", DEFAULT_LOOP);
 	impl->dscp = pw_properties_get_uint32(props, "net.dscp", DEFAULT_DSCP);
+	impl->gso = pw_properties_get_bool(props, "net.gso", DEFAULT_GSO);
 
 	ts_offset = pw_properties_get_int64(props, "sess.ts-offset", DEFAULT_TS_OFFSET);
 	if (ts_offset == -1)
@@ -115,6 +115,8 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
 
 #define DEFAULT_TS_OFFSET		-1
 
+#define MAX_MMSG			32
+
 #define USAGE   "( local.ifname=<local interface name to use> ) "						\
 		"( source.ip=<source IP address, default:"DEFAULT_SOURCE_IP"> ) "				\
  		"source.port=<int, source port> "								\
@@ -163,35 +165,49 @@ struct impl {
 	struct spa_source *source;
 
 	unsigned receiving:1;
+
+	/* packets received with one syscall */
+	struct mmsghdr msgs[MAX_MMSG];
+	struct iovec iov[MAX_MMSG];
+	uint8_t buffer[MAX_MMSG][2048];
 };
 
 static void
 on_rtp_io(void *data, int fd, uint32_t mask)
 {
 	struct impl *impl = data;
+	int i, n;
 	ssize_t len;
-	uint8_t buffer[2048];
-
-	if (mask & SPA_IO_IN) {
-		if ((len = recv(fd, buffer, sizeof(buffer), 0)) < 0)
-			goto receive_error;
 
-		if (len < 12)
-			goto short_packet;
-
-		if (SPA_LIKELY(impl->stream))
-			rtp_stream_receive_packet(impl->stream, buffer, len);
+	if (!(mask & SPA_IO_IN))
+		return;
 
-		impl->receiving = true;
-	}
-	return;
-
-receive_error:
-	pw_log_warn("recv error: %m");
-	return;
-short_packet:
-	pw_log_warn("short packet received");
-	return;
+	/* drain the socket, a full batch means there can be more */
+	do {
+		for (i = 0; i < MAX_MMSG; i++) {
+			impl->iov[i].iov_base = impl->buffer[i];
+			impl->iov[i].iov_len = sizeof(impl->buffer[i]);
+			spa_zero(impl->msgs[i]);
+			impl->msgs[i].msg_hdr.msg_iov = &impl->iov[i];
+			impl->msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		if ((n = recvmmsg(fd, impl->msgs, MAX_MMSG, MSG_DONTWAIT, NULL)) < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				pw_log_warn("recv error: %m");
+			return;
+		}
+		for (i = 0; i < n; i++) {
+			len = impl->msgs[i].msg_len;
+			if (len < 12) {
+				pw_log_warn("short packet received");
+				continue;
+			}
+			if (SPA_LIKELY(impl->stream))
+				rtp_stream_receive_packet(impl->stream, impl->buffer[i], len);
+
+			impl->receiving = true;
+		}
+	} while (n == MAX_MMSG);
 }
 
 static int parse_address(const char *address, uint16_t port,
@@ -446,6 +462,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	const char *str, *sess_name;
 	struct timespec value, interval;
 	struct pw_properties *props, *stream_props;
+	struct pw_data_loop *data_loop;
 	int64_t ts_offset;
 	int res = 0;
 
@@ -469,7 +486,6 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	impl->module = module;
 	impl->context = context;
 	impl->loop = pw_context_get_main_loop(context);
-	impl->data_loop = pw_data_loop_get_loop(pw_context_get_data_loop(context));
 
 	if ((sess_name = pw_properties_get(props, "sess.name")) == NULL)
 		sess_name = pw_get_host_name();
@@ -505,6 +521,17 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	copy_props(impl, props, "sess.latency.msec");
 	copy_props(impl, props, "sess.ts-direct");
 	copy_props(impl, props, "sess.ignore-ssrc");
+	copy_props(impl, props, PW_KEY_NODE_LOOP_NAME);
+
+	/* receive the packets on the data loop of the stream, the loop name
+	 * is placed in the stream properties */
+	if ((data_loop = pw_context_place_data_loop(context, stream_props)) == NULL) {
+		res = -ENOENT;
+		pw_log_error("can't find data loop %s",
+				pw_properties_get(stream_props, PW_KEY_NODE_LOOP_NAME));
+		goto out;
+	}
+	impl->data_loop = pw_data_loop_get_loop(data_loop);
 
 	str = pw_properties_get(props, "local.ifname");
 	impl->ifname = str ? strdup(str) : NULL;
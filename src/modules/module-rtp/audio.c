@@ -202,12 +202,15 @@ set_iovec(struct spa_ringbuffer *rbuf, void *buffer, uint32_t size,
 	iov[1].iov_base = buffer;
 }
 
+/* packets that are handed to the sender in one go */
+#define MAX_BATCH	64
+
 static void rtp_audio_flush_packets(struct impl *impl)
 {
 	int32_t avail, tosend;
-	uint32_t stride, timestamp;
-	struct iovec iov[3];
-	struct rtp_header header;
+	uint32_t stride, timestamp, n_packets;
+	struct iovec iov[MAX_BATCH][3];
+	struct rtp_header header[MAX_BATCH];
 
 	avail = spa_ringbuffer_get_read_index(&impl->ring, &timestamp);
 	tosend = impl->psamples;
@@ -216,36 +219,38 @@ static void rtp_audio_flush_packets(struct impl *impl)
 		return;
 
 	stride = impl->stride;
-
-	spa_zero(header);
-	header.v = 2;
-	header.pt = impl->payload;
-	header.ssrc = htonl(impl->ssrc);
-
-	iov[0].iov_base = &header;
-	iov[0].iov_len = sizeof(header);
+	n_packets = 0;
 
 	while (avail >= tosend) {
+		struct rtp_header *h = &header[n_packets];
+
+		spa_zero(*h);
+		h->v = 2;
+		h->pt = impl->payload;
+		h->ssrc = htonl(impl->ssrc);
 		if (impl->marker_on_first && impl->first)
-			header.m = 1;
-		else
-			header.m = 0;
-		header.sequence_number = htons(impl->seq);
-		header.timestamp = htonl(impl->ts_offset + timestamp);
+			h->m = 1;
+		h->sequence_number = htons(impl->seq);
+		h->timestamp = htonl(impl->ts_offset + timestamp);
 
+		iov[n_packets][0].iov_base = h;
+		iov[n_packets][0].iov_len = sizeof(*h);
 		set_iovec(&impl->ring,
 			impl->buffer, BUFFER_SIZE,
 			(timestamp * stride) & BUFFER_MASK,
-			&iov[1], tosend * stride);
+			&iov[n_packets][1], tosend * stride);
 
 		pw_log_trace("sending %d avail:%d ts_offset:%d timestamp:%d", tosend, avail, impl->ts_offset, timestamp);
 
-		rtp_stream_emit_send_packet(impl, iov, 3);
-
 		impl->seq++;
 		impl->first = false;
 		timestamp += tosend;
 		avail -= tosend;
+
+		if (++n_packets == MAX_BATCH || avail < tosend) {
+			rtp_stream_emit_send_packets(impl, &iov[0][0], 3, n_packets);
+			n_packets = 0;
+		}
 	}
 	spa_ringbuffer_read_update(&impl->ring, timestamp);
 }
@@ -0,0 +1,257 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <spa/utils/defs.h>
+
+/* Send RTP sized packets over loopback for a number of streams, one
+ * syscall per packet or one syscall per stream and cycle. */
+
+#define MAX_STREAMS	64
+#define MAX_PACKETS	16
+/* 1ms of 2 channel L24 at 48kHz and the RTP header */
+#define PACKET_SIZE	(12 + 48 * 2 * 3)
+#define N_CYCLES	2000
+
+struct stats {
+	uint32_t n_streams;
+	uint32_t n_packets;
+	uint64_t received;
+	double pps;
+	double cpu_usec;
+	const char *name;
+};
+
+struct stream {
+	int send_fd;
+	int recv_fd;
+	struct sockaddr_in addr;
+};
+
+static struct stream streams[MAX_STREAMS];
+static uint8_t packet[PACKET_SIZE];
+static uint8_t buffer[MAX_PACKETS][2048];
+
+static const uint32_t stream_counts[] = { 1, 8, 64 };
+static const uint32_t packet_counts[] = { 1, 5, 16 };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(stream_counts) * SPA_N_ELEMENTS(packet_counts) * 2
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+typedef int (*send_func_t) (struct stream *s, uint32_t n_packets);
+typedef int (*recv_func_t) (struct stream *s);
+
+static int make_streams(uint32_t n_streams)
+{
+	uint32_t i;
+	int val = 4 * 1024 * 1024;
+	socklen_t len;
+
+	for (i = 0; i < n_streams; i++) {
+		struct stream *s = &streams[i];
+
+		s->send_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+		s->recv_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+		if (s->send_fd < 0 || s->recv_fd < 0)
+			return -errno;
+
+		setsockopt(s->recv_fd, SOL_SOCKET, SO_RCVBUF, &val, sizeof(val));
+
+		spa_zero(s->addr);
+		s->addr.sin_family = AF_INET;
+		s->addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (bind(s->recv_fd, (struct sockaddr*)&s->addr, sizeof(s->addr)) < 0)
+			return -errno;
+		len = sizeof(s->addr);
+		if (getsockname(s->recv_fd, (struct sockaddr*)&s->addr, &len) < 0)
+			return -errno;
+		if (connect(s->send_fd, (struct sockaddr*)&s->addr, sizeof(s->addr)) < 0)
+			return -errno;
+	}
+	return 0;
+}
+
+static void free_streams(uint32_t n_streams)
+{
+	uint32_t i;
+	for (i = 0; i < n_streams; i++) {
+		close(streams[i].send_fd);
+		close(streams[i].recv_fd);
+	}
+}
+
+static int send_single(struct stream *s, uint32_t n_packets)
+{
+	struct iovec iov[2];
+	struct msghdr msg;
+	uint32_t i;
+
+	/* header and payload in separate iovecs like the rtp stream */
+	iov[0].iov_base = packet;
+	iov[0].iov_len = 12;
+	iov[1].iov_base = &packet[12];
+	iov[1].iov_len = PACKET_SIZE - 12;
+
+	spa_zero(msg);
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+
+	for (i = 0; i < n_packets; i++) {
+		if (sendmsg(s->send_fd, &msg, MSG_NOSIGNAL) < 0)
+			return -errno;
+	}
+	return 0;
+}
+
+static int recv_single(struct stream *s)
+{
+	int n = 0;
+
+	while (recv(s->recv_fd, buffer[0], sizeof(buffer[0]), 0) >= 0)
+		n++;
+	return n;
+}
+
+static int send_batched(struct stream *s, uint32_t n_packets)
+{
+	struct iovec iov[MAX_PACKETS][2];
+	struct mmsghdr msg[MAX_PACKETS];
+	uint32_t i;
+
+	for (i = 0; i < n_packets; i++) {
+		iov[i][0].iov_base = packet;
+		iov[i][0].iov_len = 12;
+		iov[i][1].iov_base = &packet[12];
+		iov[i][1].iov_len = PACKET_SIZE - 12;
+		spa_zero(msg[i]);
+		msg[i].msg_hdr.msg_iov = iov[i];
+		msg[i].msg_hdr.msg_iovlen = 2;
+	}
+	if (sendmmsg(s->send_fd, msg, n_packets, MSG_NOSIGNAL) < 0)
+		return -errno;
+	return 0;
+}
+
+static int recv_batched(struct stream *s)
+{
+	struct iovec iov[MAX_PACKETS];
+	struct mmsghdr msg[MAX_PACKETS];
+	int i, n, total = 0;
+
+	do {
+		for (i = 0; i < MAX_PACKETS; i++) {
+			iov[i].iov_base = buffer[i];
+			iov[i].iov_len = sizeof(buffer[i]);
+			spa_zero(msg[i]);
+			msg[i].msg_hdr.msg_iov = &iov[i];
+			msg[i].msg_hdr.msg_iovlen = 1;
+		}
+		if ((n = recvmmsg(s->recv_fd, msg, MAX_PACKETS, MSG_DONTWAIT, NULL)) < 0)
+			break;
+		total += n;
+	} while (n == MAX_PACKETS);
+
+	return total;
+}
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static uint64_t get_cpu_usec(void)
+{
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * SPA_USEC_PER_SEC +
+		ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+static void run_test(const char *name, send_func_t send_func, recv_func_t recv_func,
+		uint32_t n_streams, uint32_t n_packets)
+{
+	uint32_t i, j;
+	uint64_t t1, t2, c1, c2, received = 0;
+
+	if (make_streams(n_streams) < 0) {
+		fprintf(stderr, "can't make sockets: %m\n");
+		exit(EXIT_FAILURE);
+	}
+
+	t1 = get_time();
+	c1 = get_cpu_usec();
+	for (i = 0; i < N_CYCLES; i++) {
+		for (j = 0; j < n_streams; j++)
+			send_func(&streams[j], n_packets);
+		for (j = 0; j < n_streams; j++)
+			received += recv_func(&streams[j]);
+	}
+	c2 = get_cpu_usec();
+	t2 = get_time();
+
+	free_streams(n_streams);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_streams = n_streams,
+		.n_packets = n_packets,
+		.received = received,
+		.pps = received * (double)SPA_NSEC_PER_SEC / (t2 - t1),
+		/* cpu time per stream for one second of 1ms packets */
+		.cpu_usec = (c2 - c1) * 1000.0 / ((double)N_CYCLES * n_packets * n_streams),
+		.name = name,
+	};
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = a->n_streams - b->n_streams) != 0) return diff;
+	if ((diff = a->n_packets - b->n_packets) != 0) return diff;
+	return strcmp(a->name, b->name);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	for (i = 0; i < PACKET_SIZE; i++)
+		packet[i] = i;
+
+	SPA_FOR_EACH_ELEMENT_VAR(stream_counts, s) {
+		SPA_FOR_EACH_ELEMENT_VAR(packet_counts, p) {
+			run_test("single", send_single, recv_single, *s, *p);
+			run_test("batched", send_batched, recv_batched, *s, *p);
+		}
+	}
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12.0f pkt/s \t%-8.8s \t streams %d, packets/cycle %d, "
+				"cpu %.1f usec/stream/s, received %"PRIu64"\n",
+				s->pps, s->name, s->n_streams, s->n_packets,
+				s->cpu_usec, s->received);
+	}
+	return 0;
+}
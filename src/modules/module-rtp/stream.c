@@ -87,6 +87,25 @@ struct impl {
 	int (*receive_rtp)(struct impl *impl, uint8_t *buffer, ssize_t len);
 };
 
+/* give all the packets of a cycle to the listeners at once */
+static void rtp_stream_emit_send_packets(struct impl *impl, struct iovec *iov,
+		size_t iovlen, uint32_t n_packets)
+{
+	struct spa_hook *h;
+	uint32_t i;
+
+	spa_list_for_each(h, &impl->listener_list.list, link) {
+		const struct rtp_stream_events *ev = h->cb.funcs;
+
+		if (SPA_CALLBACK_CHECK(ev, send_packets, 1)) {
+			ev->send_packets(h->cb.data, iov, iovlen, n_packets);
+		} else if (SPA_CALLBACK_CHECK(ev, send_packet, 0)) {
+			for (i = 0; i < n_packets; i++)
+				ev->send_packet(h->cb.data, &iov[i * iovlen], iovlen);
+		}
+	}
+}
+
 #include "module-rtp/audio.c"
 #include "module-rtp/midi.c"
 #include "module-rtp/opus.c"
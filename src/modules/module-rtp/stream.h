@@ -24,7 +24,7 @@ struct rtp_stream;
 #define DEFAULT_MAX_PTIME	20
 
 struct rtp_stream_events {
-#define RTP_VERSION_STREAM_EVENTS        0
+#define RTP_VERSION_STREAM_EVENTS        1
 	uint32_t version;
 
 	void (*destroy) (void *data);
@@ -36,6 +36,10 @@ struct rtp_stream_events {
 	void (*send_packet) (void *data, struct iovec *iov, size_t iovlen);
 
 	void (*send_feedback) (void *data, uint32_t seqnum);
+
+	/* since 1: send \a n_packets packets of \a iovlen iovecs each. Without
+	 * this event, send_packet is called for each packet */
+	void (*send_packets) (void *data, struct iovec *iov, size_t iovlen, uint32_t n_packets);
 };
 
 struct rtp_stream *rtp_stream_new(struct pw_core *core,
@@ -441,6 +441,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	const char *str, *sess_name;
 	struct timespec value, interval;
 	struct pw_properties *props, *stream_props;
+	struct pw_data_loop *data_loop;
 	int res = 0;
 
 	PW_LOG_TOPIC_INIT(mod_topic);
@@ -463,7 +464,6 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	impl->module = module;
 	impl->context = context;
 	impl->loop = pw_context_get_main_loop(context);
-	impl->data_loop = pw_data_loop_get_loop(pw_context_get_data_loop(context));
 
 	if ((sess_name = pw_properties_get(props, "sess.name")) == NULL)
 		sess_name = pw_get_host_name();
@@ -497,6 +497,17 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	copy_props(impl, props, "sess.min-ptime");
 	copy_props(impl, props, "sess.max-ptime");
 	copy_props(impl, props, "sess.latency.msec");
+	copy_props(impl, props, PW_KEY_NODE_LOOP_NAME);
+
+	/* receive the packets on the data loop of the stream, the loop name
+	 * is placed in the stream properties */
+	if ((data_loop = pw_context_place_data_loop(context, stream_props)) == NULL) {
+		res = -ENOENT;
+		pw_log_error("can't find data loop %s",
+				pw_properties_get(stream_props, PW_KEY_NODE_LOOP_NAME));
+		goto out;
+	}
+	impl->data_loop = pw_data_loop_get_loop(data_loop);
 
 	str = pw_properties_get(props, "local.ifname");
 	impl->ifname = str ? strdup(str) : NULL;
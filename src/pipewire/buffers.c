@@ -25,7 +25,8 @@ struct port {
 };
 
 /* Allocate an array of buffers that can be shared */
-static int alloc_buffers(struct pw_mempool *pool,
+static int alloc_buffers(struct pw_context *context,
+			 const void *owner[2],
 			 uint32_t n_buffers,
 			 uint32_t n_params,
 			 struct spa_pod **params,
@@ -45,6 +46,7 @@ static int alloc_buffers(struct pw_mempool *pool,
 	struct spa_data *datas;
 	struct pw_memblock *m;
 	struct spa_buffer_alloc_info info = { 0, };
+	enum pw_memblock_flags mem_flags;
 
 	if (!SPA_FLAG_IS_SET(flags, PW_BUFFERS_FLAG_SHARED))
 		SPA_FLAG_SET(info.flags, SPA_BUFFER_ALLOC_FLAG_INLINE_ALL);
@@ -103,16 +105,28 @@ static int alloc_buffers(struct pw_mempool *pool,
 
 	if (SPA_FLAG_IS_SET(flags, PW_BUFFERS_FLAG_SHARED)) {
 		/* pointer to buffer structures */
-		m = pw_mempool_alloc(pool,
-				PW_MEMBLOCK_FLAG_READWRITE |
-				PW_MEMBLOCK_FLAG_SEAL |
-				PW_MEMBLOCK_FLAG_MAP,
-				SPA_DATA_MemFd,
-				n_buffers * info.mem_size);
+		mem_flags = PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_SEAL |
+			PW_MEMBLOCK_FLAG_MAP |
+			context->buffer_mem_flags;
+		if (SPA_FLAG_IS_SET(flags, PW_BUFFERS_FLAG_RECYCLE))
+			m = pw_mempool_alloc_cached(context->pool, mem_flags,
+					SPA_DATA_MemFd, n_buffers * info.mem_size, owner);
+		else
+			m = pw_mempool_alloc(context->pool, mem_flags,
+					SPA_DATA_MemFd, n_buffers * info.mem_size);
 		if (m == NULL) {
 			free(buffers);
 			return -errno;
 		}
+		if (SPA_FLAG_IS_SET(flags, PW_BUFFERS_FLAG_RECYCLE)) {
+			struct pw_mempool_stats stats;
+			pw_mempool_get_stats(context->pool, &stats);
+			pw_log_debug("%p: mem cache reused:%"PRIu64"/%"PRIu64" evicted:%"PRIu64
+					" cached:%u (%"PRIu64" bytes)", allocation,
+					stats.n_reused, stats.n_alloc, stats.n_evicted,
+					stats.n_cached, stats.cached_size);
+		}
 
 		data = m->map->ptr;
 	} else {
@@ -229,6 +243,7 @@ int pw_buffers_negotiate(struct pw_context *context, uint32_t flags,
 	uint32_t types, *data_types;
 	struct port output = { outnode, SPA_DIRECTION_OUTPUT, out_port_id };
 	struct port input = { innode, SPA_DIRECTION_INPUT, in_port_id };
+	const void *owner[2] = { outnode, innode };
 	int res;
 
 	if (flags & PW_BUFFERS_FLAG_IN_PRIORITY) {
@@ -326,7 +341,8 @@ int pw_buffers_negotiate(struct pw_context *context, uint32_t flags,
 		data_types[i] = types;
 	}
 
-	if ((res = alloc_buffers(context->pool,
+	if ((res = alloc_buffers(context,
+				 owner,
 				 max_buffers,
 				 n_params,
 				 params,
@@ -30,6 +30,8 @@ extern "C" {
 #define PW_BUFFERS_FLAG_SHARED_MEM	(1<<3)	/**< buffers need shared memory */
 #define PW_BUFFERS_FLAG_IN_PRIORITY	(1<<4)	/**< input parameters have priority */
 #define PW_BUFFERS_FLAG_ASYNC		(1<<5)	/**< one of the nodes is async */
+#define PW_BUFFERS_FLAG_RECYCLE		(1<<6)	/**< the memory can be reused for the same
+						  *  nodes, see \ref pw_mempool_alloc_cached() */
 
 struct pw_buffers {
 	struct pw_memblock *mem;	/**< allocated buffer memory */
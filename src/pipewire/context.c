@@ -7,6 +7,7 @@
 #include <time.h>
 #include <stdio.h>
 #include <regex.h>
+#include <fnmatch.h>
 #include <limits.h>
 #include <sys/mman.h>
 
@@ -18,6 +19,7 @@
 #include <spa/support/plugin-loader.h>
 #include <spa/node/utils.h>
 #include <spa/utils/atomic.h>
+#include <spa/utils/json.h>
 #include <spa/utils/names.h>
 #include <spa/utils/string.h>
 #include <spa/debug/types.h>
@@ -33,16 +35,39 @@ PW_LOG_TOPIC_EXTERN(log_context);
 #define PW_LOG_TOPIC_DEFAULT log_context
 
 #define MAX_HOPS	64
+#define MAX_DATA_LOOPS	64
+#define ACTIVATION_SLAB_SLOTS	64
 
 /** \cond */
+struct activation_slab {
+	struct spa_list link;
+	uint64_t client_serial;
+	int ref;
+	struct pw_memslab *slab;
+};
+
+struct data_loop {
+	struct pw_data_loop *impl;
+	uint32_t n_drivers;		/* running driver groups, updated in recalc */
+	uint32_t n_followers;		/* followers of those driver groups */
+};
+
 struct impl {
 	struct pw_context this;
 	struct spa_handle *dbus_handle;
 	struct spa_plugin_loader plugin_loader;
 	unsigned int recalc:1;
 	unsigned int recalc_pending:1;
+	unsigned int recalc_full:1;
 
-	struct pw_data_loop *data_loop_impl;
+	struct pw_impl_node *recalc_target;	/* target of unassigned nodes in last recalc */
+	uint32_t n_visited;			/* nodes collected in the current recalc */
+
+	uint32_t n_data_loops;
+	struct data_loop data_loops[MAX_DATA_LOOPS];
+
+	unsigned int slab_activations:1;
+	struct spa_list activation_slabs;	/* slabs for the node activations, one per client */
 };
 
 
@@ -90,23 +115,29 @@ static int context_set_freewheel(struct pw_context *context, bool freewheel)
 {
 	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
 	struct spa_thread *thr;
+	uint32_t i;
 	int res = 0;
 
-	if ((thr = pw_data_loop_get_thread(impl->data_loop_impl)) == NULL)
-		return -EIO;
-
-	if (freewheel) {
+	if (freewheel)
 		pw_log_info("%p: enter freewheel", context);
-		if (context->thread_utils)
-			res = spa_thread_utils_drop_rt(context->thread_utils, thr);
-	} else {
+	else
 		pw_log_info("%p: exit freewheel", context);
-		/* Use the priority as configured within the realtime module */
-		if (context->thread_utils)
+
+	for (i = 0; i < impl->n_data_loops; i++) {
+		if ((thr = pw_data_loop_get_thread(impl->data_loops[i].impl)) == NULL)
+			return -EIO;
+
+		if (context->thread_utils == NULL)
+			continue;
+
+		if (freewheel)
+			res = spa_thread_utils_drop_rt(context->thread_utils, thr);
+		else
+			/* Use the priority as configured within the realtime module */
 			res = spa_thread_utils_acquire_rt(context->thread_utils, thr, -1);
+		if (res < 0)
+			pw_log_info("%p: freewheel error:%s", context, spa_strerror(res));
 	}
-	if (res < 0)
-		pw_log_info("%p: freewheel error:%s", context, spa_strerror(res));
 
 	context->freewheeling = freewheel;
 
@@ -163,6 +194,92 @@ static int do_data_loop_setup(struct spa_loop *loop, bool async, uint32_t seq,
 	return 0;
 }
 
+struct data_loop_conf {
+	struct pw_properties *props;
+	uint32_t index;
+	uint32_t count;
+};
+
+static int parse_data_loop_conf(void *user_data, const char *location,
+		const char *section, const char *str, size_t len)
+{
+	struct data_loop_conf *d = user_data;
+	struct spa_json it[2];
+	const char *val;
+	int l;
+
+	spa_json_init(&it[0], str, len);
+	if (spa_json_enter_array(&it[0], &it[1]) < 0) {
+		pw_log_error("config file error: context.data-loops is not an array");
+		return -EINVAL;
+	}
+	while ((l = spa_json_next(&it[1], &val)) > 0) {
+		if (!spa_json_is_object(val, l))
+			continue;
+		l = spa_json_container_len(&it[1], val, l);
+		if (d->count++ == d->index)
+			pw_properties_update_string(d->props, val, l);
+	}
+	return 0;
+}
+
+/* Create the data loops. The number of loops is configured with
+ * context.num-data-loops, each loop can be further configured with
+ * an entry in the context.data-loops section, for example:
+ *
+ * context.data-loops = [
+ *     { loop.name = data-loop.0 thread.affinity = [ 0 1 ] }
+ *     { thread.affinity = [ 2 3 ] }
+ * ]
+ *
+ * The first data loop is the default data loop that is also given to
+ * the plugins as the DataLoop support interface.
+ */
+static int create_data_loops(struct impl *impl, struct spa_cpu *cpu)
+{
+	struct pw_context *this = &impl->this;
+	struct pw_properties *pr;
+	const char *str;
+	int32_t i, n_loops;
+	int res = 0;
+
+	n_loops = pw_properties_get_int32(this->properties,
+			PW_KEY_CONTEXT_NUM_DATA_LOOPS, 1);
+	if (n_loops < 0)
+		n_loops = cpu ? spa_cpu_get_count(cpu) : 1;
+	n_loops = SPA_CLAMP(n_loops, 1, MAX_DATA_LOOPS);
+
+	for (i = 0; i < n_loops; i++) {
+		struct data_loop_conf conf;
+
+		pr = pw_properties_copy(this->properties);
+		if (pr == NULL)
+			return -errno;
+
+		if ((str = pw_properties_get(pr, "context.data-loop." PW_KEY_LIBRARY_NAME_SYSTEM)))
+			pw_properties_set(pr, PW_KEY_LIBRARY_NAME_SYSTEM, str);
+
+		pw_properties_setf(pr, PW_KEY_LOOP_NAME, "data-loop.%d", i);
+
+		conf = (struct data_loop_conf) { .props = pr, .index = i };
+		pw_context_conf_section_for_each(this, "context.data-loops",
+				parse_data_loop_conf, &conf);
+
+		impl->data_loops[i].impl = pw_data_loop_new(&pr->dict);
+		pw_properties_free(pr);
+		if (impl->data_loops[i].impl == NULL)  {
+			res = -errno;
+			break;
+		}
+		impl->n_data_loops++;
+
+		pw_log_info("%p: data-loop %d name:%s affinity:%s", this, i,
+				impl->data_loops[i].impl->name,
+				impl->data_loops[i].impl->affinity);
+	}
+	return res;
+}
+
 /** Create a new context object
  *
  * \param main_loop the main loop to use
@@ -179,8 +296,8 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	struct pw_context *this;
 	const char *lib, *str;
 	void *dbus_iface = NULL;
-	uint32_t n_support;
-	struct pw_properties *pr, *conf;
+	uint32_t i, n_support;
+	struct pw_properties *conf;
 	struct spa_cpu *cpu;
 	int res = 0;
 
@@ -276,24 +393,25 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	pw_settings_init(this);
 	this->settings = this->defaults;
 
-	pr = pw_properties_copy(properties);
-	if ((str = pw_properties_get(pr, "context.data-loop." PW_KEY_LIBRARY_NAME_SYSTEM)))
-		pw_properties_set(pr, PW_KEY_LIBRARY_NAME_SYSTEM, str);
-
-	impl->data_loop_impl = pw_data_loop_new(&pr->dict);
-	pw_properties_free(pr);
-	if (impl->data_loop_impl == NULL)  {
-		res = -errno;
+	if ((res = create_data_loops(impl, cpu)) < 0)
 		goto error_free;
-	}
 
-	this->pool = pw_mempool_new(NULL);
+	this->pool = pw_mempool_new(pw_properties_new(
+				"mem.cache-size", pw_properties_get(properties, "mem.cache-size"),
+				NULL));
 	if (this->pool == NULL) {
 		res = -errno;
 		goto error_free;
 	}
-
-	this->data_loop = pw_data_loop_get_loop(impl->data_loop_impl);
+	spa_list_init(&impl->activation_slabs);
+	impl->slab_activations = pw_properties_get_bool(properties,
+			"mem.slab-activations", false);
+	if (pw_properties_get_bool(properties, "mem.prefault", false))
+		this->buffer_mem_flags |= PW_MEMBLOCK_FLAG_PREFAULT;
+	if (pw_properties_get_bool(properties, "mem.hugepages", false))
+		this->buffer_mem_flags |= PW_MEMBLOCK_FLAG_HUGEPAGES;
+
+	this->data_loop = pw_data_loop_get_loop(impl->data_loops[0].impl);
 	this->data_system = this->data_loop->system;
 	this->main_loop = main_loop;
 
@@ -359,11 +477,13 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 		goto error_free;
 	pw_log_info("%p: parsed %d context.exec items", this, res);
 
-	if ((res = pw_data_loop_start(impl->data_loop_impl)) < 0)
-		goto error_free;
+	for (i = 0; i < impl->n_data_loops; i++) {
+		if ((res = pw_data_loop_start(impl->data_loops[i].impl)) < 0)
+			goto error_free;
 
-	pw_data_loop_invoke(impl->data_loop_impl,
-			do_data_loop_setup, 0, NULL, 0, false, this);
+		pw_data_loop_invoke(impl->data_loops[i].impl,
+				do_data_loop_setup, 0, NULL, 0, false, this);
+	}
 
 	pw_settings_expose(this);
 
@@ -396,6 +516,8 @@ void pw_context_destroy(struct pw_context *context)
 	struct factory_entry *entry;
 	struct pw_impl_metadata *metadata;
 	struct pw_impl_core *core_impl;
+	struct activation_slab *slab;
+	uint32_t i;
 
 	pw_log_debug("%p: destroy", context);
 	pw_context_emit_destroy(context);
@@ -415,8 +537,8 @@ void pw_context_destroy(struct pw_context *context)
 	spa_list_consume(resource, &context->registry_resource_list, link)
 		pw_resource_destroy(resource);
 
-	if (impl->data_loop_impl)
-		pw_data_loop_stop(impl->data_loop_impl);
+	for (i = 0; i < impl->n_data_loops; i++)
+		pw_data_loop_stop(impl->data_loops[i].impl);
 
 	spa_list_consume(module, &context->module_list, link)
 		pw_impl_module_destroy(module);
@@ -433,9 +555,14 @@ void pw_context_destroy(struct pw_context *context)
 	pw_log_debug("%p: free", context);
 	pw_context_emit_free(context);
 
-	if (impl->data_loop_impl)
-		pw_data_loop_destroy(impl->data_loop_impl);
+	for (i = 0; i < impl->n_data_loops; i++)
+		pw_data_loop_destroy(impl->data_loops[i].impl);
 
+	spa_list_consume(slab, &impl->activation_slabs, link) {
+		spa_list_remove(&slab->link);
+		pw_memslab_destroy(slab->slab);
+		free(slab);
+	}
 	if (context->pool)
 		pw_mempool_destroy(context->pool);
 
@@ -498,7 +625,212 @@ SPA_EXPORT
 struct pw_data_loop *pw_context_get_data_loop(struct pw_context *context)
 {
 	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
-	return impl->data_loop_impl;
+	return impl->data_loops[0].impl;
+}
+
+SPA_EXPORT
+uint32_t pw_context_get_n_data_loops(struct pw_context *context)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	return impl->n_data_loops;
+}
+
+SPA_EXPORT
+struct pw_data_loop *pw_context_find_data_loop(struct pw_context *context, const char *name)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	uint32_t i;
+
+	if (name == NULL)
+		return impl->data_loops[0].impl;
+
+	for (i = 0; i < impl->n_data_loops; i++) {
+		if (spa_streq(impl->data_loops[i].impl->name, name))
+			return impl->data_loops[i].impl;
+	}
+	return NULL;
+}
+
+static bool props_want_driver_loop(const struct spa_dict *props)
+{
+	const char *str;
+
+	if ((str = spa_dict_lookup(props, PW_KEY_NODE_DRIVER)) != NULL &&
+	    spa_atob(str))
+		return true;
+	if ((str = spa_dict_lookup(props, PW_KEY_PRIORITY_DRIVER)) != NULL &&
+	    atoi(str) > 0)
+		return true;
+	return false;
+}
+
+/* The load of a loop for placing a new node. Drivers are spread over the
+ * loops with the least amount of running driver groups, as counted in the
+ * last graph recalculation, and then over the total number of drivers on
+ * the loop. Other nodes are spread over the number of followers. */
+static uint32_t data_loop_load(struct impl *impl, struct data_loop *l, bool driver)
+{
+	struct pw_context *context = &impl->this;
+	struct pw_loop *loop = pw_data_loop_get_loop(l->impl);
+	struct pw_impl_node *n;
+	uint32_t count = 0;
+
+	spa_list_for_each(n, &context->node_list, link) {
+		if (n->data_loop == loop && n->driver == driver)
+			count++;
+	}
+	return driver ? (l->n_drivers << 16) + count : count;
+}
+
+/* nodes in the same link group are internally linked and share their state.
+ * They need to run in the same thread. */
+static struct data_loop *find_link_group_loop(struct impl *impl, const char *pattern,
+		const char *link_group)
+{
+	struct pw_context *context = &impl->this;
+	struct pw_impl_node *n;
+	struct data_loop *res = NULL;
+	char **groups;
+	uint32_t i;
+
+	if ((groups = pw_strv_parse(link_group, strlen(link_group), INT_MAX, NULL)) == NULL)
+		return NULL;
+
+	spa_list_for_each(n, &context->node_list, link) {
+		if (n->link_groups == NULL ||
+		    pw_strv_find_common(n->link_groups, groups) < 0)
+			continue;
+		for (i = 0; i < impl->n_data_loops; i++) {
+			struct data_loop *l = &impl->data_loops[i];
+			if (n->data_loop == pw_data_loop_get_loop(l->impl) &&
+			    fnmatch(pattern, l->impl->name, 0) == 0) {
+				res = l;
+				goto done;
+			}
+		}
+	}
+done:
+	pw_free_strv(groups);
+	return res;
+}
+
+/* The activations of the nodes of one client are packed in a slab of that
+ * client. A client that links to a node imports the block of the node
+ * activation so it can see the other activations in that block. With a slab
+ * per client that is limited to the nodes of the owner of the peer. Nodes
+ * without an owner, like the devices, keep a memfd per activation. The slab
+ * is found with the serial of the client because the id can be reused while
+ * the lingering nodes of the old client still exist. */
+struct pw_memslab *pw_context_acquire_activation_slab(struct pw_context *context,
+		const struct spa_dict *props)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct activation_slab *slab;
+	struct pw_global *global;
+	uint64_t serial;
+	const char *str;
+
+	if (!impl->slab_activations)
+		return NULL;
+	if ((str = spa_dict_lookup(props, PW_KEY_CLIENT_ID)) == NULL)
+		return NULL;
+	if ((global = pw_context_find_global(context, atoi(str))) == NULL ||
+	    !pw_global_is_type(global, PW_TYPE_INTERFACE_Client))
+		return NULL;
+
+	serial = pw_global_get_serial(global);
+	spa_list_for_each(slab, &impl->activation_slabs, link) {
+		if (slab->client_serial == serial) {
+			slab->ref++;
+			return slab->slab;
+		}
+	}
+
+	if ((slab = calloc(1, sizeof(*slab))) == NULL)
+		return NULL;
+
+	slab->slab = pw_memslab_new(context->pool,
+			PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_SEAL |
+			PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, sizeof(struct pw_node_activation),
+			ACTIVATION_SLAB_SLOTS);
+	if (slab->slab == NULL) {
+		free(slab);
+		return NULL;
+	}
+	slab->client_serial = serial;
+	slab->ref = 1;
+	spa_list_append(&impl->activation_slabs, &slab->link);
+
+	pw_log_debug("%p: new activation slab %p for client %s", context, slab->slab, str);
+	return slab->slab;
+}
+
+void pw_context_release_activation_slab(struct pw_context *context,
+		struct pw_memslab *memslab)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct activation_slab *slab;
+
+	spa_list_for_each(slab, &impl->activation_slabs, link) {
+		if (slab->slab != memslab)
+			continue;
+		if (--slab->ref > 0)
+			return;
+		spa_list_remove(&slab->link);
+		pw_memslab_destroy(slab->slab);
+		free(slab);
+		return;
+	}
+}
+
+SPA_EXPORT
+struct pw_data_loop *pw_context_place_data_loop(struct pw_context *context,
+		struct pw_properties *props)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct data_loop *best = NULL;
+	uint32_t i, load, best_load = 0;
+	const char *pattern, *str;
+	bool driver;
+
+	driver = props_want_driver_loop(&props->dict);
+
+	if ((pattern = pw_properties_get(props, PW_KEY_NODE_LOOP_NAME)) == NULL) {
+		if (impl->n_data_loops == 1 || !driver)
+			return impl->data_loops[0].impl;
+		pattern = "*";
+	} else if (strpbrk(pattern, "*?[") == NULL) {
+		return pw_context_find_data_loop(context, pattern);
+	}
+
+	if ((str = pw_properties_get(props, PW_KEY_NODE_LINK_GROUP)) != NULL)
+		best = find_link_group_loop(impl, pattern, str);
+
+	for (i = 0; best == NULL && i < impl->n_data_loops; i++) {
+		struct data_loop *l = &impl->data_loops[i];
+
+		if (fnmatch(pattern, l->impl->name, 0) != 0)
+			continue;
+
+		load = data_loop_load(impl, l, driver);
+		if (best == NULL || load < best_load) {
+			best = l;
+			best_load = load;
+		}
+	}
+	if (best == NULL) {
+		pw_log_warn("%p: no data loop matches %s", context, pattern);
+		return NULL;
+	}
+	pw_log_info("%p: place %s %s on %s (%u running drivers, %u followers)", context,
+			driver ? "driver" : "node",
+			pw_properties_get(props, PW_KEY_NODE_NAME),
+			best->impl->name, best->n_drivers, best->n_followers);
+
+	pw_properties_set(props, PW_KEY_NODE_LOOP_NAME, best->impl->name);
+	return best->impl;
 }
 
 SPA_EXPORT
@@ -877,6 +1209,7 @@ static inline int run_nodes(struct pw_context *context, struct pw_impl_node *nod
  */
 static int collect_nodes(struct pw_context *context, struct pw_impl_node *node, struct spa_list *collect)
 {
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
 	struct spa_list queue;
 	struct pw_impl_node *n, *t;
 	struct pw_impl_port *p;
@@ -894,6 +1227,7 @@ static int collect_nodes(struct pw_context *context, struct pw_impl_node *node,
 	spa_list_consume(n, &queue, sort_link) {
 		spa_list_remove(&n->sort_link);
 		spa_list_append(collect, &n->sort_link);
+		impl->n_visited++;
 
 		pw_log_debug(" next node %p: '%s' runnable:%u", n, n->name, n->runnable);
 
@@ -1175,6 +1509,93 @@ static uint32_t find_best_rate(const uint32_t *rates, uint32_t n_rates, uint32_t
 	return def;
 }
 
+/* keep track of the running driver groups per data loop. This is used
+ * to place new drivers on the least busy data loop. */
+static void account_data_loop(struct impl *impl, struct pw_impl_node *driver)
+{
+	struct pw_impl_node *s;
+	uint32_t i;
+
+	for (i = 0; i < impl->n_data_loops; i++) {
+		struct data_loop *l = &impl->data_loops[i];
+
+		if (driver->data_loop != pw_data_loop_get_loop(l->impl))
+			continue;
+
+		l->n_drivers++;
+		spa_list_for_each(s, &driver->follower_list, follower_link) {
+			if (s == driver)
+				continue;
+			l->n_followers++;
+			if (s->data_loop != driver->data_loop && !s->remote && !s->exported)
+				pw_log_debug("%p: follower %s of %s runs on another data loop",
+						impl, s->name, driver->name);
+		}
+		break;
+	}
+}
+
+static inline void add_recalc(struct spa_list *queue, struct pw_impl_node *n)
+{
+	if (n == NULL || n->recalc || !n->registered)
+		return;
+	n->recalc = true;
+	spa_list_append(queue, &n->sort_link);
+}
+
+/* Mark the nodes that need to be looked at in this recalc. This is everything
+ * when a full recalc was requested, else it is the closure of the dirty nodes
+ * over all links, groups and driver groups, whether the links are prepared
+ * or not. collect_nodes() can then never reach a node outside of this set.
+ * Returns the number of nodes in the graph. */
+static uint32_t mark_recalc(struct pw_context *context, bool full)
+{
+	struct spa_list queue;
+	struct pw_impl_node *n, *t;
+	struct pw_impl_port *p;
+	struct pw_impl_link *l;
+	uint32_t n_nodes = 0;
+
+	spa_list_init(&queue);
+	spa_list_for_each(n, &context->node_list, link) {
+		n->recalc = full;
+		n_nodes++;
+	}
+	spa_list_for_each(n, &context->node_list, link) {
+		if (n->recalc_dirty)
+			add_recalc(&queue, n);
+		n->recalc_dirty = false;
+	}
+	spa_list_consume(n, &queue, sort_link) {
+		spa_list_remove(&n->sort_link);
+
+		add_recalc(&queue, n->driver_node);
+		spa_list_for_each(t, &n->driver_node->follower_list, follower_link)
+			add_recalc(&queue, t);
+		spa_list_for_each(t, &n->follower_list, follower_link)
+			add_recalc(&queue, t);
+
+		spa_list_for_each(p, &n->input_ports, link)
+			spa_list_for_each(l, &p->links, input_link)
+				add_recalc(&queue, l->output->node);
+		spa_list_for_each(p, &n->output_ports, link)
+			spa_list_for_each(l, &p->links, output_link)
+				add_recalc(&queue, l->input->node);
+
+		if (n->groups != NULL || n->link_groups != NULL) {
+			spa_list_for_each(t, &context->node_list, link) {
+				if (t->recalc)
+					continue;
+				if (pw_strv_find_common(t->groups, n->groups) < 0 &&
+				    pw_strv_find_common(t->link_groups, n->link_groups) < 0)
+					continue;
+				add_recalc(&queue, t);
+			}
+		}
+	}
+	return n_nodes;
+}
+
 /* here we evaluate the complete state of the graph.
  *
  * It roughly operates in 3 stages:
@@ -1189,19 +1610,20 @@ static uint32_t find_best_rate(const uint32_t *rates, uint32_t n_rates, uint32_t
  * 3. go over all drivers again, collect the quantum/rate of all followers, select
  *    the desired final value and activate the followers and then the driver.
  *
- * A complete graph evaluation is performed for each change that is made to the
- * graph, such as making/destroying links, adding/removing nodes, property changes such
- * as quantum/rate changes or metadata changes.
+ * A complete graph evaluation is performed for changes that affect all drivers,
+ * such as settings changes. Other changes, such as making/destroying links,
+ * adding/removing nodes and node property changes, mark the changed nodes as
+ * dirty and only the driver groups connected to them are evaluated again.
  */
-int pw_context_recalc_graph(struct pw_context *context, const char *reason)
+static int recalc_graph(struct pw_context *context, const char *reason)
 {
 	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
 	struct settings *settings = &context->settings;
 	struct pw_impl_node *n, *s, *target, *fallback;
 	const uint32_t *rates;
 	uint32_t max_quantum, min_quantum, def_quantum, lim_quantum, rate_quantum;
-	uint32_t n_rates, def_rate;
-	bool freewheel = false, global_force_rate, global_force_quantum;
+	uint32_t i, n_rates, def_rate, n_nodes;
+	bool freewheel, global_force_rate, global_force_quantum, full;
 	struct spa_list collect;
 
 	pw_log_info("%p: busy:%d reason:%s", context, impl->recalc, reason);
@@ -1213,9 +1635,18 @@ int pw_context_recalc_graph(struct pw_context *context, const char *reason)
 
 again:
 	impl->recalc = true;
+	impl->n_visited = 0;
+	full = impl->recalc_full;
+	impl->recalc_full = false;
+	n_nodes = mark_recalc(context, full);
+
+restart:
+	freewheel = false;
 
 	/* clean up the flags first */
 	spa_list_for_each(n, &context->node_list, link) {
+		if (!n->recalc)
+			continue;
 		n->visited = false;
 		n->checked = 0;
 		n->runnable = n->always_process && n->active;
@@ -1236,7 +1667,7 @@ again:
 		if (n->exported)
 			continue;
 
-		if (!n->visited) {
+		if (n->recalc && !n->visited) {
 			spa_list_init(&collect);
 			collect_nodes(context, n, &collect);
 			move_to_driver(context, &collect, n);
@@ -1272,6 +1703,17 @@ again:
 	if (target == NULL)
 		target = fallback;
 
+	/* when the target for unassigned nodes changes, they might all need to
+	 * move, evaluate the complete graph */
+	if (!full && target != impl->recalc_target) {
+		pw_log_debug("%p: target changed %p -> %p, full recalc", context,
+				impl->recalc_target, target);
+		full = true;
+		n_nodes = mark_recalc(context, full);
+		goto restart;
+	}
+	impl->recalc_target = target;
+
 	/* update the freewheel status */
 	if (context->freewheeling != freewheel)
 		context_set_freewheel(context, freewheel);
@@ -1284,7 +1726,7 @@ again:
 	spa_list_for_each(n, &context->node_list, link) {
 		struct pw_impl_node *t, *driver;
 
-		if (n->exported || n->visited)
+		if (n->exported || n->visited || !n->recalc)
 			continue;
 
 		pw_log_debug("%p: unassigned node %p: '%s' active:%d want_driver:%d target:%p",
@@ -1305,6 +1747,7 @@ again:
 		}
 		if (driver != NULL) {
 			driver->runnable = true;
+			driver->recalc = true;
 			/* driver needed for this group */
 			move_to_driver(context, &collect, driver);
 		} else {
@@ -1327,6 +1770,10 @@ again:
 		uint32_t node_n_rates, node_def_rate;
 		uint32_t node_max_quantum, node_min_quantum, node_def_quantum, node_rate_quantum;
 
+		if (!n->recalc)
+			continue;
+
+		n->group_running = false;
 		if (!n->driving || n->exported)
 			continue;
 
@@ -1524,7 +1971,7 @@ again:
 			if (do_reconfigure) {
 				reconfigure_driver(context, n);
 				/* we might be suspended now and the links need to be prepared again */
-				goto again;
+				goto restart;
 			}
 			/* we have a pending change. We place the new values in the
 			 * pending fields so that they are picked up by the driver in
@@ -1562,7 +2009,22 @@ again:
 		}
 		/* now that all the followers are ready, start the driver */
 		ensure_state(n, running);
+
+		n->group_running = running;
 	}
+
+	for (i = 0; i < impl->n_data_loops; i++) {
+		impl->data_loops[i].n_drivers = 0;
+		impl->data_loops[i].n_followers = 0;
+	}
+	spa_list_for_each(n, &context->driver_list, driver_link) {
+		if (n->group_running && n->driving && !n->exported)
+			account_data_loop(impl, n);
+	}
+
+	pw_log_info("%p: recalc %s visited %u of %u nodes", context,
+			full ? "full" : "partial", impl->n_visited, n_nodes);
+
 	impl->recalc = false;
 	if (impl->recalc_pending) {
 		impl->recalc_pending = false;
@@ -1572,6 +2034,18 @@ again:
 	return 0;
 }
 
+int pw_context_recalc_graph(struct pw_context *context, const char *reason)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	impl->recalc_full = true;
+	return recalc_graph(context, reason);
+}
+
+int pw_context_recalc_graph_dirty(struct pw_context *context, const char *reason)
+{
+	return recalc_graph(context, reason);
+}
+
 SPA_EXPORT
 int pw_context_add_spa_lib(struct pw_context *context,
 		const char *factory_regexp, const char *lib)
@@ -1614,7 +2088,7 @@ struct spa_handle *pw_context_load_spa_handle(struct pw_context *context,
 		const char *factory_name,
 		const struct spa_dict *info)
 {
-	const char *lib;
+	const char *lib, *str;
 	const struct spa_support *support;
 	uint32_t n_support;
 	struct spa_handle *handle;
@@ -1633,6 +2107,29 @@ struct spa_handle *pw_context_load_spa_handle(struct pw_context *context,
 
 	support = pw_context_get_support(context, &n_support);
 
+	if (info != NULL &&
+	    (str = spa_dict_lookup(info, PW_KEY_NODE_LOOP_NAME)) != NULL) {
+		struct pw_data_loop *loop = pw_context_find_data_loop(context, str);
+		struct spa_support *s;
+		uint32_t i;
+
+		if (loop == NULL) {
+			pw_log_warn("%p: unknown data loop %s for %s, using default",
+					context, str, factory_name);
+		} else {
+			/* give the plugin the data loop the node will run on */
+			s = alloca(n_support * sizeof(struct spa_support));
+			memcpy(s, support, n_support * sizeof(struct spa_support));
+			for (i = 0; i < n_support; i++) {
+				if (spa_streq(s[i].type, SPA_TYPE_INTERFACE_DataLoop))
+					s[i].data = loop->loop->loop;
+				else if (spa_streq(s[i].type, SPA_TYPE_INTERFACE_DataSystem))
+					s[i].data = loop->loop->system;
+			}
+			support = s;
+		}
+	}
+
 	handle = pw_load_spa_handle(lib, factory_name,
 			info, n_support, support);
 
@@ -1698,9 +2195,10 @@ int pw_context_set_object(struct pw_context *context, const char *type, void *va
 		entry->value = value;
 	}
 	if (spa_streq(type, SPA_TYPE_INTERFACE_ThreadUtils)) {
+		uint32_t i;
 		context->thread_utils = value;
-		if (impl->data_loop_impl)
-			pw_data_loop_set_thread_utils(impl->data_loop_impl,
+		for (i = 0; i < impl->n_data_loops; i++)
+			pw_data_loop_set_thread_utils(impl->data_loops[i].impl,
 					context->thread_utils);
 	}
 	return 0;
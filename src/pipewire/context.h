@@ -125,6 +125,18 @@ struct pw_loop *pw_context_get_main_loop(struct pw_context *context);
 /** get the context data loop. Since 0.3.56 */
 struct pw_data_loop *pw_context_get_data_loop(struct pw_context *context);
 
+/** get the number of data loops of the context. Since 0.3.86 */
+uint32_t pw_context_get_n_data_loops(struct pw_context *context);
+
+/** find a data loop by name, NULL returns the default data loop. Since 0.3.86 */
+struct pw_data_loop *pw_context_find_data_loop(struct pw_context *context, const char *name);
+
+/** get the data loop a node with \a props should run on. When no node.loop.name
+ * is given and the node is a driver, the least busy data loop is selected
+ * and its name is placed in \a props. Since 0.3.86 */
+struct pw_data_loop *pw_context_place_data_loop(struct pw_context *context,
+		struct pw_properties *props);
+
 /** Get the work queue from the context: Since 0.3.26 */
 struct pw_work_queue *pw_context_get_work_queue(struct pw_context *context);
 
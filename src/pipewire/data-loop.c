@@ -111,6 +111,12 @@ static struct pw_data_loop *loop_new(struct pw_loop *loop, const struct spa_dict
 	if (props != NULL &&
 	    (str = spa_dict_lookup(props, "loop.cancel")) != NULL)
 		this->cancel = pw_properties_parse_bool(str);
+	if (props != NULL &&
+	    (str = spa_dict_lookup(props, PW_KEY_LOOP_NAME)) != NULL)
+		this->name = strdup(str);
+	if (props != NULL &&
+	    (str = spa_dict_lookup(props, SPA_KEY_THREAD_AFFINITY)) != NULL)
+		this->affinity = strdup(str);
 
 	spa_hook_list_init(&this->listener_list);
 
@@ -151,6 +157,8 @@ void pw_data_loop_destroy(struct pw_data_loop *loop)
 
 	spa_hook_list_clean(&loop->listener_list);
 
+	free(loop->name);
+	free(loop->affinity);
 	free(loop);
 }
 
@@ -183,12 +191,20 @@ int pw_data_loop_start(struct pw_data_loop *loop)
 	if (!loop->running) {
 		struct spa_thread_utils *utils;
 		struct spa_thread *thr;
+		struct spa_dict_item items[2];
+		uint32_t n_items = 0;
 
 		loop->running = true;
 
+		if (loop->name)
+			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_THREAD_NAME, loop->name);
+		if (loop->affinity)
+			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_THREAD_AFFINITY, loop->affinity);
+
 		if ((utils = loop->thread_utils) == NULL)
 			utils = pw_thread_utils_get();
-		thr = spa_thread_utils_create(utils, NULL, do_loop, loop);
+		thr = spa_thread_utils_create(utils, n_items > 0 ?
+				&SPA_DICT_INIT(items, n_items) : NULL, do_loop, loop);
 		loop->thread = (pthread_t)thr;
 		if (thr == NULL) {
 			pw_log_error("%p: can't create thread: %m", loop);
@@ -9,7 +9,11 @@
 extern "C" {
 #endif
 
+#include <errno.h>
+#include <string.h>
+
 #include <spa/utils/defs.h>
+#include <spa/utils/atomic.h>
 
 /** \defgroup pw_profiler Profiler
  * Profiler interface
@@ -21,7 +25,7 @@ extern "C" {
  */
 #define PW_TYPE_INTERFACE_Profiler		PW_TYPE_INFO_INTERFACE_BASE "Profiler"
 
-#define PW_VERSION_PROFILER			3
+#define PW_VERSION_PROFILER			4
 struct pw_profiler;
 
 #define PW_EXTENSION_MODULE_PROFILER		PIPEWIRE_MODULE_PREFIX "module-profiler"
@@ -29,16 +33,179 @@ struct pw_profiler;
 #define PW_PROFILER_PERM_MASK			PW_PERM_R
 
 #define PW_PROFILER_EVENT_PROFILE		0
-#define PW_PROFILER_EVENT_NUM			1
+#define PW_PROFILER_EVENT_RING			1
+#define PW_PROFILER_EVENT_NODE			2
+#define PW_PROFILER_EVENT_NUM			3
 
 /** \ref pw_profiler events */
 struct pw_profiler_events {
-#define PW_VERSION_PROFILER_EVENTS		0
+#define PW_VERSION_PROFILER_EVENTS		1
 	uint32_t version;
 
+	/**
+	 * Profiling data as a struct of Profiler objects. Not emitted to
+	 * resources of version 4 or newer, they receive the ring instead.
+	 */
 	void (*profile) (void *data, const struct spa_pod *pod);
+	/**
+	 * The shared memory ring with profiler records. Since version 1
+	 * of the events and version 4 of the interface.
+	 *
+	 * \param mem_id the memory id of the ring, map with pw_mempool_map_id()
+	 * \param offset offset of the \ref pw_profiler_ring in the memory
+	 * \param size size of the ring and the records
+	 */
+	void (*ring) (void *data, uint32_t mem_id, uint32_t offset, uint32_t size);
+	/**
+	 * The name of a node in the records. Emitted once for each node
+	 * before the records of the node appear in the ring. Since version 1
+	 * of the events and version 4 of the interface.
+	 */
+	void (*node) (void *data, uint32_t id, const char *name);
+};
+
+#define PW_PROFILER_RING_VERSION		0
+
+/** The header of the shared memory ring.
+ *
+ * The header is followed by n_records records of record_size bytes. The
+ * records of one cycle are written to consecutive indexes: a driver record
+ * followed by its n_followers follower records. Writers never wait for
+ * readers, readers that fall more than n_records behind lose records.
+ */
+struct pw_profiler_ring {
+	uint32_t version;			/**< PW_PROFILER_RING_VERSION */
+	uint32_t n_records;			/**< number of records, a power of 2 */
+	uint32_t record_size;			/**< size of a record, >= sizeof(struct pw_profiler_record) */
+	uint32_t write_index;			/**< index of the next record to claim */
+	uint32_t padding[12];
 };
 
+#define PW_PROFILER_RECORD_DRIVER		0
+#define PW_PROFILER_RECORD_FOLLOWER		1
+
+/** A profiler record in the ring */
+struct pw_profiler_record {
+	uint32_t seq;				/**< odd while the record is written */
+	uint32_t index;				/**< the ring index of the record */
+	uint32_t type;				/**< PW_PROFILER_RECORD_DRIVER or _FOLLOWER */
+	uint32_t id;				/**< node id */
+	uint32_t driver_id;			/**< id of the driver of the cycle */
+	int32_t status;				/**< activation status */
+	int64_t count;				/**< cycle counter of the driver */
+	int64_t prev_signal;			/**< previous signal time of the driver
+						  *  or signal time of the driver for
+						  *  followers */
+	int64_t signal;
+	int64_t awake;
+	int64_t finish;
+	struct spa_fraction latency;
+	uint32_t xrun_count;
+	uint32_t n_followers;			/**< driver: number of follower records */
+
+	/* only valid in driver records */
+	float cpu_load[3];
+	uint32_t clock_flags;
+	int64_t clock_nsec;
+	struct spa_fraction clock_rate;
+	uint64_t clock_position;
+	uint64_t clock_duration;
+	int64_t clock_delay;
+	double clock_rate_diff;
+	uint64_t clock_next_nsec;
+
+	/* latency histograms of the node in nanoseconds: p50, p99, p99.9
+	 * and max, all 0 when the node has no histograms */
+	uint64_t wakeup_hist[4];		/**< signal to awake */
+	uint64_t process_hist[4];		/**< awake to finish */
+	uint64_t cycle_hist[4];			/**< driver start to finish */
+};
+
+/** The record at \a index in a ring with \a mask + 1 records of \a stride bytes */
+#define PW_PROFILER_RING_RECORD(r,mask,stride,index)	SPA_PTROFF((r), sizeof(struct pw_profiler_ring) + \
+		((index) & (mask)) * (stride), struct pw_profiler_record)
+
+/** A reader of the ring.
+ *
+ * All clients of the profiler can map the ring, the layout is taken from
+ * the header only once and checked against the size of the mapping.
+ */
+struct pw_profiler_ring_reader {
+	struct pw_profiler_ring *ring;
+	uint32_t n_records;
+	uint32_t record_size;
+	uint32_t index;				/**< index of the next record to read */
+};
+
+/**
+ * Start reading the ring of \a size bytes at \a data from the next
+ * record that is written.
+ *
+ * \return 0 on success or -EINVAL when the ring is not valid.
+ */
+static inline int pw_profiler_ring_reader_init(struct pw_profiler_ring_reader *reader,
+		void *data, size_t size)
+{
+	struct pw_profiler_ring *ring = (struct pw_profiler_ring *)data;
+	uint32_t n_records, record_size;
+
+	if (size < sizeof(*ring))
+		return -EINVAL;
+
+	n_records = SPA_ATOMIC_LOAD(ring->n_records);
+	record_size = SPA_ATOMIC_LOAD(ring->record_size);
+	if (record_size < sizeof(struct pw_profiler_record) ||
+	    n_records == 0 || (n_records & (n_records - 1)) ||
+	    (size - sizeof(*ring)) / record_size < n_records)
+		return -EINVAL;
+
+	reader->ring = ring;
+	reader->n_records = n_records;
+	reader->record_size = record_size;
+	reader->index = SPA_ATOMIC_LOAD(ring->write_index);
+	return 0;
+}
+
+/**
+ * Read the next record into \a rec.
+ *
+ * \return 1 when a record was read, 0 when the record was not written yet
+ * or -EPIPE when records were overwritten before they were read. The reader
+ * then moves to the oldest record.
+ */
+static inline int pw_profiler_ring_read(struct pw_profiler_ring_reader *reader,
+		struct pw_profiler_record *rec)
+{
+	struct pw_profiler_record *r;
+	uint32_t s1, s2, windex;
+
+	windex = SPA_ATOMIC_LOAD(reader->ring->write_index);
+	if (windex - reader->index > reader->n_records) {
+		reader->index = windex - reader->n_records;
+		return -EPIPE;
+	}
+	if (windex == reader->index)
+		return 0;
+
+	r = PW_PROFILER_RING_RECORD(reader->ring, reader->n_records - 1,
+			reader->record_size, reader->index);
+	s1 = SPA_SEQ_READ(r->seq);
+	memcpy(rec, r, sizeof(*rec));
+	s2 = SPA_SEQ_READ(r->seq);
+
+	if (!SPA_SEQ_READ_SUCCESS(s1, s2) || rec->index != reader->index) {
+		/* not written yet or being overwritten */
+		windex = SPA_ATOMIC_LOAD(reader->ring->write_index);
+		if (windex - reader->index > reader->n_records) {
+			reader->index = windex - reader->n_records;
+			return -EPIPE;
+		}
+		return 0;
+	}
+	reader->index++;
+	return 1;
+}
+
 #define PW_PROFILER_METHOD_ADD_LISTENER		0
 #define PW_PROFILER_METHOD_NUM			1
 
@@ -89,6 +89,9 @@ static void pw_node_peer_unref(struct pw_node_peer *peer)
 	free(peer);
 }
 
+/* called from the data loop of the output node, the only thread that uses
+ * its target list. The required count of the input node is also changed
+ * by the loop of its driver so it is updated atomically. */
 static void pw_node_peer_activate(struct pw_node_peer *peer)
 {
 	struct pw_node_activation_state *state;
@@ -98,7 +101,7 @@ static void pw_node_peer_activate(struct pw_node_peer *peer)
 	if (peer->active_count++ == 0) {
 		spa_list_append(&peer->output->rt.target_list, &peer->target.link);
 		if (!peer->target.active && peer->output->rt.driver_target.node != NULL) {
-			state->required++;
+			SPA_ATOMIC_INC(state->required);
 			peer->target.active = true;
 		}
 	}
@@ -115,7 +118,7 @@ static void pw_node_peer_deactivate(struct pw_node_peer *peer)
 		spa_list_remove(&peer->target.link);
 
 		if (peer->target.active) {
-			state->required--;
+			SPA_ATOMIC_DEC(state->required);
 			peer->target.active = false;
 		}
 	}
@@ -140,6 +143,15 @@ static void info_changed(struct pw_impl_link *link)
 	link->info.change_mask = 0;
 }
 
+/* the nodes on both sides of the link need to be evaluated again */
+static inline void mark_dirty(struct pw_impl_link *link)
+{
+	if (link->output != NULL)
+		link->output->node->recalc_dirty = true;
+	if (link->input != NULL)
+		link->input->node->recalc_dirty = true;
+}
+
 static inline void input_set_busy_id(struct pw_impl_link *link, uint32_t id)
 {
 	struct impl *impl = SPA_CONTAINER_OF(link, struct impl, this);
@@ -210,11 +222,13 @@ static void link_update_state(struct pw_impl_link *link, enum pw_link_state stat
 	if (old < PW_LINK_STATE_PAUSED && state == PW_LINK_STATE_PAUSED) {
 		link->prepared = true;
 		link->preparing = false;
-		pw_context_recalc_graph(link->context, "link prepared");
+		mark_dirty(link);
+		pw_context_recalc_graph_dirty(link->context, "link prepared");
 	} else if (old == PW_LINK_STATE_PAUSED && state < PW_LINK_STATE_PAUSED) {
 		link->prepared = false;
 		link->preparing = false;
-		pw_context_recalc_graph(link->context, "link unprepared");
+		mark_dirty(link);
+		pw_context_recalc_graph_dirty(link->context, "link unprepared");
 	} else if (state == PW_LINK_STATE_INIT) {
 		link->prepared = false;
 		link->preparing = false;
@@ -586,8 +600,10 @@ static int do_allocation(struct pw_impl_link *this)
 		uint32_t flags, alloc_flags;
 
 		flags = 0;
-		/* always shared buffers for the link */
-		alloc_flags = PW_BUFFERS_FLAG_SHARED;
+		/* always shared buffers for the link. The memory can be reused
+		 * when the link renegotiates, the nodes flush it when they are
+		 * destroyed. */
+		alloc_flags = PW_BUFFERS_FLAG_SHARED | PW_BUFFERS_FLAG_RECYCLE;
 		if (output->node->remote || input->node->remote)
 			alloc_flags |= PW_BUFFERS_FLAG_SHARED_MEM;
 
@@ -1583,6 +1599,9 @@ void pw_impl_link_destroy(struct pw_impl_link *link)
 
 	try_unlink_controls(impl, link->output, link->input);
 
+	if (was_prepared)
+		mark_dirty(link);
+
 	output_remove(link, link->output);
 	input_remove(link, link->input);
 
@@ -1592,7 +1611,7 @@ void pw_impl_link_destroy(struct pw_impl_link *link)
 	}
 
 	if (was_prepared)
-		pw_context_recalc_graph(link->context, "link destroy");
+		pw_context_recalc_graph_dirty(link->context, "link destroy");
 
 	pw_log_debug("%p: free", impl);
 	pw_impl_link_emit_free(link);
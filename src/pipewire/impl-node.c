@@ -70,25 +70,43 @@ struct resource_data {
 
 /** \endcond */
 
-/* Called from the node data loop when a node needs to be scheduled by
- * the given driver. 3 things needs to happen:
+/* Nodes of one driver can run on different data loops. A target list is
+ * only changed from the data loop of the thread that walks it: the list of
+ * followers from the driver data loop and the targets of a node from the
+ * node data loop. Adding a node to a driver is therefore done in 2 steps
+ * that are invoked one after the other from the main thread:
  *
  * - the node is added to the driver target list and the required state
  *   is incremented. This makes sure the node is woken up when the driver
  *   starts a new cycle.
  * - the node needs to trigger the driver when it completes. This means
- *   the driver is added to the target list.
- * - the node targets (including the driver we added above) have their
- *   required state incremented.
+ *   the driver is added to the target list and the node targets (including
+ *   the driver) have their required state incremented.
  *
- * This code is called from the data-loop to ensure synchronization
+ * The required state of a node can be changed from both loops so it is
+ * updated atomically. A step never waits for another loop so the data
+ * loops can't deadlock on each other.
  */
-static void add_node(struct pw_impl_node *this, struct pw_impl_node *driver)
+static inline void target_activate(struct pw_node_target *t)
 {
-	struct pw_node_activation_state *dstate, *nstate;
-	struct pw_node_target *t;
+	if (!t->active) {
+		SPA_ATOMIC_INC(t->activation->state[0].required);
+		t->active = true;
+	}
+}
 
-	if (this->exported)
+static inline void target_deactivate(struct pw_node_target *t)
+{
+	if (t->active) {
+		SPA_ATOMIC_DEC(t->activation->state[0].required);
+		t->active = false;
+	}
+}
+
+/* called from the driver data loop */
+static void add_follower(struct pw_impl_node *this, struct pw_impl_node *driver)
+{
+	if (this->exported || this->rt.target.active)
 		return;
 
 	pw_log_trace("%p: add to driver %p %p %p", this, driver,
@@ -96,11 +114,28 @@ static void add_node(struct pw_impl_node *this, struct pw_impl_node *driver)
 
 	/* let the driver trigger us as part of the processing cycle */
 	spa_list_append(&driver->rt.target_list, &this->rt.target.link);
-	nstate = &this->rt.target.activation->state[0];
-	if (!this->rt.target.active) {
-		nstate->required++;
-		this->rt.target.active = true;
-	}
+	target_activate(&this->rt.target);
+}
+
+/* called from the data loop of the driver we were added to */
+static void remove_follower(struct pw_impl_node *this)
+{
+	if (this->exported || !this->rt.target.active)
+		return;
+
+	pw_log_trace("%p: remove from driver %p", this, this->rt.target.activation);
+
+	spa_list_remove(&this->rt.target.link);
+	target_deactivate(&this->rt.target);
+}
+
+/* called from the node data loop */
+static void add_targets(struct pw_impl_node *this, struct pw_impl_node *driver)
+{
+	struct pw_node_target *t;
+
+	if (this->exported)
+		return;
 
 	/* trigger the driver when we complete */
 	copy_target(&this->rt.driver_target, &driver->rt.target);
@@ -109,53 +144,51 @@ static void add_node(struct pw_impl_node *this, struct pw_impl_node *driver)
 	/* now increment the required states of all this node targets, including
 	 * the driver we added above */
 	spa_list_for_each(t, &this->rt.target_list, link) {
-		dstate = &t->activation->state[0];
-		if (!t->active) {
-			dstate->required++;
-			t->active = true;
-		}
-		pw_log_trace("%p: driver state:%p pending:%d/%d, node state:%p pending:%d/%d",
-				this, dstate, dstate->pending, dstate->required,
-				nstate, nstate->pending, nstate->required);
+		target_activate(t);
+		pw_log_trace("%p: target state:%p pending:%d/%d", this,
+				&t->activation->state[0], t->activation->state[0].pending,
+				t->activation->state[0].required);
 	}
 }
 
-/* called from the data loop and undoes the changes done in add_node.  */
-static void remove_node(struct pw_impl_node *this)
+/* called from the node data loop and undoes the changes done in add_targets. */
+static void remove_targets(struct pw_impl_node *this)
 {
-	struct pw_node_activation_state *dstate, *nstate;
 	struct pw_node_target *t;
 
 	if (this->exported)
 		return;
 
-	pw_log_trace("%p: remove from driver %s %p %p",
-			this, this->rt.driver_target.name,
-			this->rt.driver_target.activation, this->rt.target.activation);
-
-	spa_list_remove(&this->rt.target.link);
-
-	nstate = &this->rt.target.activation->state[0];
-	if (this->rt.target.active) {
-		nstate->required--;
-		this->rt.target.active = false;
-	}
-
 	spa_list_for_each(t, &this->rt.target_list, link) {
-		dstate = &t->activation->state[0];
-		if (t->active) {
-			dstate->required--;
-			t->active = false;
-		}
-		pw_log_trace("%p: driver state:%p pending:%d/%d, node state:%p pending:%d/%d",
-				this, dstate, dstate->pending, dstate->required,
-				nstate, nstate->pending, nstate->required);
+		target_deactivate(t);
+		pw_log_trace("%p: target state:%p pending:%d/%d", this,
+				&t->activation->state[0], t->activation->state[0].pending,
+				t->activation->state[0].required);
 	}
 	spa_list_remove(&this->rt.driver_target.link);
 
 	spa_zero(this->rt.driver_target);
 }
 
+static int
+do_add_follower(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct pw_impl_node *this = user_data;
+	struct pw_impl_node *driver = *(struct pw_impl_node **)data;
+	add_follower(this, driver);
+	return 0;
+}
+
+static int
+do_remove_follower(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct pw_impl_node *this = user_data;
+	remove_follower(this);
+	return 0;
+}
+
 static int
 do_node_add(struct spa_loop *loop, bool async, uint32_t seq,
 		const void *data, size_t size, void *user_data)
@@ -175,8 +208,8 @@ do_node_add(struct spa_loop *loop, bool async, uint32_t seq,
 		this->added = true;
 		/* remote nodes have their source added in client-node instead */
 		if (!this->remote)
-			spa_loop_add_source(loop, &this->source);
-		add_node(this, driver);
+			spa_loop_add_source(this->data_loop->loop, &this->source);
+		add_targets(this, driver);
 	}
 	return 0;
 }
@@ -188,13 +221,39 @@ do_node_remove(struct spa_loop *loop, bool async, uint32_t seq,
 	struct pw_impl_node *this = user_data;
 	if (this->added) {
 		if (!this->remote)
-			spa_loop_remove_source(loop, &this->source);
-		remove_node(this);
+			spa_loop_remove_source(this->data_loop->loop, &this->source);
+		remove_targets(this);
 		this->added = false;
 	}
 	return 0;
 }
 
+/* The driver starts to trigger the node before the node triggers the
+ * driver. Until the second step the node runs without being waited for. */
+static void node_add(struct pw_impl_node *this)
+{
+	struct pw_impl_node *driver = this->driver_node;
+
+	if (this->added)
+		return;
+
+	pw_loop_invoke(driver->data_loop, do_add_follower, SPA_ID_INVALID,
+			&driver, sizeof(struct pw_impl_node *), true, this);
+	pw_loop_invoke(this->data_loop, do_node_add, SPA_ID_INVALID, NULL, 0, true, this);
+}
+
+/* The reverse of node_add, the driver stops waiting for the node before
+ * it stops triggering the node. */
+static void node_remove(struct pw_impl_node *this)
+{
+	if (!this->added)
+		return;
+
+	pw_loop_invoke(this->data_loop, do_node_remove, SPA_ID_INVALID, NULL, 0, true, this);
+	pw_loop_invoke(this->driver_node->data_loop, do_remove_follower, SPA_ID_INVALID,
+			NULL, 0, true, this);
+}
+
 static void node_deactivate(struct pw_impl_node *this)
 {
 	struct pw_impl_port *port;
@@ -203,7 +262,7 @@ static void node_deactivate(struct pw_impl_node *this)
 	pw_log_debug("%p: deactivate", this);
 
 	/* make sure the node doesn't get woken up while not active */
-	pw_loop_invoke(this->data_loop, do_node_remove, 1, NULL, 0, true, this);
+	node_remove(this);
 
 	spa_list_for_each(port, &this->input_ports, link) {
 		spa_list_for_each(link, &port->links, input_link)
@@ -372,7 +431,7 @@ static void node_update_state(struct pw_impl_node *node, enum pw_node_state stat
 				node->driving, node->driver, node->added);
 
 		if (res >= 0) {
-			pw_loop_invoke(node->data_loop, do_node_add, 1, NULL, 0, true, node);
+			node_add(node);
 		}
 		if (node->driving && node->driver) {
 			res = spa_node_send_command(node->node,
@@ -380,7 +439,7 @@ static void node_update_state(struct pw_impl_node *node, enum pw_node_state stat
 			if (res < 0) {
 				state = PW_NODE_STATE_ERROR;
 				error = spa_aprintf("Start error: %s", spa_strerror(res));
-				pw_loop_invoke(node->data_loop, do_node_remove, 1, NULL, 0, true, node);
+				node_remove(node);
 			}
 		}
 		break;
@@ -388,7 +447,7 @@ static void node_update_state(struct pw_impl_node *node, enum pw_node_state stat
 	case PW_NODE_STATE_SUSPENDED:
 	case PW_NODE_STATE_ERROR:
 		if (state != PW_NODE_STATE_IDLE || node->pause_on_idle)
-			pw_loop_invoke(node->data_loop, do_node_remove, 1, NULL, 0, true, node);
+			node_remove(node);
 		break;
 	default:
 		break;
@@ -807,8 +866,10 @@ int pw_impl_node_register(struct pw_impl_node *this,
 	spa_list_for_each(port, &this->output_ports, link)
 		pw_impl_port_register(port, NULL);
 
-	if (this->active)
-		pw_context_recalc_graph(context, "register active node");
+	if (this->active) {
+		this->recalc_dirty = true;
+		pw_context_recalc_graph_dirty(context, "register active node");
+	}
 
 	return 0;
 
@@ -843,8 +904,8 @@ do_move_nodes(struct spa_loop *loop,
 	node->target_quantum = node->rt.position->clock.target_duration;
 
 	if (node->added) {
-		remove_node(node);
-		add_node(node, driver);
+		remove_targets(node);
+		add_targets(node, driver);
 	}
 	return 0;
 }
@@ -901,9 +962,16 @@ int pw_impl_node_set_driver(struct pw_impl_node *node, struct pw_impl_node *driv
 		pw_log_debug("%p: set position: %s", node, spa_strerror(res));
 	}
 
-	pw_loop_invoke(node->data_loop,
-		       do_move_nodes, SPA_ID_INVALID, &driver, sizeof(struct pw_impl_node *),
-		       true, impl);
+	/* move the node to the follower list of the new driver first, until
+	 * the node is moved it completes the cycle of the old driver. */
+	if (node->added) {
+		pw_loop_invoke(old->data_loop, do_remove_follower, SPA_ID_INVALID,
+				NULL, 0, true, node);
+		pw_loop_invoke(driver->data_loop, do_add_follower, SPA_ID_INVALID,
+				&driver, sizeof(struct pw_impl_node *), true, node);
+	}
+	pw_loop_invoke(node->data_loop, do_move_nodes, SPA_ID_INVALID,
+			&driver, sizeof(struct pw_impl_node *), true, impl);
 
 	pw_impl_node_emit_driver_changed(node, old, driver);
 
@@ -961,9 +1029,9 @@ static void check_properties(struct pw_impl_node *node)
 	if (trigger != node->trigger) {
 		node->trigger = trigger;
 		if (trigger)
-			node->rt.target.activation->state[0].required++;
+			SPA_ATOMIC_INC(node->rt.target.activation->state[0].required);
 		else
-			node->rt.target.activation->state[0].required--;
+			SPA_ATOMIC_DEC(node->rt.target.activation->state[0].required);
 	}
 
 	/* group defines what nodes are scheduled together */
@@ -1075,8 +1143,10 @@ static void check_properties(struct pw_impl_node *node)
 	pw_log_debug("%p: driver:%d recalc:%s active:%d", node, node->driver,
 			recalc_reason, node->active);
 
-	if (recalc_reason != NULL && node->active)
-		pw_context_recalc_graph(context, recalc_reason);
+	if (recalc_reason != NULL && node->active) {
+		node->recalc_dirty = true;
+		pw_context_recalc_graph_dirty(context, recalc_reason);
+	}
 }
 
 static const char *str_status(uint32_t status)
@@ -1129,6 +1199,16 @@ static void check_states(struct pw_impl_node *driver, uint64_t nsec)
 				(uint32_t)(cl->rate.num * cl->duration), cl->rate.denom,
 				cl->position, str_status(a->status),
 				suppressed);
+			if (t->node != NULL)
+				pw_log(level, "(%s-%u) cycle p50:%"PRIu64" p99:%"PRIu64" p99.9:%"PRIu64
+					" process p99:%"PRIu64" wakeup p99:%"PRIu64" max:%"PRIu64,
+					t->name, t->id,
+					pw_node_hist_percentile(&t->node->rt.cycle_hist, 0.5),
+					pw_node_hist_percentile(&t->node->rt.cycle_hist, 0.99),
+					pw_node_hist_percentile(&t->node->rt.cycle_hist, 0.999),
+					pw_node_hist_percentile(&t->node->rt.process_hist, 0.99),
+					pw_node_hist_percentile(&t->node->rt.wakeup_hist, 0.99),
+					t->node->rt.cycle_hist.max);
 		}
 		pw_log_debug("(%s-%u) state:%p pending:%d/%d s:%"PRIu64" a:%"PRIu64" f:%"PRIu64
 				" waiting:%"PRIu64" process:%"PRIu64" status:%s sync:%d",
@@ -1157,8 +1237,21 @@ static inline void node_trigger(struct pw_impl_node *this)
 		pw_log_warn("node %p: write failed %m", this);
 }
 
-/* called from data-loop when all the targets of a node need to be triggered */
-static inline int trigger_targets(struct pw_impl_node *this, int status, uint64_t nsec)
+/* A target can be processed from the current thread, without a wakeup through
+ * its eventfd, when it is implemented in this process, runs on the same data
+ * loop and is not driving. Drivers are always woken up with their eventfd
+ * because they are usually triggered from their own ready callback. */
+static inline bool target_is_local(struct pw_impl_node *this, struct pw_node_target *t)
+{
+	struct pw_impl_node *n = t->node;
+	return n != NULL && n->data_loop == this->data_loop &&
+		!n->remote && !n->exported && !n->driving && n->added;
+}
+
+/* called from data-loop when all the targets of a node need to be triggered.
+ * Local targets are added to queue when not NULL. */
+static inline int trigger_targets(struct pw_impl_node *this, int status, uint64_t nsec,
+		struct spa_list *queue)
 {
 	struct pw_node_target *t;
 
@@ -1174,7 +1267,9 @@ static inline int trigger_targets(struct pw_impl_node *this, int status, uint64_
 		if (pw_node_activation_state_dec(state)) {
 			a->status = PW_NODE_ACTIVATION_TRIGGERED;
 			a->signal_time = nsec;
-			if (SPA_UNLIKELY(spa_system_eventfd_write(t->system, t->fd, 1) < 0))
+			if (queue != NULL && target_is_local(this, t))
+				spa_list_append(queue, &t->node->rt.run_link);
+			else if (SPA_UNLIKELY(spa_system_eventfd_write(t->system, t->fd, 1) < 0))
 				pw_log_warn("node %p: write failed %m", this);
 		}
 	}
@@ -1202,14 +1297,34 @@ static inline void calculate_stats(struct pw_impl_node *this,  struct pw_node_ac
 			a->cpu_load[0], a->cpu_load[1], a->cpu_load[2]);
 }
 
+/* update the latency histograms of the driver and the followers that
+ * completed in this cycle. This is called from the driver thread at the
+ * end of the cycle so there is only one writer for each node. */
+static inline void update_hists(struct pw_impl_node *driver, uint64_t start)
+{
+	struct pw_node_target *t;
+
+	spa_list_for_each(t, &driver->rt.target_list, link) {
+		struct pw_node_activation *a = t->activation;
+		struct pw_impl_node *n = t->node;
+
+		if (n == NULL || a->status != PW_NODE_ACTIVATION_FINISHED ||
+		    a->finish_time < start || a->awake_time < a->signal_time)
+			continue;
+
+		pw_node_hist_add(&n->rt.wakeup_hist, a->awake_time - a->signal_time);
+		pw_node_hist_add(&n->rt.process_hist, a->finish_time - a->awake_time);
+		pw_node_hist_add(&n->rt.cycle_hist, a->finish_time - start);
+	}
+}
+
 /* The main processing entry point of a node. This is called from the data-loop and usually
  * as a result of signaling the eventfd of the node.
  *
  * This code runs on the client and the server, depending on where the node is.
  */
-static inline int process_node(void *data)
+static inline int process_node(struct pw_impl_node *this, struct spa_list *queue)
 {
-	struct pw_impl_node *this = data;
 	struct pw_impl_port *p;
 	struct pw_node_activation *a = this->rt.target.activation;
 	struct spa_system *data_system = this->data_system;
@@ -1257,11 +1372,12 @@ static inline int process_node(void *data)
 	/* we don't need to trigger targets when the node was driving the
 	 * graph because that means we finished the graph. */
 	if (SPA_LIKELY(!this->driving)) {
-		trigger_targets(this, status, nsec);
+		trigger_targets(this, status, nsec, queue);
 	} else {
 		/* calculate CPU time when finished */
 		a->signal_time = this->driver_start;
 		calculate_stats(this, a);
+		update_hists(this, this->driver_start);
 		pw_impl_node_rt_emit_complete(this);
 //		pw_context_driver_emit_complete(this->context, this);
 	}
@@ -1286,9 +1402,21 @@ int pw_impl_node_trigger(struct pw_impl_node *node)
 	return 0;
 }
 
+/* process the nodes that were made ready by a node in this thread */
+static inline void process_queue(struct spa_list *queue)
+{
+	struct pw_impl_node *n;
+
+	spa_list_consume(n, queue, rt.run_link) {
+		spa_list_remove(&n->rt.run_link);
+		process_node(n, queue);
+	}
+}
+
 static void node_on_fd_events(struct spa_source *source)
 {
 	struct pw_impl_node *this = source->data;
+	struct spa_list queue;
 
 	if (SPA_UNLIKELY(source->rmask & (SPA_IO_ERR | SPA_IO_HUP))) {
 		pw_log_warn("%p: got socket error %08x", this, source->rmask);
@@ -1305,7 +1433,9 @@ static void node_on_fd_events(struct spa_source *source)
 
 		pw_log_trace_fp("%p: remote:%u exported:%u %s got process", this, this->remote,
 				this->exported, this->name);
-		process_node(this);
+		spa_list_init(&queue);
+		process_node(this, &queue);
+		process_queue(&queue);
 	}
 }
 
@@ -1339,6 +1469,19 @@ static void reset_position(struct pw_impl_node *this, struct spa_io_position *po
 		reset_segment(&pos->segments[i]);
 }
 
+static void free_activation(struct pw_impl_node *node)
+{
+	if (node->activation_slab != NULL) {
+		pw_memslab_free(node->activation_slab,
+				node->activation, node->activation_offset);
+		pw_context_release_activation_slab(node->context, node->activation_slab);
+		node->activation_slab = NULL;
+	} else {
+		pw_memblock_unref(node->activation);
+	}
+	node->activation = NULL;
+}
+
 SPA_EXPORT
 struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 			    struct pw_properties *properties,
@@ -1346,6 +1489,7 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 {
 	struct impl *impl;
 	struct pw_impl_node *this;
+	struct pw_data_loop *data_loop;
 	size_t size;
 	int res;
 
@@ -1361,9 +1505,7 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 	this = &impl->this;
 	this->context = context;
 	this->name = strdup("node");
-
-	this->data_loop = pw_context_get_data_loop(context)->loop;
-	this->data_system = this->data_loop->system;
+	this->source.fd = -1;
 
 	if (user_data_size > 0)
                 this->user_data = SPA_PTROFF(impl, sizeof(struct impl), void);
@@ -1377,6 +1519,14 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 
 	this->properties = properties;
 
+	if ((data_loop = pw_context_place_data_loop(context, properties)) == NULL) {
+		pw_log_warn("%p: unknown data loop %s, using default", this,
+				pw_properties_get(properties, PW_KEY_NODE_LOOP_NAME));
+		data_loop = pw_context_get_data_loop(context);
+	}
+	this->data_loop = data_loop->loop;
+	this->data_system = this->data_loop->system;
+
 	/* the eventfd used to signal the node */
 	if ((res = spa_system_eventfd_create(this->data_system,
 					SPA_FD_CLOEXEC | SPA_FD_NONBLOCK)) < 0)
@@ -1392,11 +1542,19 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 
 	size = sizeof(struct pw_node_activation);
 
-	this->activation = pw_mempool_alloc(this->context->pool,
-			PW_MEMBLOCK_FLAG_READWRITE |
-			PW_MEMBLOCK_FLAG_SEAL |
-			PW_MEMBLOCK_FLAG_MAP,
-			SPA_DATA_MemFd, size);
+	this->activation_slab = pw_context_acquire_activation_slab(context,
+			&properties->dict);
+	if (this->activation_slab != NULL) {
+		this->activation = pw_memslab_alloc(this->activation_slab,
+				&this->activation_offset);
+	} else {
+		this->activation = pw_mempool_alloc(this->context->pool,
+				PW_MEMBLOCK_FLAG_READWRITE |
+				PW_MEMBLOCK_FLAG_SEAL |
+				PW_MEMBLOCK_FLAG_MAP,
+				SPA_DATA_MemFd, size);
+		this->activation_offset = 0;
+	}
 	if (this->activation == NULL) {
 		res = -errno;
                 goto error_clean;
@@ -1424,7 +1582,8 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 	spa_list_init(&this->rt.output_mix);
 	spa_list_init(&this->rt.target_list);
 
-	this->rt.target.activation = this->activation->map->ptr;
+	this->rt.target.activation = SPA_PTROFF(this->activation->map->ptr,
+			this->activation_offset, struct pw_node_activation);
 	this->rt.target.node = this;
 	this->rt.target.system = this->data_system;
 	this->rt.target.fd = this->source.fd;
@@ -1446,7 +1605,9 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 
 error_clean:
 	if (this->activation)
-		pw_memblock_unref(this->activation);
+		free_activation(this);
+	else if (this->activation_slab)
+		pw_context_release_activation_slab(context, this->activation_slab);
 	if (this->source.fd != -1)
 		spa_system_close(this->data_system, this->source.fd);
 	free(impl);
@@ -1572,8 +1733,10 @@ static void node_info(void *data, const struct spa_node_info *info)
 	if (n_changed_ids > 0)
 		emit_params(node, changed_ids, n_changed_ids);
 
-	if (flags_changed)
-		pw_context_recalc_graph(node->context, "node flags changed");
+	if (flags_changed) {
+		node->recalc_dirty = true;
+		pw_context_recalc_graph_dirty(node->context, "node flags changed");
+	}
 }
 
 static void node_port_info(void *data, enum spa_direction direction, uint32_t port_id,
@@ -1765,6 +1928,7 @@ static int node_ready(void *data, int status)
 	struct spa_system *data_system = node->data_system;
 	struct pw_node_target *t, *reposition_target = NULL;;
 	struct pw_impl_port *p;
+	struct spa_list queue;
 	uint64_t nsec;
 
 	pw_log_trace_fp("%p: ready driver:%d exported:%d %p status:%d added:%d", node,
@@ -1881,8 +2045,11 @@ again:
 		spa_list_for_each(p, &node->rt.output_mix, rt.node_link)
 			spa_node_process_fast(p->mix);
 	}
-	/* now signal all the nodes we drive */
-	return trigger_targets(node, status, nsec);
+	/* now signal all the nodes we drive and run the ones that are local */
+	spa_list_init(&queue);
+	trigger_targets(node, status, nsec, &queue);
+	process_queue(&queue);
+	return 0;
 }
 
 static int node_reuse_buffer(void *data, uint32_t port_id, uint32_t buffer_id)
@@ -2051,6 +2218,7 @@ void pw_impl_node_destroy(struct pw_impl_node *node)
 
 	pw_log_debug("%p: driver node %p", impl, node->driver_node);
 	had_driver = node != node->driver_node;
+	node->driver_node->recalc_dirty = true;
 
 	/* remove ourself as a follower from the driver node */
 	spa_list_remove(&node->follower_link);
@@ -2084,8 +2252,13 @@ void pw_impl_node_destroy(struct pw_impl_node *node)
 		pw_global_destroy(node->global);
 	}
 
-	if (active || had_driver)
+	/* a driver can be the target for unassigned nodes, evaluate the
+	 * complete graph when it goes away. */
+	if ((active || had_driver) && node->driver)
 		pw_context_recalc_graph(context,
+				"active driver destroy");
+	else if (active || had_driver)
+		pw_context_recalc_graph_dirty(context,
 				"active node destroy");
 
 	pw_log_debug("%p: free", node);
@@ -2093,7 +2266,11 @@ void pw_impl_node_destroy(struct pw_impl_node *node)
 
 	spa_hook_list_clean(&node->listener_list);
 
-	pw_memblock_unref(node->activation);
+	free_activation(node);
+
+	/* the buffer memory of our links can't be reused for other nodes */
+	if (node->node)
+		pw_mempool_flush_cache(context->pool, node->node);
 
 	pw_param_clear(&impl->param_list, SPA_ID_INVALID);
 	pw_param_clear(&impl->pending_list, SPA_ID_INVALID);
@@ -2464,11 +2641,13 @@ int pw_impl_node_set_active(struct pw_impl_node *node, bool active)
 		node->active = active;
 		pw_impl_node_emit_active_changed(node, active);
 
-		if (node->registered)
-			pw_context_recalc_graph(node->context,
+		if (node->registered) {
+			node->recalc_dirty = true;
+			pw_context_recalc_graph_dirty(node->context,
 					active ? "node activate" : "node deactivate");
+		}
 		else if (!active && node->exported)
-			pw_loop_invoke(node->data_loop, do_node_remove, 1, NULL, 0, true, node);
+			node_remove(node);
 	}
 	return 0;
 }
@@ -67,6 +67,12 @@ extern "C" {
 #define PW_KEY_CONTEXT_PROFILE_MODULES	"context.profile.modules"	/**< a context profile for modules, deprecated */
 #define PW_KEY_USER_NAME		"context.user-name"	/**< The user name that runs pipewire */
 #define PW_KEY_HOST_NAME		"context.host-name"	/**< The host name of the machine */
+#define PW_KEY_CONTEXT_NUM_DATA_LOOPS	"context.num-data-loops"	/**< Number of data loops to create.
+								  *  Default 1, -1 uses one data loop per
+								  *  CPU core. */
+
+/* loop */
+#define PW_KEY_LOOP_NAME		"loop.name"		/**< the name of a loop */
 
 /* core */
 #define PW_KEY_CORE_NAME		"core.name"		/**< The name of the core. Default is
@@ -170,6 +176,14 @@ extern "C" {
 #define PW_KEY_NODE_CACHE_PARAMS	"node.cache-params"	/**< cache the node params */
 #define PW_KEY_NODE_TRANSPORT_SYNC	"node.transport.sync"	/**< the node handles transport sync */
 #define PW_KEY_NODE_DRIVER		"node.driver"		/**< node can drive the graph */
+#define PW_KEY_NODE_LOOP_NAME		"node.loop.name"	/**< the name of the data loop the node
+								  *  runs on. Drivers without a loop name are
+								  *  placed on the least busy data loop. A
+								  *  pattern such as "data-loop.*" places the
+								  *  node on the least busy matching loop so
+								  *  that independent nodes of one driver can
+								  *  run in parallel. Followers without a loop
+								  *  name all run on the first data loop. */
 #define PW_KEY_NODE_STREAM		"node.stream"		/**< node is a stream, the server side should
 								  *  add a converter */
 #define PW_KEY_NODE_VIRTUAL		"node.virtual"		/**< the node is some sort of virtual
@@ -289,6 +303,12 @@ extern "C" {
 #define PW_KEY_STREAM_DONT_REMIX	"stream.dont-remix"	/**< don't remix channels */
 #define PW_KEY_STREAM_CAPTURE_SINK	"stream.capture.sink"	/**< Try to capture the sink output instead of
 								  *  source output */
+#define PW_KEY_STREAM_PREQUEUE		"stream.prequeue"	/**< Number of buffers an output stream without
+								  *  PW_STREAM_FLAG_RT_PROCESS keeps queued
+								  *  ahead. When set, the main loop is woken up
+								  *  once for all the cycles that passed and
+								  *  process is called until the queue is filled
+								  *  up or all input buffers are dequeued. */
 
 /** Media */
 #define PW_KEY_MEDIA_TYPE		"media.type"		/**< Media type, one of
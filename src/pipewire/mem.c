@@ -47,6 +47,13 @@ static inline int memfd_create(const char *name, unsigned int flags)
 #define MAP_LOCKED 0
 #endif
 
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+
+/* mappings from this size can use a transparent huge page */
+#define HUGEPAGE_SIZE	(2u * 1024 * 1024)
+
 /* memfd_create(2) flags */
 
 #ifndef MFD_CLOEXEC
@@ -86,6 +93,10 @@ struct mempool {
 	struct pw_map map;		/* map memblock to id */
 	struct spa_list blocks;		/* list of memblock */
 	uint32_t pagesize;
+
+	struct spa_list cache;		/* list of recycled memblock, oldest first */
+	uint64_t cache_max;		/* max bytes in the cache */
+	struct pw_mempool_stats stats;
 };
 
 struct memblock {
@@ -93,6 +104,7 @@ struct memblock {
 	struct spa_list link;		/* link in mempool */
 	struct spa_list mappings;	/* list of struct mapping */
 	struct spa_list memmaps;	/* list of struct memmap */
+	const void *owner[2];		/* owners of a recycled block */
 };
 
 /* a mapped region of a block */
@@ -133,6 +145,10 @@ struct pw_mempool *pw_mempool_new(struct pw_properties *props)
 	spa_hook_list_init(&impl->listener_list);
 	pw_map_init(&impl->map, 64, 64);
 	spa_list_init(&impl->blocks);
+	spa_list_init(&impl->cache);
+
+	if (props)
+		impl->cache_max = pw_properties_get_uint64(props, "mem.cache-size", 0);
 
 	return this;
 }
@@ -148,6 +164,8 @@ void pw_mempool_clear(struct pw_mempool *pool)
 	spa_list_consume(b, &impl->blocks, link)
 		pw_memblock_free(&b->this);
 	pw_map_reset(&impl->map);
+
+	pw_mempool_flush_cache(pool, NULL);
 }
 
 SPA_EXPORT
@@ -258,6 +276,21 @@ static struct mapping * memblock_find_mapping(struct memblock *b,
 	return NULL;
 }
 
+static void memblock_advise_huge(struct memblock *b, void *ptr, uint32_t size, int prot)
+{
+#ifdef MADV_HUGEPAGE
+	if (madvise(ptr, size, MADV_HUGEPAGE) < 0)
+		pw_log_debug("%p: no huge pages for fd:%d: %m", b->this.pool, b->this.fd);
+#endif
+	if (!SPA_FLAG_IS_SET(b->this.flags, PW_MEMBLOCK_FLAG_PREFAULT))
+		return;
+#if defined(MADV_POPULATE_WRITE) && defined(MADV_POPULATE_READ)
+	if (madvise(ptr, size, (prot & PROT_WRITE) ?
+				MADV_POPULATE_WRITE : MADV_POPULATE_READ) < 0)
+		pw_log_debug("%p: can't prefault fd:%d: %m", b->this.pool, b->this.fd);
+#endif
+}
+
 static struct mapping * memblock_map(struct memblock *b,
 		enum pw_memmap_flags flags, uint32_t offset, uint32_t size)
 {
@@ -265,6 +298,7 @@ static struct mapping * memblock_map(struct memblock *b,
 	struct mapping *m;
 	void *ptr;
 	int prot = 0, fl = 0;
+	bool huge;
 
 	if (flags & PW_MEMMAP_FLAG_READ)
 		prot |= PROT_READ;
@@ -279,6 +313,12 @@ static struct mapping * memblock_map(struct memblock *b,
 	if (flags & PW_MEMMAP_FLAG_LOCKED)
 		fl |= MAP_LOCKED;
 
+	/* the huge page advice must come before the pages are faulted in */
+	huge = SPA_FLAG_IS_SET(b->this.flags, PW_MEMBLOCK_FLAG_HUGEPAGES) &&
+		size >= HUGEPAGE_SIZE;
+	if (SPA_FLAG_IS_SET(b->this.flags, PW_MEMBLOCK_FLAG_PREFAULT) && !huge)
+		fl |= MAP_POPULATE;
+
 	if (flags & PW_MEMMAP_FLAG_TWICE) {
 		pw_log_error("%p: implement me PW_MEMMAP_FLAG_TWICE", p);
 		errno = ENOTSUP;
@@ -292,6 +332,8 @@ static struct mapping * memblock_map(struct memblock *b,
 				p, b->this.fd, offset, size);
 		return NULL;
 	}
+	if (huge)
+		memblock_advise_huge(b, ptr, size, prot);
 
 	m = calloc(1, sizeof(struct mapping));
 	if (m == NULL) {
@@ -363,7 +405,12 @@ struct pw_memmap * pw_memblock_map(struct pw_memblock *block,
 		return NULL;
 	}
 
-	pw_map_range_init(&range, offset, size, p->pagesize);
+	if (SPA_FLAG_IS_SET(block->flags, PW_MEMBLOCK_FLAG_SLAB))
+		/* map the complete slab, the other records will use the
+		 * same mapping */
+		pw_map_range_init(&range, 0, sb.st_size, p->pagesize);
+	else
+		pw_map_range_init(&range, offset, size, p->pagesize);
 
 	m = memblock_find_mapping(b, flags, offset, size);
 	if (m == NULL)
@@ -384,7 +431,7 @@ struct pw_memmap * pw_memblock_map(struct pw_memblock *block,
 	mm->this.flags = flags;
 	mm->this.offset = offset;
 	mm->this.size = size;
-	mm->this.ptr = SPA_PTROFF(m->ptr, range.start, void);
+	mm->this.ptr = SPA_PTROFF(m->ptr, offset - m->offset, void);
 
         pw_log_debug("%p: map:%p block:%p fd:%d ptr:%p (%u %u) mapping:%p ref:%d", p,
 			&mm->this, b, b->this.fd, mm->this.ptr, offset, size, m, m->ref);
@@ -697,6 +744,59 @@ int pw_mempool_remove_id(struct pw_mempool *pool, uint32_t id)
 	return 0;
 }
 
+/* free a recycled block from the cache */
+static void memblock_evict(struct mempool *impl, struct memblock *b)
+{
+	pw_log_debug("%p: evict block:%p fd:%d size:%u", &impl->this,
+			&b->this, b->this.fd, b->this.size);
+
+	impl->stats.n_cached--;
+	impl->stats.cached_size -= b->this.size;
+	impl->stats.n_evicted++;
+
+	/* the removed event was emitted when the block was recycled */
+	SPA_FLAG_CLEAR(b->this.flags, PW_MEMBLOCK_FLAG_RECYCLE);
+	SPA_FLAG_SET(b->this.flags, PW_MEMBLOCK_FLAG_DONT_NOTIFY);
+	pw_memblock_free(&b->this);
+}
+
+/* move an unused block to the cache, the fd and the mapping of the
+ * block are kept */
+static bool memblock_recycle(struct mempool *impl, struct memblock *b)
+{
+	struct pw_memblock *block = &b->this;
+	struct memmap *mm;
+
+	if (block->size > impl->cache_max)
+		return false;
+
+	/* only the mapping of the block itself can be kept */
+	spa_list_for_each(mm, &b->memmaps, link) {
+		if (&mm->this != block->map)
+			return false;
+	}
+
+	while (impl->stats.cached_size + block->size > impl->cache_max)
+		memblock_evict(impl, spa_list_first(&impl->cache, struct memblock, link));
+
+	if (block->id != SPA_ID_INVALID)
+		pw_map_remove(&impl->map, block->id);
+	spa_list_remove(&b->link);
+
+	if (!SPA_FLAG_IS_SET(block->flags, PW_MEMBLOCK_FLAG_DONT_NOTIFY))
+		pw_mempool_emit_removed(impl, block);
+
+	block->id = SPA_ID_INVALID;
+	spa_list_append(&impl->cache, &b->link);
+	impl->stats.n_cached++;
+	impl->stats.cached_size += block->size;
+
+	pw_log_debug("%p: recycle block:%p fd:%d size:%u cached:%u/%"PRIu64,
+			&impl->this, block, block->fd, block->size,
+			impl->stats.n_cached, impl->stats.cached_size);
+	return true;
+}
+
 /** Free a memblock
  * \param block a memblock
  */
@@ -714,6 +814,11 @@ void pw_memblock_free(struct pw_memblock *block)
 	pw_log_debug("%p: block:%p id:%d fd:%d ref:%d",
 			pool, block, block->id, block->fd, block->ref);
 
+	if (block->ref == 0 &&
+	    SPA_FLAG_IS_SET(block->flags, PW_MEMBLOCK_FLAG_RECYCLE) &&
+	    memblock_recycle(impl, b))
+		return;
+
 	block->ref++;
 	if (block->map)
 		block->ref++;
@@ -740,6 +845,88 @@ void pw_memblock_free(struct pw_memblock *block)
 	free(b);
 }
 
+/* round up to a multiple of the page size and then to one of 4 size
+ * classes per power of two, this wastes less than 25% */
+static size_t size_class(struct mempool *impl, size_t size)
+{
+	size_t step;
+
+	size = SPA_ROUND_UP_N(size, impl->pagesize);
+	for (step = impl->pagesize; step * 8 <= size; step <<= 1);
+	return SPA_ROUND_UP_N(size, step);
+}
+
+SPA_EXPORT
+struct pw_memblock * pw_mempool_alloc_cached(struct pw_mempool *pool,
+		enum pw_memblock_flags flags, uint32_t type, size_t size,
+		const void *owner[2])
+{
+	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
+	struct pw_memblock *block;
+	struct memblock *b;
+
+	if (impl->cache_max == 0 || size == 0)
+		return pw_mempool_alloc(pool, flags, type, size);
+
+	flags |= PW_MEMBLOCK_FLAG_RECYCLE;
+	size = size_class(impl, size);
+	impl->stats.n_alloc++;
+
+	spa_list_for_each(b, &impl->cache, link) {
+		if (b->this.flags != flags || b->this.type != type ||
+		    b->this.size != size ||
+		    b->owner[0] != owner[0] || b->owner[1] != owner[1])
+			continue;
+
+		spa_list_remove(&b->link);
+		impl->stats.n_cached--;
+		impl->stats.cached_size -= size;
+		impl->stats.n_reused++;
+
+		b->this.ref = 1;
+		b->this.id = pw_map_insert_new(&impl->map, b);
+		spa_list_append(&impl->blocks, &b->link);
+
+		pw_log_debug("%p: reuse block:%p id:%d fd:%d size:%zu reused:%"PRIu64"/%"PRIu64,
+				pool, &b->this, b->this.id, b->this.fd, size,
+				impl->stats.n_reused, impl->stats.n_alloc);
+
+		if (!SPA_FLAG_IS_SET(flags, PW_MEMBLOCK_FLAG_DONT_NOTIFY))
+			pw_mempool_emit_added(impl, &b->this);
+
+		return &b->this;
+	}
+
+	block = pw_mempool_alloc(pool, flags, type, size);
+	if (block == NULL)
+		return NULL;
+
+	b = SPA_CONTAINER_OF(block, struct memblock, this);
+	b->owner[0] = owner[0];
+	b->owner[1] = owner[1];
+
+	return block;
+}
+
+SPA_EXPORT
+void pw_mempool_flush_cache(struct pw_mempool *pool, const void *owner)
+{
+	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
+	struct memblock *b, *t;
+
+	spa_list_for_each_safe(b, t, &impl->cache, link) {
+		if (owner == NULL || b->owner[0] == owner || b->owner[1] == owner)
+			memblock_evict(impl, b);
+	}
+}
+
+SPA_EXPORT
+void pw_mempool_get_stats(struct pw_mempool *pool, struct pw_mempool_stats *stats)
+{
+	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
+	*stats = impl->stats;
+}
+
 SPA_EXPORT
 struct pw_memblock * pw_mempool_find_ptr(struct pw_mempool *pool, const void *ptr)
 {
@@ -805,3 +992,149 @@ struct pw_memmap * pw_mempool_find_tag(struct pw_mempool *pool, uint32_t tag[5],
 	}
 	return NULL;
 }
+
+/* a block of the slab with a bitmap of the used slots */
+struct slab_block {
+	struct spa_list link;
+	struct pw_memblock *block;
+	uint32_t n_used;
+	uint64_t used[];
+};
+
+struct pw_memslab {
+	struct pw_mempool *pool;
+	uint32_t flags;
+	uint32_t type;
+	uint32_t slot_size;
+	uint32_t n_slots;
+	struct spa_list blocks;		/* list of struct slab_block */
+};
+
+SPA_EXPORT
+struct pw_memslab * pw_memslab_new(struct pw_mempool *pool,
+		enum pw_memblock_flags flags, uint32_t type, size_t size, uint32_t n_slots)
+{
+	struct pw_memslab *slab;
+
+	if (size == 0 || n_slots == 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+	slab = calloc(1, sizeof(*slab));
+	if (slab == NULL)
+		return NULL;
+
+	slab->pool = pool;
+	/* we need the mapping to hand out pointers */
+	slab->flags = flags | PW_MEMBLOCK_FLAG_MAP | PW_MEMBLOCK_FLAG_SLAB;
+	slab->type = type;
+	/* keep the records on their own cache lines */
+	slab->slot_size = SPA_ROUND_UP_N(size, 64);
+	slab->n_slots = n_slots;
+	spa_list_init(&slab->blocks);
+
+	pw_log_debug("%p: new slab:%p slot-size:%u slots:%u", pool, slab,
+			slab->slot_size, slab->n_slots);
+
+	return slab;
+}
+
+SPA_EXPORT
+void pw_memslab_destroy(struct pw_memslab *slab)
+{
+	struct slab_block *sb;
+
+	pw_log_debug("%p: destroy slab:%p", slab->pool, slab);
+
+	spa_list_consume(sb, &slab->blocks, link) {
+		if (sb->n_used > 0)
+			pw_log_warn("%p: slab block %p still has %u records in use",
+					slab->pool, sb->block, sb->n_used);
+		spa_list_remove(&sb->link);
+		pw_memblock_unref(sb->block);
+		free(sb);
+	}
+	free(slab);
+}
+
+static struct slab_block *slab_block_new(struct pw_memslab *slab)
+{
+	struct slab_block *sb;
+
+	sb = calloc(1, sizeof(*sb) +
+			SPA_ROUND_UP_N(slab->n_slots, 64) / 64 * sizeof(uint64_t));
+	if (sb == NULL)
+		return NULL;
+
+	sb->block = pw_mempool_alloc(slab->pool, slab->flags, slab->type,
+			(size_t)slab->slot_size * slab->n_slots);
+	if (sb->block == NULL) {
+		free(sb);
+		return NULL;
+	}
+	spa_list_append(&slab->blocks, &sb->link);
+
+	pw_log_debug("%p: slab:%p new block:%p id:%u fd:%d", slab->pool, slab,
+			sb->block, sb->block->id, sb->block->fd);
+	return sb;
+}
+
+SPA_EXPORT
+struct pw_memblock * pw_memslab_alloc(struct pw_memslab *slab, uint32_t *offset)
+{
+	struct slab_block *sb;
+	uint32_t i, slot;
+	bool found = false;
+
+	spa_list_for_each(sb, &slab->blocks, link) {
+		if (sb->n_used < slab->n_slots) {
+			found = true;
+			break;
+		}
+	}
+	/* empty blocks are kept around, a client might still have the fd
+	 * imported for the records it used before */
+	if (!found && (sb = slab_block_new(slab)) == NULL)
+		return NULL;
+
+	for (i = 0; sb->used[i] == UINT64_MAX; i++);
+	slot = i * 64 + __builtin_ctzll(~sb->used[i]);
+
+	sb->used[i] |= 1ULL << (slot & 63);
+	sb->n_used++;
+	sb->block->ref++;
+
+	*offset = slot * slab->slot_size;
+	memset(SPA_PTROFF(sb->block->map->ptr, *offset, void), 0, slab->slot_size);
+
+	pw_log_debug("%p: slab:%p block:%p alloc slot:%u offset:%u used:%u", slab->pool,
+			slab, sb->block, slot, *offset, sb->n_used);
+
+	return sb->block;
+}
+
+SPA_EXPORT
+void pw_memslab_free(struct pw_memslab *slab, struct pw_memblock *block, uint32_t offset)
+{
+	struct slab_block *sb;
+	uint32_t slot = offset / slab->slot_size;
+
+	spa_list_for_each(sb, &slab->blocks, link) {
+		if (sb->block != block)
+			continue;
+
+		pw_log_debug("%p: slab:%p block:%p free slot:%u used:%u", slab->pool,
+				slab, block, slot, sb->n_used);
+
+		if (!(sb->used[slot / 64] & (1ULL << (slot & 63)))) {
+			pw_log_warn("%p: slab:%p block:%p slot:%u not in use",
+					slab->pool, slab, block, slot);
+			return;
+		}
+		sb->used[slot / 64] &= ~(1ULL << (slot & 63));
+		sb->n_used--;
+		pw_memblock_unref(block);
+		return;
+	}
+	pw_log_warn("%p: slab:%p unknown block:%p", slab->pool, slab, block);
+}
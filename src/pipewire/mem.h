@@ -29,6 +29,13 @@ enum pw_memblock_flags {
 	PW_MEMBLOCK_FLAG_MAP =		(1 << 3),	/**< mmap the fd */
 	PW_MEMBLOCK_FLAG_DONT_CLOSE =	(1 << 4),	/**< don't close fd */
 	PW_MEMBLOCK_FLAG_DONT_NOTIFY =	(1 << 5),	/**< don't notify events */
+	PW_MEMBLOCK_FLAG_SLAB =		(1 << 6),	/**< block holds many small records, map it
+							  *  completely so that they share one mapping */
+	PW_MEMBLOCK_FLAG_PREFAULT =	(1 << 7),	/**< fault in the pages when mapping */
+	PW_MEMBLOCK_FLAG_HUGEPAGES =	(1 << 8),	/**< use transparent huge pages for
+							  *  large mappings */
+	PW_MEMBLOCK_FLAG_RECYCLE =	(1 << 9),	/**< keep the block for reuse when it is
+							  *  freed, see \ref pw_mempool_alloc_cached() */
 
 	PW_MEMBLOCK_FLAG_READWRITE = PW_MEMBLOCK_FLAG_READABLE | PW_MEMBLOCK_FLAG_WRITABLE,
 };
@@ -110,6 +117,37 @@ void pw_mempool_destroy(struct pw_mempool *pool);
 struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool,
 		enum pw_memblock_flags flags, uint32_t type, size_t size);
 
+/** Allocate a memory block that is recycled when it is freed.
+ *
+ * The size is rounded up to a size class and a freed block is kept in
+ * the pool. A later allocation with the same flags, type, size class and
+ * owners reuses the block instead of making a new one. The memory
+ * can still be mapped by the peers of the previous user so \a owner
+ * should identify all of them. Blocks of an owner are released with
+ * \ref pw_mempool_flush_cache() when the owner goes away.
+ *
+ * The pool keeps at most the number of bytes in the mem.cache-size
+ * property of the pool, 0 or no property disables the cache. */
+struct pw_memblock * pw_mempool_alloc_cached(struct pw_mempool *pool,
+		enum pw_memblock_flags flags, uint32_t type, size_t size,
+		const void *owner[2]);
+
+/** Free the recycled blocks of \a owner, or all of them when \a owner
+ * is NULL */
+void pw_mempool_flush_cache(struct pw_mempool *pool, const void *owner);
+
+/** Counters of the block cache of a pool */
+struct pw_mempool_stats {
+	uint64_t n_alloc;		/**< number of cached allocations */
+	uint64_t n_reused;		/**< allocations that reused a block */
+	uint64_t n_evicted;		/**< recycled blocks that were freed */
+	uint32_t n_cached;		/**< blocks in the cache */
+	uint64_t cached_size;		/**< bytes in the cache */
+};
+
+/** Get the cache counters of a pool */
+void pw_mempool_get_stats(struct pw_mempool *pool, struct pw_mempool_stats *stats);
+
 /** Import a block from another pool */
 struct pw_memblock * pw_mempool_import_block(struct pw_mempool *pool,
 		struct pw_memblock *mem);
@@ -160,6 +198,26 @@ struct pw_memmap * pw_mempool_find_tag(struct pw_mempool *pool, uint32_t tag[5],
 /** Unmap a region */
 int pw_memmap_free(struct pw_memmap *map);
 
+/**
+ * A slab packs many fixed size records in a few memory blocks.
+ * Each record is identified by its block and offset in the block. */
+struct pw_memslab;
+
+/** Make a slab for records of \a size bytes, \a n_slots records are
+ * placed in one block */
+struct pw_memslab * pw_memslab_new(struct pw_mempool *pool,
+		enum pw_memblock_flags flags, uint32_t type, size_t size, uint32_t n_slots);
+
+/** Destroy a slab and release its blocks */
+void pw_memslab_destroy(struct pw_memslab *slab);
+
+/** Allocate a zeroed record from the slab. The block of the record is
+ * returned with an extra reference and the record is at \a offset. */
+struct pw_memblock * pw_memslab_alloc(struct pw_memslab *slab, uint32_t *offset);
+
+/** Free a record allocated with \ref pw_memslab_alloc() */
+void pw_memslab_free(struct pw_memslab *slab, struct pw_memblock *block, uint32_t offset);
+
 
 /** parameters to map a memory range */
 struct pw_map_range {
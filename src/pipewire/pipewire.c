@@ -555,7 +555,7 @@ SPA_EXPORT
 void pw_init(int *argc, char **argv[])
 {
 	const char *str;
-	struct spa_dict_item items[6];
+	struct spa_dict_item items[7];
 	uint32_t n_items;
 	struct spa_dict info;
 	struct support *support = &global_support;
@@ -612,6 +612,8 @@ void pw_init(int *argc, char **argv[])
 			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_LOG_FILE, str);
 		if ((patterns = parse_pw_debug_env()) != NULL)
 			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_LOG_PATTERNS, patterns);
+		if ((str = getenv("PIPEWIRE_LOG_DEFERRED")) != NULL)
+			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_LOG_DEFERRED, str);
 		info = SPA_DICT_INIT(items, n_items);
 
 		log = add_interface(support, SPA_NAME_SUPPORT_LOG, SPA_TYPE_INTERFACE_Log, &info);
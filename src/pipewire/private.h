@@ -387,6 +387,7 @@ struct pw_context {
 	void *settings_impl;		/**< settings metadata */
 
 	struct pw_mempool *pool;		/**< global memory pool */
+	uint32_t buffer_mem_flags;		/**< extra memblock flags for buffer memory */
 
 	uint64_t stamp;
 	uint64_t serial;
@@ -442,6 +443,9 @@ struct pw_data_loop {
 
 	struct spa_thread_utils *thread_utils;
 
+	char *name;
+	char *affinity;
+
 	pthread_t thread;
 	unsigned int cancel:1;
 	unsigned int created:1;
@@ -522,6 +526,75 @@ static inline void pw_node_activation_state_reset(struct pw_node_activation_stat
 
 #define pw_node_activation_state_dec(s) (SPA_ATOMIC_DEC(s->pending) == 0)
 
+/* Latency histogram with fixed, logarithmic buckets. Every power of two is
+ * split in 4 sub-buckets, bucket 0 holds everything below 1 microsecond and
+ * the last bucket everything above ~2 seconds. There is only one writer,
+ * the thread of the driver of the node, readers can read the counters at
+ * any time and should tolerate a slightly inconsistent view. */
+#define PW_NODE_HIST_MIN_SHIFT	10
+#define PW_NODE_HIST_SUB_BITS	2
+#define PW_NODE_HIST_BUCKETS		88
+
+struct pw_node_hist {
+	uint64_t count;					/* number of samples */
+	uint64_t max;					/* max sample in nanoseconds */
+	uint32_t bucket[PW_NODE_HIST_BUCKETS];
+};
+
+static inline uint32_t pw_node_hist_index(uint64_t nsec)
+{
+	uint32_t msb, idx;
+	if (nsec < (1ULL << PW_NODE_HIST_MIN_SHIFT))
+		return 0;
+	msb = 63 - __builtin_clzll(nsec);
+	idx = ((msb - PW_NODE_HIST_MIN_SHIFT) << PW_NODE_HIST_SUB_BITS) +
+		((nsec >> (msb - PW_NODE_HIST_SUB_BITS)) &
+		 ((1u << PW_NODE_HIST_SUB_BITS) - 1)) + 1;
+	return SPA_MIN(idx, PW_NODE_HIST_BUCKETS - 1u);
+}
+
+/* the upper bound in nanoseconds of the values in bucket idx */
+static inline uint64_t pw_node_hist_value(uint32_t idx)
+{
+	uint32_t sub = 1u << PW_NODE_HIST_SUB_BITS, octave, frac;
+	if (idx == 0)
+		return 1ULL << PW_NODE_HIST_MIN_SHIFT;
+	octave = (idx - 1) >> PW_NODE_HIST_SUB_BITS;
+	frac = (idx - 1) & (sub - 1);
+	return ((uint64_t)(sub + frac + 1) << (octave + PW_NODE_HIST_MIN_SHIFT)) >>
+		PW_NODE_HIST_SUB_BITS;
+}
+
+/* RT safe, called from the thread of the driver */
+static inline void pw_node_hist_add(struct pw_node_hist *h, uint64_t nsec)
+{
+	h->bucket[pw_node_hist_index(nsec)]++;
+	if (nsec > h->max)
+		h->max = nsec;
+	h->count++;
+}
+
+/* get an upper bound in nanoseconds for the given percentile (0.0 to 1.0) */
+static inline uint64_t pw_node_hist_percentile(const struct pw_node_hist *h,
+		double percentile)
+{
+	uint64_t total = 0, target, sum = 0;
+	uint32_t i;
+
+	for (i = 0; i < PW_NODE_HIST_BUCKETS; i++)
+		total += h->bucket[i];
+	if (total == 0)
+		return 0;
+	target = (uint64_t)(percentile * total + 0.5);
+	target = SPA_CLAMP(target, 1u, total);
+	for (i = 0; i < PW_NODE_HIST_BUCKETS; i++) {
+		sum += h->bucket[i];
+		if (sum >= target)
+			return SPA_MIN(pw_node_hist_value(i), h->max);
+	}
+	return h->max;
+}
+
 struct pw_node_target {
 	struct spa_list link;
 #define PW_NODE_TARGET_NONE	0
@@ -677,6 +750,9 @@ struct pw_impl_node {
 	unsigned int trigger:1;		/**< has the TRIGGER property and needs an extra
 					  *  trigger to start processing. */
 	unsigned int can_suspend:1;
+	unsigned int recalc_dirty:1;	/**< node changed since the last graph recalc */
+	unsigned int recalc:1;		/**< node is part of the current graph recalc */
+	unsigned int group_running:1;	/**< driver group was running in the last recalc */
 	unsigned int checked;		/**< for sorting */
 
 	uint32_t port_user_data_size;	/**< extra size for port user data */
@@ -712,6 +788,8 @@ struct pw_impl_node {
 	uint32_t stamp;				/**< stamp of last update */
 	struct spa_source source;		/**< source to remotely trigger this node */
 	struct pw_memblock *activation;
+	uint32_t activation_offset;		/**< offset of the activation in the block */
+	struct pw_memslab *activation_slab;	/**< slab of the activation or NULL */
 	struct {
 		struct spa_io_clock *clock;	/**< io area of the clock or NULL */
 		struct spa_io_position *position;
@@ -725,8 +803,16 @@ struct pw_impl_node {
 		struct pw_node_target target;		/* our target that is signaled by the
 							   driver */
 		struct spa_list driver_link;		/* our link in driver */
+		struct spa_list run_link;		/* our link in the local run queue */
 
 		struct spa_ratelimit rate_limit;
+
+		/* latency histograms, updated by the driver of the node at the
+		 * end of each cycle. They are not in the activation so that the
+		 * shared memory layout stays the same. */
+		struct pw_node_hist wakeup_hist;	/* signal to awake time */
+		struct pw_node_hist process_hist;	/* awake to finish time */
+		struct pw_node_hist cycle_hist;		/* driver start to finish time */
 	} rt;
 	struct spa_fraction target_rate;
 	uint64_t target_quantum;
@@ -1166,6 +1252,15 @@ void pw_proxy_remove(struct pw_proxy *proxy);
 
 int pw_context_recalc_graph(struct pw_context *context, const char *reason);
 
+/** Get the slab for the node activations of the client in \a props, NULL
+ * when the node should allocate its own activation */
+struct pw_memslab *pw_context_acquire_activation_slab(struct pw_context *context,
+		const struct spa_dict *props);
+void pw_context_release_activation_slab(struct pw_context *context,
+		struct pw_memslab *slab);
+/* only recalc the parts of the graph connected to nodes with recalc_dirty set */
+int pw_context_recalc_graph_dirty(struct pw_context *context, const char *reason);
+
 void pw_impl_port_update_info(struct pw_impl_port *port, const struct spa_port_info *info);
 
 int pw_impl_port_register(struct pw_impl_port *port,
@@ -4,12 +4,14 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <pthread.h>
 
 #include <spa/utils/ansi.h>
 #include <spa/utils/json.h>
 #include <spa/utils/string.h>
 
 #include "pipewire/array.h"
+#include "pipewire/keys.h"
 #include "pipewire/log.h"
 #include "pipewire/utils.h"
 #include "pipewire/properties.h"
@@ -17,43 +19,264 @@
 PW_LOG_TOPIC_EXTERN(log_properties);
 #define PW_LOG_TOPIC_DEFAULT log_properties
 
+/* properties with this many items get a hash index */
+#define HASH_THRESHOLD	16
+
 /** \cond */
+struct slot {
+	uint32_t hash;
+	uint32_t pos;			/* index of the item + 1, 0 when unused */
+};
+
 struct properties {
 	struct pw_properties this;
 
 	struct pw_array items;
+
+	struct slot *index;		/* hash index of the items or NULL */
+	uint32_t index_mask;
 };
 /** \endcond */
 
-static int add_func(struct pw_properties *this, char *key, char *value)
+/* keys used by almost all objects, they are shared instead of copied */
+static const char * const common_keys[] = {
+	PW_KEY_OBJECT_PATH, PW_KEY_OBJECT_ID, PW_KEY_OBJECT_SERIAL,
+	PW_KEY_OBJECT_LINGER, PW_KEY_OBJECT_REGISTER,
+	PW_KEY_PROTOCOL, PW_KEY_ACCESS, PW_KEY_CLIENT_ACCESS,
+	PW_KEY_SEC_PID, PW_KEY_SEC_UID, PW_KEY_SEC_GID, PW_KEY_SEC_LABEL, PW_KEY_SEC_SOCKET,
+	PW_KEY_CORE_NAME, PW_KEY_CORE_VERSION, PW_KEY_CORE_ID,
+	PW_KEY_PRIORITY_SESSION, PW_KEY_PRIORITY_DRIVER,
+	PW_KEY_APP_NAME, PW_KEY_APP_ID, PW_KEY_APP_ICON_NAME, PW_KEY_APP_LANGUAGE,
+	PW_KEY_APP_PROCESS_ID, PW_KEY_APP_PROCESS_BINARY, PW_KEY_APP_PROCESS_USER,
+	PW_KEY_APP_PROCESS_HOST, PW_KEY_APP_PROCESS_MACHINE_ID,
+	PW_KEY_APP_PROCESS_SESSION_ID,
+	PW_KEY_CLIENT_ID, PW_KEY_CLIENT_NAME, PW_KEY_CLIENT_API,
+	PW_KEY_NODE_ID, PW_KEY_NODE_NAME, PW_KEY_NODE_NICK, PW_KEY_NODE_DESCRIPTION,
+	PW_KEY_NODE_PLUGGED, PW_KEY_NODE_GROUP, PW_KEY_NODE_AUTOCONNECT,
+	PW_KEY_NODE_LATENCY, PW_KEY_NODE_MAX_LATENCY, PW_KEY_NODE_RATE,
+	PW_KEY_NODE_DONT_RECONNECT, PW_KEY_NODE_ALWAYS_PROCESS, PW_KEY_NODE_DRIVER,
+	PW_KEY_NODE_LOOP_NAME, PW_KEY_NODE_VIRTUAL, PW_KEY_NODE_PASSIVE,
+	PW_KEY_NODE_LINK_GROUP, PW_KEY_NODE_TRANSPORT_SYNC,
+	PW_KEY_PORT_ID, PW_KEY_PORT_NAME, PW_KEY_PORT_DIRECTION, PW_KEY_PORT_ALIAS,
+	PW_KEY_PORT_PHYSICAL, PW_KEY_PORT_TERMINAL, PW_KEY_PORT_MONITOR,
+	PW_KEY_LINK_ID, PW_KEY_LINK_INPUT_NODE, PW_KEY_LINK_INPUT_PORT,
+	PW_KEY_LINK_OUTPUT_NODE, PW_KEY_LINK_OUTPUT_PORT, PW_KEY_LINK_PASSIVE,
+	PW_KEY_DEVICE_ID, PW_KEY_DEVICE_NAME, PW_KEY_DEVICE_NICK, PW_KEY_DEVICE_API,
+	PW_KEY_DEVICE_DESCRIPTION, PW_KEY_DEVICE_BUS_PATH, PW_KEY_DEVICE_BUS,
+	PW_KEY_DEVICE_SUBSYSTEM, PW_KEY_DEVICE_SYSFS_PATH, PW_KEY_DEVICE_ICON_NAME,
+	PW_KEY_DEVICE_VENDOR_ID, PW_KEY_DEVICE_VENDOR_NAME, PW_KEY_DEVICE_PRODUCT_ID,
+	PW_KEY_DEVICE_PRODUCT_NAME, PW_KEY_DEVICE_FORM_FACTOR,
+	PW_KEY_MODULE_ID, PW_KEY_MODULE_NAME, PW_KEY_FACTORY_ID, PW_KEY_FACTORY_NAME,
+	PW_KEY_FACTORY_TYPE_NAME, PW_KEY_FACTORY_TYPE_VERSION,
+	PW_KEY_STREAM_IS_LIVE, PW_KEY_STREAM_MONITOR,
+	PW_KEY_MEDIA_TYPE, PW_KEY_MEDIA_CATEGORY, PW_KEY_MEDIA_ROLE, PW_KEY_MEDIA_CLASS,
+	PW_KEY_MEDIA_NAME, PW_KEY_MEDIA_TITLE, PW_KEY_MEDIA_SOFTWARE,
+	PW_KEY_FORMAT_DSP, PW_KEY_AUDIO_CHANNEL, PW_KEY_AUDIO_RATE,
+	PW_KEY_AUDIO_CHANNELS, PW_KEY_AUDIO_FORMAT, "audio.position",
+	PW_KEY_TARGET_OBJECT,
+	"api.alsa.path", "api.alsa.card", "api.alsa.pcm.card", "api.alsa.pcm.device",
+	"card.profile.device", "factory.mode", "node.target", "adapt.follower.spa-node",
+};
+
+#define INTERN_SIZE	256
+#define INTERN_MASK	(INTERN_SIZE-1)
+
+static struct slot intern_index[INTERN_SIZE];
+static pthread_once_t intern_once = PTHREAD_ONCE_INIT;
+
+static inline uint32_t key_hash(const char *key)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+	while (*key) {
+		hash ^= (uint8_t)*key++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void slot_insert(struct slot *index, uint32_t mask, uint32_t hash, uint32_t pos)
+{
+	uint32_t i;
+	for (i = hash & mask; index[i].pos != 0; i = (i + 1) & mask);
+	index[i].hash = hash;
+	index[i].pos = pos + 1;
+}
+
+static struct slot *slot_find(struct slot *index, uint32_t mask, uint32_t hash, uint32_t pos)
+{
+	uint32_t i;
+	for (i = hash & mask; index[i].pos != 0; i = (i + 1) & mask) {
+		if (index[i].hash == hash && index[i].pos == pos + 1)
+			return &index[i];
+	}
+	return NULL;
+}
+
+/* remove the slot and move the following slots of the probe sequence
+ * back so that they can still be found */
+static void slot_remove(struct slot *index, uint32_t mask, struct slot *slot)
+{
+	uint32_t i = slot - index, j = i, k;
+
+	while (true) {
+		j = (j + 1) & mask;
+		if (index[j].pos == 0)
+			break;
+		k = index[j].hash & mask;
+		/* the slot can't move before its home slot k */
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		index[i] = index[j];
+		i = j;
+	}
+	index[i].pos = 0;
+}
+
+static void intern_init(void)
+{
+	uint32_t i;
+	SPA_STATIC_ASSERT(SPA_N_ELEMENTS(common_keys) * 2 <= INTERN_SIZE);
+	for (i = 0; i < SPA_N_ELEMENTS(common_keys); i++)
+		slot_insert(intern_index, INTERN_MASK, key_hash(common_keys[i]), i);
+}
+
+static const char *intern_lookup(const char *key, uint32_t hash)
+{
+	uint32_t i;
+
+	pthread_once(&intern_once, intern_init);
+
+	for (i = hash & INTERN_MASK; intern_index[i].pos != 0; i = (i + 1) & INTERN_MASK) {
+		const char *k = common_keys[intern_index[i].pos - 1];
+		if (intern_index[i].hash == hash && spa_streq(k, key))
+			return k;
+	}
+	return NULL;
+}
+
+static void index_rebuild(struct properties *impl)
+{
+	const struct spa_dict *dict = &impl->this.dict;
+	uint32_t i, size;
+
+	free(impl->index);
+	impl->index = NULL;
+	impl->index_mask = 0;
+
+	if (dict->n_items < HASH_THRESHOLD)
+		return;
+
+	/* keep the table at most half full */
+	for (size = 64; size < dict->n_items * 2; size <<= 1);
+
+	/* without an index we do a linear search */
+	if ((impl->index = calloc(size, sizeof(struct slot))) == NULL)
+		return;
+
+	impl->index_mask = size - 1;
+	for (i = 0; i < dict->n_items; i++)
+		slot_insert(impl->index, impl->index_mask,
+				key_hash(dict->items[i].key), i);
+}
+
+static int add_func(struct pw_properties *this, const char *key, uint32_t hash, char *value)
 {
 	struct spa_dict_item *item;
 	struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
+	const char *k;
+	uint32_t pos = this->dict.n_items;
+
+	if ((k = intern_lookup(key, hash)) == NULL &&
+	    (k = strdup(key)) == NULL)
+		goto error;
 
 	item = pw_array_add(&impl->items, sizeof(struct spa_dict_item));
 	if (item == NULL) {
-		free(key);
-		free(value);
-		return -errno;
+		if (k != intern_lookup(key, hash))
+			free((char*)k);
+		goto error;
 	}
 
-	item->key = key;
+	item->key = k;
 	item->value = value;
 
 	this->dict.items = impl->items.data;
 	this->dict.n_items++;
+
+	if (impl->index == NULL || this->dict.n_items * 2 > impl->index_mask + 1)
+		index_rebuild(impl);
+	else
+		slot_insert(impl->index, impl->index_mask, hash, pos);
+
 	return 0;
+error:
+	free(value);
+	return -errno;
 }
 
 static void clear_item(struct spa_dict_item *item)
 {
-	free((char *) item->key);
+	if (intern_lookup(item->key, key_hash(item->key)) != item->key)
+		free((char *) item->key);
 	free((char *) item->value);
 }
 
+/* update the index after the item at pos was removed and the last item
+ * was moved to pos */
+static void index_remove(struct properties *impl, uint32_t hash, uint32_t pos)
+{
+	const struct spa_dict *dict = &impl->this.dict;
+	struct slot *slot;
+	uint32_t last = dict->n_items;
+
+	if (impl->index == NULL)
+		return;
+	if (dict->n_items < HASH_THRESHOLD) {
+		index_rebuild(impl);
+		return;
+	}
+	/* the slots don't match the items when they were reordered with
+	 * spa_dict_qsort() */
+	if ((slot = slot_find(impl->index, impl->index_mask, hash, pos)) == NULL)
+		goto rebuild;
+	slot_remove(impl->index, impl->index_mask, slot);
+
+	if (pos != last) {
+		hash = key_hash(dict->items[pos].key);
+		if ((slot = slot_find(impl->index, impl->index_mask, hash, last)) == NULL)
+			goto rebuild;
+		slot->pos = pos + 1;
+	}
+	return;
+rebuild:
+	index_rebuild(impl);
+}
+
 static int find_index(const struct pw_properties *this, const char *key)
 {
+	const struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
 	const struct spa_dict_item *item;
+	uint32_t i, pos, hash;
+
+	/* small properties don't have an index, don't hash the key */
+	if (impl->index != NULL) {
+		hash = key_hash(key);
+		for (i = hash & impl->index_mask; impl->index[i].pos != 0;
+		     i = (i + 1) & impl->index_mask) {
+			if (impl->index[i].hash != hash)
+				continue;
+			pos = impl->index[i].pos - 1;
+			if (pos < this->dict.n_items &&
+			    spa_streq(this->dict.items[pos].key, key))
+				return pos;
+			/* another key with the same hash or the items were
+			 * reordered with spa_dict_qsort(), do a normal lookup */
+			goto lookup;
+		}
+		return -1;
+	}
+lookup:
 	item = spa_dict_lookup_item(&this->dict, key);
 	if (item == NULL)
 		return -1;
@@ -95,7 +318,7 @@ struct pw_properties *pw_properties_new(const char *key, ...)
 	while (key != NULL) {
 		value = va_arg(varargs, char *);
 		if (value && key[0])
-			add_func(&impl->this, strdup(key), strdup(value));
+			add_func(&impl->this, key, key_hash(key), strdup(value));
 		key = va_arg(varargs, char *);
 	}
 	va_end(varargs);
@@ -121,7 +344,7 @@ struct pw_properties *pw_properties_new_dict(const struct spa_dict *dict)
 	for (i = 0; i < dict->n_items; i++) {
 		const struct spa_dict_item *it = &dict->items[i];
 		if (it->key != NULL && it->key[0] && it->value != NULL)
-			add_func(&impl->this, strdup(it->key),
+			add_func(&impl->this, it->key, key_hash(it->key),
 				 strdup(it->value));
 	}
 
@@ -269,6 +492,7 @@ void pw_properties_clear(struct pw_properties *properties)
 		clear_item(item);
 	pw_array_reset(&impl->items);
 	properties->dict.n_items = 0;
+	index_rebuild(impl);
 }
 
 /** Update properties
@@ -357,12 +581,14 @@ void pw_properties_free(struct pw_properties *properties)
 	impl = SPA_CONTAINER_OF(properties, struct properties, this);
 	pw_properties_clear(properties);
 	pw_array_clear(&impl->items);
+	free(impl->index);
 	free(impl);
 }
 
 static int do_replace(struct pw_properties *properties, const char *key, char *value, bool copy)
 {
 	struct properties *impl = SPA_CONTAINER_OF(properties, struct properties, this);
+	uint32_t hash;
 	int index;
 
 	if (key == NULL || key[0] == 0)
@@ -373,7 +599,7 @@ static int do_replace(struct pw_properties *properties, const char *key, char *v
 	if (index == -1) {
 		if (value == NULL)
 			return 0;
-		add_func(properties, strdup(key), copy ? strdup(value) : value);
+		add_func(properties, key, key_hash(key), copy ? strdup(value) : value);
 		SPA_FLAG_CLEAR(properties->dict.flags, SPA_DICT_FLAG_SORTED);
 	} else {
 		struct spa_dict_item *item =
@@ -386,12 +612,14 @@ static int do_replace(struct pw_properties *properties, const char *key, char *v
 			struct spa_dict_item *last = pw_array_get_unchecked(&impl->items,
 						     pw_array_get_len(&impl->items, struct spa_dict_item) - 1,
 						     struct spa_dict_item);
+			hash = impl->index ? key_hash(item->key) : 0;
 			clear_item(item);
 			item->key = last->key;
 			item->value = last->value;
 			impl->items.size -= sizeof(struct spa_dict_item);
 			properties->dict.n_items--;
 			SPA_FLAG_CLEAR(properties->dict.flags, SPA_DICT_FLAG_SORTED);
+			index_remove(impl, hash, index);
 		} else {
 			free((char *) item->value);
 			item->value = copy ? strdup(value) : value;
@@ -473,8 +701,12 @@ SPA_EXPORT
 const char *pw_properties_get(const struct pw_properties *properties, const char *key)
 {
 	struct properties *impl = SPA_CONTAINER_OF(properties, struct properties, this);
-	int index = find_index(properties, key);
+	int index;
+
+	if (key == NULL)
+		return NULL;
 
+	index = find_index(properties, key);
 	if (index == -1)
 		return NULL;
 
@@ -28,7 +28,7 @@
 PW_LOG_TOPIC_EXTERN(log_stream);
 #define PW_LOG_TOPIC_DEFAULT log_stream
 
-#define MAX_BUFFERS	64
+#define MAX_BUFFERS	64u
 
 #define MASK_BUFFERS	(MAX_BUFFERS-1)
 
@@ -147,6 +147,10 @@ struct stream {
 
 	struct spa_callbacks rt_callbacks;
 
+	uint32_t prequeue;			/* buffers to keep queued for non-RT process */
+	struct spa_source *process_event;	/* wakes up the non-RT process */
+	int process_pending;
+
 	unsigned int disconnecting:1;
 	unsigned int disconnect_core:1;
 	unsigned int draining:1;
@@ -359,6 +363,13 @@ static inline bool queue_is_empty(struct stream *stream, struct queue *queue)
 	return spa_ringbuffer_get_read_index(&queue->ring, &index) < 1;
 }
 
+static inline uint32_t queue_level(struct stream *stream, struct queue *queue)
+{
+	uint32_t index;
+	int32_t avail = spa_ringbuffer_get_read_index(&queue->ring, &index);
+	return SPA_MAX(avail, 0);
+}
+
 static inline struct buffer *queue_pop(struct stream *stream, struct queue *queue)
 {
 	uint32_t index, id;
@@ -454,6 +465,45 @@ do_call_process(struct spa_loop *loop,
 	return 0;
 }
 
+/* the queue of an output stream has less than the wanted number of buffers */
+static inline bool need_queued(struct stream *impl)
+{
+	return queue_level(impl, &impl->queued) < SPA_MAX(impl->prequeue, 1u);
+}
+
+static inline bool want_process(struct stream *impl)
+{
+	if (queue_is_empty(impl, &impl->dequeued))
+		return false;
+	if (impl->direction == SPA_DIRECTION_INPUT)
+		return true;
+	return need_queued(impl) && update_requested(impl) > 0;
+}
+
+/* with a prequeue, the main thread is woken up once for any number of
+ * cycles and it then calls process until the queue is filled up again */
+static void on_process_event(void *data, uint64_t count)
+{
+	struct stream *impl = data;
+	struct pw_stream *stream = &impl->this;
+	uint32_t i, index;
+
+	SPA_ATOMIC_STORE(impl->process_pending, 0);
+
+	for (i = 0; i < impl->n_buffers && !impl->disconnecting; i++) {
+		if (!want_process(impl))
+			break;
+
+		index = impl->dequeued.ring.readindex;
+		pw_log_trace_fp("%p: do process %u", stream, i);
+		pw_stream_emit_process(stream);
+
+		/* stop when the app did not take a buffer */
+		if (index == impl->dequeued.ring.readindex)
+			break;
+	}
+}
+
 static inline void call_process(struct stream *impl)
 {
 	pw_log_trace_fp("%p: call process rt:%u", impl, impl->process_rt);
@@ -463,6 +513,9 @@ static inline void call_process(struct stream *impl)
 	if (impl->process_rt) {
 		if (impl->rt_callbacks.funcs)
 			spa_callbacks_call_fast(&impl->rt_callbacks, struct pw_stream_events, process, 0);
+	} else if (impl->process_event) {
+		if (SPA_ATOMIC_CAS(impl->process_pending, 0, 1))
+			pw_loop_signal_event(impl->main_loop, impl->process_event);
 	} else {
 		pw_loop_invoke(impl->main_loop,
 			do_call_process, 1, NULL, 0, false, impl);
@@ -1104,7 +1157,7 @@ again:
 			 * rate matching node (audioconvert) has been scheduled to
 			 * update the values. */
 			ask_more = !impl->process_rt && impl->rate_match == NULL &&
-				(impl->early_process || queue_is_empty(impl, &impl->queued)) &&
+				(impl->early_process || need_queued(impl)) &&
 				!queue_is_empty(impl, &impl->dequeued);
 			pw_log_trace_fp("%p: pop %d %p ask_more:%u %p", stream, b->id, io,
 					ask_more, impl->rate_match);
@@ -1122,7 +1175,7 @@ again:
 		}
 	} else {
 		ask_more = !impl->process_rt &&
-			(impl->early_process || queue_is_empty(impl, &impl->queued)) &&
+			(impl->early_process || need_queued(impl)) &&
 			!queue_is_empty(impl, &impl->dequeued);
 	}
 
@@ -1710,6 +1763,9 @@ void pw_stream_destroy(struct pw_stream *stream)
 	spa_hook_list_clean(&impl->hooks);
 	spa_hook_list_clean(&stream->listener_list);
 
+	if (impl->process_event)
+		pw_loop_destroy_source(impl->main_loop, impl->process_event);
+
 	if (impl->data.context)
 		pw_context_destroy(impl->data.context);
 
@@ -1915,6 +1971,15 @@ pw_stream_connect(struct pw_stream *stream,
 	impl->process_rt = SPA_FLAG_IS_SET(flags, PW_STREAM_FLAG_RT_PROCESS);
 	impl->early_process = SPA_FLAG_IS_SET(flags, PW_STREAM_FLAG_EARLY_PROCESS);
 
+	impl->prequeue = SPA_MIN(pw_properties_get_uint32(stream->properties,
+				PW_KEY_STREAM_PREQUEUE, 0), MAX_BUFFERS);
+	if (!impl->process_rt && impl->prequeue > 0 && impl->process_event == NULL) {
+		impl->process_event = pw_loop_add_event(impl->main_loop,
+				on_process_event, impl);
+		if (impl->process_event == NULL)
+			return -errno;
+	}
+
 	impl->impl_node.iface = SPA_INTERFACE_INIT(
 			SPA_TYPE_INTERFACE_Node,
 			SPA_VERSION_NODE,
@@ -2558,3 +2623,10 @@ int pw_stream_trigger_process(struct pw_stream *stream)
 	}
 	return res;
 }
+
+SPA_EXPORT
+struct pw_loop *pw_stream_get_data_loop(struct pw_stream *stream)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	return impl->data_loop;
+}
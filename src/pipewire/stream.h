@@ -525,6 +525,12 @@ bool pw_stream_is_driving(struct pw_stream *stream);
  * scheduled and process() will be called. Since 0.3.34 */
 int pw_stream_trigger_process(struct pw_stream *stream);
 
+/** Get the loop where the data of the stream is processed. This is the
+ * loop that calls the process callback of a stream with
+ * PW_STREAM_FLAG_RT_PROCESS. NULL when the stream is not connected.
+ * Since 0.3.86 */
+struct pw_loop *pw_stream_get_data_loop(struct pw_stream *stream);
+
 /**
  * \}
  */
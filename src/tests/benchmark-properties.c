@@ -0,0 +1,92 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <stdio.h>
+#include <time.h>
+
+#include <spa/utils/defs.h>
+
+#include <pipewire/pipewire.h>
+
+#define MAX_COUNT 20000
+
+static const char * const keys[] = {
+	PW_KEY_OBJECT_ID, PW_KEY_OBJECT_SERIAL, PW_KEY_CLIENT_ID,
+	PW_KEY_NODE_NAME, PW_KEY_NODE_DESCRIPTION, PW_KEY_NODE_NICK,
+	PW_KEY_MEDIA_CLASS, PW_KEY_MEDIA_TYPE, PW_KEY_MEDIA_CATEGORY,
+	PW_KEY_MEDIA_ROLE, PW_KEY_DEVICE_ID, PW_KEY_DEVICE_API,
+	PW_KEY_FACTORY_ID, PW_KEY_PRIORITY_SESSION, PW_KEY_PRIORITY_DRIVER,
+	PW_KEY_AUDIO_CHANNELS, PW_KEY_AUDIO_RATE, PW_KEY_AUDIO_FORMAT,
+	PW_KEY_APP_NAME, PW_KEY_APP_PROCESS_ID, PW_KEY_APP_PROCESS_BINARY,
+	PW_KEY_NODE_LATENCY, PW_KEY_NODE_RATE, PW_KEY_NODE_DRIVER,
+	"api.alsa.path", "api.alsa.card", "api.alsa.pcm.card",
+	"alsa.card_name", "alsa.long_card_name", "alsa.driver_name",
+	"device.profile.name", "device.profile.description",
+};
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void run_test(uint32_t n)
+{
+	struct pw_properties *props, *copy;
+	uint64_t t1, t2;
+	uint32_t i, count = MAX_COUNT;
+	char key[64];
+
+	props = pw_properties_new(NULL, NULL);
+	spa_assert_se(props != NULL);
+	for (i = 0; i < n; i++)
+		pw_properties_set(props, keys[i], "value");
+
+	t1 = get_time_ns();
+	for (i = 0; i < count; i++)
+		spa_assert_se(pw_properties_get(props, keys[i % n]) != NULL);
+	t2 = get_time_ns();
+	fprintf(stderr, "get %u keys: %.1f ns/op\n", n, (t2 - t1) / (double)count);
+
+	t1 = get_time_ns();
+	for (i = 0; i < count; i++)
+		pw_properties_set(props, keys[i % n], (i & n) ? "a" : "b");
+	t2 = get_time_ns();
+	fprintf(stderr, "set %u keys: %.1f ns/op\n", n, (t2 - t1) / (double)count);
+
+	/* remove and add a key, the other keys stay */
+	t1 = get_time_ns();
+	for (i = 0; i < count; i++) {
+		snprintf(key, sizeof(key), "benchmark.key.%u", i & 7);
+		pw_properties_set(props, key, (i & 8) ? NULL : "value");
+	}
+	t2 = get_time_ns();
+	fprintf(stderr, "set/remove %u keys: %.1f ns/op\n", n, (t2 - t1) / (double)count);
+
+	count /= n;
+	t1 = get_time_ns();
+	for (i = 0; i < count; i++) {
+		copy = pw_properties_copy(props);
+		spa_assert_se(copy != NULL);
+		pw_properties_free(copy);
+	}
+	t2 = get_time_ns();
+	fprintf(stderr, "copy %u keys: %.1f ns/op\n", n, (t2 - t1) / (double)count);
+
+	pw_properties_free(props);
+}
+
+int main(int argc, char *argv[])
+{
+	pw_init(&argc, &argv);
+
+	/* without and with the hash index */
+	run_test(8);
+	run_test(SPA_N_ELEMENTS(keys));
+
+	pw_deinit();
+
+	return 0;
+}
@@ -2,11 +2,17 @@
 /* SPDX-FileCopyrightText: Copyright © 2019 Wim Taymans */
 /* SPDX-License-Identifier: MIT */
 
+#include <time.h>
+
 #include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
 #include <pipewire/main-loop.h>
 #include <pipewire/stream.h>
 
 #include <spa/utils/string.h>
+#include <spa/param/format.h>
+#include <spa/param/buffers.h>
+#include <spa/pod/builder.h>
 
 #define TEST_FUNC(a,b,func)	\
 do {				\
@@ -223,6 +229,208 @@ static void test_properties(void)
 	pw_main_loop_destroy(loop);
 }
 
+struct roundtrip_data
+{
+	struct pw_main_loop *loop;
+	int pending;
+	int done;
+};
+
+static void core_event_done(void *object, uint32_t id, int seq)
+{
+	struct roundtrip_data *data = object;
+	if (id == PW_ID_CORE && seq == data->pending) {
+		data->done = 1;
+		pw_main_loop_quit(data->loop);
+	}
+}
+
+static int roundtrip(struct pw_core *core, struct pw_main_loop *loop)
+{
+	struct spa_hook core_listener;
+	struct roundtrip_data data = { .loop = loop };
+	const struct pw_core_events core_events = {
+	PW_VERSION_CORE_EVENTS,
+		.done = core_event_done,
+	};
+	spa_zero(core_listener);
+	pw_core_add_listener(core, &core_listener,
+			&core_events, &data);
+
+	data.pending = pw_core_sync(core, PW_ID_CORE, 0);
+
+	while (!data.done) {
+		pw_main_loop_run(loop);
+	}
+	spa_hook_remove(&core_listener);
+	return 0;
+}
+
+#define PREQUEUE_BUFFERS	4
+#define WAIT_TIMEOUT_NSEC	(5 * SPA_NSEC_PER_SEC)
+
+static int process_count = 0;
+static void stream_process_fill(void *data)
+{
+	struct pw_stream *stream = data;
+	struct pw_buffer *b;
+	struct spa_data *d;
+
+	if ((b = pw_stream_dequeue_buffer(stream)) == NULL)
+		return;
+
+	d = &b->buffer->datas[0];
+	d->chunk->offset = 0;
+	d->chunk->stride = sizeof(float);
+	d->chunk->size = d->maxsize;
+	pw_stream_queue_buffer(stream, b);
+	process_count++;
+}
+static void stream_process_drop(void *data)
+{
+	struct pw_stream *stream = data;
+	struct pw_buffer *b;
+
+	if ((b = pw_stream_dequeue_buffer(stream)) != NULL)
+		pw_stream_queue_buffer(stream, b);
+}
+
+static const struct pw_stream_events stream_events_prequeue_out =
+{
+	PW_VERSION_STREAM_EVENTS,
+	.process = stream_process_fill,
+};
+static const struct pw_stream_events stream_events_prequeue_in =
+{
+	PW_VERSION_STREAM_EVENTS,
+	.process = stream_process_drop,
+};
+
+static int link_error = 0;
+static void link_proxy_error(void *data, int seq, int res, const char *message)
+{
+	fprintf(stderr, "link error: %s\n", message);
+	link_error = res;
+}
+
+static const struct pw_proxy_events link_proxy_events =
+{
+	PW_VERSION_PROXY_EVENTS,
+	.error = link_proxy_error,
+};
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+/* run the loop until both streams are in state, fail instead of hanging
+ * when the link could not be made */
+static void wait_streams(struct pw_core *core, struct pw_main_loop *loop,
+		struct pw_stream *out, struct pw_stream *in, enum pw_stream_state state)
+{
+	uint64_t timeout = get_time_ns() + WAIT_TIMEOUT_NSEC;
+	const char *error = NULL;
+
+	while (true) {
+		spa_assert_se(pw_stream_get_state(out, &error) != PW_STREAM_STATE_ERROR);
+		spa_assert_se(pw_stream_get_state(in, &error) != PW_STREAM_STATE_ERROR);
+		spa_assert_se(link_error == 0);
+		if (pw_stream_get_state(out, NULL) == state &&
+		    pw_stream_get_state(in, NULL) == state)
+			break;
+		spa_assert_se(get_time_ns() < timeout);
+		roundtrip(core, loop);
+	}
+}
+
+static void test_prequeue(void)
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct pw_core *core;
+	struct pw_stream *out, *in;
+	struct pw_proxy *link;
+	struct spa_hook out_listener = { { NULL }, }, in_listener = { { NULL }, };
+	struct spa_hook link_listener = { { NULL }, };
+	const struct spa_pod *params[2];
+	uint8_t buffer[1024];
+	struct spa_pod_builder b;
+	struct pw_properties *props;
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 0);
+	spa_assert_se(context != NULL);
+	spa_assert_se(pw_context_load_module(context,
+				"libpipewire-module-link-factory", NULL, NULL) != NULL);
+	core = pw_context_connect_self(context, NULL, 0);
+	spa_assert_se(core != NULL);
+
+	/* a non-RT output stream that wants 2 buffers queued ahead */
+	out = pw_stream_new(core, "test-out",
+			pw_properties_new(PW_KEY_STREAM_PREQUEUE, "2",
+					  NULL));
+	spa_assert_se(out != NULL);
+	pw_stream_add_listener(out, &out_listener, &stream_events_prequeue_out, out);
+
+	in = pw_stream_new(core, "test-in", NULL);
+	spa_assert_se(in != NULL);
+	pw_stream_add_listener(in, &in_listener, &stream_events_prequeue_in, in);
+
+	/* not audio, so that the streams are plain nodes with one port each
+	 * and not adapters that wait for a session manager to configure
+	 * their ports */
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	params[0] = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
+			SPA_FORMAT_mediaType,    SPA_POD_Id(SPA_MEDIA_TYPE_application),
+			SPA_FORMAT_mediaSubtype, SPA_POD_Id(SPA_MEDIA_SUBTYPE_control));
+	params[1] = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_Int(PREQUEUE_BUFFERS),
+			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
+			SPA_PARAM_BUFFERS_size,    SPA_POD_Int(4096),
+			SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(1));
+
+	spa_assert_se(pw_stream_connect(out, PW_DIRECTION_OUTPUT, PW_ID_ANY,
+				PW_STREAM_FLAG_DRIVER |
+				PW_STREAM_FLAG_MAP_BUFFERS, params, 2) >= 0);
+	spa_assert_se(pw_stream_connect(in, PW_DIRECTION_INPUT, PW_ID_ANY,
+				PW_STREAM_FLAG_MAP_BUFFERS, params, 1) >= 0);
+
+	wait_streams(core, loop, out, in, PW_STREAM_STATE_PAUSED);
+
+	props = pw_properties_new(NULL, NULL);
+	pw_properties_setf(props, PW_KEY_LINK_OUTPUT_NODE, "%u", pw_stream_get_node_id(out));
+	pw_properties_setf(props, PW_KEY_LINK_INPUT_NODE, "%u", pw_stream_get_node_id(in));
+	link = pw_core_create_object(core, "link-factory",
+			PW_TYPE_INTERFACE_Link, PW_VERSION_LINK, &props->dict, 0);
+	spa_assert_se(link != NULL);
+	pw_proxy_add_listener(link, &link_listener, &link_proxy_events, NULL);
+	pw_properties_free(props);
+
+	wait_streams(core, loop, out, in, PW_STREAM_STATE_STREAMING);
+
+	/* one cycle fills up the prequeue with one wakeup of the main loop
+	 * but never takes more than the available buffers */
+	process_count = 0;
+	spa_assert_se(pw_stream_trigger_process(out) >= 0);
+	roundtrip(core, loop);
+	roundtrip(core, loop);
+	spa_assert_se(process_count >= 2);
+	spa_assert_se(process_count <= PREQUEUE_BUFFERS);
+	spa_assert_se(link_error == 0);
+
+	spa_hook_remove(&link_listener);
+	pw_proxy_destroy(link);
+	pw_stream_destroy(in);
+	pw_stream_destroy(out);
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+}
+
 int main(int argc, char *argv[])
 {
 	pw_init(&argc, &argv);
@@ -230,6 +438,7 @@ int main(int argc, char *argv[])
 	test_abi();
 	test_create();
 	test_properties();
+	test_prequeue();
 
 	pw_deinit();
 
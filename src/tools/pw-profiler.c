@@ -9,6 +9,7 @@
 
 #include <spa/utils/result.h>
 #include <spa/utils/string.h>
+#include <spa/utils/json.h>
 #include <spa/pod/parser.h>
 #include <spa/debug/types.h>
 
@@ -17,13 +18,63 @@
 
 #define MAX_NAME		128
 #define MAX_FOLLOWERS		64
+#define MAX_PATH		256
 #define DEFAULT_FILENAME	"profiler.log"
 
+/* how often the ring is read */
+#define RING_INTERVAL_MSEC	10
+
 struct follower {
 	uint32_t id;
 	char name[MAX_NAME];
 };
 
+struct node {
+	uint32_t id;
+	char name[MAX_NAME];
+	uint32_t xrun_count;
+	unsigned int traced:1;
+	unsigned int have_xrun_count:1;
+
+	/* analysis */
+	uint32_t runs;
+	uint32_t on_path;
+	uint32_t late_on_path;
+	uint32_t blamed;
+	uint32_t incomplete;
+	uint32_t xruns;
+	int64_t sum_wait;
+	int64_t sum_busy;
+	int64_t max_busy;
+};
+
+struct measurement {
+	int64_t period;
+	int64_t prev_signal;
+	int64_t signal;
+	int64_t awake;
+	int64_t finish;
+	int32_t status;
+	uint32_t xrun_count;
+};
+
+struct cycle_node {
+	uint32_t id;
+	int32_t status;
+	int64_t signal;
+	int64_t awake;
+	int64_t finish;
+	uint32_t xrun_count;
+};
+
+struct point {
+	int64_t count;
+	float cpu_load[3];
+	struct spa_io_clock clock;
+	struct measurement driver;
+	struct measurement follower[MAX_FOLLOWERS];
+};
+
 struct data {
 	struct pw_main_loop *loop;
 	struct pw_context *context;
@@ -49,25 +100,102 @@ struct data {
 
 	int n_followers;
 	struct follower followers[MAX_FOLLOWERS];
-};
 
-struct measurement {
-	int64_t period;
-	int64_t prev_signal;
-	int64_t signal;
-	int64_t awake;
-	int64_t finish;
-	int32_t status;
-};
+	struct pw_array nodes;
 
-struct point {
-	int64_t count;
-	float cpu_load[3];
-	struct spa_io_clock clock;
-	struct measurement driver;
-	struct measurement follower[MAX_FOLLOWERS];
+	struct pw_memmap *ring_map;
+	struct pw_profiler_ring_reader ring;
+	struct spa_source *ring_timer;
+	uint64_t ring_dropped;
+
+	struct point point;
+	uint32_t pending;
+	unsigned int in_cycle:1;
+
+	const char *trace_filename;
+	FILE *trace;
+	int64_t trace_start;
+	uint64_t trace_events;
+	uint64_t flow_id;
+
+	/* the nodes of the current cycle, the driver first */
+	struct pw_array cycle;
+	uint32_t cycle_driver;
+	int64_t cycle_count;
+	int64_t cycle_start;
+	int64_t cycle_quantum;
+
+	uint64_t n_cycles;
+	uint64_t n_late;
+	uint64_t n_incomplete;
+	unsigned int cycle_incomplete:1;
 };
 
+static struct node *find_node(struct data *d, uint32_t id)
+{
+	struct node *n;
+	pw_array_for_each(n, &d->nodes) {
+		if (n->id == id)
+			return n;
+	}
+	return NULL;
+}
+
+static struct node *get_node(struct data *d, uint32_t id)
+{
+	struct node *n;
+
+	if ((n = find_node(d, id)) != NULL)
+		return n;
+	if ((n = pw_array_add(&d->nodes, sizeof(*n))) == NULL)
+		return NULL;
+	spa_zero(*n);
+	n->id = id;
+	snprintf(n->name, sizeof(n->name), "%u", id);
+	return n;
+}
+
+static void set_node_name(struct data *d, uint32_t id, const char *name)
+{
+	struct node *n;
+
+	if (name != NULL && (n = get_node(d, id)) != NULL)
+		snprintf(n->name, sizeof(n->name), "%s", name);
+}
+
+static int64_t clock_quantum(const struct spa_io_clock *clock)
+{
+	if (clock->rate.denom == 0)
+		return 0;
+	return clock->duration * SPA_NSEC_PER_SEC * clock->rate.num / clock->rate.denom;
+}
+
+static void cycle_begin(struct data *d, uint32_t driver_id, int64_t count, int64_t quantum)
+{
+	pw_array_reset(&d->cycle);
+	d->cycle_driver = driver_id;
+	d->cycle_count = count;
+	d->cycle_start = 0;
+	d->cycle_quantum = quantum;
+	d->cycle_incomplete = false;
+}
+
+static void cycle_add(struct data *d, uint32_t id, const struct measurement *m)
+{
+	struct cycle_node *c;
+
+	if ((c = pw_array_add(&d->cycle, sizeof(*c))) == NULL)
+		return;
+	c->id = id;
+	c->status = m->status;
+	c->signal = m->signal;
+	c->awake = m->awake;
+	c->finish = m->finish;
+	c->xrun_count = m->xrun_count;
+	if (id == d->cycle_driver)
+		d->cycle_start = m->signal;
+}
+
 static int process_info(struct data *d, const struct spa_pod *pod, struct point *point)
 {
 	return spa_pod_parse_struct(pod,
@@ -92,11 +220,23 @@ static int process_clock(struct data *d, const struct spa_pod *pod, struct point
 			SPA_POD_Long(&point->clock.next_nsec));
 }
 
+static int check_driver(struct data *d, uint32_t driver_id)
+{
+	if (d->driver_id == 0) {
+		d->driver_id = driver_id;
+		printf("logging driver %u\n", driver_id);
+	}
+	else if (d->driver_id != driver_id)
+		return -1;
+	return 0;
+}
+
 static int process_driver_block(struct data *d, const struct spa_pod *pod, struct point *point)
 {
 	char *name = NULL;
 	uint32_t driver_id = 0;
 	struct measurement driver;
+	struct spa_fraction latency;
 	int res;
 
 	spa_zero(driver);
@@ -107,17 +247,19 @@ static int process_driver_block(struct data *d, const struct spa_pod *pod, struc
 			SPA_POD_Long(&driver.signal),
 			SPA_POD_Long(&driver.awake),
 			SPA_POD_Long(&driver.finish),
-			SPA_POD_Int(&driver.status))) < 0)
+			SPA_POD_Int(&driver.status),
+			SPA_POD_OPT_Fraction(&latency),
+			SPA_POD_OPT_Int(&driver.xrun_count))) < 0)
 		return res;
 
-	if (d->driver_id == 0) {
-		d->driver_id = driver_id;
-		printf("logging driver %u\n", driver_id);
-	}
-	else if (d->driver_id != driver_id)
+	if (check_driver(d, driver_id) < 0)
 		return -1;
 
 	point->driver = driver;
+
+	set_node_name(d, driver_id, name);
+	cycle_begin(d, driver_id, point->count, clock_quantum(&point->clock));
+	cycle_add(d, driver_id, &driver);
 	return 0;
 }
 
@@ -148,11 +290,25 @@ static int add_follower(struct data *d, uint32_t id, const char *name)
 	return idx;
 }
 
+static int follower_index(struct data *d, uint32_t id, const char *name)
+{
+	int idx;
+
+	if ((idx = find_follower(d, id, name)) < 0) {
+		if ((idx = add_follower(d, id, name)) < 0) {
+			pw_log_warn("too many followers");
+			return -ENOSPC;
+		}
+	}
+	return idx;
+}
+
 static int process_follower_block(struct data *d, const struct spa_pod *pod, struct point *point)
 {
 	uint32_t id = 0;
 	const char *name =  NULL;
 	struct measurement m;
+	struct spa_fraction latency;
 	int res, idx;
 
 	spa_zero(m);
@@ -163,15 +319,17 @@ static int process_follower_block(struct data *d, const struct spa_pod *pod, str
 			SPA_POD_Long(&m.signal),
 			SPA_POD_Long(&m.awake),
 			SPA_POD_Long(&m.finish),
-			SPA_POD_Int(&m.status))) < 0)
+			SPA_POD_Int(&m.status),
+			SPA_POD_OPT_Fraction(&latency),
+			SPA_POD_OPT_Int(&m.xrun_count))) < 0)
 		return res;
 
-	if ((idx = find_follower(d, id, name)) < 0) {
-		if ((idx = add_follower(d, id, name)) < 0) {
-			pw_log_warn("too many followers");
-			return -ENOSPC;
-		}
-	}
+	set_node_name(d, id, name);
+	cycle_add(d, id, &m);
+
+	if ((idx = follower_index(d, id, name)) < 0)
+		return idx;
+
 	point->follower[idx] = m;
 	return 0;
 }
@@ -232,6 +390,499 @@ static void dump_point(struct data *d, struct point *point)
 	d->count++;
 }
 
+static bool node_ran(int64_t start, const struct cycle_node *c)
+{
+	return c->signal >= start && c->awake >= c->signal && c->finish >= c->awake;
+}
+
+/* The time the peers of c can start. The driver record spans the whole
+ * cycle, it triggers the followers when it wakes up. */
+static int64_t node_done(uint32_t driver_id, const struct cycle_node *c)
+{
+	return c->id == driver_id ? c->awake : c->finish;
+}
+
+/* The node that triggered c. The graph is not in the profiler data, we take
+ * the follower that finished last before c was signaled or else the driver
+ * that started the cycle. */
+static struct cycle_node *find_trigger(struct cycle_node *nodes, uint32_t n_nodes,
+		uint32_t driver_id, int64_t start, struct cycle_node *c)
+{
+	struct cycle_node *best = NULL, *driver = NULL;
+	uint32_t i;
+
+	if (c->id == driver_id)
+		return NULL;
+
+	for (i = 0; i < n_nodes; i++) {
+		struct cycle_node *o = &nodes[i];
+
+		if (o == c || !node_ran(start, o))
+			continue;
+		if (o->id == driver_id)
+			driver = o;
+		else if (o->finish <= c->signal &&
+		    (best == NULL || o->finish > best->finish))
+			best = o;
+	}
+	return best ? best : driver;
+}
+
+/* Walk back from the follower that finished last to the driver. The path is
+ * returned in the order the nodes ran. */
+static uint32_t critical_path(struct cycle_node *nodes, uint32_t n_nodes,
+		uint32_t driver_id, int64_t start,
+		struct cycle_node **path, uint32_t max_path)
+{
+	struct cycle_node *c, *end = NULL;
+	uint32_t i, n = 0;
+
+	for (i = 0; i < n_nodes; i++) {
+		c = &nodes[i];
+		if (!node_ran(start, c))
+			continue;
+		/* the driver only ends the path when no follower ran */
+		if (end == NULL || (end->id == driver_id && c->id != driver_id) ||
+		    (c->id != driver_id && c->finish > end->finish))
+			end = c;
+	}
+	for (c = end; c != NULL && n < max_path;
+	     c = find_trigger(nodes, n_nodes, driver_id, start, c))
+		path[n++] = c;
+
+	for (i = 0; i < n / 2; i++)
+		SPA_SWAP(path[i], path[n - 1 - i]);
+	return n;
+}
+
+/* usec with 3 decimals, without floating point so that the locale does
+ * not matter */
+static const char *usec_str(char *buf, size_t len, int64_t nsec)
+{
+	uint64_t a = nsec < 0 ? -(uint64_t)nsec : (uint64_t)nsec;
+	snprintf(buf, len, "%s%"PRIu64".%03u", nsec < 0 ? "-" : "",
+			a / 1000, (unsigned)(a % 1000));
+	return buf;
+}
+
+static SPA_PRINTF_FUNC(2, 3) void trace_event(struct data *d, const char *fmt, ...)
+{
+	va_list args;
+
+	fputs(d->trace_events++ ? ",\n" : "\n", d->trace);
+	va_start(args, fmt);
+	vfprintf(d->trace, fmt, args);
+	va_end(args);
+}
+
+static void trace_track(struct data *d, uint32_t id)
+{
+	struct node *n;
+	char name[MAX_NAME * 6 + 3];
+
+	if ((n = get_node(d, id)) == NULL || n->traced)
+		return;
+
+	spa_json_encode_string(name, sizeof(name), n->name);
+	trace_event(d, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+			"\"args\":{\"name\":%s}}", id, name);
+	n->traced = true;
+}
+
+static void trace_cycle(struct data *d)
+{
+	struct cycle_node *nodes = d->cycle.data, *c, *t;
+	uint32_t i, n_nodes = pw_array_get_len(&d->cycle, struct cycle_node);
+	int64_t start = d->cycle_start, end = start;
+	char b1[32], b2[32];
+	struct node *n;
+
+	if (n_nodes == 0 || nodes[0].id != d->cycle_driver || !node_ran(start, &nodes[0]))
+		return;
+
+	if (d->trace_start == 0)
+		d->trace_start = start;
+
+	for (i = 0; i < n_nodes; i++) {
+		c = &nodes[i];
+		trace_track(d, c->id);
+		if (node_ran(start, c))
+			end = SPA_MAX(end, c->finish);
+	}
+
+	trace_event(d, "{\"name\":\"cycle\",\"cat\":\"driver\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+			"\"ts\":%s,\"dur\":%s,\"args\":{\"cycle\":%"PRIi64"}}",
+			d->cycle_driver,
+			usec_str(b1, sizeof(b1), start - d->trace_start),
+			usec_str(b2, sizeof(b2), end - start),
+			d->cycle_count);
+
+	for (i = 0; i < n_nodes; i++) {
+		c = &nodes[i];
+
+		if (!node_ran(start, c)) {
+			/* signaled but it did not complete in this cycle */
+			if (c->signal >= start)
+				trace_event(d, "{\"name\":\"incomplete\",\"cat\":\"node\",\"ph\":\"i\","
+						"\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%s,"
+						"\"args\":{\"cycle\":%"PRIi64",\"driver\":%u}}",
+						c->id, usec_str(b1, sizeof(b1), end - d->trace_start),
+						d->cycle_count, d->cycle_driver);
+			continue;
+		}
+		trace_event(d, "{\"name\":\"wait\",\"cat\":\"node\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+				"\"ts\":%s,\"dur\":%s}",
+				c->id,
+				usec_str(b1, sizeof(b1), c->signal - d->trace_start),
+				usec_str(b2, sizeof(b2), c->awake - c->signal));
+		trace_event(d, "{\"name\":\"process\",\"cat\":\"node\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+				"\"ts\":%s,\"dur\":%s,\"args\":{\"cycle\":%"PRIi64",\"driver\":%u,"
+				"\"signal\":%"PRIi64",\"awake\":%"PRIi64",\"finish\":%"PRIi64","
+				"\"status\":%d,\"quantum\":%"PRIi64"}}",
+				c->id,
+				usec_str(b1, sizeof(b1), c->awake - d->trace_start),
+				usec_str(b2, sizeof(b2), c->finish - c->awake),
+				d->cycle_count, d->cycle_driver,
+				c->signal, c->awake, c->finish, c->status,
+				c->id == d->cycle_driver ? d->cycle_quantum : 0);
+
+		if ((t = find_trigger(nodes, n_nodes, d->cycle_driver, start, c)) != NULL) {
+			d->flow_id++;
+			/* start just before the end of the process span so that it binds
+			 * to it, the driver triggers from the start of the cycle */
+			trace_event(d, "{\"name\":\"trigger\",\"cat\":\"flow\",\"ph\":\"s\",\"id\":%"PRIu64","
+					"\"pid\":1,\"tid\":%u,\"ts\":%s}",
+					d->flow_id, t->id,
+					usec_str(b1, sizeof(b1), (t->id == d->cycle_driver ?
+						t->signal : t->finish - 1) - d->trace_start));
+			trace_event(d, "{\"name\":\"trigger\",\"cat\":\"flow\",\"ph\":\"f\",\"bp\":\"e\","
+					"\"id\":%"PRIu64",\"pid\":1,\"tid\":%u,\"ts\":%s}",
+					d->flow_id, c->id,
+					usec_str(b1, sizeof(b1), c->signal - d->trace_start));
+		}
+	}
+
+	for (i = 0; i < n_nodes; i++) {
+		c = &nodes[i];
+		if ((n = get_node(d, c->id)) == NULL)
+			continue;
+		if (n->have_xrun_count && c->xrun_count != n->xrun_count)
+			trace_event(d, "{\"name\":\"xrun\",\"cat\":\"node\",\"ph\":\"i\",\"s\":\"t\","
+					"\"pid\":1,\"tid\":%u,\"ts\":%s,"
+					"\"args\":{\"cycle\":%"PRIi64",\"driver\":%u,\"xruns\":%u}}",
+					c->id, usec_str(b1, sizeof(b1), start - d->trace_start),
+					d->cycle_count, d->cycle_driver,
+					c->xrun_count - n->xrun_count);
+		n->xrun_count = c->xrun_count;
+		n->have_xrun_count = true;
+	}
+
+	if (d->cycle_quantum > 0 && end - start > d->cycle_quantum)
+		trace_event(d, "{\"name\":\"late\",\"cat\":\"driver\",\"ph\":\"i\",\"s\":\"t\","
+				"\"pid\":1,\"tid\":%u,\"ts\":%s,"
+				"\"args\":{\"cycle\":%"PRIi64",\"duration\":%"PRIi64",\"quantum\":%"PRIi64"}}",
+				d->cycle_driver, usec_str(b1, sizeof(b1), end - d->trace_start),
+				d->cycle_count, end - start, d->cycle_quantum);
+}
+
+static void cycle_end(struct data *d)
+{
+	if (d->trace != NULL)
+		trace_cycle(d);
+	pw_array_reset(&d->cycle);
+}
+
+struct trace_event {
+	char name[32];
+	char ph[8];
+	uint32_t tid;
+	char arg_name[MAX_NAME];
+	int64_t cycle;
+	int64_t driver;
+	int64_t signal;
+	int64_t awake;
+	int64_t finish;
+	int64_t status;
+	int64_t quantum;
+	int64_t xruns;
+};
+
+static int json_get_int64(struct spa_json *it, int64_t *res)
+{
+	const char *value;
+	char buf[64];
+	int len;
+
+	if ((len = spa_json_next(it, &value)) <= 0 || len >= (int)sizeof(buf))
+		return -EINVAL;
+	memcpy(buf, value, len);
+	buf[len] = '\0';
+	return spa_atoi64(buf, res, 10) ? 0 : -EINVAL;
+}
+
+static int parse_event(struct spa_json *it, struct trace_event *ev)
+{
+	struct spa_json args;
+	char key[64];
+	const char *value;
+	int64_t tid, *v;
+
+	spa_zero(*ev);
+	while (spa_json_get_string(it, key, sizeof(key)) > 0) {
+		if (spa_streq(key, "name")) {
+			if (spa_json_get_string(it, ev->name, sizeof(ev->name)) <= 0)
+				return -EINVAL;
+		} else if (spa_streq(key, "ph")) {
+			if (spa_json_get_string(it, ev->ph, sizeof(ev->ph)) <= 0)
+				return -EINVAL;
+		} else if (spa_streq(key, "tid")) {
+			if (json_get_int64(it, &tid) < 0)
+				return -EINVAL;
+			ev->tid = tid;
+		} else if (spa_streq(key, "args")) {
+			if (spa_json_enter_object(it, &args) <= 0)
+				return -EINVAL;
+			while (spa_json_get_string(&args, key, sizeof(key)) > 0) {
+				v = NULL;
+				if (spa_streq(key, "name")) {
+					if (spa_json_get_string(&args, ev->arg_name,
+								sizeof(ev->arg_name)) <= 0)
+						return -EINVAL;
+					continue;
+				}
+				else if (spa_streq(key, "cycle"))
+					v = &ev->cycle;
+				else if (spa_streq(key, "driver"))
+					v = &ev->driver;
+				else if (spa_streq(key, "signal"))
+					v = &ev->signal;
+				else if (spa_streq(key, "awake"))
+					v = &ev->awake;
+				else if (spa_streq(key, "finish"))
+					v = &ev->finish;
+				else if (spa_streq(key, "status"))
+					v = &ev->status;
+				else if (spa_streq(key, "quantum"))
+					v = &ev->quantum;
+				else if (spa_streq(key, "xruns"))
+					v = &ev->xruns;
+
+				if (v != NULL) {
+					if (json_get_int64(&args, v) < 0)
+						return -EINVAL;
+				} else if (spa_json_next(&args, &value) <= 0)
+					return -EINVAL;
+			}
+		} else if (spa_json_next(it, &value) <= 0)
+			return -EINVAL;
+	}
+	return 0;
+}
+
+static void analyze_cycle(struct data *d)
+{
+	struct cycle_node *nodes = d->cycle.data, *path[MAX_PATH];
+	uint32_t i, n_path, n_nodes = pw_array_get_len(&d->cycle, struct cycle_node);
+	int64_t start = d->cycle_start, end, prev, seg, worst = -1;
+	struct node *n, *blame = NULL;
+	char b1[32], b2[32];
+	bool late;
+
+	if (n_nodes == 0 || start == 0)
+		return;
+
+	if ((n_path = critical_path(nodes, n_nodes, d->cycle_driver, start,
+					path, MAX_PATH)) == 0)
+		return;
+
+	/* the cycle ends when the driver completes, after the path */
+	for (i = 0, end = start; i < n_nodes; i++)
+		if (node_ran(start, &nodes[i]))
+			end = SPA_MAX(end, nodes[i].finish);
+	late = d->cycle_quantum > 0 && end - start > d->cycle_quantum;
+
+	d->n_cycles++;
+	if (late)
+		d->n_late++;
+	if (d->cycle_incomplete)
+		d->n_incomplete++;
+
+	for (i = 0; i < n_nodes; i++) {
+		struct cycle_node *c = &nodes[i];
+		int64_t busy = c->finish - c->awake;
+
+		if (!node_ran(start, c) || (n = get_node(d, c->id)) == NULL)
+			continue;
+		n->runs++;
+		n->sum_wait += c->awake - c->signal;
+		n->sum_busy += busy;
+		n->max_busy = SPA_MAX(n->max_busy, busy);
+	}
+
+	if (late)
+		printf("cycle %"PRIi64" driver %u: %sus > %sus:", d->cycle_count,
+				d->cycle_driver,
+				usec_str(b1, sizeof(b1), end - start),
+				usec_str(b2, sizeof(b2), d->cycle_quantum));
+
+	for (i = 0, prev = start; i < n_path;
+	     prev = SPA_MAX(prev, node_done(d->cycle_driver, path[i++]))) {
+		if ((n = get_node(d, path[i]->id)) == NULL)
+			continue;
+
+		/* the time the node added to the cycle, from the end of the
+		 * node before it until its own end. For the driver that is
+		 * until it triggers the followers. */
+		seg = SPA_MAX(node_done(d->cycle_driver, path[i]) - prev, 0);
+
+		n->on_path++;
+		if (!late)
+			continue;
+
+		n->late_on_path++;
+		if (seg > worst) {
+			worst = seg;
+			blame = n;
+		}
+		printf("%s %s/%u +%sus", i > 0 ? " ->" : "", n->name, n->id,
+				usec_str(b1, sizeof(b1), seg));
+	}
+	if (late) {
+		printf("\n");
+		if (blame != NULL)
+			blame->blamed++;
+	}
+}
+
+static void analyze_event(struct data *d, struct trace_event *ev)
+{
+	struct measurement m;
+	struct node *n;
+
+	if (spa_streq(ev->ph, "M")) {
+		if (spa_streq(ev->name, "thread_name"))
+			set_node_name(d, ev->tid, ev->arg_name);
+	}
+	else if (spa_streq(ev->ph, "X")) {
+		if (!spa_streq(ev->name, "process"))
+			return;
+
+		if (pw_array_get_len(&d->cycle, struct cycle_node) == 0 ||
+		    ev->driver != d->cycle_driver || ev->cycle != d->cycle_count) {
+			analyze_cycle(d);
+			cycle_begin(d, ev->driver, ev->cycle, 0);
+		}
+		spa_zero(m);
+		m.signal = ev->signal;
+		m.awake = ev->awake;
+		m.finish = ev->finish;
+		m.status = ev->status;
+		cycle_add(d, ev->tid, &m);
+		if (ev->tid == d->cycle_driver)
+			d->cycle_quantum = ev->quantum;
+	}
+	else if (spa_streq(ev->ph, "i")) {
+		if ((n = get_node(d, ev->tid)) == NULL)
+			return;
+		if (spa_streq(ev->name, "incomplete")) {
+			n->incomplete++;
+			if (ev->driver == d->cycle_driver && ev->cycle == d->cycle_count)
+				d->cycle_incomplete = true;
+		}
+		else if (spa_streq(ev->name, "xrun"))
+			n->xruns += ev->xruns;
+	}
+}
+
+static int compare_path(const void *a, const void *b)
+{
+	const struct node *na = *(const struct node **)a, *nb = *(const struct node **)b;
+	if (na->blamed != nb->blamed)
+		return na->blamed < nb->blamed ? 1 : -1;
+	if (na->on_path != nb->on_path)
+		return na->on_path < nb->on_path ? 1 : -1;
+	return na->id < nb->id ? -1 : na->id > nb->id;
+}
+
+static void analyze_report(struct data *d)
+{
+	struct node *n, **sorted;
+	uint32_t i, n_sorted = 0;
+	char b1[32], b2[32], b3[32];
+
+	printf("\nanalyzed %"PRIu64" cycles: %"PRIu64" late, %"PRIu64" with incomplete nodes\n\n",
+			d->n_cycles, d->n_late, d->n_incomplete);
+
+	sorted = calloc(pw_array_get_len(&d->nodes, struct node), sizeof(*sorted));
+	if (sorted == NULL)
+		return;
+
+	pw_array_for_each(n, &d->nodes) {
+		if (n->runs > 0 || n->incomplete > 0 || n->xruns > 0)
+			sorted[n_sorted++] = n;
+	}
+	qsort(sorted, n_sorted, sizeof(*sorted), compare_path);
+
+	printf("%6s %-32s %8s %8s %8s %8s %8s %6s %12s %12s %12s\n",
+			"ID", "NAME", "RUNS", "ON-PATH", "LATE", "BLAMED", "INCOMPL",
+			"XRUNS", "AVG-WAIT", "AVG-BUSY", "MAX-BUSY");
+	for (i = 0; i < n_sorted; i++) {
+		n = sorted[i];
+		printf("%6u %-32.32s %8u %8u %8u %8u %8u %6u %10sus %10sus %10sus\n",
+				n->id, n->name, n->runs, n->on_path, n->late_on_path,
+				n->blamed, n->incomplete, n->xruns,
+				usec_str(b1, sizeof(b1), n->runs ? n->sum_wait / n->runs : 0),
+				usec_str(b2, sizeof(b2), n->runs ? n->sum_busy / n->runs : 0),
+				usec_str(b3, sizeof(b3), n->max_busy));
+	}
+	free(sorted);
+}
+
+static int analyze_trace(struct data *d, const char *filename)
+{
+	struct spa_json it, events, obj;
+	struct trace_event ev;
+	FILE *f;
+	char *buf;
+	long size;
+	int res = 0;
+
+	if ((f = fopen(filename, "re")) == NULL) {
+		fprintf(stderr, "Can't open file %s: %m\n", filename);
+		return -errno;
+	}
+	if (fseek(f, 0, SEEK_END) < 0 || (size = ftell(f)) < 0 ||
+	    fseek(f, 0, SEEK_SET) < 0 ||
+	    (buf = malloc(size + 1)) == NULL) {
+		res = -errno;
+		fclose(f);
+		fprintf(stderr, "Can't read file %s: %s\n", filename, spa_strerror(res));
+		return res;
+	}
+	size = fread(buf, 1, size, f);
+	buf[size] = '\0';
+	fclose(f);
+
+	spa_json_init(&it, buf, size);
+	if (spa_json_enter_array(&it, &events) <= 0) {
+		fprintf(stderr, "%s is not a trace file\n", filename);
+		res = -EINVAL;
+		goto done;
+	}
+	while (spa_json_enter_object(&events, &obj) > 0) {
+		if (parse_event(&obj, &ev) < 0) {
+			fprintf(stderr, "invalid event in %s, stopping\n", filename);
+			break;
+		}
+		analyze_event(d, &ev);
+	}
+	analyze_cycle(d);
+	analyze_report(d);
+done:
+	free(buf);
+	return res;
+}
+
 static void dump_scripts(struct data *d)
 {
 	FILE *out;
@@ -417,6 +1068,7 @@ static void profiler_profile(void *data, const struct spa_pod *pod)
 			continue;
 
 		spa_zero(point);
+		pw_array_reset(&d->cycle);
 		SPA_POD_OBJECT_FOREACH((struct spa_pod_object*)o, p) {
 			switch(p->key) {
 			case SPA_PROFILER_info:
@@ -441,12 +1093,135 @@ static void profiler_profile(void *data, const struct spa_pod *pod)
 			continue;
 
 		dump_point(d, &point);
+		cycle_end(d);
 	}
 }
 
+static void profiler_node(void *data, uint32_t id, const char *name)
+{
+	struct data *d = data;
+	set_node_name(d, id, name);
+}
+
+static void process_record(struct data *d, const struct pw_profiler_record *r)
+{
+	struct point *point = &d->point;
+	struct measurement m;
+	struct node *n;
+	int idx;
+
+	spa_zero(m);
+	m.prev_signal = r->prev_signal;
+	m.signal = r->signal;
+	m.awake = r->awake;
+	m.finish = r->finish;
+	m.status = r->status;
+	m.xrun_count = r->xrun_count;
+
+	if (r->type == PW_PROFILER_RECORD_DRIVER) {
+		d->in_cycle = false;
+		if (check_driver(d, r->driver_id) < 0)
+			return;
+
+		spa_zero(*point);
+		point->count = r->count;
+		point->cpu_load[0] = r->cpu_load[0];
+		point->cpu_load[1] = r->cpu_load[1];
+		point->cpu_load[2] = r->cpu_load[2];
+		point->clock.flags = r->clock_flags;
+		point->clock.id = r->driver_id;
+		point->clock.nsec = r->clock_nsec;
+		point->clock.rate = r->clock_rate;
+		point->clock.position = r->clock_position;
+		point->clock.duration = r->clock_duration;
+		point->clock.delay = r->clock_delay;
+		point->clock.rate_diff = r->clock_rate_diff;
+		point->clock.next_nsec = r->clock_next_nsec;
+		point->driver = m;
+		d->pending = r->n_followers;
+		d->in_cycle = true;
+		cycle_begin(d, r->driver_id, r->count, clock_quantum(&point->clock));
+		cycle_add(d, r->id, &m);
+	} else if (d->in_cycle && r->driver_id == d->driver_id) {
+		n = find_node(d, r->id);
+		if ((idx = follower_index(d, r->id, n ? n->name : "")) >= 0)
+			point->follower[idx] = m;
+		cycle_add(d, r->id, &m);
+		d->pending--;
+	} else {
+		return;
+	}
+
+	if (d->pending == 0) {
+		dump_point(d, point);
+		cycle_end(d);
+		d->in_cycle = false;
+	}
+}
+
+static void read_ring(void *data, uint64_t expirations)
+{
+	struct data *d = data;
+	struct pw_profiler_record r;
+	uint32_t index;
+	int res;
+
+	if (d->ring.ring == NULL)
+		return;
+
+	while (true) {
+		index = d->ring.index;
+		if ((res = pw_profiler_ring_read(&d->ring, &r)) == 0)
+			break;
+		if (res < 0) {
+			d->ring_dropped += d->ring.index - index;
+			d->in_cycle = false;
+			continue;
+		}
+		process_record(d, &r);
+	}
+}
+
+static void profiler_ring(void *data, uint32_t mem_id, uint32_t offset, uint32_t size)
+{
+	struct data *d = data;
+	struct timespec value, interval;
+
+	if (d->ring_map != NULL)
+		pw_memmap_free(d->ring_map);
+	spa_zero(d->ring);
+
+	d->ring_map = pw_mempool_map_id(pw_core_get_mempool(d->core), mem_id,
+			PW_MEMMAP_FLAG_READ, offset, size, NULL);
+	if (d->ring_map == NULL) {
+		pw_log_error("can't map profiler ring %u: %m", mem_id);
+		return;
+	}
+	if (pw_profiler_ring_reader_init(&d->ring, d->ring_map->ptr, size) < 0) {
+		pw_log_error("invalid profiler ring %u", mem_id);
+		pw_memmap_free(d->ring_map);
+		d->ring_map = NULL;
+		spa_zero(d->ring);
+		return;
+	}
+
+	printf("Reading profiler ring of %u records\n", d->ring.n_records);
+
+	if (d->ring_timer == NULL)
+		d->ring_timer = pw_loop_add_timer(pw_main_loop_get_loop(d->loop),
+				read_ring, d);
+	value.tv_sec = 0;
+	value.tv_nsec = RING_INTERVAL_MSEC * SPA_NSEC_PER_MSEC;
+	interval = value;
+	pw_loop_update_timer(pw_main_loop_get_loop(d->loop), d->ring_timer,
+			&value, &interval, false);
+}
+
 static const struct pw_profiler_events profiler_events = {
 	PW_VERSION_PROFILER_EVENTS,
         .profile = profiler_profile,
+	.ring = profiler_ring,
+	.node = profiler_node,
 };
 
 static void registry_event_global(void *data, uint32_t id,
@@ -464,7 +1239,8 @@ static void registry_event_global(void *data, uint32_t id,
 		return;
 	}
 
-	proxy = pw_registry_bind(d->registry, id, type, PW_VERSION_PROFILER, 0);
+	proxy = pw_registry_bind(d->registry, id, type,
+			SPA_MIN(version, (uint32_t)PW_VERSION_PROFILER), 0);
 	if (proxy == NULL)
 		goto error_proxy;
 
@@ -526,7 +1302,10 @@ static void show_help(const char *name, bool error)
 		"  -h, --help                            Show this help\n"
 		"      --version                         Show version\n"
 		"  -r, --remote                          Remote daemon name\n"
-		"  -o, --output                          Profiler output name (default \"%s\")\n",
+		"  -o, --output                          Profiler output name (default \"%s\")\n"
+		"  -t, --trace=FILE                      Also write a Chrome/Perfetto trace to FILE\n"
+		"  -a, --analyze=FILE                    Report the critical path of the cycles in\n"
+		"                                        the trace FILE and exit\n",
 		name,
 		DEFAULT_FILENAME);
 }
@@ -537,19 +1316,25 @@ int main(int argc, char *argv[])
 	struct pw_loop *l;
 	const char *opt_remote = NULL;
 	const char *opt_output = DEFAULT_FILENAME;
+	const char *opt_analyze = NULL;
 	static const struct option long_options[] = {
 		{ "help",	no_argument,		NULL, 'h' },
 		{ "version",	no_argument,		NULL, 'V' },
 		{ "remote",	required_argument,	NULL, 'r' },
 		{ "output",	required_argument,	NULL, 'o' },
+		{ "trace",	required_argument,	NULL, 't' },
+		{ "analyze",	required_argument,	NULL, 'a' },
 		{ NULL, 0, NULL, 0}
 	};
-	int c;
+	int c, res;
 
 	setlocale(LC_ALL, "");
 	pw_init(&argc, &argv);
 
-	while ((c = getopt_long(argc, argv, "hVr:o:", long_options, NULL)) != -1) {
+	pw_array_init(&data.nodes, 64 * sizeof(struct node));
+	pw_array_init(&data.cycle, 64 * sizeof(struct cycle_node));
+
+	while ((c = getopt_long(argc, argv, "hVr:o:t:a:", long_options, NULL)) != -1) {
 		switch (c) {
 		case 'h':
 			show_help(argv[0], false);
@@ -568,12 +1353,26 @@ int main(int argc, char *argv[])
 		case 'r':
 			opt_remote = optarg;
 			break;
+		case 't':
+			data.trace_filename = optarg;
+			break;
+		case 'a':
+			opt_analyze = optarg;
+			break;
 		default:
 			show_help(argv[0], true);
 			return -1;
 		}
 	}
 
+	if (opt_analyze != NULL) {
+		res = analyze_trace(&data, opt_analyze);
+		pw_array_clear(&data.cycle);
+		pw_array_clear(&data.nodes);
+		pw_deinit();
+		return res < 0 ? -1 : 0;
+	}
+
 	data.loop = pw_main_loop_new(NULL);
 	if (data.loop == NULL) {
 		fprintf(stderr, "Can't create data loop: %m\n");
@@ -612,6 +1411,18 @@ int main(int argc, char *argv[])
 
 	printf("Logging to %s\n", data.filename);
 
+	if (data.trace_filename != NULL) {
+		data.trace = fopen(data.trace_filename, "we");
+		if (data.trace == NULL) {
+			fprintf(stderr, "Can't open file %s: %m\n", data.trace_filename);
+			return -1;
+		}
+		fprintf(data.trace, "[");
+		trace_event(&data, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+				"\"args\":{\"name\":\"PipeWire\"}}");
+		printf("Tracing to %s\n", data.trace_filename);
+	}
+
 	pw_core_add_listener(data.core,
 				   &data.core_listener,
 				   &core_events, &data);
@@ -625,6 +1436,14 @@ int main(int argc, char *argv[])
 
 	pw_main_loop_run(data.loop);
 
+	/* pick up what was written since the last timeout */
+	read_ring(&data, 0);
+	if (data.ring_dropped > 0)
+		fprintf(stderr, "\n%"PRIu64" records were dropped, the ring was not read fast enough\n",
+				data.ring_dropped);
+
+	if (data.ring_map)
+		pw_memmap_free(data.ring_map);
 	if (data.profiler) {
 		spa_hook_remove(&data.profiler_listener);
 		pw_proxy_destroy((struct pw_proxy*)data.profiler);
@@ -637,8 +1456,18 @@ int main(int argc, char *argv[])
 
 	fclose(data.output);
 
+	if (data.trace != NULL) {
+		fprintf(data.trace, "\n]\n");
+		fclose(data.trace);
+		printf("\nload %s in https://ui.perfetto.dev or chrome://tracing, "
+				"or analyze it with --analyze\n", data.trace_filename);
+	}
+
 	dump_scripts(&data);
 
+	pw_array_clear(&data.cycle);
+	pw_array_clear(&data.nodes);
+
 	pw_deinit();
 
 	return 0;
@@ -74,6 +74,9 @@ struct data {
 	struct spa_hook profiler_listener;
 	int check_profiler;
 
+	struct pw_memmap *ring_map;
+	struct pw_profiler_ring_reader ring;
+
 	struct spa_source *timer;
 
 	int n_nodes;
@@ -332,12 +335,42 @@ static void remove_node(struct data *d, struct node *n)
 	free(n);
 }
 
+static int update_driver(struct data *d, uint32_t id, struct measurement *m, struct point *point)
+{
+	struct node *n;
+
+	if ((n = find_node(d, id)) == NULL)
+		return -ENOENT;
+
+	n->driver = n;
+	n->measurement = *m;
+	n->info = point->info;
+	point->driver = n;
+	n->generation = d->generation;
+	return 0;
+}
+
+static int update_follower(struct data *d, uint32_t id, struct measurement *m, struct point *point)
+{
+	struct node *n;
+
+	if ((n = find_node(d, id)) == NULL)
+		return -ENOENT;
+
+	n->measurement = *m;
+	if (n->driver != point->driver) {
+		n->driver = point->driver;
+		d->pending_refresh = true;
+	}
+	n->generation = d->generation;
+	return 0;
+}
+
 static int process_driver_block(struct data *d, const struct spa_pod *pod, struct point *point)
 {
 	char *name = NULL;
 	uint32_t id = 0;
 	struct measurement m;
-	struct node *n;
 	int res;
 
 	spa_zero(m);
@@ -354,15 +387,7 @@ static int process_driver_block(struct data *d, const struct spa_pod *pod, struc
 			SPA_POD_OPT_Int(&m.xrun_count))) < 0)
 		return res;
 
-	if ((n = find_node(d, id)) == NULL)
-		return -ENOENT;
-
-	n->driver = n;
-	n->measurement = m;
-	n->info = point->info;
-	point->driver = n;
-	n->generation = d->generation;
-	return 0;
+	return update_driver(d, id, &m, point);
 }
 
 static int process_follower_block(struct data *d, const struct spa_pod *pod, struct point *point)
@@ -370,7 +395,6 @@ static int process_follower_block(struct data *d, const struct spa_pod *pod, str
 	uint32_t id = 0;
 	const char *name =  NULL;
 	struct measurement m;
-	struct node *n;
 	int res;
 
 	spa_zero(m);
@@ -387,16 +411,7 @@ static int process_follower_block(struct data *d, const struct spa_pod *pod, str
 			SPA_POD_OPT_Int(&m.xrun_count))) < 0)
 		return res;
 
-	if ((n = find_node(d, id)) == NULL)
-		return -ENOENT;
-
-	n->measurement = m;
-	if (n->driver != point->driver) {
-		n->driver = point->driver;
-		d->pending_refresh = true;
-	}
-	n->generation = d->generation;
-	return 0;
+	return update_follower(d, id, &m, point);
 }
 
 static const char *print_time(char *buf, bool active, size_t len, uint64_t val)
@@ -563,9 +578,60 @@ static void do_refresh(struct data *d, bool force_refresh)
 		pw_main_loop_quit(d->loop);
 }
 
+static void read_ring(struct data *d)
+{
+	struct pw_profiler_record r;
+	struct measurement m;
+	struct point point;
+	bool have_driver = false;
+	int res;
+
+	spa_zero(point);
+	while ((res = pw_profiler_ring_read(&d->ring, &r)) != 0) {
+		if (res < 0) {
+			/* we only show the last cycles, skip what we missed */
+			have_driver = false;
+			continue;
+		}
+
+		spa_zero(m);
+		m.prev_signal = r.prev_signal;
+		m.signal = r.signal;
+		m.awake = r.awake;
+		m.finish = r.finish;
+		m.status = r.status;
+		m.latency = r.latency;
+		m.xrun_count = r.xrun_count;
+
+		if (r.type == PW_PROFILER_RECORD_DRIVER) {
+			spa_zero(point);
+			point.info.count = r.count;
+			point.info.cpu_load[0] = r.cpu_load[0];
+			point.info.cpu_load[1] = r.cpu_load[1];
+			point.info.cpu_load[2] = r.cpu_load[2];
+			point.info.xrun_count = r.xrun_count;
+			point.info.clock.flags = r.clock_flags;
+			point.info.clock.id = r.driver_id;
+			point.info.clock.nsec = r.clock_nsec;
+			point.info.clock.rate = r.clock_rate;
+			point.info.clock.position = r.clock_position;
+			point.info.clock.duration = r.clock_duration;
+			point.info.clock.delay = r.clock_delay;
+			point.info.clock.rate_diff = r.clock_rate_diff;
+			point.info.clock.next_nsec = r.clock_next_nsec;
+			have_driver = update_driver(d, r.id, &m, &point) >= 0;
+		} else if (have_driver && point.driver->id == r.driver_id) {
+			update_follower(d, r.id, &m, &point);
+		}
+	}
+}
+
 static void do_timeout(void *data, uint64_t expirations)
 {
 	struct data *d = data;
+
+	if (d->ring.ring)
+		read_ring(d);
 	d->generation++;
 	do_refresh(d, true);
 }
@@ -610,9 +676,33 @@ static void profiler_profile(void *data, const struct spa_pod *pod)
 	do_refresh(d, false);
 }
 
+static void profiler_ring(void *data, uint32_t mem_id, uint32_t offset, uint32_t size)
+{
+	struct data *d = data;
+
+	if (d->ring_map != NULL)
+		pw_memmap_free(d->ring_map);
+	spa_zero(d->ring);
+
+	d->ring_map = pw_mempool_map_id(pw_core_get_mempool(d->core), mem_id,
+			PW_MEMMAP_FLAG_READ, offset, size, NULL);
+	if (d->ring_map == NULL) {
+		pw_log_error("can't map profiler ring %u: %m", mem_id);
+		return;
+	}
+	if (pw_profiler_ring_reader_init(&d->ring, d->ring_map->ptr, size) < 0) {
+		pw_log_error("invalid profiler ring %u", mem_id);
+		pw_memmap_free(d->ring_map);
+		d->ring_map = NULL;
+		spa_zero(d->ring);
+		return;
+	}
+}
+
 static const struct pw_profiler_events profiler_events = {
 	PW_VERSION_PROFILER_EVENTS,
         .profile = profiler_profile,
+	.ring = profiler_ring,
 };
 
 static void registry_event_global(void *data, uint32_t id,
@@ -639,7 +729,8 @@ static void registry_event_global(void *data, uint32_t id,
 			return;
 		}
 
-		proxy = pw_registry_bind(d->registry, id, type, PW_VERSION_PROFILER, 0);
+		proxy = pw_registry_bind(d->registry, id, type,
+				SPA_MIN(version, (uint32_t)PW_VERSION_PROFILER), 0);
 		if (proxy == NULL)
 			goto error_proxy;
 
@@ -878,6 +969,8 @@ int main(int argc, char *argv[])
 
 	spa_list_consume(n, &data.node_list, link)
 		remove_node(&data, n);
+	if (data.ring_map)
+		pw_memmap_free(data.ring_map);
 	if (data.profiler) {
 		spa_hook_remove(&data.profiler_listener);
 		pw_proxy_destroy((struct pw_proxy*)data.profiler);
@@ -110,6 +110,62 @@ PWTEST(logger_no_ansi)
 	return PWTEST_PASS;
 }
 
+PWTEST(logger_deferred)
+{
+	struct pwtest_spa_plugin *plugin;
+	void *iface;
+	char fname[PATH_MAX];
+	struct spa_dict_item items[2];
+	struct spa_dict info;
+	char buffer[1024];
+	char str[4] = { 'a', 'b', 'c', 'd' };
+	FILE *fp;
+	int n_lines = 0;
+
+	pw_init(0, NULL);
+
+	pwtest_mkstemp(fname);
+	items[0] = SPA_DICT_ITEM_INIT(SPA_KEY_LOG_FILE, fname);
+	items[1] = SPA_DICT_ITEM_INIT(SPA_KEY_LOG_DEFERRED, "true");
+	info = SPA_DICT_INIT(items, 2);
+	plugin = pwtest_spa_plugin_new();
+	iface = pwtest_spa_plugin_load_interface(plugin, "support/libspa-support",
+						 SPA_NAME_SUPPORT_LOG, SPA_TYPE_INTERFACE_Log,
+						 &info);
+	pwtest_ptr_notnull(iface);
+
+	spa_log_error(iface, "MARK1 %d %u %ld %zd %s %.*s %5.2f %p %%",
+			-1, 2u, 3l, (ssize_t)4, "five", 3, str, 6.0, (void*)0x7);
+	spa_log_warn(iface, "MARK2 %s", (char*)NULL);
+	/* not recorded, formatted by the caller */
+	spa_log_warn(iface, "MARK3 %2$s %1$s", "b", "a");
+
+	/* clearing the handle flushes the messages */
+	pwtest_spa_plugin_destroy(plugin);
+
+	fp = fopen(fname, "re");
+	while (fgets(buffer, sizeof(buffer), fp) != NULL) {
+		if (strstr(buffer, "MARK1")) {
+			pwtest_ptr_notnull(strstr(buffer, "MARK1 -1 2 3 4 five abc  6.00 0x7 %\n"));
+			n_lines++;
+		}
+		if (strstr(buffer, "MARK2")) {
+			pwtest_ptr_notnull(strstr(buffer, "MARK2 (null)\n"));
+			n_lines++;
+		}
+		if (strstr(buffer, "MARK3")) {
+			pwtest_ptr_notnull(strstr(buffer, "MARK3 a b\n"));
+			n_lines++;
+		}
+	}
+	fclose(fp);
+
+	pwtest_int_eq(n_lines, 3);
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
 static void
 test_log_levels(enum spa_log_level level)
 {
@@ -613,6 +669,7 @@ PWTEST_SUITE(logger)
 {
 	pwtest_add(logger_truncate_long_lines, PWTEST_NOARG);
 	pwtest_add(logger_no_ansi, PWTEST_NOARG);
+	pwtest_add(logger_deferred, PWTEST_NOARG);
 	pwtest_add(logger_levels,
 		   PWTEST_ARG_RANGE, SPA_LOG_LEVEL_NONE, SPA_LOG_LEVEL_TRACE + 1,
 		   PWTEST_NOARG);
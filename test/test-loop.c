@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/eventfd.h>
 
 #include "pwtest.h"
@@ -435,6 +436,125 @@ PWTEST(cancel_thread_while_dispatching)
 	return PWTEST_PASS;
 }
 
+#define STRESS_THREADS	8
+#define STRESS_INVOKES	20000
+#define STRESS_LARGE	(64 * 1024)
+
+struct stress_data {
+	struct pw_loop *l;
+	uint32_t last[STRESS_THREADS];
+	uint32_t count;
+	uint32_t errors;
+	uint32_t failed;
+};
+
+struct stress_thread {
+	struct stress_data *data;
+	uint32_t id;
+	pthread_t thread;
+};
+
+struct stress_item {
+	uint32_t id;
+	uint32_t seq;
+	uint8_t pad[];
+};
+
+static int stress_invoke(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct stress_data *d = user_data;
+	const struct stress_item *item = data;
+
+	/* invokes from one thread are called in order */
+	if (size < sizeof(*item) || item->seq != d->last[item->id] + 1)
+		d->errors++;
+	d->last[item->id] = item->seq;
+	d->count++;
+	return item->seq;
+}
+
+static void *stress_thread(void *user_data)
+{
+	struct stress_thread *t = user_data;
+	struct stress_data *d = t->data;
+	struct stress_item *item;
+	uint32_t i;
+	size_t size;
+	int res;
+
+	item = calloc(1, sizeof(*item) + STRESS_LARGE);
+	item->id = t->id;
+
+	for (i = 1; i <= STRESS_INVOKES; i++) {
+		item->seq = i;
+		/* mostly small items, sometimes one that does not fit in the queue */
+		if (i % 997 == 0)
+			size = sizeof(*item) + STRESS_LARGE;
+		else
+			size = sizeof(*item) + (i % 64) * 8;
+
+		if (i % 1000 == 0) {
+			res = pw_loop_invoke(d->l, stress_invoke, 0, item, size, true, d);
+			if (res != (int)i)
+				__atomic_add_fetch(&d->failed, 1, __ATOMIC_SEQ_CST);
+		} else {
+			res = pw_loop_invoke(d->l, stress_invoke, 0, item, size, false, d);
+			if (res < 0)
+				__atomic_add_fetch(&d->failed, 1, __ATOMIC_SEQ_CST);
+		}
+	}
+	free(item);
+	return NULL;
+}
+
+static int stress_check(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	return 0;
+}
+
+PWTEST(invoke_stress)
+{
+	struct stress_data data;
+	struct stress_thread threads[STRESS_THREADS];
+	struct pw_data_loop *dl;
+	uint32_t i;
+
+	pw_init(NULL, NULL);
+
+	spa_zero(data);
+	dl = pw_data_loop_new(NULL);
+	pwtest_ptr_notnull(dl);
+	data.l = pw_data_loop_get_loop(dl);
+	pwtest_neg_errno_ok(pw_data_loop_start(dl));
+
+	for (i = 0; i < STRESS_THREADS; i++) {
+		threads[i].data = &data;
+		threads[i].id = i;
+		pwtest_int_eq(pthread_create(&threads[i].thread, NULL,
+					stress_thread, &threads[i]), 0);
+	}
+	for (i = 0; i < STRESS_THREADS; i++)
+		pthread_join(threads[i].thread, NULL);
+
+	/* all invokes of the threads are older than this one */
+	pw_loop_invoke(data.l, stress_check, 0, NULL, 0, true, &data);
+
+	pwtest_int_eq(data.failed, 0u);
+	pwtest_int_eq(data.errors, 0u);
+	pwtest_int_eq(data.count, (uint32_t)(STRESS_THREADS * STRESS_INVOKES));
+	for (i = 0; i < STRESS_THREADS; i++)
+		pwtest_int_eq(data.last[i], (uint32_t)STRESS_INVOKES);
+
+	pwtest_neg_errno_ok(pw_data_loop_stop(dl));
+	pw_data_loop_destroy(dl);
+
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(support)
 {
 	pwtest_add(pwtest_loop_destroy2, PWTEST_NOARG);
@@ -443,6 +563,7 @@ PWTEST_SUITE(support)
 	pwtest_add(destroy_managed_source_before_dispatch, PWTEST_NOARG);
 	pwtest_add(destroy_managed_source_before_dispatch_recurse, PWTEST_NOARG);
 	pwtest_add(cancel_thread_while_dispatching, PWTEST_NOARG);
+	pwtest_add(invoke_stress, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }
@@ -0,0 +1,278 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include "pwtest.h"
+
+#include <spa/buffer/buffer.h>
+
+#include "pipewire/pipewire.h"
+#include "pipewire/mem.h"
+
+#define SLAB_FLAGS	(PW_MEMBLOCK_FLAG_READWRITE | PW_MEMBLOCK_FLAG_SEAL)
+
+PWTEST(memslab_alloc_free)
+{
+	struct pw_mempool *pool;
+	struct pw_memslab *slab;
+	struct pw_memblock *b[5];
+	uint32_t offs[5], i;
+
+	pw_init(0, NULL);
+
+	pool = pw_mempool_new(NULL);
+	pwtest_ptr_notnull(pool);
+
+	/* records are rounded up to a cache line */
+	slab = pw_memslab_new(pool, SLAB_FLAGS, SPA_DATA_MemFd, 100, 4);
+	pwtest_ptr_notnull(slab);
+
+	for (i = 0; i < 4; i++) {
+		b[i] = pw_memslab_alloc(slab, &offs[i]);
+		pwtest_ptr_notnull(b[i]);
+		pwtest_ptr_notnull(b[i]->map);
+		pwtest_int_eq(offs[i] % 64, 0u);
+		pwtest_int_eq(offs[i], i * 128u);
+		pwtest_bool_true(SPA_FLAG_IS_SET(b[i]->flags, PW_MEMBLOCK_FLAG_SLAB));
+		/* all the records of a block share its fd */
+		pwtest_ptr_eq(b[i], b[0]);
+	}
+	/* one ref for the slab and one for each record */
+	pwtest_int_eq(b[0]->ref, 5);
+
+	/* the block is full, the next record is in a new block */
+	b[4] = pw_memslab_alloc(slab, &offs[4]);
+	pwtest_ptr_notnull(b[4]);
+	pwtest_ptr_ne(b[4], b[0]);
+	pwtest_int_eq(offs[4], 0u);
+	pwtest_int_eq(b[4]->ref, 2);
+
+	for (i = 0; i < 5; i++)
+		pw_memslab_free(slab, b[i], offs[i]);
+	pwtest_int_eq(b[0]->ref, 1);
+	pwtest_int_eq(b[4]->ref, 1);
+
+	pw_memslab_destroy(slab);
+	pw_mempool_destroy(pool);
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
+PWTEST(memslab_reuse)
+{
+	struct pw_mempool *pool;
+	struct pw_memslab *slab;
+	struct pw_memblock *b[3], *r;
+	uint32_t offs[3], o, i;
+	uint8_t *p;
+
+	pw_init(0, NULL);
+
+	pool = pw_mempool_new(NULL);
+	pwtest_ptr_notnull(pool);
+	slab = pw_memslab_new(pool, SLAB_FLAGS, SPA_DATA_MemFd, 64, 3);
+	pwtest_ptr_notnull(slab);
+
+	for (i = 0; i < 3; i++) {
+		b[i] = pw_memslab_alloc(slab, &offs[i]);
+		pwtest_ptr_notnull(b[i]);
+		memset(SPA_PTROFF(b[i]->map->ptr, offs[i], void), 0xa5, 64);
+	}
+
+	/* a freed slot is handed out again, zeroed, before a new block is made */
+	pw_memslab_free(slab, b[1], offs[1]);
+	r = pw_memslab_alloc(slab, &o);
+	pwtest_ptr_eq(r, b[1]);
+	pwtest_int_eq(o, offs[1]);
+	p = SPA_PTROFF(r->map->ptr, o, uint8_t);
+	for (i = 0; i < 64; i++)
+		pwtest_int_eq(p[i], 0);
+
+	/* the neighbours are not touched */
+	p = SPA_PTROFF(b[0]->map->ptr, offs[0], uint8_t);
+	pwtest_int_eq(p[63], 0xa5);
+	p = SPA_PTROFF(b[2]->map->ptr, offs[2], uint8_t);
+	pwtest_int_eq(p[0], 0xa5);
+
+	/* an empty block is kept and reused */
+	for (i = 0; i < 3; i++)
+		pw_memslab_free(slab, b[i], offs[i]);
+	r = pw_memslab_alloc(slab, &o);
+	pwtest_ptr_eq(r, b[0]);
+	pwtest_int_eq(o, 0u);
+	pw_memslab_free(slab, r, o);
+
+	/* freeing twice is ignored */
+	pw_memslab_free(slab, r, o);
+	pwtest_int_eq(r->ref, 1);
+
+	pw_memslab_destroy(slab);
+	pw_mempool_destroy(pool);
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
+static struct pw_mempool *cache_pool_new(size_t cache_size)
+{
+	struct pw_properties *props;
+
+	props = pw_properties_new(NULL, NULL);
+	pw_properties_setf(props, "mem.cache-size", "%zu", cache_size);
+	return pw_mempool_new(props);
+}
+
+PWTEST(mempool_cache_reuse)
+{
+	struct pw_mempool *pool;
+	struct pw_memblock *m, *r;
+	struct pw_mempool_stats stats;
+	long pagesize = sysconf(_SC_PAGESIZE);
+	int a, b, c;
+	const void *owner[2] = { &a, &b }, *other[2] = { &a, &c };
+	int fd;
+
+	pw_init(0, NULL);
+
+	pool = cache_pool_new(4 * pagesize);
+	pwtest_ptr_notnull(pool);
+
+	/* the size is rounded up to a size class */
+	m = pw_mempool_alloc_cached(pool, SLAB_FLAGS | PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, 100, owner);
+	pwtest_ptr_notnull(m);
+	pwtest_int_eq(m->size, (uint32_t)pagesize);
+	pwtest_bool_true(SPA_FLAG_IS_SET(m->flags, PW_MEMBLOCK_FLAG_RECYCLE));
+	fd = m->fd;
+
+	/* freeing the block keeps it in the cache */
+	pw_memblock_unref(m);
+	pw_mempool_get_stats(pool, &stats);
+	pwtest_int_eq(stats.n_cached, 1u);
+	pwtest_int_eq(stats.cached_size, (uint64_t)pagesize);
+
+	/* other owners don't get the block */
+	r = pw_mempool_alloc_cached(pool, SLAB_FLAGS | PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, 100, other);
+	pwtest_ptr_notnull(r);
+	pwtest_int_ne(r->fd, fd);
+	pw_memblock_unref(r);
+
+	/* the same owners, flags and size class get it back */
+	r = pw_mempool_alloc_cached(pool, SLAB_FLAGS | PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, 200, owner);
+	pwtest_ptr_eq(r, m);
+	pwtest_int_eq(r->fd, fd);
+	pwtest_int_eq(r->ref, 1);
+	pwtest_int_ne(r->id, SPA_ID_INVALID);
+	pwtest_ptr_eq(pw_mempool_find_id(pool, r->id), r);
+
+	pw_mempool_get_stats(pool, &stats);
+	pwtest_int_eq(stats.n_alloc, 3u);
+	pwtest_int_eq(stats.n_reused, 1u);
+	pwtest_int_eq(stats.n_cached, 1u);
+
+	pw_memblock_unref(r);
+	pw_mempool_destroy(pool);
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
+PWTEST(mempool_cache_evict)
+{
+	struct pw_mempool *pool;
+	struct pw_memblock *m[3];
+	struct pw_mempool_stats stats;
+	long pagesize = sysconf(_SC_PAGESIZE);
+	int a, b;
+	const void *owner[2] = { &a, &b };
+	uint32_t i;
+
+	pw_init(0, NULL);
+
+	pool = cache_pool_new(2 * pagesize);
+	pwtest_ptr_notnull(pool);
+
+	for (i = 0; i < 3; i++) {
+		m[i] = pw_mempool_alloc_cached(pool, SLAB_FLAGS | PW_MEMBLOCK_FLAG_MAP,
+				SPA_DATA_MemFd, pagesize, owner);
+		pwtest_ptr_notnull(m[i]);
+	}
+	/* the cache holds 2 pages, the oldest block is evicted */
+	for (i = 0; i < 3; i++)
+		pw_memblock_unref(m[i]);
+
+	pw_mempool_get_stats(pool, &stats);
+	pwtest_int_eq(stats.n_cached, 2u);
+	pwtest_int_eq(stats.n_evicted, 1u);
+	pwtest_int_eq(stats.cached_size, (uint64_t)(2 * pagesize));
+
+	/* blocks larger than the cache are not kept */
+	m[0] = pw_mempool_alloc_cached(pool, SLAB_FLAGS | PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, 3 * pagesize, owner);
+	pwtest_ptr_notnull(m[0]);
+	pw_memblock_unref(m[0]);
+	pw_mempool_get_stats(pool, &stats);
+	pwtest_int_eq(stats.n_cached, 2u);
+
+	/* flushing an owner frees its blocks */
+	pw_mempool_flush_cache(pool, &b);
+	pw_mempool_get_stats(pool, &stats);
+	pwtest_int_eq(stats.n_cached, 0u);
+	pwtest_int_eq(stats.cached_size, 0u);
+	pwtest_int_eq(stats.n_evicted, 3u);
+
+	pw_mempool_destroy(pool);
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
+PWTEST(mempool_cache_disabled)
+{
+	struct pw_mempool *pool;
+	struct pw_memblock *m;
+	struct pw_mempool_stats stats;
+	int a, b;
+	const void *owner[2] = { &a, &b };
+
+	pw_init(0, NULL);
+
+	pool = pw_mempool_new(NULL);
+	pwtest_ptr_notnull(pool);
+
+	/* without a cache size this is a plain allocation */
+	m = pw_mempool_alloc_cached(pool, SLAB_FLAGS | PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, 100, owner);
+	pwtest_ptr_notnull(m);
+	pwtest_int_eq(m->size, 100u);
+	pwtest_bool_false(SPA_FLAG_IS_SET(m->flags, PW_MEMBLOCK_FLAG_RECYCLE));
+	pw_memblock_unref(m);
+
+	pw_mempool_get_stats(pool, &stats);
+	pwtest_int_eq(stats.n_alloc, 0u);
+	pwtest_int_eq(stats.n_cached, 0u);
+
+	pw_mempool_destroy(pool);
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
+PWTEST_SUITE(mem)
+{
+	pwtest_add(memslab_alloc_free, PWTEST_NOARG);
+	pwtest_add(memslab_reuse, PWTEST_NOARG);
+	pwtest_add(mempool_cache_reuse, PWTEST_NOARG);
+	pwtest_add(mempool_cache_evict, PWTEST_NOARG);
+	pwtest_add(mempool_cache_disabled, PWTEST_NOARG);
+
+	return PWTEST_PASS;
+}
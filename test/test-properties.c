@@ -7,6 +7,7 @@
 
 #include "pwtest.h"
 
+#include "pipewire/keys.h"
 #include "pipewire/properties.h"
 
 PWTEST(properties_abi)
@@ -584,6 +585,72 @@ PWTEST(properties_update)
 	return PWTEST_PASS;
 }
 
+PWTEST(properties_many_keys)
+{
+	struct pw_properties *props, *copy;
+	char key[64], value[64];
+	int i;
+
+	/* enough keys to use the hash index */
+	props = pw_properties_new(NULL, NULL);
+	pwtest_ptr_notnull(props);
+
+	for (i = 0; i < 200; i++) {
+		snprintf(key, sizeof(key), "test.key.%d", i);
+		snprintf(value, sizeof(value), "%d", i);
+		pwtest_int_eq(pw_properties_set(props, key, value), 1);
+	}
+	pwtest_int_eq(pw_properties_set(props, PW_KEY_NODE_NAME, "node"), 1);
+	pwtest_int_eq(pw_properties_set(props, PW_KEY_MEDIA_CLASS, "Audio/Sink"), 1);
+	pwtest_int_eq(props->dict.n_items, 202U);
+
+	for (i = 0; i < 200; i += 2) {
+		snprintf(key, sizeof(key), "test.key.%d", i);
+		pwtest_int_eq(pw_properties_set(props, key, NULL), 1);
+	}
+	pwtest_int_eq(props->dict.n_items, 102U);
+
+	for (i = 0; i < 200; i++) {
+		snprintf(key, sizeof(key), "test.key.%d", i);
+		snprintf(value, sizeof(value), "%d", i);
+		if (i & 1)
+			pwtest_str_eq(pw_properties_get(props, key), value);
+		else
+			pwtest_ptr_null(pw_properties_get(props, key));
+	}
+	pwtest_str_eq(pw_properties_get(props, PW_KEY_NODE_NAME), "node");
+
+	/* reordering the items must not break the lookups */
+	spa_dict_qsort(&props->dict);
+	pwtest_str_eq(pw_properties_get(props, "test.key.101"), "101");
+	pwtest_str_eq(pw_properties_get(props, PW_KEY_MEDIA_CLASS), "Audio/Sink");
+	pwtest_int_eq(pw_properties_set(props, "test.key.101", "foo"), 1);
+	pwtest_str_eq(pw_properties_get(props, "test.key.101"), "foo");
+	pwtest_int_eq(pw_properties_set(props, "test.key.102", "bar"), 1);
+	pwtest_str_eq(pw_properties_get(props, "test.key.102"), "bar");
+	pwtest_int_eq(pw_properties_set(props, "test.key.103", NULL), 1);
+	pwtest_ptr_null(pw_properties_get(props, "test.key.103"));
+	pwtest_str_eq(pw_properties_get(props, "test.key.105"), "105");
+	pwtest_str_eq(pw_properties_get(props, PW_KEY_NODE_NAME), "node");
+
+	copy = pw_properties_copy(props);
+	pwtest_ptr_notnull(copy);
+	pwtest_int_eq(copy->dict.n_items, props->dict.n_items);
+	for (i = 0; i < (int)props->dict.n_items; i++) {
+		const struct spa_dict_item *it = &props->dict.items[i];
+		pwtest_str_eq(pw_properties_get(copy, it->key), it->value);
+	}
+
+	pw_properties_clear(props);
+	pwtest_int_eq(props->dict.n_items, 0U);
+	pwtest_ptr_null(pw_properties_get(props, "test.key.101"));
+
+	pw_properties_free(copy);
+	pw_properties_free(props);
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(properties)
 {
 	pwtest_add(properties_abi, PWTEST_NOARG);
@@ -603,6 +670,7 @@ PWTEST_SUITE(properties)
 	pwtest_add(properties_new_dict, PWTEST_NOARG);
 	pwtest_add(properties_new_json, PWTEST_NOARG);
 	pwtest_add(properties_update, PWTEST_NOARG);
+	pwtest_add(properties_many_keys, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }
@@ -2,11 +2,17 @@
 /* SPDX-FileCopyrightText: Copyright © 2021 Red Hat, Inc. */
 /* SPDX-License-Identifier: MIT */
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
 #include "pwtest.h"
 
 #include <spa/utils/names.h>
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
+#include <spa/support/system.h>
 
 PWTEST(pwtest_load_nonexisting)
 {
@@ -59,10 +65,271 @@ PWTEST(pwtest_load_plugin)
 	return PWTEST_PASS;
 }
 
+/* the uring system is only built with liburing and the kernel or a
+ * seccomp filter can refuse to make a ring, skip the tests then */
+static int uring_system_new(struct pwtest_spa_plugin *plugin,
+		struct spa_system **system, int *pfd)
+{
+	void *iface;
+	int res;
+
+	res = pwtest_spa_plugin_try_load_interface(plugin, &iface,
+					"support/libspa-uring",
+					SPA_NAME_SUPPORT_SYSTEM, SPA_TYPE_INTERFACE_System,
+					NULL);
+	if (res == -ENOENT)
+		return PWTEST_SKIP;
+	pwtest_neg_errno_ok(res);
+	*system = iface;
+
+	*pfd = spa_system_pollfd_create(*system, SPA_FD_CLOEXEC);
+	if (*pfd == -ENOSYS || *pfd == -EPERM)
+		return PWTEST_SKIP;
+	pwtest_neg_errno_ok(*pfd);
+
+	return PWTEST_PASS;
+}
+
+/* completions of cancels and updates can end a wait without events,
+ * wait until there are events or the timeout expired */
+static int uring_wait(struct spa_system *system, int pfd,
+		struct spa_poll_event *ev, int n_ev, int timeout)
+{
+	struct timespec now;
+	int64_t end;
+	int n;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	end = SPA_TIMESPEC_TO_NSEC(&now) + timeout * SPA_NSEC_PER_MSEC;
+	do {
+		if ((n = spa_system_pollfd_wait(system, pfd, ev, n_ev, timeout)) != 0)
+			break;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	} while (SPA_TIMESPEC_TO_NSEC(&now) < end);
+
+	return n;
+}
+
+PWTEST(uring_counters)
+{
+	struct pwtest_spa_plugin *plugin;
+	struct spa_system *system;
+	struct spa_poll_event ev[4];
+	struct itimerspec its;
+	uint64_t count;
+	int pfd, efd, tfd, res;
+
+	plugin = pwtest_spa_plugin_new();
+	if ((res = uring_system_new(plugin, &system, &pfd)) != PWTEST_PASS) {
+		pwtest_spa_plugin_destroy(plugin);
+		return res;
+	}
+
+	efd = spa_system_eventfd_create(system, SPA_FD_CLOEXEC | SPA_FD_NONBLOCK);
+	pwtest_neg_errno_ok(efd);
+	pwtest_neg_errno_ok(spa_system_pollfd_add(system, pfd, efd, SPA_IO_IN, &efd));
+
+	/* nothing happened yet */
+	pwtest_int_eq(spa_system_pollfd_wait(system, pfd, ev, 4, 0), 0);
+
+	/* writes before the wait are summed up in one value */
+	pwtest_neg_errno_ok(spa_system_eventfd_write(system, efd, 1));
+	pwtest_neg_errno_ok(spa_system_eventfd_write(system, efd, 2));
+	pwtest_int_eq(uring_wait(system, pfd, ev, 4, 1000), 1);
+	pwtest_ptr_eq(ev[0].data, &efd);
+	pwtest_bool_true(SPA_FLAG_IS_SET(ev[0].events, SPA_IO_IN));
+	pwtest_neg_errno_ok(spa_system_eventfd_read(system, efd, &count));
+	pwtest_int_eq(count, 3u);
+
+	/* the value is consumed only once */
+	pwtest_neg_errno(spa_system_eventfd_read(system, efd, &count), -EAGAIN);
+	pwtest_int_eq(spa_system_pollfd_wait(system, pfd, ev, 4, 0), 0);
+
+	/* and the fd is read again after it was consumed */
+	pwtest_neg_errno_ok(spa_system_eventfd_write(system, efd, 5));
+	pwtest_int_eq(uring_wait(system, pfd, ev, 4, 1000), 1);
+	pwtest_ptr_eq(ev[0].data, &efd);
+	pwtest_neg_errno_ok(spa_system_eventfd_read(system, efd, &count));
+	pwtest_int_eq(count, 5u);
+
+	/* a value that is not consumed keeps the fd ready */
+	pwtest_neg_errno_ok(spa_system_eventfd_write(system, efd, 1));
+	pwtest_int_eq(uring_wait(system, pfd, ev, 4, 1000), 1);
+	pwtest_int_eq(spa_system_pollfd_wait(system, pfd, ev, 4, 0), 1);
+	pwtest_ptr_eq(ev[0].data, &efd);
+	pwtest_neg_errno_ok(spa_system_eventfd_read(system, efd, &count));
+	pwtest_int_eq(count, 1u);
+
+	tfd = spa_system_timerfd_create(system, CLOCK_MONOTONIC,
+			SPA_FD_CLOEXEC | SPA_FD_NONBLOCK);
+	pwtest_neg_errno_ok(tfd);
+	pwtest_neg_errno_ok(spa_system_pollfd_add(system, pfd, tfd, SPA_IO_IN, &tfd));
+
+	spa_zero(its);
+	its.it_value.tv_nsec = 1 * SPA_NSEC_PER_MSEC;
+	pwtest_neg_errno_ok(spa_system_timerfd_settime(system, tfd, 0, &its, NULL));
+	pwtest_int_eq(uring_wait(system, pfd, ev, 4, 1000), 1);
+	pwtest_ptr_eq(ev[0].data, &tfd);
+	pwtest_neg_errno_ok(spa_system_timerfd_read(system, tfd, &count));
+	pwtest_int_eq(count, 1u);
+	pwtest_neg_errno(spa_system_timerfd_read(system, tfd, &count), -EAGAIN);
+
+	/* expirations of the old setting are forgotten when the timer is set */
+	pwtest_neg_errno_ok(spa_system_timerfd_settime(system, tfd, 0, &its, NULL));
+	pwtest_int_eq(uring_wait(system, pfd, ev, 4, 1000), 1);
+	spa_zero(its);
+	pwtest_neg_errno_ok(spa_system_timerfd_settime(system, tfd, 0, &its, NULL));
+	pwtest_neg_errno(spa_system_timerfd_read(system, tfd, &count), -EAGAIN);
+
+	pwtest_neg_errno_ok(spa_system_pollfd_del(system, pfd, tfd));
+	pwtest_neg_errno_ok(spa_system_pollfd_del(system, pfd, efd));
+	pwtest_neg_errno_ok(spa_system_close(system, tfd));
+	pwtest_neg_errno_ok(spa_system_close(system, efd));
+	pwtest_neg_errno_ok(spa_system_close(system, pfd));
+
+	pwtest_spa_plugin_destroy(plugin);
+
+	return PWTEST_PASS;
+}
+
+PWTEST(uring_mod_del_inflight)
+{
+	struct pwtest_spa_plugin *plugin;
+	struct spa_system *system;
+	struct spa_poll_event ev[4];
+	int pfd, fds[2], res, a, b;
+	char c = 0;
+
+	plugin = pwtest_spa_plugin_new();
+	if ((res = uring_system_new(plugin, &system, &pfd)) != PWTEST_PASS) {
+		pwtest_spa_plugin_destroy(plugin);
+		return res;
+	}
+	pwtest_errno_ok(pipe2(fds, O_CLOEXEC | O_NONBLOCK));
+
+	/* submit a poll on the empty pipe, it stays in flight */
+	pwtest_neg_errno_ok(spa_system_pollfd_add(system, pfd, fds[0], SPA_IO_IN, &a));
+	pwtest_int_eq(spa_system_pollfd_wait(system, pfd, ev, 4, 0), 0);
+
+	/* modify the events and data of the poll in flight */
+	pwtest_neg_errno_ok(spa_system_pollfd_mod(system, pfd, fds[0], SPA_IO_IN | SPA_IO_HUP, &b));
+	pwtest_int_eq(spa_system_pollfd_wait(system, pfd, ev, 4, 0), 0);
+	pwtest_int_eq(write(fds[1], &c, 1), 1);
+	pwtest_int_eq(uring_wait(system, pfd, ev, 4, 1000), 1);
+	pwtest_ptr_eq(ev[0].data, &b);
+	pwtest_bool_true(SPA_FLAG_IS_SET(ev[0].events, SPA_IO_IN));
+	pwtest_int_eq(read(fds[0], &c, 1), 1);
+
+	/* the oneshot poll is armed again */
+	pwtest_int_eq(spa_system_pollfd_wait(system, pfd, ev, 4, 0), 0);
+
+	/* remove the poll in flight and add the fd again right away, only
+	 * the new registration reports events */
+	pwtest_neg_errno_ok(spa_system_pollfd_del(system, pfd, fds[0]));
+	pwtest_neg_errno(spa_system_pollfd_del(system, pfd, fds[0]), -ENOENT);
+	pwtest_neg_errno_ok(spa_system_pollfd_add(system, pfd, fds[0], SPA_IO_IN, &a));
+	pwtest_int_eq(write(fds[1], &c, 1), 1);
+	pwtest_int_eq(uring_wait(system, pfd, ev, 4, 1000), 1);
+	pwtest_ptr_eq(ev[0].data, &a);
+	pwtest_int_eq(read(fds[0], &c, 1), 1);
+
+	/* a removed fd reports nothing */
+	pwtest_int_eq(spa_system_pollfd_wait(system, pfd, ev, 4, 0), 0);
+	pwtest_neg_errno_ok(spa_system_pollfd_del(system, pfd, fds[0]));
+	pwtest_int_eq(write(fds[1], &c, 1), 1);
+	pwtest_int_eq(uring_wait(system, pfd, ev, 4, 10), 0);
+
+	/* closing the ring frees the cancelled entries */
+	pwtest_neg_errno_ok(spa_system_close(system, pfd));
+	close(fds[0]);
+	close(fds[1]);
+
+	pwtest_spa_plugin_destroy(plugin);
+
+	return PWTEST_PASS;
+}
+
+struct uring_waiter {
+	struct spa_system *system;
+	int pfd;
+	int n_events;
+	void *data;
+};
+
+static void *uring_wait_thread(void *user_data)
+{
+	struct uring_waiter *w = user_data;
+	struct spa_poll_event ev[4];
+	int i, n;
+
+	/* the kick wakes up the wait without events, go back to waiting
+	 * until the new fd is ready */
+	for (i = 0; i < 10 && w->n_events == 0; i++) {
+		n = spa_system_pollfd_wait(w->system, w->pfd, ev, 4, 5000);
+		if (n > 0) {
+			w->n_events = n;
+			w->data = ev[0].data;
+		}
+	}
+	return NULL;
+}
+
+PWTEST(uring_kick)
+{
+	struct pwtest_spa_plugin *plugin;
+	struct spa_system *system;
+	struct uring_waiter w = { 0, };
+	struct timespec t0, t1;
+	pthread_t thread;
+	int pfd, fds[2], res;
+	int64_t elapsed;
+	char c = 0;
+
+	plugin = pwtest_spa_plugin_new();
+	if ((res = uring_system_new(plugin, &system, &pfd)) != PWTEST_PASS) {
+		pwtest_spa_plugin_destroy(plugin);
+		return res;
+	}
+	pwtest_errno_ok(pipe2(fds, O_CLOEXEC | O_NONBLOCK));
+
+	w.system = system;
+	w.pfd = pfd;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	pwtest_int_eq(pthread_create(&thread, NULL, uring_wait_thread, &w), 0);
+
+	/* give the thread time to block in the ring, then add a ready fd
+	 * from here. Without a kick, the wait would only see it after
+	 * its timeout. */
+	usleep(100 * SPA_USEC_PER_MSEC);
+	pwtest_int_eq(write(fds[1], &c, 1), 1);
+	pwtest_neg_errno_ok(spa_system_pollfd_add(system, pfd, fds[0], SPA_IO_IN, &w));
+
+	pthread_join(thread, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	elapsed = SPA_TIMESPEC_TO_NSEC(&t1) - SPA_TIMESPEC_TO_NSEC(&t0);
+
+	pwtest_int_eq(w.n_events, 1);
+	pwtest_ptr_eq(w.data, &w);
+	pwtest_int_lt(elapsed, 4000 * SPA_NSEC_PER_MSEC);
+
+	pwtest_neg_errno_ok(spa_system_pollfd_del(system, pfd, fds[0]));
+	pwtest_neg_errno_ok(spa_system_close(system, pfd));
+	close(fds[0]);
+	close(fds[1]);
+
+	pwtest_spa_plugin_destroy(plugin);
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(support)
 {
 	pwtest_add(pwtest_load_nonexisting, PWTEST_NOARG);
 	pwtest_add(pwtest_load_plugin, PWTEST_NOARG);
+	pwtest_add(uring_counters, PWTEST_NOARG);
+	pwtest_add(uring_mod_del_inflight, PWTEST_NOARG);
+	pwtest_add(uring_kick, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }